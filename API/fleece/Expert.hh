@@ -86,6 +86,27 @@ namespace fleece {
         static inline bool apply(Value old,
                                  slice jsonDelta,
                                  Encoder &encoder);
+        /// Combines two deltas into one; see `FLComposeJSONDeltas`.
+        [[nodiscard]] static inline alloc_slice compose(slice jsonDelta1,
+                                                        slice jsonDelta2,
+                                                        FLError* FL_NULLABLE error);
+    };
+
+
+    /** Generates and applies Fleece-format deltas between two Fleece values. These work like
+        JSONDelta's, but are usually smaller and are much faster to apply. */
+    class FleeceDelta {
+    public:
+        static inline alloc_slice create(Value old, Value nuu);
+
+        [[nodiscard]] static inline alloc_slice apply(Value old,
+                                                      slice fleeceDelta,
+                                                      FLError* FL_NULLABLE error);
+        /// Writes patched Fleece to the Encoder.
+        /// On failure, returns false and sets the Encoder's error property.
+        static inline bool apply(Value old,
+                                 slice fleeceDelta,
+                                 Encoder &encoder);
     };
 
 
@@ -178,6 +199,25 @@ namespace fleece {
     {
         return FLEncodeApplyingJSONDelta(old, jsonDelta, encoder);
     }
+    inline alloc_slice JSONDelta::compose(slice jsonDelta1,
+                                          slice jsonDelta2,
+                                          FLError * FL_NULLABLE error)
+    {
+        return FLComposeJSONDeltas(jsonDelta1, jsonDelta2, error);
+    }
+
+    inline alloc_slice FleeceDelta::create(Value old, Value nuu) {
+        return FLCreateFleeceDelta(old, nuu);
+    }
+    inline alloc_slice FleeceDelta::apply(Value old, slice fleeceDelta, FLError * FL_NULLABLE error) {
+        return FLApplyFleeceDelta(old, fleeceDelta, error);
+    }
+    inline bool FleeceDelta::apply(Value old,
+                                   slice fleeceDelta,
+                                   Encoder &encoder)
+    {
+        return FLEncodeApplyingFleeceDelta(old, fleeceDelta, encoder);
+    }
 
     inline void SharedKeys::writeState(const Encoder &enc) {
         FLSharedKeys_WriteState(_sk, enc);
@@ -0,0 +1,124 @@
+//
+// FLArrow.h
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#ifndef _FLARROW_H
+#define _FLARROW_H
+
+#include "FLKeyPath.h"
+#include <stdint.h>
+
+FL_ASSUME_NONNULL_BEGIN
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // This is the C API! For the C++ API, see Fleece.hh.
+
+
+    /** \defgroup FLArrow   Apache Arrow Export
+        @{
+     Converts an array of dictionaries (like a JSON table of records) into columns in the memory
+     layout of Apache Arrow, so they can be scanned or handed to Arrow-based libraries without
+     reading Fleece values row by row.
+
+     The columns are returned through the Arrow C Data Interface, a stable ABI consisting of the
+     two structs below: <https://arrow.apache.org/docs/format/CDataInterface.html>.
+     No Arrow library is needed.
+     */
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+    /** Describes the type of an ArrowArray (Arrow C Data Interface.) */
+    struct ArrowSchema {
+        // Array type description
+        const char* format;
+        const char* FL_NULLABLE name;
+        const char* FL_NULLABLE metadata;
+        int64_t flags;
+        int64_t n_children;
+        struct ArrowSchema* FL_NULLABLE * FL_NULLABLE children;
+        struct ArrowSchema* FL_NULLABLE dictionary;
+
+        // Release callback
+        void (* FL_NULLABLE release)(struct ArrowSchema*);
+        // Opaque producer-specific data
+        void* FL_NULLABLE private_data;
+    };
+
+    /** Column data (Arrow C Data Interface.) */
+    struct ArrowArray {
+        // Array data description
+        int64_t length;
+        int64_t null_count;
+        int64_t offset;
+        int64_t n_buffers;
+        int64_t n_children;
+        const void* FL_NULLABLE * FL_NULLABLE buffers;
+        struct ArrowArray* FL_NULLABLE * FL_NULLABLE children;
+        struct ArrowArray* FL_NULLABLE dictionary;
+
+        // Release callback
+        void (* FL_NULLABLE release)(struct ArrowArray*);
+        // Opaque producer-specific data
+        void* FL_NULLABLE private_data;
+    };
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+
+    /** Exports values from each item of `rows` as an Arrow struct array, with one child column
+        per key-path. The key-paths are evaluated relative to each row (typically a Dict), and
+        must be literal: no wildcards, slices or descendants.
+
+        A column's type depends on the values found in it; a missing or `null` value is an Arrow
+        null in any column.
+        - Booleans: `b` (boolean.)
+        - Integers: `l` (int64.)
+        - Numbers, if any aren't integers or don't fit in an int64: `g` (float64.)
+        - Strings: `u` (UTF-8.)
+        - Data: `z` (binary.)
+        - No values at all: `n` (null.)
+        - Anything else (mixed types, arrays or dicts): `u`, containing each value as JSON, with
+          the `arrow.json` extension type.
+
+        Each child schema's name is its key-path in string form. On success, the caller owns
+        `outSchema` and `outArray` and must call their `release` callbacks.
+        @param rows  The array of rows.
+        @param paths  The key-paths of the columns.
+        @param nPaths  The number of key-paths.
+        @param outSchema  On success, the schema (type) of the exported struct array.
+        @param outArray  On success, the exported struct array.
+        @param outError  On failure, the error code is stored here.
+        @returns  True on success, false on failure. */
+    NODISCARD FLEECE_PUBLIC bool FLArray_ExportArrow(FLArray FL_NULLABLE rows,
+                                                     const FLKeyPath paths[],
+                                                     size_t nPaths,
+                                                     struct ArrowSchema *outSchema,
+                                                     struct ArrowArray *outArray,
+                                                     FLError* FL_NULLABLE outError) FLAPI;
+
+    /** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+FL_ASSUME_NONNULL_END
+
+#endif // _FLARROW_H
@@ -59,10 +59,24 @@ extern "C" {
     /** Returns the FLSharedKeys used by this FLDoc, as specified when it was created. */
     FLEECE_PUBLIC FLSharedKeys FLDoc_GetSharedKeys(FLDoc FL_NULLABLE) FLAPI FLPURE;
 
+    /** Returns the number of bytes of memory the document keeps alive: the sizes of the allocated
+        blocks its data and its parent documents' data are part of (which may be shared with other
+        documents.) Memory it doesn't own isn't counted, including the base document that an
+        amended document's external pointers refer to, since the document doesn't keep that
+        alive. */
+    FLEECE_PUBLIC size_t FLDoc_GetRetainedBytes(FLDoc FL_NULLABLE) FLAPI FLPURE;
+
     /** Looks up the Doc containing the Value, or NULL if there is none.
         @note Caller must release the FLDoc reference!! */
     NODISCARD FLEECE_PUBLIC FLDoc FL_NULLABLE FLValue_FindDoc(FLValue FL_NULLABLE) FLAPI FLPURE;
 
+    /** Creates a new FLDoc holding a copy of a Value and its descendants, in memory of its own,
+        with the same FLSharedKeys. Retaining a Value keeps its entire document's data in memory;
+        retaining the extracted copy keeps only what the copy needs.
+        @note Caller must release the FLDoc reference!! */
+    NODISCARD FLEECE_PUBLIC FLDoc FL_NULLABLE FLValue_ExtractDoc(FLValue FL_NULLABLE,
+                                                                 FLError* FL_NULLABLE outError) FLAPI;
+
     /** Associates an arbitrary pointer value with a document, and thus its contained values.
         Allows client code to associate its own pointer with this FLDoc and its Values,
         which can later be retrieved with \ref FLDoc_GetAssociated.
@@ -41,7 +41,8 @@ extern "C" {
     /** \name  Delta Compression
      @{
         These functions implement a fairly-efficient "delta" encoding that encapsulates the changes
-        needed to transform one Fleece value into another. The delta is expressed in JSON form.
+        needed to transform one Fleece value into another. The delta is expressed in JSON form,
+        or (with the `FleeceDelta` functions) as Fleece.
 
         A delta can be stored or transmitted
         as an efficient way to produce the second value, when the first is already present. Deltas
@@ -93,6 +94,75 @@ extern "C" {
     FLEECE_PUBLIC bool FLEncodeApplyingJSONDelta(FLValue FL_NULLABLE old,
                                    FLSlice jsonDelta,
                                    FLEncoder encoder) FLAPI;
+
+    /** Applies the JSON data created by `CreateJSONDelta` to a mutable dict, in place, instead of
+        encoding a new document. Only the values the delta changes are touched, and nested
+        collections are made mutable only if the delta changes them, so this is much faster
+        than `FLApplyJSONDelta` for a small change to a large dict that's already mutable.
+        @param dict  A mutable dict equal to the `old` value used when creating the `jsonDelta`.
+        @param jsonDelta  A JSON-encoded delta created by `FLCreateJSONDelta` or `FLEncodeJSONDelta`.
+        @param outError  On failure, error information will be stored where this points, if non-null.
+        @return  True on success, false if an error occurred; in that case the dict may have been
+                    partly modified. */
+    FLEECE_PUBLIC bool FLMutableDict_ApplyJSONDelta(FLMutableDict dict,
+                                      FLSlice jsonDelta,
+                                      FLError* FL_NULLABLE outError) FLAPI;
+
+    /** Applies the JSON data created by `CreateJSONDelta` to a mutable array, in place.
+        See `FLMutableDict_ApplyJSONDelta`. */
+    FLEECE_PUBLIC bool FLMutableArray_ApplyJSONDelta(FLMutableArray array,
+                                       FLSlice jsonDelta,
+                                       FLError* FL_NULLABLE outError) FLAPI;
+
+    /** Combines two JSON deltas into one: if `jsonDelta1` changes a value A into B, and
+        `jsonDelta2` changes B into C, the result changes A into C. This doesn't need any of the
+        values, so a chain of deltas can be collapsed into one and applied in a single pass.
+        @param jsonDelta1  A JSON-encoded delta created by `FLCreateJSONDelta` or `FLEncodeJSONDelta`.
+        @param jsonDelta2  A delta from the value produced by applying `jsonDelta1`.
+        @param outError  On failure, error information will be stored where this points, if non-null.
+        @return  The combined JSON delta, or null if an error occurred. If the deltas are valid but
+                    can't be combined (which happens when `jsonDelta2` copies an array item that
+                    `jsonDelta1` modified), returns null and sets `*outError` to `kFLNoError`;
+                    in that case apply the deltas one at a time. */
+    NODISCARD FLEECE_PUBLIC FLSliceResult FLComposeJSONDeltas(FLSlice jsonDelta1,
+                                      FLSlice jsonDelta2,
+                                      FLError* FL_NULLABLE outError) FLAPI;
+
+    /** Returns Fleece data that encodes the changes to turn the value `old` into `nuu`.
+        This is an alternative to `FLCreateJSONDelta` whose deltas are usually smaller, and much
+        faster to apply since they don't need to be parsed.
+        (The format is documented in Deltas.md, but you should treat it as a black box.)
+        @param old  A value that's typically the old/original state of some data.
+        @param nuu  A value that's typically the new/changed state of the `old` data.
+        @return  Fleece data representing the changes from `old` to `nuu`, or NULL on
+                    (extremely unlikely) failure. */
+    NODISCARD FLEECE_PUBLIC FLSliceResult FLCreateFleeceDelta(FLValue FL_NULLABLE old,
+                                      FLValue FL_NULLABLE nuu) FLAPI;
+
+    /** Applies the Fleece data created by `FLCreateFleeceDelta` to the value `old`, which must be
+        equal to the `old` value originally passed to `FLCreateFleeceDelta`, and returns a Fleece
+        document equal to the original `nuu` value.
+        @param old  A value that's typically the old/original state of some data. This must be
+                    equal to the `old` value used when creating the `fleeceDelta`.
+        @param fleeceDelta  A delta created by `FLCreateFleeceDelta`.
+        @param outError  On failure, error information will be stored where this points, if non-null.
+        @return  The corresponding `nuu` value, encoded as Fleece, or null if an error occurred. */
+    NODISCARD FLEECE_PUBLIC FLSliceResult FLApplyFleeceDelta(FLValue FL_NULLABLE old,
+                                     FLSlice fleeceDelta,
+                                     FLError* FL_NULLABLE outError) FLAPI;
+
+    /** Applies the Fleece data created by `FLCreateFleeceDelta` to the value `old`, which must be
+        equal to the `old` value originally passed to `FLCreateFleeceDelta`, and writes the
+        corresponding `nuu` value to the encoder.
+        @param old  A value that's typically the old/original state of some data. This must be
+                    equal to the `old` value used when creating the `fleeceDelta`.
+        @param fleeceDelta  A delta created by `FLCreateFleeceDelta`.
+        @param encoder  A Fleece encoder to write the decoded `nuu` value to. (JSON encoding is not
+                    supported.)
+        @return  True on success, false on error; call `FLEncoder_GetError` for details. */
+    FLEECE_PUBLIC bool FLEncodeApplyingFleeceDelta(FLValue FL_NULLABLE old,
+                                     FLSlice fleeceDelta,
+                                     FLEncoder encoder) FLAPI;
     /** @} */
 
 
@@ -38,10 +38,17 @@ extern "C" {
      A leading JSONPath-like `$.` is allowed but ignored.
 
      A '\' can be used to escape a special character ('.', '[' or '$').
+
+     A path may also have JSONPath-like elements that match multiple values: `[*]` or `.*` for
+     every item of an array or value of a dictionary, `[start:end]` for a slice of an array
+     (negative bounds count from the end), and `..` for a value and all its descendants, as in
+     `orders[*].items[*].sku`, `events[-10:]` or `..sku`. Use FLKeyPath_ForEachMatch to get
+     all the matches of such a path; FLKeyPath_Eval returns only the first.
      */
 
 #ifndef FL_IMPL
     typedef struct _FLKeyPath*     FLKeyPath;       ///< A reference to a key path.
+    typedef struct _FLProjection*  FLProjection;    ///< A reference to a set of key paths.
 #endif
 
     /** Creates a new FLKeyPath object by compiling a path specifier string. */
@@ -55,6 +62,18 @@ extern "C" {
     NODISCARD FLEECE_PUBLIC FLValue FL_NULLABLE FLKeyPath_Eval(FLKeyPath,
                                                                FLValue root) FLAPI;
 
+    /** Callback for FLKeyPath_ForEachMatch; returns false to stop the iteration. */
+    typedef bool (*FLKeyPathMatchCallback)(void* FL_NULLABLE context, FLValue value);
+
+    /** Evaluates a key-path for a given Fleece root object, calling the callback with each
+        value the path matches, in document order. The matches are found as the tree is walked;
+        nothing is allocated.
+        @returns  False if the callback stopped the iteration, else true. */
+    FLEECE_PUBLIC bool FLKeyPath_ForEachMatch(FLKeyPath,
+                                              FLValue FL_NULLABLE root,
+                                              FLKeyPathMatchCallback callback,
+                                              void* FL_NULLABLE context) FLAPI;
+
     /** Evaluates a key-path from a specifier string, for a given Fleece root object.
         If you only need to evaluate the path once, this is a bit faster than creating an
         FLKeyPath object, evaluating, then freeing it. */
@@ -77,7 +96,8 @@ extern "C" {
                            if this component is an array index.
         @param outArrayIndex  On return this will be the array index,
                               or 0 if this component is a property.
-        @returns  True on success, false if there is no such component. */
+        @returns  True on success, false if there is no such component, or it's a wildcard,
+                  slice or descendants component. */
     FLEECE_PUBLIC bool FLKeyPath_GetElement(FLKeyPath path,
                                             size_t i,
                                             FLSlice *outDictKey,
@@ -99,6 +119,81 @@ extern "C" {
     /** Removes the first `n` components. */
     FLEECE_PUBLIC void FLKeyPath_DropComponents(FLKeyPath, size_t n) FLAPI;
 
+
+    /** Creates an FLProjection, which evaluates a set of key-paths in one pass. Paths that
+        share a prefix, like `address.geo.lat` and `address.geo.lon`, look up the shared part
+        only once, so this is much faster than evaluating the paths one by one.
+        The paths are copied, so they can be freed afterwards. Returns NULL if any path
+        contains a wildcard, slice or descendants component. */
+    NODISCARD FLEECE_PUBLIC FLProjection FL_NULLABLE FLProjection_New(const FLKeyPath paths[],
+                                                                      size_t count) FLAPI;
+
+    /** Frees an FLProjection. (It's ok to pass NULL.) */
+    FLEECE_PUBLIC void FLProjection_Free(FLProjection FL_NULLABLE) FLAPI;
+
+    /** The number of key-paths in a projection. */
+    FLEECE_PUBLIC size_t FLProjection_GetCount(FLProjection) FLAPI;
+
+    /** Evaluates all the key-paths of a projection for a given Fleece root object.
+        The value of each path (or NULL if it doesn't exist) is stored in `outValues`, in the
+        order the paths were given to FLProjection_New; the array must have room for
+        FLProjection_GetCount() values. */
+    FLEECE_PUBLIC void FLProjection_Eval(FLProjection,
+                                         FLValue FL_NULLABLE root,
+                                         FLValue FL_NULLABLE outValues[]) FLAPI;
+
+
+    /** Count, sum, minimum and maximum of the numbers found by FLArray_Summarize. */
+    typedef struct {
+        size_t count;       ///< Number of items whose value is a number
+        double sum;         ///< Sum of the numbers
+        double min;         ///< Smallest number, or +infinity if there are none
+        double max;         ///< Largest number, or -infinity if there are none
+    } FLNumericSummary;
+
+    /** Comparison operators for FLArray_Select. */
+    typedef enum {
+        kFLEqual,
+        kFLNotEqual,
+        kFLLess,
+        kFLLessOrEqual,
+        kFLGreater,
+        kFLGreaterOrEqual,
+    } FLComparison;
+
+    /** Computes the count, sum, min and max of the numeric value at `path` in every item of
+        `rows` (typically an array of dictionaries.) Items where the path is missing or isn't a
+        number are skipped. The values are decoded in batches and aggregated with vectorizable
+        loops, which is much faster than evaluating the path on each item.
+        The path must not contain a wildcard, slice or descendants component. */
+    NODISCARD FLEECE_PUBLIC bool FLArray_Summarize(FLArray FL_NULLABLE rows,
+                                                   FLKeyPath path,
+                                                   FLNumericSummary *outSummary,
+                                                   FLError* FL_NULLABLE outError) FLAPI;
+
+    /** Finds the items of `rows` whose numeric value at `path` satisfies `value <op> operand`,
+        and sets the corresponding bits of `outBitmap`: bit `i % 64` of word `i / 64` for item
+        `i`. The bitmap must have room for `(count + 63) / 64` words. Items where the path is
+        missing or isn't a number never match.
+        The path must not contain a wildcard, slice or descendants component.
+        @returns  The number of matching items, or -1 on error. */
+    NODISCARD FLEECE_PUBLIC int64_t FLArray_Select(FLArray FL_NULLABLE rows,
+                                                   FLKeyPath path,
+                                                   FLComparison op,
+                                                   double operand,
+                                                   uint64_t outBitmap[],
+                                                   FLError* FL_NULLABLE outError) FLAPI;
+
+    /** Returns a new mutable array containing the items of `array` sorted by FLValue_Compare,
+        or, if `key` is given, by the value of that key-path in each item. The sort is stable,
+        and uses multiple threads if the array is large. The key-path must not contain a
+        wildcard, slice or descendants component.
+        Its initial ref-count is 1, so a call to FLMutableArray_Release will free it.
+        @note  The items are not copied, so the array's document must remain valid. */
+    NODISCARD FLEECE_PUBLIC FLMutableArray FL_NULLABLE FLArray_Sorted(FLArray FL_NULLABLE array,
+                                                                      FLKeyPath FL_NULLABLE key,
+                                                                      FLError* FL_NULLABLE outError) FLAPI;
+
     /** @} */
 
 #ifdef __cplusplus
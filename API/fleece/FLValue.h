@@ -141,9 +141,32 @@ extern "C" {
     /** Compares two values for equality. This is a deep recursive comparison. */
     FLEECE_PUBLIC bool FLValue_IsEqual(FLValue FL_NULLABLE v1, FLValue FL_NULLABLE v2) FLAPI FLPURE;
 
+    /** Compares two values, returning a negative number if `v1` sorts first, 0 if they're
+        equivalent, or a positive number if `v1` sorts last. The ordering is the same as that
+        of \ref FLValue_ToCollatable: types sort as undefined (or NULL), null, false, true,
+        numbers, strings, data, arrays, dicts; numbers by exact numeric value, so `1` and
+        `1.0` are equivalent. */
+    FLEECE_PUBLIC int FLValue_Compare(FLValue FL_NULLABLE v1, FLValue FL_NULLABLE v2) FLAPI FLPURE;
+
+    /** Returns a hash of a value's contents. Values that FLValue_Compare says are equivalent
+        have the same hash. */
+    FLEECE_PUBLIC uint32_t FLValue_Hash(FLValue FL_NULLABLE) FLAPI FLPURE;
+
     /** Returns true if the value is mutable. */
     FLEECE_PUBLIC bool FLValue_IsMutable(FLValue FL_NULLABLE) FLAPI FLPURE;
 
+    /** Encodes a value as a "collatable" key: a byte string such that comparing two keys with
+        memcmp (a prefix sorting first) orders them like their values. Types sort as undefined,
+        null, false, true, numbers, strings, data, arrays, dicts; numbers by numeric value
+        (so `1` and `1.0` have the same key); strings and data by their bytes; arrays and
+        dicts lexicographically. This is useful for keys of sorted indexes. */
+    FLEECE_PUBLIC FLSliceResult FLValue_ToCollatable(FLValue FL_NULLABLE) FLAPI;
+
+    /** Decodes a key created by \ref FLValue_ToCollatable back into Fleece data. Integral
+        numbers decode as integers. Returns null on error, if the key is invalid. */
+    NODISCARD FLEECE_PUBLIC FLSliceResult FLData_FromCollatable(FLSlice key,
+                                                                FLError* FL_NULLABLE outError) FLAPI;
+
     /** @} */
 
 
@@ -27,6 +27,7 @@
 #include "FLValue.h"
 
 // #include "FLExpert.h"  -- advanced & rarely-used functionality
+// #include "FLArrow.h"   -- exports columns in Apache Arrow format
 
 #ifdef __OBJC__
     // When compiling as Objective-C, include CoreFoundation / Objective-C utilities:
@@ -16,6 +16,7 @@
 #include "Encoder.hh"
 #include "JSONEncoder.hh"
 #include "Path.hh"
+#include "PathProjection.hh"
 #include "DeepIterator.hh"
 #include "Doc.hh"
 #include "FleeceException.hh"
@@ -36,6 +37,7 @@ typedef fleece::impl::MutableDict*    FLMutableDict;
 typedef fleece::impl::FLEncoderImpl*  FLEncoder;
 typedef fleece::impl::SharedKeys*     FLSharedKeys;
 typedef fleece::impl::Path*           FLKeyPath;
+typedef fleece::impl::PathProjection* FLProjection;
 typedef fleece::impl::DeepIterator*   FLDeepIterator;
 typedef const fleece::impl::Doc*      FLDoc;
 
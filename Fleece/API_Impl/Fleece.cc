@@ -14,6 +14,11 @@
 #include "MutableArray.hh"
 #include "MutableDict.hh"
 #include "JSONDelta.hh"
+#include "FleeceDelta.hh"
+#include "ArrayKernels.hh"
+#include "ArrowExport.hh"
+#include "Collatable.hh"
+#include "ValueSort.hh"
 #include "fleece/Fleece.h"
 #include "JSON5.hh"
 #include "ParseDate.hh"
@@ -110,6 +115,15 @@ FLDoc FL_NULLABLE FLValue_FindDoc(FLValue FL_NULLABLE v) FLAPI {
     return v ? retain(Doc::containing(v).get()) : nullptr;
 }
 
+FLDoc FL_NULLABLE FLValue_ExtractDoc(FLValue FL_NULLABLE v, FLError* FL_NULLABLE outError) FLAPI {
+    if (!v)
+        return nullptr;
+    try {
+        return retain(Doc::extract(v));
+    } catchError(outError)
+    return nullptr;
+}
+
 bool FLValue_IsEqual(FLValue FL_NULLABLE v1, FLValue FL_NULLABLE v2) FLAPI {
     if (_usuallyTrue(v1 != nullptr))
         return v1->isEqual(v2);
@@ -117,6 +131,31 @@ bool FLValue_IsEqual(FLValue FL_NULLABLE v1, FLValue FL_NULLABLE v2) FLAPI {
         return v2 == nullptr;
 }
 
+int FLValue_Compare(FLValue FL_NULLABLE v1, FLValue FL_NULLABLE v2) FLAPI {
+    if (_usuallyTrue(v1 != nullptr))
+        return v1->compare(v2);
+    else
+        return v2 ? -v2->compare(nullptr) : 0;
+}
+
+uint32_t FLValue_Hash(FLValue FL_NULLABLE v) FLAPI {
+    return v ? v->hash() : 0;
+}
+
+FLSliceResult FLValue_ToCollatable(FLValue FL_NULLABLE v) FLAPI {
+    try {
+        return FLSliceResult(Collatable::encode(v));
+    } catchError(nullptr)
+    return {};
+}
+
+FLSliceResult FLData_FromCollatable(FLSlice key, FLError* FL_NULLABLE outError) FLAPI {
+    try {
+        return FLSliceResult(Collatable::decode(key));
+    } catchError(outError)
+    return {};
+}
+
 FLSliceResult FLValue_ToString(FLValue FL_NULLABLE v) FLAPI {
     if (v) {
         try {
@@ -566,6 +605,14 @@ FLValue FL_NULLABLE FLKeyPath_Eval(FLKeyPath path, FLValue root) FLAPI {
     return path->eval(root);
 }
 
+bool FLKeyPath_ForEachMatch(FLKeyPath path, FLValue FL_NULLABLE root,
+                            FLKeyPathMatchCallback callback, void* FL_NULLABLE context) FLAPI
+{
+    return path->forEachMatch(root, [&](const Value *match) {
+        return callback(context, match);
+    });
+}
+
 FLValue FL_NULLABLE FLKeyPath_EvalOnce(FLSlice specifier, FLValue root, FLError * FL_NULLABLE outError) FLAPI {
     try {
         return Path::eval(specifier, root);
@@ -589,6 +636,8 @@ bool FLKeyPath_GetElement(FLKeyPath path, size_t i, FLSlice *outKey, int32_t *ou
     if (i >= path->size())
         return false;
     auto &element = (*path)[i];
+    if (!element.isLiteral())
+        return false;
     *outKey = element.keyStr();
     *outIndex = element.index();
     return true;
@@ -620,6 +669,79 @@ void FLKeyPath_DropComponents(FLKeyPath path, size_t n) FLAPI {
 }
 
 
+FLProjection FL_NULLABLE FLProjection_New(const FLKeyPath paths[], size_t count) FLAPI {
+    try {
+        auto projection = std::make_unique<PathProjection>();
+        for (size_t i = 0; i < count; ++i)
+            projection->addPath(*paths[i]);
+        return projection.release();
+    } catchError(nullptr)
+    return nullptr;
+}
+
+void FLProjection_Free(FLProjection FL_NULLABLE projection) FLAPI {
+    delete projection;
+}
+
+size_t FLProjection_GetCount(FLProjection projection) FLAPI {
+    return projection->size();
+}
+
+void FLProjection_Eval(FLProjection projection, FLValue FL_NULLABLE root,
+                       FLValue FL_NULLABLE outValues[]) FLAPI
+{
+    projection->eval(root, outValues);
+}
+
+
+bool FLArray_Summarize(FLArray FL_NULLABLE rows, FLKeyPath path,
+                       FLNumericSummary *outSummary, FLError* FL_NULLABLE outError) FLAPI
+{
+    try {
+        NumericSummary summary = ArrayKernels::summarize(rows, *path);
+        *outSummary = {summary.count, summary.sum, summary.min, summary.max};
+        return true;
+    } catchError(outError)
+    return false;
+}
+
+int64_t FLArray_Select(FLArray FL_NULLABLE rows, FLKeyPath path, FLComparison op,
+                       double operand, uint64_t outBitmap[], FLError* FL_NULLABLE outError) FLAPI
+{
+    try {
+        return int64_t(ArrayKernels::select(rows, *path, ArrayKernels::Comparison(op),
+                                            operand, outBitmap));
+    } catchError(outError)
+    return -1;
+}
+
+
+FLMutableArray FL_NULLABLE FLArray_Sorted(FLArray FL_NULLABLE array, FLKeyPath FL_NULLABLE key,
+                                          FLError* FL_NULLABLE outError) FLAPI
+{
+    try {
+        return (MutableArray*)retain(ValueSort::sorted(array, key));
+    } catchError(outError)
+    return nullptr;
+}
+
+
+bool FLArray_ExportArrow(FLArray FL_NULLABLE rows, const FLKeyPath paths[], size_t nPaths,
+                         struct ArrowSchema *outSchema, struct ArrowArray *outArray,
+                         FLError* FL_NULLABLE outError) FLAPI
+{
+    try {
+        std::vector<Path> pathVec;
+        pathVec.reserve(nPaths);
+        for (size_t i = 0; i < nPaths; ++i)
+            pathVec.push_back(*paths[i]);
+        ArrowExport::exportColumns(rows, pathVec, outSchema, outArray);
+        return true;
+    } catchError(outError)
+    return false;
+}
+
+
 #pragma mark - ENCODER:
 
 
@@ -680,6 +802,7 @@ FLDoc FL_NULLABLE FLDoc_Retain(FLDoc FL_NULLABLE doc)      FLAPI {return retain(
 FLSharedKeys FL_NULLABLE FLDoc_GetSharedKeys(FLDoc FL_NULLABLE doc)    FLAPI {return doc ? doc->sharedKeys() : nullptr;}
 FLValue FL_NULLABLE FLDoc_GetRoot(FLDoc FL_NULLABLE doc)               FLAPI {return doc ? doc->root() : nullptr;}
 FLSlice FLDoc_GetData(FLDoc FL_NULLABLE doc)               FLAPI {return doc ? doc->data() : slice();}
+size_t FLDoc_GetRetainedBytes(FLDoc FL_NULLABLE doc)       FLAPI {return doc ? doc->retainedBytes() : 0;}
 
 FLSliceResult FLDoc_GetAllocedData(FLDoc FL_NULLABLE doc) FLAPI {
     return doc ? FLSliceResult(doc->allocedData()) : FLSliceResult{};
@@ -738,4 +861,61 @@ bool FLEncodeApplyingJSONDelta(FLValue FL_NULLABLE old, FLSlice jsonDelta, FLEnc
     }
 }
 
+
+bool FLMutableDict_ApplyJSONDelta(FLMutableDict dict, FLSlice jsonDelta, FLError * FL_NULLABLE outError) FLAPI {
+    try {
+        JSONDelta::applyInPlace(dict, jsonDelta);
+        return true;
+    } catchError(outError)
+    return false;
+}
+
+bool FLMutableArray_ApplyJSONDelta(FLMutableArray array, FLSlice jsonDelta, FLError * FL_NULLABLE outError) FLAPI {
+    try {
+        JSONDelta::applyInPlace(array, jsonDelta);
+        return true;
+    } catchError(outError)
+    return false;
+}
+
+
+FLSliceResult FLComposeJSONDeltas(FLSlice jsonDelta1, FLSlice jsonDelta2, FLError * FL_NULLABLE outError) FLAPI {
+    try {
+        alloc_slice composed = JSONDelta::compose(jsonDelta1, jsonDelta2);
+        if (!composed && outError)
+            *outError = kFLNoError;
+        return FLSliceResult(std::move(composed));
+    } catchError(outError)
+    return {};
+}
+
+
+FLSliceResult FLCreateFleeceDelta(FLValue FL_NULLABLE old, FLValue FL_NULLABLE nuu) FLAPI {
+    try {
+        return FLSliceResult(FleeceDelta::create(old, nuu));
+    } catch (const std::exception&) {
+        return {};
+    }
+}
+
+FLSliceResult FLApplyFleeceDelta(FLValue FL_NULLABLE old, FLSlice fleeceDelta, FLError * FL_NULLABLE outError) FLAPI {
+    try {
+        return FLSliceResult(FleeceDelta::apply(old, fleeceDelta));
+    } catchError(outError)
+    return {};
+}
+
+bool FLEncodeApplyingFleeceDelta(FLValue FL_NULLABLE old, FLSlice fleeceDelta, FLEncoder encoder) FLAPI {
+    try {
+        Encoder *enc = encoder->fleeceEncoder();
+        if (!enc)
+            FleeceException::_throw(EncodeError, "FLEncodeApplyingFleeceDelta cannot encode JSON");
+        FleeceDelta::apply(old, fleeceDelta, *enc);
+        return true;
+    } catch (const std::exception &x) {
+        encoder->recordException(x);
+        return false;
+    }
+}
+
 FL_ASSUME_NONNULL_END
@@ -0,0 +1,183 @@
+//
+// ArrayKernels.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "ArrayKernels.hh"
+#include "Array.hh"
+#include "Bitmap.hh"
+#include "FleeceException.hh"
+#include "fleece/PlatformCompat.hh"
+#include <algorithm>
+
+using namespace std;
+
+namespace fleece { namespace impl {
+
+    namespace {
+
+        // The kernels process this many values per step, with a separate accumulator for each
+        // lane, so the compiler can map a step onto SIMD registers.
+        constexpr size_t kLanes = 8;
+        constexpr size_t kWordsPerBatch = ArrayKernels::kBatchSize / 64;
+
+        static_assert(ArrayKernels::kBatchSize % 64 == 0 && 64 % kLanes == 0);
+
+
+        // One batch of decoded field values. Items without a numeric value are NaN in `values`
+        // and have a clear bit in `valid`; so are the padding values after the last item.
+        struct Batch {
+            double   values[ArrayKernels::kBatchSize];
+            uint64_t valid[kWordsPerBatch];
+            size_t   size;                              // Number of items
+
+            size_t paddedSize() const       {return (size + kLanes - 1) & ~(kLanes - 1);}
+            size_t nWords() const           {return (size + 63) / 64;}
+
+            // Decodes the field of the next items of `iter` into this batch.
+            void decode(Array::iterator &iter, const Path &path) {
+                Array::iterator i = iter;          // (a local copy can live in registers)
+                size_t n = 0;
+                uint64_t bits = 0;
+                for (; i && n < ArrayKernels::kBatchSize; ++i, ++n) {
+                    const Value *v = i.value();
+                    for (auto &e : path.path()) {
+                        if (_usuallyTrue(e.isKey())) {
+                            auto dict = v->asDict();
+                            v = dict ? dict->get(e.key()) : nullptr;
+                        } else {
+                            v = e.eval(v);
+                        }
+                        if (!v)
+                            break;
+                    }
+                    double d = NAN;
+                    if (v && v->type() == kNumber)
+                        d = v->asDouble();
+                    values[n] = d;
+                    bits |= uint64_t(d == d) << (n % 64);
+                    if (n % 64 == 63) {
+                        valid[n / 64] = bits;
+                        bits = 0;
+                    }
+                }
+                iter = i;
+                size = n;
+                if (n % 64)
+                    valid[n / 64] = bits;
+                std::fill(&values[n], &values[paddedSize()], NAN);
+            }
+        };
+
+
+        // Calls `fn` with each decoded batch of the items of `rows`.
+        template <class FN>
+        void forEachBatch(const Array *rows, const Path &path, FN fn) {
+            throwIf(!path.isLiteral(), PathSyntaxError, "Array kernel paths must be literal");
+            Batch batch;
+            size_t start = 0;
+            for (Array::iterator iter(rows); iter; ) {
+                batch.decode(iter, path);
+                fn(batch, start);
+                start += batch.size;
+            }
+        }
+
+
+        // Sets `outBits` to the comparison results of a batch, and returns their count.
+        template <class CMP>
+        size_t compareBatch(const Batch &batch, double operand, uint64_t outBits[], CMP cmp) {
+            size_t count = 0;
+            for (size_t w = 0; w < batch.nWords(); ++w) {
+                const double *values = &batch.values[w * 64];
+                size_t n = std::min(batch.paddedSize() - w * 64, size_t(64));
+                uint64_t bits = 0;
+                for (size_t i = 0; i < n; ++i)
+                    bits |= uint64_t(cmp(values[i], operand)) << i;
+                bits &= batch.valid[w];         // NaN compares unequal to everything
+                outBits[w] = bits;
+                count += popcount(bits);
+            }
+            return count;
+        }
+
+    }
+
+
+    NumericSummary ArrayKernels::summarize(const Array *rows, const Path &path) {
+        double sums[kLanes], mins[kLanes], maxs[kLanes];
+        std::fill_n(sums, kLanes, 0.0);
+        std::fill_n(mins, kLanes, INFINITY);
+        std::fill_n(maxs, kLanes, -INFINITY);
+        NumericSummary result;
+        forEachBatch(rows, path, [&](const Batch &batch, size_t) {
+            for (size_t i = 0; i < batch.paddedSize(); i += kLanes) {
+                for (size_t lane = 0; lane < kLanes; ++lane) {
+                    // Comparisons with NaN are false, so these skip invalid values:
+                    double v = batch.values[i + lane];
+                    sums[lane] += (v == v) ? v : 0.0;
+                    mins[lane] = (v < mins[lane]) ? v : mins[lane];
+                    maxs[lane] = (v > maxs[lane]) ? v : maxs[lane];
+                }
+            }
+            for (size_t w = 0; w < batch.nWords(); ++w)
+                result.count += popcount(batch.valid[w]);
+        });
+        for (size_t lane = 0; lane < kLanes; ++lane) {
+            result.sum += sums[lane];
+            result.min = std::min(result.min, mins[lane]);
+            result.max = std::max(result.max, maxs[lane]);
+        }
+        return result;
+    }
+
+
+    size_t ArrayKernels::select(const Array *rows, const Path &path,
+                                Comparison op, double operand, uint64_t outBitmap[])
+    {
+        size_t count = 0;
+        forEachBatch(rows, path, [&](const Batch &batch, size_t start) {
+            uint64_t *bits = &outBitmap[start / 64];
+            switch (op) {
+                case kEqual:
+                    count += compareBatch(batch, operand, bits, [](double a, double b) {return a == b;});
+                    break;
+                case kNotEqual:
+                    count += compareBatch(batch, operand, bits, [](double a, double b) {return a != b;});
+                    break;
+                case kLess:
+                    count += compareBatch(batch, operand, bits, [](double a, double b) {return a < b;});
+                    break;
+                case kLessOrEqual:
+                    count += compareBatch(batch, operand, bits, [](double a, double b) {return a <= b;});
+                    break;
+                case kGreater:
+                    count += compareBatch(batch, operand, bits, [](double a, double b) {return a > b;});
+                    break;
+                case kGreaterOrEqual:
+                    count += compareBatch(batch, operand, bits, [](double a, double b) {return a >= b;});
+                    break;
+                default:
+                    FleeceException::_throw(InvalidData, "Invalid comparison");
+            }
+        });
+        return count;
+    }
+
+
+    vector<uint64_t> ArrayKernels::select(const Array *rows, const Path &path,
+                                          Comparison op, double operand)
+    {
+        vector<uint64_t> bitmap(((rows ? rows->count() : 0) + 63) / 64);
+        select(rows, path, op, operand, bitmap.data());
+        return bitmap;
+    }
+
+} }
@@ -0,0 +1,66 @@
+//
+// ArrayKernels.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "Path.hh"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace fleece { namespace impl {
+    class Array;
+
+    /** Count, sum, minimum and maximum of a set of numbers. */
+    struct NumericSummary {
+        size_t count {0};
+        double sum {0.0};
+        double min {std::numeric_limits<double>::infinity()};
+        double max {-std::numeric_limits<double>::infinity()};
+
+        /** The mean, or NaN if there are no numbers. */
+        double average() const      {return count ? sum / double(count) : std::nan("");}
+    };
+
+
+    /** Scans a numeric field of every item in an Array, like `price` in an array of product
+        Dicts, and aggregates or filters it.
+        The field is decoded for a batch of items at a time into a flat buffer of doubles, which
+        the aggregation and comparison loops then process in fixed-width groups the compiler can
+        vectorize. An item whose field is missing or isn't a number is skipped: it isn't counted
+        and never matches a comparison.
+        The Path must be literal (no wildcards, slices or descendants); if it isn't, these
+        functions throw FleeceException with code PathSyntaxError. */
+    class ArrayKernels {
+    public:
+        enum Comparison : uint8_t {
+            kEqual, kNotEqual, kLess, kLessOrEqual, kGreater, kGreaterOrEqual
+        };
+
+        /** Number of items decoded per batch. */
+        static constexpr size_t kBatchSize = 256;
+
+        /** Returns the count, sum, min and max of the field in the items of `rows`.
+            Integers are converted to double, so very large ones lose precision. */
+        static NumericSummary summarize(const Array *rows, const Path&);
+
+        /** Returns a bitmap of the items whose field satisfies `field <op> operand`. Bit `i % 64`
+            of word `i / 64` is set if item `i` matches; there are `(count + 63) / 64` words. */
+        static std::vector<uint64_t> select(const Array *rows, const Path&,
+                                            Comparison op, double operand);
+
+        /** Same as the other `select`, but writes the bitmap to `outBitmap`, which must have
+            room for `(count + 63) / 64` words. Returns the number of matching items. */
+        static size_t select(const Array *rows, const Path&,
+                             Comparison op, double operand, uint64_t outBitmap[]);
+    };
+
+} }
@@ -0,0 +1,314 @@
+//
+// ArrowExport.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "ArrowExport.hh"
+#include "PathProjection.hh"
+#include "FleeceException.hh"
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace fleece { namespace impl {
+
+    namespace {
+
+        // The types a column can have, in the order they're promoted.
+        enum ColumnType : uint8_t {
+            kNullColumn, kBoolColumn, kIntColumn, kDoubleColumn, kStringColumn, kBinaryColumn,
+            kJSONColumn
+        };
+
+        const char* const kFormats[] = {"n", "b", "l", "g", "u", "z", "u"};
+
+
+        // The column type of a single value; nullptr, null and undefined are kNullColumn.
+        ColumnType columnTypeOf(const Value *v) {
+            if (!v)
+                return kNullColumn;
+            switch (v->type()) {
+                case kNull:     return kNullColumn;     // (includes undefined)
+                case kBoolean:  return kBoolColumn;
+                case kNumber:
+                    if (v->isInteger() && !(v->isUnsigned() && v->asUnsigned() > INT64_MAX))
+                        return kIntColumn;
+                    return kDoubleColumn;
+                case kString:   return kStringColumn;
+                case kData:     return kBinaryColumn;
+                default:        return kJSONColumn;
+            }
+        }
+
+
+        // The type of a column containing values of both types.
+        ColumnType combine(ColumnType a, ColumnType b) {
+            if (a == b || b == kNullColumn)
+                return a;
+            else if (a == kNullColumn)
+                return b;
+            else if ((a == kIntColumn && b == kDoubleColumn) || (a == kDoubleColumn && b == kIntColumn))
+                return kDoubleColumn;
+            else
+                return kJSONColumn;
+        }
+
+
+        // Owns the strings and children of an ArrowSchema.
+        struct SchemaData {
+            string              format, name, metadata;
+            vector<ArrowSchema> children;
+            vector<ArrowSchema*> childPointers;
+        };
+
+        void releaseSchema(ArrowSchema *schema) {
+            auto data = (SchemaData*)schema->private_data;
+            for (auto &child : data->children) {
+                if (child.release)          // (the consumer may have moved the child out)
+                    child.release(&child);
+            }
+            delete data;
+            schema->release = nullptr;
+        }
+
+        void initSchema(ArrowSchema *schema, unique_ptr<SchemaData> data, int64_t flags) {
+            auto d = data.release();
+            for (auto &child : d->children)
+                d->childPointers.push_back(&child);
+            *schema = {};
+            schema->format = d->format.c_str();
+            schema->name = d->name.c_str();
+            schema->metadata = d->metadata.empty() ? nullptr : d->metadata.data();
+            schema->flags = flags;
+            schema->n_children = int64_t(d->children.size());
+            schema->children = d->childPointers.empty() ? nullptr : d->childPointers.data();
+            schema->release = &releaseSchema;
+            schema->private_data = d;
+        }
+
+
+        // Arrow's encoding of key/value metadata: counts and lengths are native int32s.
+        string encodeMetadata(slice key, slice value) {
+            string out;
+            auto writeInt = [&](int32_t n) {out.append((const char*)&n, sizeof(n));};
+            writeInt(1);
+            writeInt(int32_t(key.size));
+            out.append((const char*)key.buf, key.size);
+            writeInt(int32_t(value.size));
+            out.append((const char*)value.buf, value.size);
+            return out;
+        }
+
+
+        // Owns the buffers and children of an ArrowArray. A column uses only the buffers its
+        // type needs.
+        struct ArrayData {
+            vector<uint8_t>     validity, bits, bytes;
+            vector<int64_t>     ints;
+            vector<double>      doubles;
+            vector<int32_t>     offsets;
+            vector<const void*> buffers;
+            vector<ArrowArray>  children;
+            vector<ArrowArray*> childPointers;
+        };
+
+        void releaseArray(ArrowArray *array) {
+            auto data = (ArrayData*)array->private_data;
+            for (auto &child : data->children) {
+                if (child.release)
+                    child.release(&child);
+            }
+            delete data;
+            array->release = nullptr;
+        }
+
+        void initArray(ArrowArray *array, unique_ptr<ArrayData> data,
+                       int64_t length, int64_t nullCount)
+        {
+            auto d = data.release();
+            for (auto &child : d->children)
+                d->childPointers.push_back(&child);
+            *array = {};
+            array->length = length;
+            array->null_count = nullCount;
+            array->n_buffers = int64_t(d->buffers.size());
+            array->buffers = d->buffers.empty() ? nullptr : d->buffers.data();
+            array->n_children = int64_t(d->children.size());
+            array->children = d->childPointers.empty() ? nullptr : d->childPointers.data();
+            array->release = &releaseArray;
+            array->private_data = d;
+        }
+
+
+        inline void setBit(vector<uint8_t> &bitmap, size_t i) {
+            bitmap[i >> 3] |= uint8_t(1 << (i & 7));
+        }
+
+
+        // Accumulates the values of one column, row by row.
+        class ColumnBuilder {
+        public:
+            ColumnBuilder(ColumnType type, size_t nRows)
+            :_type(type)
+            ,_data(new ArrayData)
+            {
+                _data->validity.resize((nRows + 7) / 8);
+                switch (_type) {
+                    case kBoolColumn:   _data->bits.resize((nRows + 7) / 8); break;
+                    case kIntColumn:    _data->ints.reserve(nRows); break;
+                    case kDoubleColumn: _data->doubles.reserve(nRows); break;
+                    case kNullColumn:   break;
+                    default:            _data->offsets.reserve(nRows + 1);
+                                        _data->offsets.push_back(0);
+                                        break;
+                }
+            }
+
+            void add(const Value *v) {
+                bool valid = (columnTypeOf(v) != kNullColumn);
+                if (valid)
+                    setBit(_data->validity, _row);
+                else
+                    ++_nullCount;
+                switch (_type) {
+                    case kNullColumn:
+                        break;
+                    case kBoolColumn:
+                        if (valid && v->asBool())
+                            setBit(_data->bits, _row);
+                        break;
+                    case kIntColumn:
+                        _data->ints.push_back(valid ? v->asInt() : 0);
+                        break;
+                    case kDoubleColumn:
+                        _data->doubles.push_back(valid ? v->asDouble() : 0.0);
+                        break;
+                    case kStringColumn:
+                        if (valid)
+                            addBytes(v->asString());
+                        addOffset();
+                        break;
+                    case kBinaryColumn:
+                        if (valid)
+                            addBytes(v->asData());
+                        addOffset();
+                        break;
+                    case kJSONColumn:
+                        if (valid)
+                            addBytes(v->toJSON());
+                        addOffset();
+                        break;
+                }
+                ++_row;
+            }
+
+            void finish(ArrowArray *outArray) {
+                auto &d = *_data;
+                if (_type != kNullColumn)
+                    d.buffers.push_back(_nullCount > 0 ? d.validity.data() : nullptr);
+                switch (_type) {
+                    case kNullColumn:   break;
+                    case kBoolColumn:   d.buffers.push_back(nonNull(d.bits)); break;
+                    case kIntColumn:    d.buffers.push_back(nonNull(d.ints)); break;
+                    case kDoubleColumn: d.buffers.push_back(nonNull(d.doubles)); break;
+                    default:            d.buffers.push_back(d.offsets.data());
+                                        d.buffers.push_back(nonNull(d.bytes));
+                                        break;
+                }
+                initArray(outArray, std::move(_data), int64_t(_row), int64_t(_nullCount));
+            }
+
+        private:
+            void addBytes(slice s) {
+                _data->bytes.insert(_data->bytes.end(), (const uint8_t*)s.buf,
+                                    (const uint8_t*)s.end());
+            }
+
+            void addOffset() {
+                throwIf(_data->bytes.size() > INT32_MAX, MemoryError,
+                        "Arrow string column is too large");
+                _data->offsets.push_back(int32_t(_data->bytes.size()));
+            }
+
+            // Arrow wants non-null buffer pointers even when the buffer is empty.
+            template <class T>
+            static const void* nonNull(vector<T> &v) {
+                if (v.empty())
+                    v.reserve(1);
+                return v.data();
+            }
+
+            ColumnType              _type;
+            unique_ptr<ArrayData>   _data;
+            size_t                  _row {0};
+            size_t                  _nullCount {0};
+        };
+
+    }
+
+
+    /*static*/ void ArrowExport::exportColumns(const Array *rows, const vector<Path> &paths,
+                                               ArrowSchema *outSchema, ArrowArray *outArray)
+    {
+        PathProjection projection(paths);
+        size_t nCols = paths.size(), nRows = rows ? rows->count() : 0;
+        vector<const Value*> values(nCols);
+
+        // First pass: find each column's type:
+        vector<ColumnType> types(nCols, kNullColumn);
+        for (Array::iterator i(rows); i; ++i) {
+            projection.eval(i.value(), values.data());
+            for (size_t c = 0; c < nCols; ++c) {
+                if (types[c] != kJSONColumn)
+                    types[c] = combine(types[c], columnTypeOf(values[c]));
+            }
+        }
+
+        // Second pass: fill in the columns:
+        vector<ColumnBuilder> builders;
+        builders.reserve(nCols);
+        for (size_t c = 0; c < nCols; ++c)
+            builders.emplace_back(types[c], nRows);
+        for (Array::iterator i(rows); i; ++i) {
+            projection.eval(i.value(), values.data());
+            for (size_t c = 0; c < nCols; ++c)
+                builders[c].add(values[c]);
+        }
+
+        // Describe the columns:
+        auto schema = make_unique<SchemaData>();
+        schema->format = "+s";
+        schema->children.resize(nCols);
+        for (size_t c = 0; c < nCols; ++c) {
+            auto column = make_unique<SchemaData>();
+            column->format = kFormats[types[c]];
+            stringstream name;
+            paths[c].writeTo(name);
+            column->name = name.str();
+            if (types[c] == kJSONColumn)
+                column->metadata = encodeMetadata("ARROW:extension:name"_sl, "arrow.json"_sl);
+            initSchema(&schema->children[c], std::move(column), ARROW_FLAG_NULLABLE);
+        }
+
+        // And assemble them into a struct array:
+        auto array = make_unique<ArrayData>();
+        array->buffers.push_back(nullptr);      // No validity bitmap; every row is valid
+        array->children.resize(nCols);
+        for (size_t c = 0; c < nCols; ++c)
+            builders[c].finish(&array->children[c]);
+
+        initSchema(outSchema, std::move(schema), 0);
+        initArray(outArray, std::move(array), int64_t(nRows), 0);
+    }
+
+} }
@@ -0,0 +1,32 @@
+//
+// ArrowExport.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "Path.hh"
+#include "fleece/FLArrow.h"
+#include <vector>
+
+namespace fleece { namespace impl {
+
+    /** Converts an Array of Dicts into columns laid out per the Apache Arrow C Data Interface.
+        (The column types are described in FLArrow.h.) */
+    class ArrowExport {
+    public:
+        /** Exports the values of `paths` in each item of `rows` as an Arrow struct array with one
+            child column per path. On success the caller owns `outSchema` and `outArray`, and
+            must call their `release` callbacks.
+            Throws FleeceException if a path isn't literal or a string column exceeds 2GB. */
+        static void exportColumns(const Array *rows, const std::vector<Path> &paths,
+                                  ArrowSchema *outSchema, ArrowArray *outArray);
+    };
+
+} }
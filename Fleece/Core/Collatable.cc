@@ -0,0 +1,287 @@
+//
+// Collatable.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "Collatable.hh"
+#include "Array.hh"
+#include "Dict.hh"
+#include "Encoder.hh"
+#include "Writer.hh"
+#include "Endian.hh"
+#include "FleeceException.hh"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace fleece { namespace impl {
+
+    namespace {
+
+        // Each value starts with one of these tags, which put the types in order. The end of an
+        // array or dict is marked by kEndTag, which sorts before any value.
+        enum : uint8_t {
+            kEndTag = 0,
+            kUndefinedTag,
+            kNullTag,
+            kFalseTag,
+            kTrueTag,
+            kNumberTag,
+            kStringTag,
+            kDataTag,
+            kArrayTag,
+            kDictTag,
+        };
+
+        // Within a string or data value, a 00 byte is escaped as 00 FF, and the value ends
+        // with a single 00, which sorts before any continuation of the bytes.
+        constexpr uint8_t kEscapedZero = 0xFF;
+
+        // A number is the big-endian bits of the nearest double, with the sign bit flipped (and
+        // all bits of negative numbers flipped) so they sort like the numbers, followed by a
+        // 16-bit biased remainder: the difference between the exact integer and that double.
+        constexpr size_t   kNumberSize     = 8 + 2;
+        constexpr uint16_t kRemainderBias  = 0x8000;
+        constexpr double   kTwoTo63        = 9223372036854775808.0;
+        constexpr double   kTwoTo64        = 18446744073709551616.0;
+        constexpr uint64_t kSignBit        = uint64_t(1) << 63;
+
+
+        void writeNumber(Writer &out, double d, int64_t remainder) {
+            if (d == 0)
+                d = 0;                                   // Changes -0.0 to 0.0
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            bits = (bits & kSignBit) ? ~bits : (bits | kSignBit);
+            uint8_t buf[1 + kNumberSize];
+            buf[0] = kNumberTag;
+            bits = endian::enc64(bits);
+            memcpy(&buf[1], &bits, 8);
+            uint16_t rem = endian::enc16(uint16_t(remainder + kRemainderBias));
+            memcpy(&buf[9], &rem, 2);
+            out.write(buf, sizeof(buf));
+        }
+
+        void writeNumber(Writer &out, const Value *v) {
+            if (!v->isInteger()) {
+                writeNumber(out, v->asDouble(), 0);
+            } else if (v->isUnsigned()) {
+                uint64_t n = v->asUnsigned();
+                double d = double(n);
+                // If d rounded up to 2^64, n - 2^64 wraps around to the (negative) remainder:
+                uint64_t base = (d < kTwoTo64) ? uint64_t(d) : 0;
+                writeNumber(out, d, int64_t(n - base));
+            } else {
+                int64_t n = v->asInt();
+                double d = double(n);
+                uint64_t base = (d < kTwoTo63) ? uint64_t(int64_t(d)) : kSignBit;
+                writeNumber(out, d, int64_t(uint64_t(n) - base));
+            }
+        }
+
+        void writeBytes(Writer &out, uint8_t tag, slice bytes) {
+            out << tag;
+            static constexpr uint8_t kEscape[2] = {0, kEscapedZero};
+            while (const void *zero = bytes.findByte(0)) {
+                out.write(bytes.buf, (const uint8_t*)zero - (const uint8_t*)bytes.buf);
+                out.write(kEscape, 2);
+                bytes.setStart(offsetby(zero, 1));
+            }
+            out << bytes << kEndTag;
+        }
+
+
+        // Reads a collatable key.
+        class Decoder {
+        public:
+            Decoder(slice key, Encoder &enc)    :_in(key), _enc(enc) { }
+
+            void decodeValue() {
+                switch (uint8_t tag = readByte()) {
+                    case kUndefinedTag: _enc.writeUndefined(); break;
+                    case kNullTag:      _enc.writeNull(); break;
+                    case kFalseTag:     _enc.writeBool(false); break;
+                    case kTrueTag:      _enc.writeBool(true); break;
+                    case kNumberTag:    decodeNumber(); break;
+                    case kStringTag:    _enc.writeString(readBytes()); break;
+                    case kDataTag:      _enc.writeData(readBytes()); break;
+                    case kArrayTag:
+                        _enc.beginArray();
+                        while (!atEnd())
+                            decodeValue();
+                        _enc.endArray();
+                        break;
+                    case kDictTag:
+                        _enc.beginDictionary();
+                        while (!atEnd()) {
+                            throwIf(readByte() != kStringTag, InvalidData, "Invalid collatable dict key");
+                            _enc.writeKey(readBytes());
+                            decodeValue();
+                        }
+                        _enc.endDictionary();
+                        break;
+                    default:
+                        FleeceException::_throw(InvalidData, "Invalid collatable tag %d", tag);
+                }
+            }
+
+            void finish() {
+                throwIf(_in.size > 0, InvalidData, "Unexpected data after collatable value");
+            }
+
+        private:
+            uint8_t readByte() {
+                throwIf(_in.size == 0, InvalidData, "Collatable key is truncated");
+                uint8_t b = _in[0];
+                _in.moveStart(1);
+                return b;
+            }
+
+            // Consumes the end marker of an array or dict, if it's next.
+            bool atEnd() {
+                throwIf(_in.size == 0, InvalidData, "Collatable key is truncated");
+                if (_in[0] != kEndTag)
+                    return false;
+                _in.moveStart(1);
+                return true;
+            }
+
+            slice readBytes() {
+                const void *zero = _in.findByte(0);
+                throwIf(!zero, InvalidData, "Collatable key is truncated");
+                slice bytes(_in.buf, zero);
+                if (_in.size > bytes.size + 1 && _in[bytes.size + 1] == kEscapedZero)
+                    return readEscapedBytes();
+                _in.setStart(offsetby(zero, 1));
+                return bytes;
+            }
+
+            slice readEscapedBytes() {
+                _unescaped.clear();
+                while (true) {
+                    const void *zero = _in.findByte(0);
+                    throwIf(!zero, InvalidData, "Collatable key is truncated");
+                    _unescaped.insert(_unescaped.end(), (const uint8_t*)_in.buf, (const uint8_t*)zero);
+                    _in.setStart(offsetby(zero, 1));
+                    if (_in.size == 0 || _in[0] != kEscapedZero)
+                        break;
+                    _unescaped.push_back(0);
+                    _in.moveStart(1);
+                }
+                return slice(_unescaped.data(), _unescaped.size());
+            }
+
+            void decodeNumber() {
+                throwIf(_in.size < kNumberSize, InvalidData, "Collatable key is truncated");
+                uint64_t bits;
+                memcpy(&bits, _in.buf, 8);
+                bits = endian::dec64(bits);
+                bits = (bits & kSignBit) ? (bits & ~kSignBit) : ~bits;
+                double d;
+                memcpy(&d, &bits, sizeof(d));
+                uint16_t rem;
+                memcpy(&rem, offsetby(_in.buf, 8), 2);
+                int64_t remainder = int64_t(endian::dec16(rem)) - kRemainderBias;
+                _in.moveStart(kNumberSize);
+
+                if (d != std::floor(d) || d < -kTwoTo63 || (d >= kTwoTo64 && remainder == 0)) {
+                    _enc.writeDouble(d);            // (includes infinities)
+                } else if (d < kTwoTo63) {
+                    _enc.writeInt(int64_t(d) + remainder);
+                } else {
+                    // At or beyond 2^63; a double of 2^64 was rounded up, so it wraps to 0:
+                    uint64_t base = (d < kTwoTo64) ? uint64_t(d) : 0;
+                    uint64_t n = base + uint64_t(remainder);
+                    if (n <= uint64_t(INT64_MAX))
+                        _enc.writeInt(int64_t(n));
+                    else
+                        _enc.writeUInt(n);
+                }
+            }
+
+            slice                   _in;
+            Encoder&                _enc;
+            std::vector<uint8_t>    _unescaped;
+        };
+
+    }
+
+
+    /*static*/ void Collatable::encode(const Value *v, Writer &out) {
+        if (!v) {
+            out << kUndefinedTag;
+            return;
+        }
+        switch (v->type()) {
+            case kNull:
+                out << (v->isUndefined() ? kUndefinedTag : kNullTag);
+                break;
+            case kBoolean:
+                out << (v->asBool() ? kTrueTag : kFalseTag);
+                break;
+            case kNumber:
+                writeNumber(out, v);
+                break;
+            case kString:
+                writeBytes(out, kStringTag, v->asString());
+                break;
+            case kData:
+                writeBytes(out, kDataTag, v->asData());
+                break;
+            case kArray:
+                out << kArrayTag;
+                for (Array::iterator i(v->asArray()); i; ++i)
+                    encode(i.value(), out);
+                out << kEndTag;
+                break;
+            case kDict: {
+                // Shared keys make the stored order differ from string order, so sort:
+                vector<pair<slice, const Value*>> items;
+                items.reserve(v->asDict()->count());
+                for (Dict::iterator i(v->asDict()); i; ++i)
+                    items.emplace_back(i.keyString(), i.value());
+                sort(items.begin(), items.end(), [](auto &a, auto &b) {return a.first < b.first;});
+                out << kDictTag;
+                for (auto &item : items) {
+                    writeBytes(out, kStringTag, item.first);
+                    encode(item.second, out);
+                }
+                out << kEndTag;
+                break;
+            }
+        }
+    }
+
+
+    /*static*/ alloc_slice Collatable::encode(const Value *v) {
+        Writer out(64);
+        encode(v, out);
+        return out.finish();
+    }
+
+
+    /*static*/ void Collatable::decode(slice key, Encoder &enc) {
+        Decoder decoder(key, enc);
+        decoder.decodeValue();
+        decoder.finish();
+    }
+
+
+    /*static*/ alloc_slice Collatable::decode(slice key) {
+        Encoder enc;
+        decode(key, enc);
+        return enc.finish();
+    }
+
+} }
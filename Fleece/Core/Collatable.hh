@@ -0,0 +1,56 @@
+//
+// Collatable.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "fleece/slice.hh"
+
+namespace fleece {
+    class Writer;
+}
+
+namespace fleece { namespace impl {
+    class Encoder;
+    class Value;
+
+    /** Converts Values to and from a "collatable" binary encoding, in which comparing two keys
+        with `memcmp` (shorter key first if one is a prefix of the other) gives the same order
+        as comparing the Values. This makes them usable as keys in sorted storage, like an index.
+
+        The ordering is:
+        - Values of different types sort by type: undefined, null, false, true, numbers,
+          strings, data, arrays, dicts.
+        - Numbers sort by numeric value; integers and floats are interchangeable, so `1` and
+          `1.0` have the same key. (-0.0 is the same as 0.) Every 64-bit integer keeps its exact
+          value, even where a double would round it.
+        - Strings and data sort by their bytes; strings are thus in Unicode code-point order.
+          They may contain zero bytes.
+        - Arrays sort lexicographically by their items; a prefix sorts first.
+        - Dicts sort like arrays of alternating keys and values, in key order. */
+    class Collatable {
+    public:
+        /** Returns the collatable key of a Value. A nullptr Value has the same key as undefined. */
+        static alloc_slice encode(const Value*);
+
+        /** Writes the collatable key of a Value to a Writer. */
+        static void encode(const Value*, Writer&);
+
+        /** Decodes a collatable key into an equivalent Fleece value, written to the Encoder.
+            Numbers that are integral and fit in 64 bits are written as integers, others as
+            doubles.
+            Throws FleeceException with code InvalidData if the key is invalid. */
+        static void decode(slice key, Encoder&);
+
+        /** Decodes a collatable key into Fleece data (see the other `decode`.) */
+        static alloc_slice decode(slice key);
+    };
+
+} }
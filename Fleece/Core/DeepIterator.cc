@@ -85,11 +85,11 @@ namespace fleece { namespace impl {
         _stack.push_front({{nullslice, 0}, nullptr});   // Push en end-of-level marker first
         auto type = container->type();
         if (type == kArray) {
-            _arrayIt.reset( new Array::iterator(container->asArray()) );
+            _arrayIt.emplace(container->asArray());
             _arrayIndex = 0;
             return true;
         } else if (type == kDict) {
-            _dictIt.reset( new Dict::iterator(container->asDict(), _sk) );
+            _dictIt.emplace(container->asDict(), _sk);
             return true;
         } else {
             return false;
@@ -103,25 +103,72 @@ namespace fleece { namespace impl {
     }
 
 
-    std::string DeepIterator::pathString() const {
-        std::stringstream s;
-        for (auto &component : _path) {
-            if (component.key) {
-                bool quote = false;
-                for (auto c : component.key) {
-                    if (!isalnum(c) && c != '_') {
-                        quote = true;
-                        break;
-                    }
+#pragma mark - PATHS:
+
+
+    // Adapts a std::ostream to the slice_ostream methods used below.
+    struct ostreamWriter {
+        std::ostream &s;
+        bool write(slice str)           {s.write((const char*)str.buf, str.size); return true;}
+        bool writeByte(uint8_t c)       {s << char(c); return true;}
+        bool writeDecimal(uint64_t n)   {s << n; return true;}
+    };
+
+
+    // Writes a path component in the syntax of `pathString`.
+    template <class OUT>
+    static bool writePathComponent(OUT &out, const DeepIterator::PathComponent &component) {
+        if (component.key) {
+            bool quote = false;
+            for (auto c : component.key) {
+                if (!isalnum(c) && c != '_') {
+                    quote = true;
+                    break;
                 }
-                s << (quote ? "[\"" : ".");
-                s.write((char*)component.key.buf, component.key.size);
-                if (quote)
-                    s << "\"]";
+            }
+            return out.write(quote ? "[\""_sl : "."_sl)
+                && out.write(component.key)
+                && (!quote || out.write("\"]"_sl));
+        } else {
+            return out.writeByte('[') && out.writeDecimal(component.index) && out.writeByte(']');
+        }
+    }
+
+
+    // Writes a path component in JSONPointer syntax.
+    template <class OUT>
+    static bool writePointerComponent(OUT &out, const DeepIterator::PathComponent &component) {
+        if (!out.writeByte('/'))
+            return false;
+        if (component.key) {
+            // Keys need to be escaped per https://tools.ietf.org/html/rfc6901#section-3 :
+            if (component.key.findAnyByteOf("/~"_sl)) {
+                for (uint8_t c : component.key) {
+                    bool ok;
+                    if (c == '/')
+                        ok = out.write("~1"_sl);
+                    else if (c == '~')
+                        ok = out.write("~0"_sl);
+                    else
+                        ok = out.writeByte(c);
+                    if (!ok)
+                        return false;
+                }
+                return true;
             } else {
-                s << '[' << component.index << ']';
+                return out.write(component.key);
             }
+        } else {
+            return out.writeDecimal(component.index);
         }
+    }
+
+
+    std::string DeepIterator::pathString() const {
+        std::stringstream s;
+        ostreamWriter out{s};
+        for (auto &component : _path)
+            writePathComponent(out, component);
         return s.str();
     }
 
@@ -130,28 +177,97 @@ namespace fleece { namespace impl {
         if (_path.empty())
             return "/";
         std::stringstream s;
-        for (auto &component : _path) {
-            s << '/';
-            if (component.key) {
-                // Keys need to be escaped per https://tools.ietf.org/html/rfc6901#section-3 :
-                if (component.key.findAnyByteOf("/~"_sl)) {
-                    auto end = (const char*)component.key.end();
-                    for (auto c = (const char*)component.key.buf; c != end; ++c) {
-                        if (*c == '/')
-                            s << "~1";
-                        else if (*c == '~')
-                            s << "~0";
-                        else
-                            s << *c;
-                    }
-                } else {
-                    s.write((char*)component.key.buf, component.key.size);
-                }
-            } else {
-                s << component.index;
-            }
-        }
+        ostreamWriter out{s};
+        for (auto &component : _path)
+            writePointerComponent(out, component);
         return s.str();
     }
 
+
+#pragma mark - PREORDER ITERATOR:
+
+
+    PreorderIterator::Frame::Frame(const Value *c, const SharedKeys *sk) noexcept
+    :container(c)
+    ,isDict(c->type() == kDict)
+    {
+        if (isDict)
+            new (&dictIt) Dict::iterator((const Dict*)c, sk);
+        else
+            new (&arrayIt) Array::iterator((const Array*)c);
+    }
+
+
+    PreorderIterator::Frame::~Frame() {
+        if (isDict)
+            dictIt.~DictIterator();
+        else
+            arrayIt.~ArrayIterator();
+    }
+
+
+    // Advances to the container's next item and returns it, or returns nullptr at the end.
+    const Value* PreorderIterator::Frame::next() noexcept {
+        if (isDict) {
+            if (index++ > 0)
+                ++dictIt;
+            return dictIt.value();
+        } else {
+            if (index++ > 0)
+                ++arrayIt;
+            return arrayIt.value();
+        }
+    }
+
+
+    // The path component of the current item.
+    DeepIterator::PathComponent PreorderIterator::Frame::component() const noexcept {
+        if (isDict)
+            return {dictIt.keyString(), 0};
+        else
+            return {nullslice, index - 1};
+    }
+
+
+    void PreorderIterator::next() {
+        if (!_value)
+            return;
+
+        // Descend into the current value if it's a container:
+        if (_skipChildren) {
+            _skipChildren = false;
+        } else if (auto type = _value->type(); type == kArray || type == kDict) {
+            _stack.emplace_back(_value, _sk);
+        }
+
+        // Get the next item of the innermost container that isn't finished:
+        while (!_stack.empty()) {
+            Frame &frame = _stack.back();
+            if ((_value = frame.next()) != nullptr)
+                return;
+            if (!_sk && frame.isDict)
+                _sk = frame.dictIt.sharedKeys();
+            _stack.pop_back();
+        }
+        _value = nullptr;
+    }
+
+
+    bool PreorderIterator::writePath(slice_ostream &out) const noexcept {
+        for (auto &frame : _stack)
+            if (!writePathComponent(out, frame.component()))
+                return false;
+        return true;
+    }
+
+
+    bool PreorderIterator::writeJSONPointer(slice_ostream &out) const noexcept {
+        if (_stack.empty())
+            return out.writeByte('/');
+        for (auto &frame : _stack)
+            if (!writePointerComponent(out, frame.component()))
+                return false;
+        return true;
+    }
+
 } }
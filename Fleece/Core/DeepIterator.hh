@@ -15,7 +15,9 @@
 #pragma once
 #include "Array.hh"
 #include "Dict.hh"
-#include <memory>
+#include "SmallVector.hh"
+#include "slice_stream.hh"
+#include <optional>
 #include <vector>
 #include <deque>
 #include <utility>
@@ -36,7 +38,8 @@ namespace fleece { namespace impl {
         the iterator, or during the iteration ignore the current value if path() is empty.
 
         The iteration is (obviously) not recursive, so it uses minimal stack space. It uses a
-        small amount of heap space, roughly proportional to the number of sub-containers. */
+        small amount of heap space, roughly proportional to the number of sub-containers.
+        (PreorderIterator is faster and doesn't allocate, if you don't need this order.) */
     class DeepIterator {
     public:
         DeepIterator(const Value *root);
@@ -86,9 +89,86 @@ namespace fleece { namespace impl {
         std::deque<std::pair<PathComponent,const Value*>> _stack;
         const Value* _container {nullptr};
         bool _skipChildren;
-        std::unique_ptr<Dict::iterator> _dictIt;
-        std::unique_ptr<Array::iterator> _arrayIt;
+        std::optional<Dict::iterator> _dictIt;
+        std::optional<Array::iterator> _arrayIt;
         uint32_t _arrayIndex;
     };
 
+
+    /** A deep iterator like DeepIterator, but visiting values in depth-first pre-order: each
+        container is immediately followed by its contents, recursively. This lets it keep just
+        one Array or Dict iterator per level of nesting, on an inline stack, so iterating doesn't
+        allocate any memory (unless the nesting is deeper than `kInlineDepth`.)
+        The path is likewise read from the stack, and can be written into a caller's buffer. */
+    class PreorderIterator {
+    public:
+        using PathComponent = DeepIterator::PathComponent;
+
+        static constexpr size_t kInlineDepth = 16;
+
+        explicit PreorderIterator(const Value *root) noexcept    :_value(root) { }
+
+        inline explicit operator bool() const           {return _value != nullptr;}
+        inline PreorderIterator& operator++ ()          {next(); return *this;}
+
+        /** The current value, or NULL if the iterator is finished. */
+        const Value* value() const                      {return _value;}
+
+        /** Call this to skip iterating the children of the current value. */
+        void skipChildren()                             {_skipChildren = true;}
+
+        /** Advances the iterator. */
+        void next();
+
+        /** The parent of the current value (NULL if at the root.) */
+        const Value* parent() const                     {return _stack.empty() ? nullptr
+                                                                 : _stack.back().container;}
+
+        /** The number of path components, i.e. 0 at the root. */
+        size_t depth() const                            {return _stack.size();}
+
+        /** A component of the path to the current value; `level` must be less than `depth()`. */
+        PathComponent pathComponent(size_t level) const {return _stack[level].component();}
+
+        /** The Dict key of the current value, or nullkey if the parent is an Array. */
+        slice keyString() const                         {return _stack.empty() ? slice()
+                                                                 : _stack.back().component().key;}
+
+        /** The Array index of the current value, or 0 if the parent is a Dict. */
+        uint32_t index() const                          {return _stack.empty() ? 0
+                                                                 : _stack.back().component().index;}
+
+        /** Writes the path in the syntax of `DeepIterator::pathString`.
+            Returns false if it doesn't fit in the stream. */
+        bool writePath(slice_ostream&) const noexcept;
+
+        /** Writes the path in JSONPointer (RFC 6901) syntax, like `DeepIterator::jsonPointer`.
+            Returns false if it doesn't fit in the stream. */
+        bool writeJSONPointer(slice_ostream&) const noexcept;
+
+    private:
+        // The iteration state of one container:
+        struct Frame {
+            Frame(const Value* NONNULL container, const SharedKeys*) noexcept;
+            Frame(const Frame&) =delete;
+            ~Frame();
+            const Value* next() noexcept;
+            PathComponent component() const noexcept;
+
+            // The iterator stays on the current item, so its key is only read if it's needed.
+            const Value*        container;
+            uint32_t            index {0};          // Index of the current item
+            union {
+                Array::iterator arrayIt;
+                Dict::iterator  dictIt;
+            };
+            bool const          isDict;
+        };
+
+        const Value*                    _value;
+        smallVector<Frame,kInlineDepth> _stack;
+        const SharedKeys*               _sk {nullptr};
+        bool                            _skipChildren {false};
+    };
+
 } }
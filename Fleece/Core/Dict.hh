@@ -158,6 +158,7 @@ namespace fleece { namespace impl {
         friend class Value;
         friend class ValueDumper;
         friend class Encoder;
+        friend class Doc;
     };
 
 
@@ -13,6 +13,7 @@
 #include "Doc.hh"
 #include "SharedKeys.hh"
 #include "Pointer.hh"
+#include "Encoder.hh"
 #include "JSONConverter.hh"
 #include "FleeceException.hh"
 #include "MutableDict.hh"
@@ -21,6 +22,7 @@
 #include <functional>
 #include <mutex>
 #include <set>
+#include <unordered_set>
 #include "betterassert.hh"
 
 #if 0
@@ -327,6 +329,13 @@ namespace fleece { namespace impl {
     }
 
 
+    Doc::Doc(slice data, Trust trust, SharedKeys *sk, slice destination) noexcept
+    :Scope(data, sk, destination, true)
+    {
+        init(trust);
+    }
+
+
     Doc::Doc(const Doc *parentDoc, slice subData, Trust trust) noexcept
     :Scope(*parentDoc, subData, true)
     ,_parent(parentDoc)                         // Ensure parent is retained
@@ -372,6 +381,140 @@ namespace fleece { namespace impl {
     }
 
 
+    /*static*/ Retained<Doc> Doc::extract(const Value *value) {
+        RetainedConst<Doc> doc = containing(value);
+        SharedKeys *sk = doc ? doc->sharedKeys() : nullptr;
+        auto type = value->type();
+        if (doc && !value->isMutable() && (type == kArray || type == kDict)) {
+            // If the collection and everything it points to are close together, copy the range
+            // of the source data they're in, as long as at most half of it belongs to other values:
+            slice data = doc->data();
+            const void *lowest = value;
+            size_t size = 0;
+            if (measureSubtree(value, data, lowest, size)) {
+                const void *end = offsetby(value, encodedSize(value));
+                end = min(offsetby(data.buf, (pointerDiff(end, data.buf) + 1) & ~1),
+                          (const void*)data.end());
+                size_t span = pointerDiff(end, lowest);
+                if (span <= 2 * size) {
+                    // Append a trailer pointing to the root, like Encoder::finish:
+                    size_t rootDistance = pointerDiff(end, value);
+                    bool wide = (rootDistance > Pointer::kMaxNarrowOffset);
+                    alloc_slice copy(span + (wide ? kWide + kNarrow : kNarrow));
+                    memcpy((void*)copy.buf, lowest, span);
+                    auto trailer = (uint8_t*)copy.buf + span;
+                    if (wide) {
+                        new (trailer) Pointer(rootDistance, kWide);
+                        new (trailer + kWide) Pointer(kWide, kNarrow);
+                    } else {
+                        new (trailer) Pointer(rootDistance, kNarrow);
+                    }
+                    return new Doc(copy, kTrusted, sk);
+                }
+            }
+        }
+        Encoder enc;
+        enc.setSharedKeys(sk);
+        enc.writeValue(value);
+        return new Doc(enc.finish(), kTrusted, sk);
+    }
+
+
+    // The size of a Value's encoded data, including a collection's items.
+    /*static*/ size_t Doc::encodedSize(const Value *value) noexcept {
+        size_t size = value->dataSize();
+        if (auto type = value->type(); type == kArray)
+            size += ((const Array*)value)->count() * (value->isWideArray() ? kWide : kNarrow);
+        else if (type == kDict)
+            size += 2 * Dict::iterator((const Dict*)value, false).count()
+                       * (value->isWideArray() ? kWide : kNarrow);
+        return size;
+    }
+
+
+    // Finds the lowest address used by a Value and its descendants, and adds up their sizes.
+    // Values pointed to more than once, like shared strings and keys, are counted once.
+    // Returns false if any of them aren't in `data`, i.e. they're in a base document.
+    /*static*/ bool Doc::measureSubtree(const Value *root, slice data,
+                                        const void* &lowest, size_t &size)
+    {
+        unordered_set<const Value*> visited;
+        auto measure = [&](auto &measure, const Value *value) -> bool {
+            if (!data.containsAddress(value))
+                return false;
+            if (!visited.insert(value).second)
+                return true;
+            lowest = min(lowest, (const void*)value);
+            size_t valueSize = encodedSize(value);
+            size += valueSize;
+            // Items stored inline in the collection are already counted; only follow pointers:
+            slice extent(value, valueSize);
+            auto measureItem = [&](const Value *item) {
+                return extent.containsAddress(item) || measure(measure, item);
+            };
+            switch (value->type()) {
+                case kArray:
+                    for (Array::iterator i((const Array*)value); i; ++i) {
+                        if (!measureItem(i.value()))
+                            return false;
+                    }
+                    break;
+                case kDict:
+                    for (Dict::iterator i((const Dict*)value, false); i; ++i) {
+                        if (!measureItem(i.key()) || !measureItem(i.value()))
+                            return false;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            return true;
+        };
+        return measure(measure, root);
+    }
+
+
+    size_t Doc::retainedBytes() const noexcept {
+        size_t size = 0;
+        const void *counted = nullptr;
+        for (const Doc *doc = this; doc; doc = doc->_parent) {
+            // A Doc created from a parent Doc usually shares its block; count that only once:
+            if (auto block = doc->allocedData(); block.buf != counted) {
+                size += block.size;
+                counted = block.buf;
+            }
+        }
+        return size;
+    }
+
+
+    /*static*/ size_t Doc::subtreeSize(const Value *value, slice data) noexcept {
+        size_t valueSize = encodedSize(value);
+        size_t size = data.containsAddress(value) ? valueSize : 0;
+        // Items stored inline in the collection are already counted; only follow pointers:
+        slice extent(value, valueSize);
+        auto addItem = [&](const Value *item) {
+            if (!extent.containsAddress(item))
+                size += subtreeSize(item, data);
+        };
+        switch (value->type()) {
+            case kArray:
+                for (Array::iterator i((const Array*)value); i; ++i)
+                    addItem(i.value());
+                break;
+            case kDict:
+                for (Dict::iterator i((const Dict*)value, false); i; ++i) {
+                    addItem(i.key());
+                    addItem(i.value());
+                }
+                break;
+            default:
+                break;
+        }
+        return size;
+    }
+
+
     bool Doc::setAssociated(void *pointer, const char *type) {
         if (_associatedType && type && strcmp(_associatedType, type) != 0)
             return false;
@@ -110,6 +110,13 @@ namespace fleece { namespace impl {
             SharedKeys* =nullptr,
             slice externDest =nullslice) noexcept;
 
+        /// Creates a Doc on memory it doesn't own, such as a memory-mapped file. The memory must
+        /// remain valid for as long as the Doc exists.
+        Doc(slice unownedData,
+            Trust,
+            SharedKeys* =nullptr,
+            slice externDest =nullslice) noexcept;
+
         Doc(const Doc *parentDoc NONNULL,
             slice subData,
             Trust =kUntrusted) noexcept;
@@ -123,6 +130,25 @@ namespace fleece { namespace impl {
 
         static RetainedConst<Doc> containing(const Value* NONNULL) noexcept;
 
+        /// Creates a new Doc holding a copy of a Value and its descendants, in memory of its own,
+        /// with the same SharedKeys. Retaining a Value keeps its whole Doc's data in memory;
+        /// retaining an extracted copy keeps only what the copy needs.
+        /// If the Value's data is contiguous in its Doc, it's copied as-is; otherwise the Value
+        /// is re-encoded.
+        static Retained<Doc> extract(const Value* NONNULL);
+
+        /// The number of bytes of memory this Doc keeps alive: the sizes of the allocated blocks
+        /// its data and its parent Docs' data are part of, which may be shared with other Docs.
+        /// Memory the Doc doesn't own isn't counted. That includes the `externDest` of an
+        /// amended Doc, i.e. its base document, which the Doc doesn't keep alive; whoever keeps
+        /// the base alive for it should count that too.
+        size_t retainedBytes() const noexcept FLPURE;
+
+        /// Adds up the sizes of the encoded data of an immutable Value and its descendants,
+        /// counting only those that lie within `data`. That's how much of `data` the Value uses,
+        /// which becomes garbage if nothing else refers to it.
+        static size_t subtreeSize(const Value* NONNULL, slice data) noexcept;
+
         const Value* root() const FLPURE               {return _root;}
         const Dict* asDict() const FLPURE              {return _root ? _root->asDict() : nullptr;}
         const Array* asArray() const FLPURE            {return _root ? _root->asArray() : nullptr;}
@@ -154,6 +180,9 @@ namespace fleece { namespace impl {
 
     private:
         void init(Trust) noexcept;
+        static size_t encodedSize(const Value* NONNULL) noexcept;
+        static bool measureSubtree(const Value* NONNULL, slice data,
+                                   const void* &lowest, size_t &size);
 
         const Value*        _root {nullptr};            // The root object of the Fleece
         RetainedConst<Doc>  _parent;
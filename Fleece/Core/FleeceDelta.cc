@@ -0,0 +1,395 @@
+//
+// FleeceDelta.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "FleeceDelta.hh"
+#include "JSONDelta.hh"
+#include "FleeceException.hh"
+#include "MyersDiff.hh"
+#include <vector>
+#include "betterassert.hh"
+
+namespace fleece { namespace impl {
+    using namespace std;
+
+
+    // Opcodes that appear as the first item of an array in a delta. (An empty array is a deletion.)
+    enum {
+        kReplaceOp = 0,         // [0, newValue]
+        kStringPatchOp = 1,     // [1, equal, deleted, insertedData, ...]
+        kArrayPatchOp = 2,      // [2, keptCount, appendedArray|null, index, delta, ...]
+    };
+
+    // A string-patch's matches shorter than this are merged into the surrounding edits,
+    // since the three integers needed to write an edit take more space than they save.
+    static constexpr size_t kMinStringMatchLength = 8;
+
+
+#pragma mark - CREATING DELTAS:
+
+
+    /*static*/ alloc_slice FleeceDelta::create(const Value *old, const Value *nuu) {
+        Encoder enc;
+        if (!FleeceDelta(enc)._write(old, nuu, nullptr)) {
+            // If there is no difference, write a no-op delta:
+            enc.beginDictionary();
+            enc.endDictionary();
+        }
+        return enc.finish();
+    }
+
+
+    // One level of the path from the root to the value being compared. `array` is set if this
+    // level is an array; otherwise it's a dict. The container is only written once something
+    // in it has changed.
+    struct FleeceDelta::pathItem {
+        pathItem *parent;
+        bool isOpen;
+        slice key;                  // Current key, in a dict
+        uint32_t index;             // Current index, in an array
+        const Array *array;         // The new array, if this level is an array
+        uint32_t keptCount;         // Number of items in both the old & new array
+    };
+
+
+    // Writes the containers (and their keys) down to this level, if they haven't been yet.
+    void FleeceDelta::openLevel(pathItem *level) {
+        if (level->isOpen)
+            return;
+        writePath(level->parent);
+        if (level->array) {
+            _encoder->beginArray();
+            _encoder->writeInt(kArrayPatchOp);
+            _encoder->writeUInt(level->keptCount);
+            if (uint32_t count = level->array->count(); count > level->keptCount) {
+                _encoder->beginArray(count - level->keptCount);
+                for (uint32_t i = level->keptCount; i < count; ++i)
+                    _encoder->writeValue(level->array->get(i));
+                _encoder->endArray();
+            } else {
+                _encoder->writeNull();
+            }
+        } else {
+            _encoder->beginDictionary();
+        }
+        level->isOpen = true;
+    }
+
+
+    // Writes the path down to a changed value, ending with its key or index.
+    void FleeceDelta::writePath(pathItem *path) {
+        if (!path)
+            return;
+        openLevel(path);
+        if (path->array)
+            _encoder->writeUInt(path->index);
+        else
+            _encoder->writeKey(path->key);
+    }
+
+
+    // Main encoder function. Called recursively, traversing the hierarchy.
+    bool FleeceDelta::_write(const Value *old, const Value *nuu, pathItem *path) {
+        if (_usuallyFalse(old == nuu))
+            return false;
+        if (old) {
+            if (!nuu) {
+                // `old` was deleted: write []
+                writePath(path);
+                _encoder->beginArray();
+                _encoder->endArray();
+                return true;
+            }
+
+            auto oldType = old->type(), nuuType = nuu->type();
+            if (oldType == nuuType) {
+                if (oldType == kDict) {
+                    // Possibly-modified dict: write a dict with the modified keys
+                    auto oldDict = (const Dict*)old, nuuDict = (const Dict*)nuu;
+                    pathItem curLevel = {path, false, nullslice, 0, nullptr, 0};
+                    unsigned oldKeysSeen = 0;
+                    for (Dict::iterator i_nuu(nuuDict); i_nuu; ++i_nuu) {
+                        slice key = i_nuu.keyString();
+                        auto oldValue = oldDict->get(key);
+                        if (oldValue)
+                            ++oldKeysSeen;
+                        curLevel.key = key;
+                        _write(oldValue, i_nuu.value(), &curLevel);
+                    }
+                    if (oldKeysSeen < oldDict->count()) {
+                        for (Dict::iterator i_old(oldDict); i_old; ++i_old) {
+                            slice key = i_old.keyString();
+                            if (nuuDict->get(key) == nullptr) {
+                                curLevel.key = key;
+                                _write(i_old.value(), nullptr, &curLevel);
+                            }
+                        }
+                    }
+                    if (!curLevel.isOpen)
+                        return false;
+                    _encoder->endDictionary();
+                    return true;
+
+                } else if (oldType == kArray) {
+                    // Possibly-modified array: write the changed items, and the appended ones
+                    auto oldArray = (const Array*)old, nuuArray = (const Array*)nuu;
+                    auto oldCount = oldArray->count(), nuuCount = nuuArray->count();
+                    pathItem curLevel = {path, false, nullslice, 0, nuuArray,
+                                         min(oldCount, nuuCount)};
+                    for (Array::iterator iOld(oldArray), iNew(nuuArray);
+                             curLevel.index < curLevel.keptCount;
+                             ++iOld, ++iNew, ++curLevel.index) {
+                        _write(iOld.value(), iNew.value(), &curLevel);
+                    }
+                    if (oldCount != nuuCount)
+                        openLevel(&curLevel);
+                    if (!curLevel.isOpen)
+                        return false;
+                    _encoder->endArray();
+                    return true;
+
+                } else if (old->isEqual(nuu)) {
+                    return false;
+
+                } else if (oldType == kString) {
+                    if (writeStringDelta(old->asString(), nuu->asString(), path))
+                        return true;
+                    // if there's no smart diff, fall through to the generic case...
+                }
+            }
+        }
+
+        // Generic modification/insertion:
+        writePath(path);
+        if (nuu->type() < kArray) {
+            _encoder->writeValue(nuu);
+        } else {
+            _encoder->beginArray(2);
+            _encoder->writeInt(kReplaceOp);
+            _encoder->writeValue(nuu);
+            _encoder->endArray();
+        }
+        return true;
+    }
+
+
+    // Writes a string patch, unless the strings are too short or too different to be worth it.
+    bool FleeceDelta::writeStringDelta(slice oldStr, slice nuuStr, pathItem *path) {
+        if (nuuStr.size < JSONDelta::gMinStringDiffLength)
+            return false;
+        MyersDiff differ(JSONDelta::gMaxStringDiffDistance, JSONDelta::gTextDiffTimeout);
+        if (!differ.diff(oldStr, nuuStr))
+            return false;
+
+        // Merge hunks separated by short matches, and estimate the size of the patch:
+        vector<MyersDiff::Hunk> hunks;
+        size_t size = 4;
+        for (auto &hunk : differ.hunks()) {
+            if (!hunks.empty() && hunk.oldPos - (hunks.back().oldPos + hunks.back().oldLen)
+                                        < kMinStringMatchLength) {
+                auto &last = hunks.back();
+                size += hunk.nuuPos + hunk.nuuLen - (last.nuuPos + last.nuuLen);
+                last.oldLen = hunk.oldPos + hunk.oldLen - last.oldPos;
+                last.nuuLen = hunk.nuuPos + hunk.nuuLen - last.nuuPos;
+            } else {
+                hunks.push_back(hunk);
+                size += 8 + hunk.nuuLen;
+            }
+            if (size >= nuuStr.size)
+                return false;       // Patch is too long; give up on using a diff
+        }
+
+        writePath(path);
+        _encoder->beginArray(1 + 3 * hunks.size());
+        _encoder->writeInt(kStringPatchOp);
+        size_t pos = 0;
+        for (auto &hunk : hunks) {
+            _encoder->writeUInt(hunk.oldPos - pos);
+            _encoder->writeUInt(hunk.oldLen);
+            _encoder->writeData(slice(offsetby(nuuStr.buf, hunk.nuuPos), hunk.nuuLen));
+            pos = hunk.oldPos + hunk.oldLen;
+        }
+        _encoder->endArray();
+        return true;
+    }
+
+
+#pragma mark - APPLYING DELTAS:
+
+
+    static inline bool isDeletion(const Value *delta) {
+        auto array = delta->asArray();
+        return array && array->empty();
+    }
+
+
+    /*static*/ alloc_slice FleeceDelta::apply(const Value *old, slice fleeceDelta) {
+        Encoder enc;
+        apply(old, fleeceDelta, enc);
+        return enc.finish();
+    }
+
+
+    /*static*/ void FleeceDelta::apply(const Value *old, slice fleeceDelta, Encoder &enc) {
+        const Value *delta = Value::fromData(fleeceDelta);
+        throwIf(!delta, InvalidData, "Delta is not valid Fleece data");
+        FleeceDelta(enc)._apply(old, delta);
+    }
+
+
+    // Recursively applies the delta to the value, going down into the tree
+    void FleeceDelta::_apply(const Value *old, const Value *delta) {
+        switch (delta->type()) {
+            case kArray:
+                _applyOp(old, (const Array*)delta);
+                break;
+            case kDict: {
+                auto deltaDict = (const Dict*)delta;
+                if (old && old->type() == kDict)
+                    _patchDict((const Dict*)old, deltaDict);
+                else if (deltaDict->empty() && old)
+                    _encoder->writeValue(old);
+                else
+                    FleeceException::_throw(InvalidData, "Invalid {...} in delta");
+                break;
+            }
+            default:
+                _encoder->writeValue(delta);
+                break;
+        }
+    }
+
+
+    void FleeceDelta::_applyOp(const Value *old, const Array* NONNULL delta) {
+        if (delta->empty()) {
+            // Deletion. 'undefined' in the context of a dict value means a deletion of a key
+            // inherited from the parent.
+            throwIf(!old, InvalidData, "Invalid deletion in delta");
+            _encoder->writeValue(Value::kUndefinedValue);
+            return;
+        }
+        const Value *op = delta->get(0);
+        throwIf(!op || !op->isInteger(), InvalidData, "Missing opcode in delta");
+        switch (op->asInt()) {
+            case kReplaceOp:
+                throwIf(delta->count() != 2, InvalidData, "Invalid replace in delta");
+                _encoder->writeValue(delta->get(1));
+                break;
+            case kStringPatchOp:
+                _patchString(old, delta);
+                break;
+            case kArrayPatchOp:
+                _patchArray(old, delta);
+                break;
+            default:
+                FleeceException::_throw(InvalidData, "Unknown opcode in delta");
+        }
+    }
+
+
+    void FleeceDelta::_patchDict(const Dict* NONNULL old, const Dict* NONNULL delta) {
+        if (_encoder->valueIsInBase(old)) {
+            // If the old dict is in the base, we can create an inherited dict:
+            _encoder->beginDictionary(old);
+            for (Dict::iterator i(delta); i; ++i) {
+                slice key = i.keyString();
+                _encoder->writeKey(key);
+                _apply(old->get(key), i.value());
+            }
+            _encoder->endDictionary();
+        } else {
+            // In the general case, have to write a new dict from scratch:
+            _encoder->beginDictionary();
+            unsigned deltaKeysUsed = 0;
+            for (Dict::iterator i(old); i; ++i) {
+                slice key = i.keyString();
+                const Value *valueDelta = delta->get(key);
+                if (!valueDelta) {
+                    _encoder->writeKey(key);
+                    _encoder->writeValue(i.value());                  // unaffected
+                } else {
+                    ++deltaKeysUsed;
+                    if (!isDeletion(valueDelta)) {                    // skip deletions
+                        _encoder->writeKey(key);
+                        _apply(i.value(), valueDelta);                // replaced/modified
+                    }
+                }
+            }
+            // Now add the inserted keys:
+            if (deltaKeysUsed < delta->count()) {
+                for (Dict::iterator i(delta); i; ++i) {
+                    slice key = i.keyString();
+                    if (old->get(key) == nullptr) {
+                        _encoder->writeKey(key);
+                        _apply(nullptr, i.value());
+                    }
+                }
+            }
+            _encoder->endDictionary();
+        }
+    }
+
+
+    void FleeceDelta::_patchArray(const Value *old, const Array* NONNULL delta) {
+        const Array *oldArray = old ? old->asArray() : nullptr;
+        uint32_t count = delta->count();
+        throwIf(!oldArray || count < 3 || (count - 3) % 2 != 0, InvalidData,
+                "Invalid array patch in delta");
+        uint64_t keptCount = delta->get(1)->asUnsigned();
+        throwIf(keptCount > oldArray->count(), InvalidData, "Invalid array patch in delta");
+        const Value *appended = delta->get(2);
+        const Array *appendedArray = appended->asArray();
+        throwIf(!appendedArray && appended->type() != kNull, InvalidData,
+                "Invalid array patch in delta");
+
+        _encoder->beginArray(size_t(keptCount) + (appendedArray ? appendedArray->count() : 0));
+        uint32_t next = 3;              // Index in `delta` of the next item to patch
+        uint32_t index = 0;
+        for (Array::iterator iOld(oldArray); index < keptCount; ++iOld, ++index) {
+            if (next < count && delta->get(next)->asUnsigned() == index) {
+                _apply(iOld.value(), delta->get(next + 1));
+                next += 2;
+            } else {
+                _encoder->writeValue(iOld.value());
+            }
+        }
+        throwIf(next != count, InvalidData, "Invalid array index in delta");
+        if (appendedArray) {
+            for (Array::iterator i(appendedArray); i; ++i)
+                _encoder->writeValue(i.value());
+        }
+        _encoder->endArray();
+    }
+
+
+    void FleeceDelta::_patchString(const Value *old, const Array* NONNULL delta) {
+        throwIf(!old || old->type() != kString, InvalidData, "Invalid text patch in delta");
+        slice oldStr = old->asString();
+        uint32_t count = delta->count();
+        throwIf((count - 1) % 3 != 0, InvalidData, "Invalid text patch in delta");
+
+        _stringBuf.clear();
+        size_t pos = 0;
+        for (uint32_t n = 1; n < count; n += 3) {
+            uint64_t equal = delta->get(n)->asUnsigned();
+            uint64_t deleted = delta->get(n + 1)->asUnsigned();
+            slice inserted = delta->get(n + 2)->asData();
+            throwIf(equal + deleted > oldStr.size - pos, InvalidData,
+                    "Invalid length in text patch");
+            _stringBuf.append((const char*)oldStr.buf + pos, size_t(equal));
+            _stringBuf.append((const char*)inserted.buf, inserted.size);
+            pos += size_t(equal + deleted);
+        }
+        _stringBuf.append((const char*)oldStr.buf + pos, oldStr.size - pos);
+        _encoder->writeString(_stringBuf);
+    }
+
+} }
@@ -0,0 +1,62 @@
+//
+// FleeceDelta.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "FleeceImpl.hh"
+#include <string>
+
+namespace fleece { namespace impl {
+
+    /** Like JSONDelta, but the delta is encoded as Fleece instead of JSON: array indexes and
+        string edits are integers, and inserted bytes are raw data. Applying it doesn't need any
+        parsing; the delta is read in place. (The format is described in Deltas.md.)
+        String diffs use JSONDelta's `gMinStringDiffLength`, `gTextDiffTimeout` and
+        `gMaxStringDiffDistance` settings. */
+    class FleeceDelta {
+    public:
+
+        /** Returns Fleece data that describes the changes to turn the value `old` into `nuu`.
+            If the values are equal, the delta is an empty Dict. */
+        static alloc_slice create(const Value *old, const Value *nuu);
+
+        /** Applies a delta created by `create` to the value `old` (which must be equal to the
+            `old` value originally passed to `create`) and returns a Fleece document equal to the
+            original `nuu` value.
+            If the delta is malformed or can't be applied to `old`, throws a FleeceException. */
+        static alloc_slice apply(const Value *old, slice fleeceDelta);
+
+        /** Applies a delta created by `create` to the value `old` and writes the corresponding
+            `nuu` value to the Fleece encoder.
+            If the delta is malformed or can't be applied to `old`, throws a FleeceException. */
+        static void apply(const Value *old, slice fleeceDelta, Encoder&);
+
+    private:
+        struct pathItem;
+
+        explicit FleeceDelta(Encoder &enc)          :_encoder(&enc) { }
+
+        bool _write(const Value *old, const Value *nuu, pathItem *path);
+        bool writeStringDelta(slice oldStr, slice nuuStr, pathItem *path);
+        void openLevel(pathItem*);
+        void writePath(pathItem*);
+
+        void _apply(const Value *old, const Value* NONNULL delta);
+        void _applyOp(const Value *old, const Array* NONNULL delta);
+        void _patchDict(const Dict* NONNULL old, const Dict* NONNULL delta);
+        void _patchArray(const Value *old, const Array* NONNULL delta);
+        void _patchString(const Value *old, const Array* NONNULL delta);
+
+        Encoder*    _encoder;       // Writes the delta when creating, the new value when applying
+        std::string _stringBuf;     // Reused for patched strings
+    };
+
+} }
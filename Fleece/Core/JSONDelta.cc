@@ -18,8 +18,14 @@
 #include "FleeceException.hh"
 #include "TempArray.hh"
 #include "NumConversion.hh"
+#include "MyersDiff.hh"
+#include "MutableArray.hh"
+#include "MutableDict.hh"
+#include <charconv>
 #include <sstream>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include "betterassert.hh"
 
 #pragma clang diagnostic push
@@ -43,14 +49,26 @@ namespace fleece { namespace impl {
 
     float JSONDelta::gTextDiffTimeout = 0.25;
 
+    size_t JSONDelta::gMaxStringDiffDistance = 4096;
+
+    size_t JSONDelta::gMaxArrayDiffDistance = 1000;
+
     // Codes that appear as the 3rd item of an array item in a diff
     enum {
         kDeletionCode = 0,
         kTextDiffCode = 2,
         kArraymoveCode = 3,
+        kDeletionIfPresentCode = 4,     // Written by `compose`, which may not know if it's present
     };
 
 
+    // Is the delta a deletion that's allowed to delete a missing key?
+    static bool isDeletionIfPresent(const Value *delta) {
+        auto array = delta->asArray();
+        return array && array->count() == 3 && array->get(2)->asInt() == kDeletionIfPresentCode;
+    }
+
+
     // Is `c` the 2nd, 3rd, ... byte of a UTF-8 multibyte character?
     // <https://en.wikipedia.org/wiki/UTF-8#Description>
     static inline bool isUTF8Continuation(uint8_t c) {
@@ -58,7 +76,8 @@ namespace fleece { namespace impl {
     }
 
 
-    static void snapToUTF8Character(long &pos, size_t &length, slice str);
+    static void writeStringDeltaOp(string &diff, size_t count, char op);
+    static size_t decimalSize(size_t n);
 
 
 #pragma mark - CREATING DELTAS:
@@ -157,38 +176,12 @@ namespace fleece { namespace impl {
                     return true;
 
                 } else if (oldType == kArray) {
-                    // Scan forwards through unchanged items:
                     auto oldArray = (const Array*)old, nuuArray = (const Array*)nuu;
                     auto oldCount = oldArray->count(), nuuCount = nuuArray->count();
-                    auto minCount = min(oldCount, nuuCount);
-                    if (minCount > 0) {
-                        pathItem curLevel = {path, false, nullslice};
-                        uint32_t index = 0;
-                        constexpr size_t bufSize = 10;
-                        char key[bufSize];
-                        for (Array::iterator iOld(oldArray), iNew(nuuArray); index < minCount;
-                             ++iOld, ++iNew, ++index) {
-                            snprintf(key, bufSize, "%u", index);
-                            curLevel.key = slice(key);
-                            _write(iOld.value(), iNew.value(), &curLevel);
-                        }
-                        if (oldCount != nuuCount) {
-                            snprintf(key, bufSize, "%u-", index);
-                            curLevel.key = slice(key);
-                            writePath(&curLevel);
-                            _encoder->beginArray();
-                            for (; index < nuuCount; ++index) {
-                                _encoder->writeValue(nuuArray->get(index));
-                            }
-                            _encoder->endArray();
-                        }
-                        if (!curLevel.isOpen)
-                            return false;
-                        _encoder->endDictionary();
-                        return true;
-                    } else if (oldCount == 0 && nuuCount == 0) {
+                    if (oldCount > 0 && nuuCount > 0)
+                        return writeArrayDelta(oldArray, nuuArray, path);
+                    else if (oldCount == 0 && nuuCount == 0)
                         return false;
-                    }
 
                 } else if (old->isEqual(nuu)) {
                     // Equal objects: do nothing
@@ -226,6 +219,124 @@ namespace fleece { namespace impl {
     }
 
 
+    // Writes an array delta. The arrays' items are diffed by their hashes, to find runs of items
+    // that were inserted or deleted; the items that weren't are matched up and diffed recursively.
+    // Inserted items that are equal to old items are written as those items' indexes.
+    // If the arrays differ too much to diff, the items at the same indexes are diffed instead.
+    bool JSONDelta::writeArrayDelta(const Array *oldArray, const Array *nuuArray, pathItem *path) {
+        uint32_t oldCount = oldArray->count(), nuuCount = nuuArray->count();
+        vector<uint32_t> oldHashes, nuuHashes;
+        vector<MyersDiff::Hunk> hunks;
+        bool diffed = false;
+        if (!gCompatibleDeltas) {
+            oldHashes.reserve(oldCount);
+            for (Array::iterator i(oldArray); i; ++i)
+                oldHashes.push_back(i.value()->hash());
+            nuuHashes.reserve(nuuCount);
+            for (Array::iterator i(nuuArray); i; ++i)
+                nuuHashes.push_back(i.value()->hash());
+            MyersDiff differ(gMaxArrayDiffDistance, gTextDiffTimeout);
+            if (differ.diff(oldHashes, nuuHashes)) {
+                hunks = differ.hunks();
+                diffed = true;
+            }
+        }
+        if (!diffed) {
+            // Just compare the items at the same indexes:
+            hunks.push_back({0, oldCount, 0, nuuCount});
+            oldHashes.clear();
+        }
+
+        // Maps hashes of old items to their indexes; built the first time it's needed:
+        unordered_map<uint32_t, uint32_t> oldIndexes;
+        auto findOldItem = [&](const Value *item) -> int64_t {
+            if (item->type() < kString || oldHashes.empty())
+                return -1;          // (scalars are too small to be worth referencing)
+            if (oldIndexes.empty()) {
+                for (uint32_t i = oldCount; i-- > 0; )
+                    oldIndexes[oldHashes[i]] = i;
+            }
+            auto found = oldIndexes.find(item->hash());
+            if (found == oldIndexes.end() || !oldArray->get(found->second)->isEqual(item))
+                return -1;
+            return found->second;
+        };
+
+        pathItem curLevel = {path, false, nullslice};
+        constexpr size_t bufSize = 16;
+        char key[bufSize];
+        uint32_t oldPos = 0, nuuPos = 0;
+        // Writes the delta between an old item and the new item it's matched with:
+        auto writeItemDelta = [&](uint32_t n) {
+            for (; n > 0; --n, ++oldPos, ++nuuPos) {
+                snprintf(key, bufSize, "%u", oldPos);
+                curLevel.key = slice(key);
+                _write(oldArray->get(oldPos), nuuArray->get(nuuPos), &curLevel);
+            }
+        };
+
+        vector<int64_t> refs;
+        for (auto &hunk : hunks) {
+            // Items before the hunk are equal, unless their hashes collided, so diff them too:
+            writeItemDelta(uint32_t(hunk.oldPos) - oldPos);
+            // Match up as many of the hunk's items as possible:
+            uint32_t oldLen = uint32_t(hunk.oldLen), nuuLen = uint32_t(hunk.nuuLen);
+            writeItemDelta(min(oldLen, nuuLen));
+            bool atEnd = (hunk.oldPos + hunk.oldLen == oldCount);
+
+            if (oldLen > nuuLen) {
+                // Deleted items: write "n-":count, or "n-":[] if they're at the end
+                snprintf(key, bufSize, "%u-", oldPos);
+                curLevel.key = slice(key);
+                writePath(&curLevel);
+                if (atEnd) {
+                    _encoder->beginArray();
+                    _encoder->endArray();
+                } else {
+                    _encoder->writeUInt(oldLen - nuuLen);
+                }
+                oldPos += oldLen - nuuLen;
+
+            } else if (nuuLen > oldLen) {
+                // Inserted items: write "n+":[...], or "n-":[...] if they're at the end and are
+                // all literal values
+                uint32_t n = nuuLen - oldLen;
+                refs.clear();
+                bool anyRefs = false;
+                for (uint32_t i = 0; i < n; ++i) {
+                    refs.push_back(findOldItem(nuuArray->get(nuuPos + i)));
+                    anyRefs = anyRefs || refs.back() >= 0;
+                }
+                bool literal = atEnd && !anyRefs;
+                snprintf(key, bufSize, "%u%c", oldPos, (literal ? '-' : '+'));
+                curLevel.key = slice(key);
+                writePath(&curLevel);
+                _encoder->beginArray(n);
+                for (uint32_t i = 0; i < n; ++i) {
+                    auto item = nuuArray->get(nuuPos + i);
+                    if (refs[i] >= 0) {
+                        _encoder->writeUInt(uint64_t(refs[i]));
+                    } else if (!literal && (item->type() == kNumber || item->type() == kArray)) {
+                        _encoder->beginArray(1);
+                        _encoder->writeValue(item);
+                        _encoder->endArray();
+                    } else {
+                        _encoder->writeValue(item);
+                    }
+                }
+                _encoder->endArray();
+                nuuPos += n;
+            }
+        }
+        writeItemDelta(oldCount - oldPos);
+
+        if (!curLevel.isOpen)
+            return false;
+        _encoder->endDictionary();
+        return true;
+    }
+
+
 #pragma mark - APPLYING DELTAS:
 
 
@@ -314,6 +425,11 @@ namespace fleece { namespace impl {
                         throwIf(!old, InvalidData, "Invalid deletion in delta");
                         _decoder->writeValue(Value::kUndefinedValue);
                         break;
+                    case kDeletionIfPresentCode:
+                        // Deletion of a dict item that may not exist (absent items are skipped
+                        // by `_patchDict`):
+                        _decoder->writeValue(Value::kUndefinedValue);
+                        break;
                     case kTextDiffCode: {
                         // Text diff:
                         slice oldStr;
@@ -343,8 +459,11 @@ namespace fleece { namespace impl {
             // If the old dict is in the base, we can create an inherited dict:
             _decoder->beginDictionary(old);
             for (Dict::iterator i(delta); i; ++i) {
+                auto oldValue = old->get(i.key());
+                if (!oldValue && isDeletionIfPresent(i.value()))
+                    continue;                                       // key is already absent
                 _decoder->writeKey(i.keyString());
-                _apply(old->get(i.key()), i.value());  // recurse into dict item!
+                _apply(oldValue, i.value());  // recurse into dict item!
             }
             _decoder->endDictionary();
         } else {
@@ -368,7 +487,7 @@ namespace fleece { namespace impl {
             // Now add the inserted keys:
             if (deltaKeysUsed < delta->count()) {
                 for (Dict::iterator i(delta); i; ++i) {
-                    if (old->get(i.key()) == nullptr) {
+                    if (old->get(i.key()) == nullptr && !isDeletionIfPresent(i.value())) {
                         _decoder->writeKey(i.keyString());
                         _apply(nullptr, i.value());  // recurse into insertion
                     }
@@ -382,42 +501,71 @@ namespace fleece { namespace impl {
     inline void JSONDelta::_patchArray(const Array* NONNULL old, const Dict* NONNULL delta) {
         // Array: Incremental update
         _decoder->beginArray();
-        uint32_t index = 0;
-        const Value *remainder = nullptr;
-        constexpr size_t bufSize = 10;
-        for (Array::iterator iOld(old); iOld; ++iOld, ++index) {
-            auto oldItem = iOld.value();
-            char key[bufSize];
+        uint32_t count = old->count();
+        constexpr size_t bufSize = 16;
+        char key[bufSize];
+        Array::iterator iOld(old);
+        for (uint32_t index = 0; index <= count; ) {
+            snprintf(key, bufSize, "%u+", index);
+            if (auto insertion = delta->get(slice(key))) {
+                // Items inserted before this index:
+                _applyArrayInsertion(old, insertion);
+            }
+            snprintf(key, bufSize, "%u-", index);
+            if (auto remainder = delta->get(slice(key))) {
+                if (remainder->type() == kNumber) {
+                    // Deletion of a number of items:
+                    uint64_t n = remainder->asUnsigned();
+                    throwIf(n == 0 || n > count - index, InvalidData,
+                            "Invalid array deletion in delta");
+                    index += uint32_t(n);
+                    iOld += uint32_t(n);
+                    continue;
+                } else {
+                    // Remainder of array is replaced by the array from the delta:
+                    auto remainderArray = remainder->asArray();
+                    throwIf(!remainderArray, InvalidData, "Invalid array remainder in delta");
+                    for (Array::iterator iRem(remainderArray); iRem; ++iRem)
+                        _decoder->writeValue(iRem.value());
+                    break;
+                }
+            }
+            if (index == count)
+                break;
             snprintf(key, bufSize, "%u", index);
-            auto replacement = delta->get(slice(key));
-            if (replacement) {
+            if (auto replacement = delta->get(slice(key))) {
                 // Patch this array item:
-                _apply(oldItem, replacement);
+                _apply(iOld.value(), replacement);
             } else {
-                strcat(key, "-");
-                remainder = delta->get(slice(key));
-                if (remainder) {
-                    break;
-                } else {
-                    // Array item is unaffected:
-                    _decoder->writeValue(oldItem);
-                }
+                // Array item is unaffected:
+                _decoder->writeValue(iOld.value());
             }
+            ++index;
+            ++iOld;
         }
+        _decoder->endArray();
+    }
 
-        if (!remainder) {
-            char key[bufSize];
-            snprintf(key, bufSize, "%u-", old->count());
-            remainder = delta->get(slice(key));
-        }
-        if (remainder) {
-            // Remainder of array is replaced by the array from the delta:
-            auto remainderArray = remainder->asArray();
-            throwIf(!remainderArray, InvalidData, "Invalid array remainder in delta");
-            for (Array::iterator iRem(remainderArray); iRem; ++iRem)
-                _decoder->writeValue(iRem.value());
+
+    // Writes the items of an array of insertions: an integer is the index of an item of `old` to
+    // copy, a single-item array contains a literal item, and anything else is a literal item.
+    void JSONDelta::_applyArrayInsertion(const Array* NONNULL old, const Value *insertion) {
+        auto items = insertion->asArray();
+        throwIf(!items, InvalidData, "Invalid array insertion in delta");
+        for (Array::iterator i(items); i; ++i) {
+            auto item = i.value();
+            if (item->isInteger()) {
+                uint64_t oldIndex = item->asUnsigned();
+                throwIf(item->asInt() < 0 || oldIndex >= old->count(), InvalidData,
+                        "Invalid array index in delta");
+                _decoder->writeValue(old->get(uint32_t(oldIndex)));
+            } else if (auto wrapped = item->asArray(); wrapped) {
+                throwIf(wrapped->count() != 1, InvalidData, "Invalid array insertion in delta");
+                _decoder->writeValue(wrapped->get(0));
+            } else {
+                _decoder->writeValue(item);
+            }
         }
-        _decoder->endArray();
     }
 
 
@@ -429,71 +577,794 @@ namespace fleece { namespace impl {
         if (!array)
             return false;
         auto count = array->count();
-        return count == 0 || (count == 3 && array->get(2)->asInt() == kDeletionCode);
+        if (count == 0)
+            return true;
+        if (count != 3)
+            return false;
+        auto code = array->get(2)->asInt();
+        return code == kDeletionCode || code == kDeletionIfPresentCode;
     }
 
 
-#pragma mark - STRING DELTAS:
 
+#pragma mark - APPLYING DELTAS IN PLACE:
 
-    /*static*/ string JSONDelta::createStringDelta(slice oldStr, slice nuuStr) {
-        if (nuuStr.size < gMinStringDiffLength
-                || (gCompatibleDeltas && oldStr.size > gMinStringDiffLength))
-            return "";
-        diff_match_patch<string> dmp;
-        dmp.Diff_Timeout = gTextDiffTimeout;
-        auto patches = dmp.patch_make(string(oldStr), string(nuuStr));
-
-        if (gCompatibleDeltas)
-            return dmp.patch_toText(patches);
-
-        // Iterate over the diffs, writing the encoded form to the output stream:
-        stringstream diff;
-        long lastOldPos = 0, correction = 0;
-        for (auto patch = patches.begin(); patch != patches.end(); ++patch) {
-            long oldPos = patch->start1 + correction;   // position in oldStr
-            long nuuPos = patch->start2;                // position in nuuStr
-            auto &diffs = patch->diffs;
-            for (auto cur_diff = diffs.begin(); cur_diff != diffs.end(); ++cur_diff) {
-                auto length = cur_diff->text.length();
-                if (cur_diff->operation == diff_match_patch<string>::EQUAL) {
-                    oldPos += narrow_cast<long>(length);
-                    nuuPos += narrow_cast<long>(length);
+
+    namespace {
+        // An operation in an array delta: a key "n", "n+" or "n-", and its value.
+        struct ArrayDeltaOp {
+            uint32_t     index;
+            char         op;            // '=' for a plain index, else '+' or '-'
+            const Value* value;
+        };
+    }
+
+
+    // If the delta replaces the value, returns the new value; else returns nullptr.
+    static const Value* replacementValue(const Value *delta) {
+        auto array = delta->asArray();
+        if (!array)
+            return delta->type() == kDict ? nullptr : delta;
+        switch (array->count()) {
+            case 1:  return array->get(0);
+            case 2:  return array->get(1);          // (JsonDiffPatch format)
+            default: return nullptr;
+        }
+    }
+
+
+    static bool isStringDelta(const Value *delta) {
+        auto array = delta->asArray();
+        return array && array->count() == 3 && array->get(2)->asInt() == kTextDiffCode;
+    }
+
+
+    // Parses a key of an array delta: a decimal index, optionally followed by '+' or '-'.
+    static bool parseArrayDeltaKey(slice key, uint32_t &index, char &op) {
+        auto begin = (const char*)key.buf, end = (const char*)key.end();
+        auto [ptr, ec] = from_chars(begin, end, index);
+        if (ec != errc() || ptr == begin || *begin == '+')
+            return false;
+        if (ptr == end) {
+            op = '=';
+            return true;
+        }
+        op = *ptr;
+        return (op == '+' || op == '-') && ptr + 1 == end;
+    }
+
+
+    // Returns the operations of an array delta, in the order `apply` processes them.
+    static vector<ArrayDeltaOp> arrayDeltaOps(const Dict *delta) {
+        vector<ArrayDeltaOp> ops;
+        ops.reserve(delta->count());
+        for (Dict::iterator i(delta); i; ++i) {
+            ArrayDeltaOp op;
+            throwIf(!parseArrayDeltaKey(i.keyString(), op.index, op.op), InvalidData,
+                    "Invalid array key in delta");
+            op.value = i.value();
+            ops.push_back(op);
+        }
+        auto rank = [](char op) {return op == '+' ? 0 : (op == '-' ? 1 : 2);};
+        sort(ops.begin(), ops.end(), [&](const ArrayDeltaOp &a, const ArrayDeltaOp &b) {
+            return a.index != b.index ? a.index < b.index : rank(a.op) < rank(b.op);
+        });
+        return ops;
+    }
+
+
+    // Parses a JSON delta into a Doc, whose values can be stored in mutable collections.
+    static Retained<Doc> parseDelta(slice jsonDelta, bool isJSON5) {
+        assert_precondition(jsonDelta);
+        string json5;
+        if (isJSON5) {
+            json5 = ConvertJSON5(string(jsonDelta));
+            jsonDelta = slice(json5);
+        }
+        return new Doc(JSONConverter::convertJSON(jsonDelta), Doc::kTrusted);
+    }
+
+
+    // Stores a value in a slot of a mutable collection. A mutable collection is copied, since it
+    // can't be shared by two parents that may later be patched separately.
+    static void storeValue(ValueSlot &slot, const Value *value) {
+        if (value->isMutable()) {
+            if (auto array = value->asArray(); array)
+                return slot.set(array->asMutable()->copy(kDeepCopy));
+            else if (auto dict = value->asDict(); dict)
+                return slot.set(dict->asMutable()->copy(kDeepCopy));
+        }
+        slot.setValue(value);
+    }
+
+
+    /*static*/ void JSONDelta::applyInPlace(MutableDict *dict, slice jsonDelta, bool isJSON5) {
+        Retained<Doc> deltaDoc = parseDelta(jsonDelta, isJSON5);
+        const Value *delta = deltaDoc->root();
+        if (auto patch = delta->asDict(); patch) {
+            _patchInPlace(dict, patch);
+        } else {
+            // The delta replaces the entire dict:
+            auto value = replacementValue(delta);
+            auto nuu = value ? value->asDict() : nullptr;
+            throwIf(!nuu, InvalidData, "Delta doesn't produce a dict");
+            dict->removeAll();
+            for (Dict::iterator i(nuu); i; ++i)
+                dict->set(i.keyString(), i.value());
+        }
+    }
+
+
+    /*static*/ void JSONDelta::applyInPlace(MutableArray *array, slice jsonDelta, bool isJSON5) {
+        Retained<Doc> deltaDoc = parseDelta(jsonDelta, isJSON5);
+        const Value *delta = deltaDoc->root();
+        if (auto patch = delta->asDict(); patch) {
+            _patchInPlace(array, patch);
+        } else {
+            // The delta replaces the entire array:
+            auto value = replacementValue(delta);
+            auto nuu = value ? value->asArray() : nullptr;
+            throwIf(!nuu, InvalidData, "Delta doesn't produce an array");
+            array->resize(0);
+            for (Array::iterator i(nuu); i; ++i)
+                array->append(i.value());
+        }
+    }
+
+
+    // Applies a delta to the item of a mutable collection with the given key or index.
+    template <class COLLECTION, class KEY>
+    void JSONDelta::_applyInPlace(COLLECTION *collection, KEY key, const Value *delta) {
+        const Value *old = collection->get(key);
+        if (auto patch = delta->asDict(); patch) {
+            // Recurse into a nested collection, making it mutable:
+            switch (old ? old->type() : kNull) {
+                case kArray:
+                    _patchInPlace(collection->getMutableArray(key), patch);
+                    break;
+                case kDict:
+                    _patchInPlace(collection->getMutableDict(key), patch);
+                    break;
+                default:
+                    throwIf(!patch->empty() || !old, InvalidData, "Invalid {...} in delta");
+            }
+        } else if (isDeltaDeletion(delta)) {
+            throwIf(!old && !isDeletionIfPresent(delta), InvalidData, "Invalid deletion in delta");
+            if constexpr (std::is_same_v<COLLECTION, MutableDict>)
+                collection->remove(key);
+            else
+                collection->set(key, Value::kUndefinedValue);   // (as `apply` does)
+        } else if (isStringDelta(delta)) {
+            slice oldStr;
+            if (old)
+                oldStr = old->asString();
+            throwIf(!oldStr, InvalidData, "Invalid text replace in delta");
+            slice diff = delta->asArray()->get(0)->asString();
+            throwIf(diff.size == 0, InvalidData, "Invalid text diff in delta");
+            collection->set(key, slice(applyStringDelta(oldStr, diff)));
+        } else if (auto value = replacementValue(delta); value) {
+            throwIf(!old && delta->asArray() && delta->asArray()->count() == 2, InvalidData,
+                    "Invalid replace in delta");
+            collection->set(key, value);
+        } else {
+            FleeceException::_throw(InvalidData, "Bad array count in delta");
+        }
+    }
+
+
+    void JSONDelta::_patchInPlace(MutableDict *dict, const Dict *delta) {
+        for (Dict::iterator i(delta); i; ++i)
+            _applyInPlace(dict, i.keyString(), i.value());
+    }
+
+
+    // Applies an array delta in place. First the operations are checked, and the old items that
+    // insertions copy are saved; then they're performed from the end of the array backwards,
+    // so that each one's index is still correct when it's reached.
+    void JSONDelta::_patchInPlace(MutableArray *array, const Dict *delta) {
+        uint32_t count = array->count();
+        vector<ArrayDeltaOp> ops;
+        Retained<MutableArray> copiedItems;     // Old items copied by insertions
+        uint32_t index = 0;
+        for (auto &op : arrayDeltaOps(delta)) {
+            if (op.index < index)
+                continue;                   // In a deleted range: ignored, as by `apply`
+            if (op.index > count || (op.index == count && op.op == '='))
+                break;                      // Past the end: ignored, as by `apply`
+            index = op.index;
+            ops.push_back(op);
+            if (op.op == '+') {
+                auto items = op.value->asArray();
+                throwIf(!items, InvalidData, "Invalid array insertion in delta");
+                for (Array::iterator i(items); i; ++i) {
+                    auto item = i.value();
+                    if (item->isInteger()) {
+                        uint64_t oldIndex = item->asUnsigned();
+                        throwIf(item->asInt() < 0 || oldIndex >= count, InvalidData,
+                                "Invalid array index in delta");
+                        if (!copiedItems)
+                            copiedItems = MutableArray::newArray();
+                        storeValue(copiedItems->appending(), array->get(uint32_t(oldIndex)));
+                    } else if (auto wrapped = item->asArray(); wrapped) {
+                        throwIf(wrapped->count() != 1, InvalidData,
+                                "Invalid array insertion in delta");
+                    }
+                }
+            } else if (op.op == '-') {
+                if (op.value->type() == kNumber) {
+                    uint64_t n = op.value->asUnsigned();
+                    throwIf(n == 0 || n > count - index, InvalidData,
+                            "Invalid array deletion in delta");
+                    index += uint32_t(n);
                 } else {
-                    // Don't break up a UTF-8 multibyte character:
-                    if (cur_diff->operation == diff_match_patch<string>::DELETE)
-                        snapToUTF8Character(oldPos, length, oldStr);
+                    throwIf(!op.value->asArray(), InvalidData, "Invalid array remainder in delta");
+                    break;                  // The rest of the array is replaced
+                }
+            } else {
+                ++index;
+            }
+        }
+
+        // At each index, the ops are in the order insert, delete, patch; do them in reverse:
+        for (auto op = ops.rbegin(); op != ops.rend(); ++op) {
+            if (op->op == '+') {
+                auto items = op->value->asArray();
+                array->insert(op->index, items->count());
+                // The copied items for this op are the last ones remaining in `copiedItems`:
+                uint32_t nCopied = 0;
+                for (Array::iterator i(items); i; ++i)
+                    nCopied += i.value()->isInteger();
+                uint32_t copiedPos = copiedItems ? copiedItems->count() - nCopied : 0;
+                uint32_t dst = op->index;
+                for (Array::iterator i(items); i; ++i, ++dst) {
+                    auto item = i.value();
+                    if (item->isInteger())
+                        storeValue(array->setting(dst), copiedItems->get(copiedPos++));
+                    else if (auto wrapped = item->asArray(); wrapped)
+                        array->set(dst, wrapped->get(0));
                     else
-                        snapToUTF8Character(nuuPos, length, nuuStr);
+                        array->set(dst, item);
+                }
+                if (nCopied > 0)
+                    copiedItems->resize(copiedPos - nCopied);
+            } else if (op->op == '-') {
+                if (op->value->type() == kNumber) {
+                    array->remove(op->index, uint32_t(op->value->asUnsigned()));
+                } else {
+                    array->resize(op->index);
+                    for (Array::iterator i(op->value->asArray()); i; ++i)
+                        array->append(i.value());
+                }
+            } else {
+                _applyInPlace(array, op->index, op->value);
+            }
+        }
+    }
+
+
+#pragma mark - COMPOSING DELTAS:
+
+
+    namespace {
+        // Thrown when two deltas can't be combined without knowing the value they apply to.
+        struct CantCompose { };
+    }
+
+
+    // Dict-form deltas don't say whether they apply to a dict or an array. Two of them are
+    // treated as array deltas if all their keys are array indexes and some key is an insertion
+    // or deletion. (Deltas that only have plain indexes compose the same way either way.)
+    static bool areArrayDeltas(const Dict *delta1, const Dict *delta2) {
+        bool anyInsertionOrDeletion = false;
+        for (auto delta : {delta1, delta2}) {
+            for (Dict::iterator i(delta); i; ++i) {
+                uint32_t index;
+                char op;
+                if (!parseArrayDeltaKey(i.keyString(), index, op))
+                    return false;
+                anyInsertionOrDeletion = anyInsertionOrDeletion || op != '=';
+            }
+        }
+        return anyInsertionOrDeletion;
+    }
+
+
+    /*static*/ alloc_slice JSONDelta::compose(slice jsonDelta1, slice jsonDelta2, bool json5) {
+        assert_precondition(jsonDelta1 && jsonDelta2);
+        alloc_slice fleeceDelta1, fleeceDelta2;
+        if (json5) {
+            fleeceDelta1 = JSONConverter::convertJSON(ConvertJSON5(string(jsonDelta1)));
+            fleeceDelta2 = JSONConverter::convertJSON(ConvertJSON5(string(jsonDelta2)));
+        } else {
+            fleeceDelta1 = JSONConverter::convertJSON(jsonDelta1);
+            fleeceDelta2 = JSONConverter::convertJSON(jsonDelta2);
+        }
+
+        JSONEncoder enc;
+        enc.setJSON5(json5);
+        try {
+            if (!JSONDelta(enc)._compose(Value::fromTrustedData(fleeceDelta1),
+                                         Value::fromTrustedData(fleeceDelta2), nullptr)) {
+                // The changes cancelled out; write a no-op delta:
+                enc.beginDictionary();
+                enc.endDictionary();
+            }
+        } catch (const CantCompose&) {
+            return nullslice;
+        }
+        return enc.finish();
+    }
+
+
+    // Writes a delta equivalent to applying `delta1` and then `delta2`; either may be nullptr,
+    // meaning no change. Called recursively, traversing the hierarchy.
+    bool JSONDelta::_compose(const Value *delta1, const Value *delta2, pathItem *path) {
+        auto dict1 = delta1 ? delta1->asDict() : nullptr;
+        auto dict2 = delta2 ? delta2->asDict() : nullptr;
+        if (!delta2 || (dict2 && dict2->empty())) {
+            // Only the first delta changes anything:
+            if (!delta1 || (dict1 && dict1->empty()))
+                return false;
+            writePath(path);
+            _encoder->writeValue(delta1);
+            return true;
+        }
+        if (delta1 && path && isDeltaDeletion(delta2) && replacementValue(delta1)) {
+            // `delta2` deletes the value `delta1` replaced; but an insertion looks the same as a
+            // replacement, so the value may not have existed before `delta1`:
+            writePath(path);
+            _encoder->beginArray();
+            _encoder->writeInt(0);
+            _encoder->writeInt(0);
+            _encoder->writeInt(kDeletionIfPresentCode);
+            _encoder->endArray();
+            return true;
+        }
+        if (!delta1 || (dict1 && dict1->empty())
+                || (!dict2 && !isStringDelta(delta2))) {
+            // Only the second delta matters, since it's applied alone or replaces the value:
+            writePath(path);
+            _encoder->writeValue(delta2);
+            return true;
+        }
+
+        // `delta2` modifies the value produced by `delta1`:
+        if (dict1 && dict2) {
+            if (areArrayDeltas(dict1, dict2))
+                return composeArrayDeltas(dict1, dict2, path);
+            else
+                return composeDictDeltas(dict1, dict2, path);
+        } else if (!dict2 && isStringDelta(delta1)) {
+            string diff = composeStringDeltas(delta1->asArray()->get(0)->asString(),
+                                              delta2->asArray()->get(0)->asString());
+            writePath(path);
+            if (!diff.empty()) {
+                _encoder->beginArray();
+                _encoder->writeString(diff);
+                _encoder->writeInt(0);
+                _encoder->writeInt(kTextDiffCode);
+                _encoder->endArray();
+            } else {
+                // (Both strings are empty, and a string delta can't be empty)
+                _encoder->beginArray();
+                _encoder->writeString(""_sl);
+                _encoder->endArray();
+            }
+            return true;
+        } else if (auto value = replacementValue(delta1); value) {
+            // `delta1` replaced the value, so apply `delta2` to its replacement:
+            Encoder enc;
+            JSONDelta(enc)._apply(value, delta2);
+            alloc_slice nuu = enc.finish();
+            writeReplacement(Value::fromTrustedData(nuu), path);
+            return true;
+        } else {
+            FleeceException::_throw(InvalidData, "Incompatible deltas");
+        }
+    }
+
+
+    // Writes a delta that replaces the value with `nuu`.
+    void JSONDelta::writeReplacement(const Value *nuu, pathItem *path) {
+        writePath(path);
+        if (nuu->type() < kArray && path) {
+            _encoder->writeValue(nuu);
+        } else {
+            _encoder->beginArray();
+            _encoder->writeValue(nuu);
+            _encoder->endArray();
+        }
+    }
 
-                    assert(oldPos >= lastOldPos);
-                    if (oldPos > lastOldPos) {
-                        // Write the number of matching bytes since the last insert/delete:
-                        diff << (oldPos-lastOldPos) << '=';
+
+    bool JSONDelta::composeDictDeltas(const Dict *delta1, const Dict *delta2, pathItem *path) {
+        pathItem curLevel = {path, false, nullslice};
+        for (Dict::iterator i(delta1); i; ++i) {
+            curLevel.key = i.keyString();
+            _compose(i.value(), delta2->get(curLevel.key), &curLevel);
+        }
+        for (Dict::iterator i(delta2); i; ++i) {
+            curLevel.key = i.keyString();
+            if (!delta1->get(curLevel.key))
+                _compose(nullptr, i.value(), &curLevel);
+        }
+        if (!curLevel.isOpen)
+            return false;
+        _encoder->endDictionary();
+        return true;
+    }
+
+
+    // Composes two array deltas. `delta1` is applied to a symbolic description of the old array,
+    // giving a description of the intermediate array in terms of the old one; then `delta2` is
+    // applied to that, and the result is written as a delta from the old array.
+    bool JSONDelta::composeArrayDeltas(const Dict *delta1, const Dict *delta2, pathItem *path) {
+        // A run of array items, described in terms of the old array:
+        struct Item {
+            enum Kind : uint8_t {kOld, kCopy, kLiteral};
+            Kind         kind;
+            uint32_t     index = 0;         // kOld, kCopy: index in the old array
+            uint32_t     count = 1;         // kOld: number of consecutive old items (or kAll)
+            const Value* value = nullptr;   // kLiteral: the item
+            const Value* delta1 = nullptr;  // kOld: deltas to apply to the (single) old item
+            const Value* delta2 = nullptr;
+        };
+        static constexpr uint32_t kAll = UINT32_MAX;    // Count of a run that goes to the end
+        vector<alloc_slice> patchedLiterals;            // Keeps patched kLiteral values alive
+
+        auto oldItems = [](uint32_t index, uint32_t count) {
+            Item item {Item::kOld};
+            item.index = index;
+            item.count = count;
+            return item;
+        };
+        auto literal = [](const Value *value) {
+            Item item {Item::kLiteral};
+            item.value = value;
+            return item;
+        };
+        // Reads an item of a "n+" insertion:
+        auto insertion = [&](const Value *v, auto getCopiedItem) -> Item {
+            if (v->isInteger()) {
+                throwIf(v->asInt() < 0 || v->asUnsigned() >= kAll, InvalidData,
+                        "Invalid array index in delta");
+                return getCopiedItem(uint32_t(v->asUnsigned()));
+            } else if (auto wrapped = v->asArray(); wrapped) {
+                throwIf(wrapped->count() != 1, InvalidData, "Invalid array insertion in delta");
+                return literal(wrapped->get(0));
+            } else {
+                return literal(v);
+            }
+        };
+        auto insertionArray = [](const Value *v) {
+            auto array = v->asArray();
+            throwIf(!array, InvalidData, "Invalid array insertion in delta");
+            return array;
+        };
+
+        // Apply delta1 to the old array, giving the intermediate array:
+        vector<Item> mid;
+        uint32_t oldPos = 0;
+        bool midEnds = false;
+        for (auto &op : arrayDeltaOps(delta1)) {
+            if (op.index < oldPos)
+                continue;           // (in a deleted range, so ignored by `apply` too)
+            if (op.index > oldPos)
+                mid.push_back(oldItems(oldPos, op.index - oldPos));
+            oldPos = op.index;
+            if (op.op == '+') {
+                for (Array::iterator i(insertionArray(op.value)); i; ++i) {
+                    mid.push_back(insertion(i.value(), [&](uint32_t index) {
+                        Item item {Item::kCopy};
+                        item.index = index;
+                        return item;
+                    }));
+                }
+            } else if (op.op == '-') {
+                if (op.value->type() == kNumber) {
+                    uint64_t n = op.value->asUnsigned();
+                    throwIf(n == 0 || n >= kAll - oldPos, InvalidData,
+                            "Invalid array deletion in delta");
+                    oldPos += uint32_t(n);
+                } else {
+                    for (Array::iterator i(insertionArray(op.value)); i; ++i)
+                        mid.push_back(literal(i.value()));
+                    midEnds = true;
+                    break;
+                }
+            } else {
+                Item item = oldItems(oldPos++, 1);
+                item.delta1 = op.value;
+                mid.push_back(item);
+            }
+        }
+        if (!midEnds)
+            mid.push_back(oldItems(oldPos, kAll));
+
+        // Returns the item at an index of the intermediate array, as an item that can be inserted
+        // anywhere (i.e. a copy or a literal):
+        vector<uint64_t> midStarts;
+        auto midItem = [&](uint32_t midIndex) -> Item {
+            if (midStarts.empty()) {
+                uint64_t start = 0;
+                for (auto &item : mid) {
+                    midStarts.push_back(start);
+                    start += item.count;
+                }
+            }
+            auto i = upper_bound(midStarts.begin(), midStarts.end(), midIndex);
+            throwIf(i == midStarts.begin(), InvalidData, "Invalid array index in delta");
+            --i;
+            Item item = mid[i - midStarts.begin()];
+            uint64_t offset = midIndex - *i;
+            throwIf(offset >= item.count, InvalidData, "Invalid array index in delta");
+            if (item.kind != Item::kOld)
+                return item;
+            if (item.delta1) {
+                if (auto value = replacementValue(item.delta1); value)
+                    return literal(value);
+                throw CantCompose();            // Can't copy a modified item
+            }
+            Item copy {Item::kCopy};
+            copy.index = item.index + uint32_t(offset);
+            return copy;
+        };
+
+        // Apply delta2 to the intermediate array, giving the new array:
+        vector<Item> nuu;
+        size_t midItemNo = 0;           // Position in `mid`: the item,
+        uint32_t midOffset = 0;         // and the offset within its run
+        uint32_t midPos = 0;
+        bool nuuEnds = false;
+        // Moves forward `n` items in the intermediate array (or to its end, if `n` is kAll),
+        // copying them to `nuu` if `copy` is true:
+        auto advance = [&](uint64_t n, bool copy) {
+            bool toEnd = (n == kAll);
+            while (n > 0) {
+                if (midItemNo >= mid.size()) {
+                    throwIf(!toEnd, InvalidData, "Invalid array index in delta");
+                    return;
+                }
+                Item &item = mid[midItemNo];
+                bool unbounded = (item.count == kAll);
+                if (unbounded && toEnd) {
+                    if (copy) {
+                        nuu.push_back(item);
+                        nuu.back().index += midOffset;
                     }
-                    if (cur_diff->operation == diff_match_patch<string>::DELETE) {
-                        // Write the number of deleted bytes:
-                        diff << length << '-';
-                        oldPos += narrow_cast<long>(length);
-                    } else /* INSERT */ {
-                        // Write an insertion, both the count and the bytes:
-                        diff << length << '+';
-                        diff.write((const char*)&nuuStr[nuuPos], length);
-                        diff << '|';
-                        nuuPos += narrow_cast<long>(length);
+                    return;
+                }
+                uint64_t avail = unbounded ? n : item.count - midOffset;
+                auto k = uint32_t(min(n, avail));
+                if (copy) {
+                    nuu.push_back(item);
+                    if (item.kind == Item::kOld) {
+                        nuu.back().index += midOffset;
+                        nuu.back().count = k;
                     }
-                    lastOldPos = oldPos;
                 }
-                if ((size_t)diff.tellp() + 6 >= nuuStr.size)
-                    return "";          // Patch is too long; give up on using a diff
+                midOffset += k;
+                midPos += k;
+                if (!toEnd)
+                    n -= k;
+                if (!unbounded && midOffset == item.count) {
+                    ++midItemNo;
+                    midOffset = 0;
+                }
             }
-            correction += patch->length1 - patch->length2;
+        };
+
+        for (auto &op : arrayDeltaOps(delta2)) {
+            if (op.index < midPos)
+                continue;
+            advance(op.index - midPos, true);
+            if (op.op == '+') {
+                for (Array::iterator i(insertionArray(op.value)); i; ++i)
+                    nuu.push_back(insertion(i.value(), midItem));
+            } else if (op.op == '-') {
+                if (op.value->type() == kNumber) {
+                    uint64_t n = op.value->asUnsigned();
+                    throwIf(n == 0 || n >= kAll - midPos, InvalidData,
+                            "Invalid array deletion in delta");
+                    advance(n, false);
+                } else {
+                    for (Array::iterator i(insertionArray(op.value)); i; ++i)
+                        nuu.push_back(literal(i.value()));
+                    nuuEnds = true;
+                    break;
+                }
+            } else {
+                throwIf(midItemNo >= mid.size(), InvalidData, "Invalid array index in delta");
+                Item item = mid[midItemNo];
+                if (item.kind == Item::kOld) {
+                    item.index += midOffset;
+                    item.count = 1;
+                    item.delta2 = op.value;
+                } else if (item.kind == Item::kLiteral) {
+                    Encoder enc;
+                    JSONDelta(enc)._apply(item.value, op.value);
+                    patchedLiterals.push_back(enc.finish());
+                    item.value = Value::fromTrustedData(patchedLiterals.back());
+                } else if (auto value = replacementValue(op.value); value) {
+                    item = literal(value);
+                } else {
+                    throw CantCompose();        // Can't modify a copied item
+                }
+                nuu.push_back(item);
+                advance(1, false);
+            }
+        }
+        if (!nuuEnds) {
+            // Copy the rest of the intermediate array:
+            advance(kAll, true);
+            nuuEnds = midEnds;
+        }
+
+        // Now write the new array as a delta from the old one:
+        pathItem curLevel = {path, false, nullslice};
+        constexpr size_t bufSize = 16;
+        char key[bufSize];
+        vector<Item> inserted;
+        bool insertedCopies = false;
+        uint32_t pos = 0;
+        auto writeKey = [&](uint32_t index, const char *suffix) {
+            snprintf(key, bufSize, "%u%s", index, suffix);
+            curLevel.key = slice(key);
+            writePath(&curLevel);
+        };
+        auto writeInserted = [&](bool wrapLiterals) {
+            _encoder->beginArray(inserted.size());
+            for (auto &item : inserted) {
+                if (item.kind == Item::kCopy) {
+                    _encoder->writeUInt(item.index);
+                } else if (wrapLiterals && (item.value->type() == kNumber
+                                            || item.value->type() == kArray)) {
+                    _encoder->beginArray(1);
+                    _encoder->writeValue(item.value);
+                    _encoder->endArray();
+                } else {
+                    _encoder->writeValue(item.value);
+                }
+            }
+            _encoder->endArray();
+            inserted.clear();
+            insertedCopies = false;
+        };
+        for (auto &item : nuu) {
+            if (item.kind == Item::kOld) {
+                // Write the items inserted before this one, and the old items deleted:
+                if (!inserted.empty()) {
+                    writeKey(pos, "+");
+                    writeInserted(true);
+                }
+                if (item.index > pos) {
+                    writeKey(pos, "-");
+                    _encoder->writeUInt(item.index - pos);
+                }
+                if (item.count == kAll)
+                    break;
+                if (item.delta1 || item.delta2) {
+                    snprintf(key, bufSize, "%u", item.index);
+                    curLevel.key = slice(key);
+                    _compose(item.delta1, item.delta2, &curLevel);
+                }
+                pos = item.index + item.count;
+            } else {
+                inserted.push_back(item);
+                insertedCopies = insertedCopies || item.kind == Item::kCopy;
+            }
+        }
+        if (nuuEnds) {
+            // The new array ends with the inserted items, so the remaining old items are deleted:
+            if (insertedCopies) {
+                writeKey(pos, "+");
+                writeInserted(true);
+            }
+            writeKey(pos, "-");
+            writeInserted(false);
+        }
+
+        if (!curLevel.isOpen)
+            return false;
+        _encoder->endDictionary();
+        return true;
+    }
+
+
+#pragma mark - STRING DELTAS:
+
+
+    /*static*/ string JSONDelta::createStringDelta(slice oldStr, slice nuuStr) {
+        if (nuuStr.size < gMinStringDiffLength
+                || (gCompatibleDeltas && oldStr.size > gMinStringDiffLength))
+            return "";
+
+        if (gCompatibleDeltas) {
+            diff_match_patch<string> dmp;
+            dmp.Diff_Timeout = gTextDiffTimeout;
+            return dmp.patch_toText(dmp.patch_make(string(oldStr), string(nuuStr)));
+        }
+
+        MyersDiff differ(gMaxStringDiffDistance, gTextDiffTimeout);
+        if (!differ.diff(oldStr, nuuStr))
+            return "";              // Too different; give up on using a diff
+
+        // Don't break up a UTF-8 multibyte character: move the start of a hunk back, and its
+        // end forward, until they're at character boundaries in both strings. (The bytes being
+        // moved over are equal in both.)
+        auto atCharBoundary = [&](size_t oldPos, size_t nuuPos) {
+            return (oldPos >= oldStr.size || !isUTF8Continuation(oldStr[oldPos]))
+                && (nuuPos >= nuuStr.size || !isUTF8Continuation(nuuStr[nuuPos]));
+        };
+        auto snapStart = [&](size_t &oldPos, size_t &nuuPos, size_t minOldPos) {
+            while (oldPos > minOldPos && !atCharBoundary(oldPos, nuuPos)) {
+                --oldPos;
+                --nuuPos;
+            }
+        };
+        auto snapEnd = [&](size_t &oldEnd, size_t &nuuEnd, size_t maxOldEnd) {
+            while (oldEnd < maxOldEnd && !atCharBoundary(oldEnd, nuuEnd)) {
+                ++oldEnd;
+                ++nuuEnd;
+            }
+        };
+
+        // Write the hunks in encoded form. Two hunks are merged unless that takes more space than
+        // writing the matching bytes between them as a match. `hunkSize` is the encoded size of
+        // a hunk's deletion and insertion.
+        auto hunkSize = [](size_t oldLen, size_t nuuLen) {
+            return (oldLen ? decimalSize(oldLen) + 1 : 0)
+                 + (nuuLen ? decimalSize(nuuLen) + 2 + nuuLen : 0);
+        };
+        auto &hunks = differ.hunks();
+        string diff;
+        size_t lastOldPos = 0;
+        for (size_t i = 0; i < hunks.size(); ) {
+            size_t oldPos = hunks[i].oldPos, nuuPos = hunks[i].nuuPos;
+            size_t oldEnd = oldPos + hunks[i].oldLen, nuuEnd = nuuPos + hunks[i].nuuLen;
+            snapStart(oldPos, nuuPos, lastOldPos);
+            while (true) {
+                ++i;
+                snapEnd(oldEnd, nuuEnd, (i < hunks.size()) ? hunks[i].oldPos : oldStr.size);
+                if (i == hunks.size())
+                    break;
+                size_t nextOldPos = hunks[i].oldPos, nextNuuPos = hunks[i].nuuPos;
+                snapStart(nextOldPos, nextNuuPos, oldEnd);
+                size_t nextOldEnd = hunks[i].oldPos + hunks[i].oldLen;
+                size_t nextNuuEnd = hunks[i].nuuPos + hunks[i].nuuLen;
+                size_t match = nextOldPos - oldEnd;
+                size_t separateSize = hunkSize(oldEnd - oldPos, nuuEnd - nuuPos)
+                                    + decimalSize(match) + 1
+                                    + hunkSize(nextOldEnd - nextOldPos, nextNuuEnd - nextNuuPos);
+                if (hunkSize(nextOldEnd - oldPos, nextNuuEnd - nuuPos) > separateSize)
+                    break;
+                oldEnd = nextOldEnd;
+                nuuEnd = nextNuuEnd;
+            }
+
+            if (oldPos > lastOldPos) {
+                // Write the number of matching bytes since the last insert/delete:
+                writeStringDeltaOp(diff, oldPos - lastOldPos, '=');
+            }
+            if (oldEnd > oldPos) {
+                // Write the number of deleted bytes:
+                writeStringDeltaOp(diff, oldEnd - oldPos, '-');
+            }
+            if (nuuEnd > nuuPos) {
+                // Write an insertion, both the count and the bytes:
+                writeStringDeltaOp(diff, nuuEnd - nuuPos, '+');
+                diff.append((const char*)&nuuStr[nuuPos], nuuEnd - nuuPos);
+                diff += '|';
+            }
+            lastOldPos = oldEnd;
+            if (diff.size() + 6 >= nuuStr.size)
+                return "";          // Patch is too long; give up on using a diff
         }
-        if (oldStr.size > size_t(lastOldPos)) {
+        if (oldStr.size > lastOldPos) {
             // Write a final matching-bytes count:
-            diff << (oldStr.size-lastOldPos) << '=';
+            writeStringDeltaOp(diff, oldStr.size - lastOldPos, '=');
         }
-        return diff.str();
+        return diff;
     }
 
 
@@ -541,17 +1412,131 @@ namespace fleece { namespace impl {
     }
 
 
-    // Given a byte range (`pos`, `length`) in the slice `str`, if either end of the range falls
-    // in the middle of a UTF-8 multibyte character, push it _outwards_ to include the entire char.
-    static void snapToUTF8Character(long &pos, size_t &length, slice str) {
-        while (isUTF8Continuation(str[pos])) {
-            --pos;
-            throwIf(pos < 0, InvalidData, "Invalid UTF-8 at start of a string");
-            ++length;
+    // Reads the next operation from a string delta and advances `diff` past it. Returns the
+    // operation character, and stores its count in `len` and an insertion's bytes in `insertion`.
+    static char readStringDeltaOp(slice &diff, size_t &len, slice &insertion) {
+        auto end = (const char*)diff.end();
+        auto [ptr, ec] = from_chars((const char*)diff.buf, end, len);
+        throwIf(ec != errc() || ptr == end, InvalidData, "Invalid text delta");
+        char op = *ptr++;
+        if (op == '+') {
+            throwIf(len >= size_t(end - ptr) || ptr[len] != '|', InvalidData,
+                    "Missing insertion delimiter in text delta");
+            insertion = slice(ptr, len);
+            ptr += len + 1;
+        } else {
+            throwIf(op != '=' && op != '-', InvalidData, "Unknown op in text delta");
         }
-        while (pos+length < str.size && isUTF8Continuation(str[pos+length])) {
-            ++length;
+        diff.setStart(ptr);
+        return op;
+    }
+
+
+    // Composes two string deltas. The first is read into a list of pieces of the intermediate
+    // string, each either a range of the old string or inserted bytes; then the second delta's
+    // operations are applied to those pieces.
+    /*static*/ string JSONDelta::composeStringDeltas(slice diff1, slice diff2) {
+        struct Piece {
+            size_t oldPos;          // Position in old string, if `inserted` is null
+            slice  inserted;        // Inserted bytes
+            size_t size;
+        };
+        vector<Piece> mid;
+        size_t oldSize = 0, len;
+        slice insertion;
+        while (diff1.size > 0) {
+            switch (readStringDeltaOp(diff1, len, insertion)) {
+                case '=':   mid.push_back({oldSize, nullslice, len}); oldSize += len; break;
+                case '-':   oldSize += len; break;
+                default:    mid.push_back({0, insertion, len}); break;
+            }
         }
+
+        // Writes the result, merging consecutive operations of the same kind:
+        string diff;
+        size_t oldPos = 0;                  // Position in the old string
+        size_t copying = 0;                 // Number of old bytes being copied
+        string inserting;                   // Bytes being inserted
+        auto flushCopy = [&] {
+            if (copying > 0)
+                writeStringDeltaOp(diff, copying, '=');
+            copying = 0;
+        };
+        auto flushInsert = [&] {
+            if (!inserting.empty()) {
+                writeStringDeltaOp(diff, inserting.size(), '+');
+                diff += inserting;
+                diff += '|';
+                inserting.clear();
+            }
+        };
+        auto copyOld = [&](size_t pos, size_t n) {
+            if (pos > oldPos || !inserting.empty()) {
+                flushCopy();
+                if (pos > oldPos)
+                    writeStringDeltaOp(diff, pos - oldPos, '-');
+                flushInsert();
+            }
+            copying += n;
+            oldPos = pos + n;
+        };
+        auto insert = [&](slice bytes) {
+            flushCopy();
+            inserting.append((const char*)bytes.buf, bytes.size);
+        };
+
+        // Apply the second delta to the pieces:
+        size_t pieceNo = 0, offset = 0;     // Current position in `mid`
+        while (diff2.size > 0) {
+            char op = readStringDeltaOp(diff2, len, insertion);
+            if (op == '+') {
+                insert(insertion);
+                continue;
+            }
+            while (len > 0) {
+                throwIf(pieceNo >= mid.size(), InvalidData, "Invalid length in text delta");
+                Piece &piece = mid[pieceNo];
+                size_t n = min(len, piece.size - offset);
+                if (op == '=') {
+                    if (piece.inserted)
+                        insert(piece.inserted.from(offset).upTo(n));
+                    else
+                        copyOld(piece.oldPos + offset, n);
+                }
+                offset += n;
+                len -= n;
+                if (offset == piece.size) {
+                    ++pieceNo;
+                    offset = 0;
+                }
+            }
+        }
+        throwIf(pieceNo < mid.size(), InvalidData, "Length mismatch in text delta");
+        if (oldPos < oldSize) {
+            flushCopy();
+            writeStringDeltaOp(diff, oldSize - oldPos, '-');
+        }
+        flushCopy();
+        flushInsert();
+        return diff;
+    }
+
+
+    // Appends a string-delta operation, i.e. a decimal count followed by an op character.
+    static void writeStringDeltaOp(string &diff, size_t count, char op) {
+        char buf[24];
+        auto result = to_chars(&buf[0], &buf[sizeof(buf) - 1], count);
+        *result.ptr++ = op;
+        diff.append(buf, result.ptr);
+    }
+
+
+    // The number of digits in the decimal form of `n`.
+    static size_t decimalSize(size_t n) {
+        size_t size = 1;
+        for (; n >= 10; n /= 10)
+            ++size;
+        return size;
     }
 
 } }
@@ -16,6 +16,8 @@
 
 namespace fleece { namespace impl {
     class JSONEncoder;
+    class MutableArray;
+    class MutableDict;
 
 
     class JSONDelta {
@@ -42,6 +44,27 @@ namespace fleece { namespace impl {
             If the delta is malformed or can't be applied to `old`, throws a FleeceException. */
         static void apply(const Value *old, slice jsonDelta, bool isJSON5, Encoder&);
 
+        /** Applies the JSON delta created by `create` to a mutable Dict, in place, instead of
+            writing a new document. Only the values the delta changes are touched, and nested
+            collections are promoted to mutable only if the delta changes them, so the cost is
+            proportional to the size of the delta rather than of the Dict.
+            If the delta is malformed or can't be applied, throws a FleeceException; the Dict may
+            then have been partly modified. */
+        static void applyInPlace(MutableDict* NONNULL, slice jsonDelta, bool isJSON5 =false);
+
+        /** Applies the JSON delta created by `create` to a mutable Array, in place. */
+        static void applyInPlace(MutableArray* NONNULL, slice jsonDelta, bool isJSON5 =false);
+
+        /** Combines two deltas into one: if `jsonDelta1` changes a value A into B, and
+            `jsonDelta2` changes B into C, the result changes A into C. The deltas are combined
+            directly, without needing any of the values, so a chain of deltas can be collapsed
+            into one and applied in a single pass.
+            Returns nullslice if the deltas can't be combined without knowing A, which happens
+            when `jsonDelta2` copies an array item that `jsonDelta1` modified; in that case,
+            apply them one at a time.
+            If a delta is malformed, throws a FleeceException. */
+        static alloc_slice compose(slice jsonDelta1, slice jsonDelta2, bool json5 =false);
+
         /** Minimum byte length of strings that will be considered for diffing (default 60) */
         static size_t gMinStringDiffLength;
 
@@ -49,22 +72,44 @@ namespace fleece { namespace impl {
             (default 0.25) */
         static float gTextDiffTimeout;
 
+        /** Maximum edit distance (bytes deleted plus bytes inserted) the string-diff algorithm
+            will search for. Strings that differ by more are replaced entirely. (default 4096) */
+        static size_t gMaxStringDiffDistance;
+
+        /** Maximum edit distance (items deleted plus items inserted) the array-diff algorithm
+            will search for. Arrays that differ by more are diffed item by item, by index.
+            (default 1000) */
+        static size_t gMaxArrayDiffDistance;
+
     private:
         struct pathItem;
 
         JSONDelta(JSONEncoder&);
         bool _write(const Value *old, const Value *nuu, pathItem *path);
+        bool writeArrayDelta(const Array *old, const Array *nuu, pathItem *path);
+
+        bool _compose(const Value *delta1, const Value *delta2, pathItem *path);
+        bool composeDictDeltas(const Dict *delta1, const Dict *delta2, pathItem *path);
+        bool composeArrayDeltas(const Dict *delta1, const Dict *delta2, pathItem *path);
+        void writeReplacement(const Value *nuu, pathItem *path);
 
         JSONDelta(Encoder&);
         void _apply(const Value *old, const Value* NONNULL delta);
         void _applyArray(const Value* old, const Array* NONNULL delta);
         void _patchArray(const Array* NONNULL old, const Dict* NONNULL delta);
+        void _applyArrayInsertion(const Array* NONNULL old, const Value *insertion);
         void _patchDict(const Dict* NONNULL old, const Dict* NONNULL delta);
 
+        static void _patchInPlace(MutableDict* NONNULL, const Dict* NONNULL delta);
+        static void _patchInPlace(MutableArray* NONNULL, const Dict* NONNULL delta);
+        template <class COLLECTION, class KEY>
+            static void _applyInPlace(COLLECTION* NONNULL, KEY, const Value* NONNULL delta);
+
         void writePath(pathItem*);
         static bool isDeltaDeletion(const Value *delta);
         static std::string createStringDelta(slice oldStr, slice nuuStr);
         static std::string applyStringDelta(slice oldStr, slice diff);
+        static std::string composeStringDeltas(slice diff1, slice diff2);
 
         JSONEncoder* _encoder;
         Encoder* _decoder;
@@ -11,10 +11,13 @@
 //
 
 #include "Path.hh"
+#include "PathIndex.hh"
 #include "SharedKeys.hh"
 #include "FleeceException.hh"
 #include "fleece/PlatformCompat.hh"
 #include "slice_stream.hh"
+#include "betterassert.hh"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -23,11 +26,15 @@ using namespace std;
 namespace fleece { namespace impl {
 
     void Path::addComponents(slice components) {
-        forEachComponent(components, _path.empty(), [&](char token, slice component, int32_t index) {
-            if (token == '.')
-                _path.emplace_back(component);
-            else
-                _path.emplace_back(index);
+        forEachComponent(components, _path.empty(), [&](char token, slice component,
+                                                         int32_t index, int32_t end) {
+            switch (token) {
+                case '.':   _path.emplace_back(component); break;
+                case '[':   _path.emplace_back(index); break;
+                case '*':   _path.emplace_back(Element::kWildcard); break;
+                case ':':   _path.emplace_back(Element::kSlice, index, end); break;
+                case '~':   _path.emplace_back(Element::kDescendants); break;
+            }
             return true;
         });
     }
@@ -43,6 +50,21 @@ namespace fleece { namespace impl {
         _path.emplace_back(index);
     }
 
+
+    void Path::addWildcard() {
+        _path.emplace_back(Element::kWildcard);
+    }
+
+
+    void Path::addSlice(int32_t start, int32_t end) {
+        _path.emplace_back(Element::kSlice, start, end);
+    }
+
+
+    void Path::addDescendants() {
+        _path.emplace_back(Element::kDescendants);
+    }
+
     
     Path& Path::operator += (const Path &other) {
         _path.reserve(_path.size() + other.size());
@@ -62,6 +84,14 @@ namespace fleece { namespace impl {
     }
 
 
+    bool Path::isLiteral() const noexcept {
+        for (auto &element : _path)
+            if (!element.isLiteral())
+                return false;
+        return true;
+    }
+
+
 #pragma mark - ENCODING:
 
 
@@ -74,11 +104,32 @@ namespace fleece { namespace impl {
 
     void Path::writeTo(std::ostream &out) const {
         bool first = true;
-        for (auto &element : _path) {
-            if (element.isKey())
-                writeProperty(out, element.key().string(), first);
-            else
-                writeIndex(out, element.index());
+        for (auto i = _path.begin(); i != _path.end(); ++i) {
+            switch (i->kind()) {
+                case Element::kKey:
+                    writeProperty(out, i->key().string(), first);
+                    break;
+                case Element::kIndex:
+                    writeIndex(out, i->index());
+                    break;
+                case Element::kWildcard:
+                    out << "[*]";
+                    break;
+                case Element::kSlice:
+                    out << '[';
+                    if (i->index() != 0)
+                        out << i->index();
+                    out << ':';
+                    if (i->sliceEnd() != kSliceToEnd)
+                        out << i->sliceEnd();
+                    out << ']';
+                    break;
+                case Element::kDescendants:
+                    // A following property supplies the second '.' of the ".."
+                    out << ((i + 1 != _path.end() && (i + 1)->isKey()) ? "." : "..");
+                    first = false;
+                    continue;
+            }
             first = false;
         }
     }
@@ -91,6 +142,10 @@ namespace fleece { namespace impl {
         } else {
             out << '.';
         }
+        if (key == "*"_sl) {
+            out << "\\*";                 // else it would be a wildcard
+            return;
+        }
         const uint8_t *toQuote;
         while (nullptr != (toQuote = key.findAnyByteOf(".[\\"_sl))) {
             out.write((const char *)key.buf, toQuote - (const uint8_t*)key.buf);
@@ -114,6 +169,15 @@ namespace fleece { namespace impl {
         if (_usuallyFalse(!item))
             return nullptr;
         for (auto &e : _path) {
+            if (_usuallyFalse(!e.isLiteral())) {
+                // Return the first match of the remainder of the path:
+                const Value *result = nullptr;
+                forEachMatch(&e, _path.end(), item, [&](const Value *match) {
+                    result = match;
+                    return false;
+                });
+                return result;
+            }
             item = e.eval(item);
             if (!item)
                 break;
@@ -122,18 +186,107 @@ namespace fleece { namespace impl {
     }
 
 
+    const Value* Path::eval(const PathIndex &index) const noexcept {
+        if (const Value *value = index.get(*this); value)
+            return value;
+        return eval(index.root());
+    }
+
+
     /*static*/ const Value* Path::eval(slice specifier, const Value *root) {
         const Value *item = root;
         if (_usuallyFalse(!item))
             return nullptr;
-        forEachComponent(specifier, true, [&](char token, slice component, int32_t index) {
+        bool literal = true;
+        forEachComponent(specifier, true, [&](char token, slice component, int32_t index,
+                                              int32_t) {
+            if (_usuallyFalse(token != '.' && token != '[')) {
+                literal = false;
+                return false;
+            }
             item = Element::eval(token, component, index, item);
             return (item != nullptr);
         });
+        if (_usuallyFalse(!literal))
+            return Path(specifier).eval(root);
         return item;
     }
 
 
+    bool Path::forEachMatch(const Value *root, matchCallback callback) const {
+        if (_usuallyFalse(!root))
+            return true;
+        return forEachMatch(_path.begin(), _path.end(), root, callback);
+    }
+
+
+    // Calls the callback on each item of an array or value of a dict, until it returns false.
+    static bool forEachChild(const Value *item, Path::matchCallback callback) {
+        switch (item->type()) {
+            case kArray:
+                for (Array::iterator i((const Array*)item); i; ++i)
+                    if (!callback(i.value()))
+                        return false;
+                break;
+            case kDict:
+                for (Dict::iterator i((const Dict*)item); i; ++i)
+                    if (!callback(i.value()))
+                        return false;
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+
+    // Matches the path elements in [e, end) against `item`. The literal elements are followed
+    // iteratively; the others recurse, once per child value they match.
+    /*static*/ bool Path::forEachMatch(const Element *e, const Element *end, const Value *item,
+                                       matchCallback callback)
+    {
+        for (; e != end; ++e) {
+            switch (e->kind()) {
+                case Element::kKey:
+                case Element::kIndex:
+                    item = e->eval(item);
+                    if (!item)
+                        return true;
+                    break;
+                case Element::kWildcard:
+                    return forEachChild(item, [&](const Value *child) {
+                        return forEachMatch(e + 1, end, child, callback);
+                    });
+                case Element::kSlice: {
+                    auto array = item->asArray();
+                    if (!array)
+                        return true;
+                    auto count = int64_t(array->count());
+                    auto bound = [count](int64_t i) {
+                        if (i < 0)
+                            i += count;
+                        return std::clamp(i, int64_t(0), count);
+                    };
+                    int64_t stop = bound(e->sliceEnd());
+                    for (int64_t i = bound(e->index()); i < stop; ++i) {
+                        if (!forEachMatch(e + 1, end, array->get(uint32_t(i)), callback))
+                            return false;
+                    }
+                    return true;
+                }
+                case Element::kDescendants:
+                    // The item itself, then each child and (recursively) its descendants:
+                    if (!forEachMatch(e + 1, end, item, callback))
+                        return false;
+                    return forEachChild(item, [&](const Value *child) {
+                        return forEachMatch(e, end, child, callback);
+                    });
+            }
+        }
+        return callback(item);
+    }
+
+
     /*static*/ const Value* Path::evalJSONPointer(slice specifier, const Value *root)
     {
         slice_istream in(specifier);
@@ -175,7 +328,16 @@ namespace fleece { namespace impl {
 #pragma mark - PARSING:
 
 
-    // Parses a path expression, calling the callback for each property or array index.
+    static int32_t parseIndex(slice param) {
+        slice_istream n = param;
+        int64_t i = n.readSignedDecimal();
+        throwIf(param.size == 0 || n.size > 0 || i > INT32_MAX || i < INT32_MIN,
+                PathSyntaxError, "Invalid array index");
+        return (int32_t)i;
+    }
+
+
+    // Parses a path expression, calling the callback for each element.
     void Path::forEachComponent(slice specifier, bool atStart, eachComponentCallback callback) {
         slice_istream in(specifier);
         throwIf(in.size == 0, PathSyntaxError, "Empty path");
@@ -207,13 +369,33 @@ namespace fleece { namespace impl {
             return;                     // "." or "" mean the root
 
         while (true) {
+            if (token == '.' && in.size > 0 && in[0] == '.') {
+                // ".." matches descendants. It's followed by a property name or a '[':
+                if (_usuallyFalse(!callback('~', nullslice, 0, 0)))
+                    return;
+                in.skip(1);
+                if (in.size == 0)
+                    break;
+                throwIf(in[0] == '.', PathSyntaxError, "Invalid '...' in path");
+                if (in[0] == '[') {
+                    token = '[';
+                    in.skip(1);
+                }
+            }
+
             // Read parameter (property name or array index):
             const uint8_t* next;
             slice param;
             alloc_slice unescaped;
-            int32_t index = 0;
-
-            if (token == '.') {
+            int32_t index = 0, end = 0;
+
+            if (token == '.' && in.size > 0 && in[0] == '*' && (in.size == 1 || in[1] == '.'
+                                                                || in[1] == '[')) {
+                // ".*" is a wildcard:
+                token = '*';
+                param = slice(in.buf, 1);
+                next = (const uint8_t*)in.buf + 1;
+            } else if (token == '.') {
                 // Find end of property name:
                 next = in.findAnyByteOf(".[\\"_sl);
                 if (next == nullptr) {
@@ -244,19 +426,24 @@ namespace fleece { namespace impl {
                 if (!next)
                     FleeceException::_throw(PathSyntaxError, "Missing ']'");
                 param = slice(in.buf, next++);
-                // Parse array index:
-                slice_istream n = param;
-                int64_t i = n.readSignedDecimal();
-                throwIf(param.size == 0 || n.size > 0 || i > INT32_MAX || i < INT32_MIN,
-                        PathSyntaxError, "Invalid array index");
-                index = (int32_t)i;
+                if (param == "*"_sl) {
+                    token = '*';
+                } else if (auto colon = param.findByte(':'); colon) {
+                    // Parse array slice; either bound may be omitted:
+                    token = ':';
+                    slice startStr(param.buf, colon), endStr(colon + 1, param.end());
+                    index = startStr.size ? parseIndex(startStr) : 0;
+                    end = endStr.size ? parseIndex(endStr) : kSliceToEnd;
+                } else {
+                    index = parseIndex(param);
+                }
             } else {
                 FleeceException::_throw(PathSyntaxError, "Invalid path component");
             }
 
             if (param.size > 0) {
                 // Invoke the callback:
-                if (_usuallyFalse(!callback(token, param, index)))
+                if (_usuallyFalse(!callback(token, param, index, end)))
                     return;
             }
 
@@ -280,9 +467,20 @@ namespace fleece { namespace impl {
     { }
 
 
+    Path::Element::Element(Kind kind, int32_t start, int32_t end)
+    :_index(start)
+    ,_end(end)
+    ,_kind(kind)
+    {
+        assert_precondition(kind >= kWildcard);
+    }
+
+
     Path::Element::Element(const Element &other)
     :_keyBuf(other._keyBuf)
     ,_index(other._index)
+    ,_end(other._end)
+    ,_kind(other._kind)
     {
         if (other._key)
             _key.reset(new Dict::key(_keyBuf));
@@ -290,7 +488,10 @@ namespace fleece { namespace impl {
 
 
     bool Path::Element::operator== (const Element &e) const {
-        return _key ? (_key == e._key) : (_index == e._index);
+        if (_key)
+            return e._key && _key->string() == e._key->string();
+        else
+            return _kind == e._kind && _index == e._index && _end == e._end;
     }
 
 
@@ -300,8 +501,10 @@ namespace fleece { namespace impl {
             if (_usuallyFalse(!d))
                 return nullptr;
             return d->get(*_key);
-        } else {
+        } else if (_usuallyTrue(_kind == kIndex)) {
             return getFromArray(item, _index);
+        } else {
+            return nullptr;
         }
     }
 
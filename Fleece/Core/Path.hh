@@ -19,6 +19,7 @@
 #include <string>
 
 namespace fleece { namespace impl {
+    class PathIndex;
     class SharedKeys;
 
     /** Describes a location in a Fleece object tree, as a path from the root that follows
@@ -28,7 +29,15 @@ namespace fleece { namespace impl {
         indexes in brackets. (Negative indexes count from the end of the array.)
         A leading JSONPath-like "$." is allowed but ignored.
         A '\' can be used to escape a special character ('.', '[' or '$') at the start of a
-        property name (but not yet in the middle of a name.) */
+        property name (but not yet in the middle of a name.)
+
+        A path can also contain JSONPath-like elements that match multiple values:
+        - `[*]` or `.*` matches every item of an array or every value of a dictionary;
+        - `[start:end]` matches a range of array items, like a Python slice: the end is
+          exclusive, either bound may be omitted, and negative bounds count from the end;
+        - `..` matches a value and all of its descendants, so `..sku` is every "sku" property at
+          any depth. (A property actually named `*` must be escaped as `\*`.)
+        Such a path is evaluated with `forEachMatch`; `eval` returns just its first match. */
     class Path {
     public:
         class Element;
@@ -42,8 +51,13 @@ namespace fleece { namespace impl {
         Path()                                      =default;
         void addProperty(slice key);
         void addIndex(int index);
+        void addWildcard();
+        void addSlice(int32_t start, int32_t end =kSliceToEnd);
+        void addDescendants();
         void addComponents(slice components);
 
+        static constexpr int32_t kSliceToEnd = INT32_MAX;   ///< Slice end meaning "to the end"
+
         bool operator== (const Path&) const;
         bool operator!= (const Path& other) const      {return !(*this == other);}
 
@@ -57,13 +71,31 @@ namespace fleece { namespace impl {
         bool empty() const                              {return _path.empty();}
         size_t size() const                             {return _path.size();}
 
+        /** True if the path has no wildcard, slice or descendant elements, so it matches at
+            most one value. */
+        bool isLiteral() const noexcept;
+
         const Element& operator[] (size_t i) const      {return _path[i];}
         Element& operator[] (size_t i)                  {return _path[i];}
 
         //// Evaluation:
 
+        /** Returns the value the path matches, or nullptr. If the path isn't literal, returns
+            its first match in document order. */
         const Value* eval(const Value *root) const noexcept;
 
+        /** Like `eval(index.root())`, but looks the path up in a PathIndex first, which is a
+            single hash probe. Falls back to regular evaluation if the index doesn't have it. */
+        const Value* eval(const PathIndex &index) const noexcept;
+
+        /** Called by `forEachMatch` for each match; returns false to stop. */
+        using matchCallback = function_ref<bool(const Value*)>;
+
+        /** Walks the tree under `root`, calling the callback with each value the path matches, in
+            document order. Nothing is allocated; matches are passed as they're found.
+            Returns false if the callback stopped the iteration. */
+        bool forEachMatch(const Value *root, matchCallback) const;
+
         /** One-shot evaluation; faster if you're only doing it once */
         static const Value* eval(slice specifier,
                                  const Value *root NONNULL);
@@ -90,18 +122,28 @@ namespace fleece { namespace impl {
         static void writeIndex(std::ostream&, int arrayIndex);
 
 
-        /** An element of a Path, representing either a named property or an array index. */
+        /** An element of a Path: a named property, an array index, or one of the elements that
+            can match multiple values (a wildcard, an array slice, or descendants.) */
         class Element {
         public:
+            enum Kind : uint8_t {
+                kKey, kIndex, kWildcard, kSlice, kDescendants
+            };
+
             Element(slice property);
-            Element(int32_t arrayIndex)             :_index(arrayIndex) { }
+            Element(int32_t arrayIndex)             :_index(arrayIndex), _kind(kIndex) { }
+            Element(Kind kind, int32_t start =0, int32_t end =0);
             Element(const Element &e);
             bool operator== (const Element &e) const;
+            Kind kind() const                       {return _kind;}
             bool isKey() const                      {return _key != nullptr;}
+            bool isLiteral() const                  {return _kind <= kIndex;}
             Dict::key& key() const                  {return *_key;}
             slice keyStr() const                    {return _key ? _key->string() : slice();}
-            int32_t index() const                   {return _index;}
+            int32_t index() const                   {return _index;}    // or slice start
+            int32_t sliceEnd() const                {return _end;}
 
+            /** Evaluates a literal element; for other kinds, returns nullptr. */
             const Value* eval(const Value* NONNULL) const noexcept;
             static const Value* eval(char token, slice property, int32_t index,
                                      const Value *item NONNULL) noexcept;
@@ -112,11 +154,17 @@ namespace fleece { namespace impl {
             alloc_slice _keyBuf;
             std::unique_ptr<Dict::key> _key {nullptr};
             int32_t _index {0};
+            int32_t _end {0};
+            Kind _kind {kKey};
         };
 
     private:
-        using eachComponentCallback = function_ref<bool(char,slice,int32_t)>;
+        // Callback params are a token ('.' property, '[' index, '*' wildcard, ':' slice, '~'
+        // descendants), the property name, and the index or slice start & end.
+        using eachComponentCallback = function_ref<bool(char,slice,int32_t,int32_t)>;
         static void forEachComponent(slice in, bool atStart, eachComponentCallback);
+        static bool forEachMatch(const Element *e, const Element *end, const Value *item,
+                                 matchCallback);
 
         smallVector<Element, 4> _path;
     };
@@ -0,0 +1,200 @@
+//
+// PathIndex.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "PathIndex.hh"
+#include "Path.hh"
+#include "DeepIterator.hh"
+#include "Endian.hh"
+#include "FleeceException.hh"
+#include "fleece/PlatformCompat.hh"
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+namespace fleece { namespace impl {
+
+    namespace {
+
+        // Layout of the index data. All integers are little-endian.
+        //   Header:  magic, capacity (a power of 2), count, fleece data size, root offset
+        //   Entries: `capacity` of {path hash (0 if empty): uint64, value offset: uint32}
+        constexpr uint32_t kMagic = 0x49504c46;            // "FLPI"
+        constexpr size_t kHeaderSize = 5 * sizeof(uint32_t);
+        constexpr size_t kEntrySize = sizeof(uint64_t) + sizeof(uint32_t);
+
+        inline uint32_t readUInt32(const uint8_t *p) {
+            uint32_t n;
+            memcpy(&n, p, sizeof(n));
+            return endian::decLittle32(n);
+        }
+
+        inline uint64_t readUInt64(const uint8_t *p) {
+            uint64_t n;
+            memcpy(&n, p, sizeof(n));
+            return endian::decLittle64(n);
+        }
+
+        inline void writeUInt32(uint8_t *p, uint32_t n) {
+            n = endian::encLittle32(n);
+            memcpy(p, &n, sizeof(n));
+        }
+
+        inline void writeUInt64(uint8_t *p, uint64_t n) {
+            n = endian::encLittle64(n);
+            memcpy(p, &n, sizeof(n));
+        }
+
+
+        // A path's hash is built up one component at a time, starting from kRootHash.
+        constexpr uint64_t kRootHash = 0x243f6a8885a308d3;
+
+        inline uint64_t mix(uint64_t h) {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccd;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53;
+            h ^= h >> 33;
+            return h;
+        }
+
+        inline uint64_t hashKey(uint64_t parentHash, slice key) {
+            uint64_t h = 0xcbf29ce484222325;               // FNV-1a
+            for (size_t i = 0; i < key.size; ++i)
+                h = (h ^ key[i]) * 0x100000001b3;
+            return mix(parentHash ^ h);
+        }
+
+        inline uint64_t hashIndex(uint64_t parentHash, uint32_t index) {
+            return mix(parentHash ^ ((uint64_t(index) + 1) * 0x9e3779b97f4a7c15));
+        }
+
+        // Entries use 0 to mark empty slots, so no path may hash to it.
+        inline uint64_t nonZero(uint64_t h)                 {return h ? h : 1;}
+
+    }
+
+
+    /*static*/ alloc_slice PathIndex::build(const Value *root, slice fleeceData) {
+        throwIf(!fleeceData.containsAddress(root), InvalidData, "Root is not in the Fleece data");
+        throwIf(fleeceData.size > UINT32_MAX, InvalidData, "Fleece data is too large to index");
+
+        // Collect the hash and offset of each value, in one pass:
+        vector<pair<uint64_t,uint32_t>> items;
+        vector<uint64_t> hashes;                            // hash of each level of the path
+        for (PreorderIterator i(root); i; ++i) {
+            const Value *value = i.value();
+            if (!fleeceData.containsAddress(value)) {
+                i.skipChildren();                           // (so are its descendants)
+                continue;
+            }
+            size_t depth = i.depth();
+            hashes.resize(depth + 1);
+            if (depth == 0)
+                hashes[0] = kRootHash;
+            else if (i.parent()->type() == kDict)
+                hashes[depth] = hashKey(hashes[depth - 1], i.keyString());
+            else
+                hashes[depth] = hashIndex(hashes[depth - 1], i.index());
+            items.emplace_back(nonZero(hashes[depth]),
+                               uint32_t((const uint8_t*)value - (const uint8_t*)fleeceData.buf));
+        }
+
+        // Store them in an open-addressed hash table, at most 75% full:
+        uint32_t capacity = 4;
+        while (capacity - capacity / 4 < items.size())
+            capacity *= 2;
+        alloc_slice index(kHeaderSize + size_t(capacity) * kEntrySize);
+        auto out = (uint8_t*)index.buf;
+        memset(out, 0, index.size);
+        writeUInt32(out, kMagic);
+        writeUInt32(out + 4, capacity);
+        writeUInt32(out + 8, uint32_t(items.size()));
+        writeUInt32(out + 12, uint32_t(fleeceData.size));
+        writeUInt32(out + 16, uint32_t((const uint8_t*)root - (const uint8_t*)fleeceData.buf));
+        uint8_t *entries = out + kHeaderSize;
+        for (auto &[hash, offset] : items) {
+            uint32_t slot = uint32_t(hash) & (capacity - 1);
+            while (readUInt64(&entries[slot * kEntrySize]) != 0)
+                slot = (slot + 1) & (capacity - 1);
+            writeUInt64(&entries[slot * kEntrySize], hash);
+            writeUInt32(&entries[slot * kEntrySize + sizeof(uint64_t)], offset);
+        }
+        return index;
+    }
+
+
+    PathIndex::PathIndex(slice indexData, slice fleeceData)
+    :_fleeceData(fleeceData)
+    {
+        auto header = (const uint8_t*)indexData.buf;
+        throwIf(indexData.size < kHeaderSize || readUInt32(header) != kMagic,
+                InvalidData, "Not a Fleece path index");
+        uint32_t capacity = readUInt32(header + 4);
+        _mask = capacity - 1;
+        _count = readUInt32(header + 8);
+        _rootOffset = readUInt32(header + 16);
+        throwIf(capacity == 0 || (capacity & _mask) != 0 || _count >= capacity
+                    || indexData.size != kHeaderSize + size_t(capacity) * kEntrySize,
+                InvalidData, "Invalid Fleece path index");
+        throwIf(readUInt32(header + 12) != fleeceData.size || _rootOffset >= fleeceData.size,
+                InvalidData, "Fleece path index doesn't match the data");
+        _entries = header + kHeaderSize;
+
+        // `lookup` stops at an empty slot, so there must be one; check that the header's count
+        // (which is less than the capacity) matches the entries:
+        uint32_t occupied = 0;
+        for (uint32_t slot = 0; slot < capacity; ++slot)
+            occupied += (readUInt64(&_entries[slot * kEntrySize]) != 0);
+        throwIf(occupied != _count, InvalidData, "Invalid Fleece path index");
+    }
+
+
+    const Value* PathIndex::root() const noexcept {
+        return (const Value*)offsetby(_fleeceData.buf, _rootOffset);
+    }
+
+
+    __hot
+    const Value* PathIndex::lookup(uint64_t hash) const noexcept {
+        hash = nonZero(hash);
+        uint32_t slot = uint32_t(hash) & _mask;
+        for (uint32_t n = 0; n <= _mask; ++n, slot = (slot + 1) & _mask) {
+            const uint8_t *entry = &_entries[slot * kEntrySize];
+            uint64_t entryHash = readUInt64(entry);
+            if (entryHash == hash) {
+                uint32_t offset = readUInt32(entry + sizeof(uint64_t));
+                if (_usuallyFalse(offset >= _fleeceData.size))
+                    return nullptr;
+                return (const Value*)offsetby(_fleeceData.buf, offset);
+            } else if (entryHash == 0) {
+                return nullptr;
+            }
+        }
+        return nullptr;                                     // (the table is never full, but...)
+    }
+
+
+    const Value* PathIndex::get(const Path &path) const noexcept {
+        uint64_t hash = kRootHash;
+        for (auto &element : path.path()) {
+            if (element.isKey())
+                hash = hashKey(hash, element.keyStr());
+            else if (element.kind() == Path::Element::kIndex && element.index() >= 0)
+                hash = hashIndex(hash, uint32_t(element.index()));
+            else
+                return nullptr;
+        }
+        return lookup(hash);
+    }
+
+} }
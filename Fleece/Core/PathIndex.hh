@@ -0,0 +1,62 @@
+//
+// PathIndex.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "Value.hh"
+#include "fleece/slice.hh"
+
+namespace fleece { namespace impl {
+    class Path;
+
+    /** A hash table from the paths of the values in a Fleece document to the values' offsets in
+        its data, stored separately from the document. With it, evaluating a deep path in a large
+        document is a single hash probe instead of a Dict or Array lookup at every level.
+
+        The index is built in one pass over the document, and is plain data that can be saved
+        alongside it. It's only valid for the exact data it was built from. Values outside that
+        data, in the base of an amended document, aren't indexed.
+        Paths are identified by 64-bit hashes. Looking up a path that isn't in a document of N
+        values has about an N/2^64 chance of a false match, which is small enough to ignore. */
+    class PathIndex {
+    public:
+        /** Builds an index of `root` and all its descendants. `root` must be in `fleeceData`.
+            Throws FleeceException (InvalidData) if it isn't. */
+        static alloc_slice build(const Value *root NONNULL, slice fleeceData);
+
+        /** Opens an index created by `build` from `fleeceData`. Neither is copied, so both must
+            remain valid while the PathIndex is in use.
+            Throws FleeceException (InvalidData) if the index is malformed or was built from data
+            of a different size. */
+        PathIndex(slice indexData, slice fleeceData);
+
+        /** The root value the index was built from. */
+        const Value* root() const noexcept FLPURE;
+
+        /** The number of values indexed. */
+        size_t count() const noexcept FLPURE                {return _count;}
+
+        /** Returns the value at `path`, or nullptr if the index doesn't contain it. The path must
+            be literal, without negative array indexes, or nullptr is returned.
+            `Path::eval(const PathIndex&)` falls back to regular evaluation instead. */
+        const Value* get(const Path&) const noexcept FLPURE;
+
+    private:
+        const Value* lookup(uint64_t hash) const noexcept FLPURE;
+
+        slice           _fleeceData;
+        const uint8_t*  _entries;
+        uint32_t        _mask;
+        uint32_t        _count;
+        uint32_t        _rootOffset;
+    };
+
+} }
@@ -0,0 +1,70 @@
+//
+// PathProjection.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "PathProjection.hh"
+#include "FleeceException.hh"
+#include "fleece/PlatformCompat.hh"
+#include <algorithm>
+
+using namespace std;
+
+namespace fleece { namespace impl {
+
+    PathProjection::PathProjection() =default;
+
+
+    PathProjection::PathProjection(const vector<Path> &paths) {
+        for (auto &path : paths)
+            addPath(path);
+    }
+
+
+    size_t PathProjection::addPath(const Path &path) {
+        throwIf(!path.isLiteral(), PathSyntaxError, "Projection paths must be literal");
+        Node *node = &_root;
+        for (auto &element : path.path()) {
+            auto &children = node->children;
+            auto i = find_if(children.begin(), children.end(), [&](auto &child) {
+                return child->element == element;
+            });
+            if (i == children.end()) {
+                children.push_back(make_unique<Node>(element));
+                node = children.back().get();
+            } else {
+                node = i->get();
+            }
+        }
+        node->outputs.push_back(uint32_t(_nPaths));
+        return _nPaths++;
+    }
+
+
+    void PathProjection::eval(const Value *root, const Value* outValues[]) const noexcept {
+        // Paths that don't resolve are skipped by evalNode, so start with all outputs null:
+        std::fill_n(outValues, _nPaths, nullptr);
+        if (_usuallyTrue(root != nullptr))
+            evalNode(_root, root, outValues);
+    }
+
+
+    /*static*/ void PathProjection::evalNode(const Node &node, const Value *value,
+                                             const Value* outValues[]) noexcept
+    {
+        for (uint32_t output : node.outputs)
+            outValues[output] = value;
+        for (auto &child : node.children) {
+            if (const Value *childValue = child->element.eval(value); childValue)
+                evalNode(*child, childValue, outValues);
+        }
+    }
+
+} }
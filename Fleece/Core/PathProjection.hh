@@ -0,0 +1,66 @@
+//
+// PathProjection.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "Path.hh"
+#include <vector>
+
+namespace fleece { namespace impl {
+
+    /** Evaluates a set of Paths against a root value in a single traversal.
+        The paths are merged into a tree by common prefix, so a container shared by several
+        paths (like `address.geo` in `address.geo.lat` and `address.geo.lon`) is looked up only
+        once per root, instead of once per path. Each output value is identical to what
+        `Path::eval` would return for that path.
+        Like Path, a PathProjection caches shared-key lookups, so it shouldn't be evaluated on
+        multiple threads at once. */
+    class PathProjection {
+    public:
+        PathProjection();
+
+        /** Constructs a projection of the given paths; their outputs are in the same order. */
+        explicit PathProjection(const std::vector<Path>&);
+
+        /** Adds a path, and returns the index of its value in the output array.
+            Adding the same path twice is allowed; it gets two outputs.
+            Throws FleeceException with code PathSyntaxError if the path isn't literal. */
+        size_t addPath(const Path&);
+
+        /** Adds a path given as a specifier string (see Path.)
+            Throws FleeceException with code PathSyntaxError if it's invalid. */
+        size_t addPath(slice specifier)             {return addPath(Path(specifier));}
+
+        /** The number of paths, i.e. the size of the output array. */
+        size_t size() const                         {return _nPaths;}
+
+        /** Evaluates all the paths against `root`, storing each path's value, or nullptr if it
+            doesn't exist, into `outValues`, which must have room for `size()` items. */
+        void eval(const Value *root, const Value* outValues[]) const noexcept;
+
+    private:
+        struct Node {
+            Node()                                  :element(0) { }
+            explicit Node(const Path::Element &e)   :element(e) { }
+            Node(const Node&) =delete;
+
+            Path::Element           element;        // Path component leading here from the parent
+            std::vector<uint32_t>   outputs;        // Indexes of the paths that end here
+            std::vector<std::unique_ptr<Node>> children;
+        };
+
+        static void evalNode(const Node&, const Value* NONNULL, const Value* outValues[]) noexcept;
+
+        Node    _root;
+        size_t  _nPaths {0};
+    };
+
+} }
@@ -23,6 +23,10 @@
 #include "fleece/PlatformCompat.hh"
 #include "JSONEncoder.hh"
 #include "ParseDate.hh"
+#include "SmallVector.hh"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <math.h>
 #include "betterassert.hh"
 
@@ -272,10 +276,37 @@ namespace fleece { namespace impl {
     }
 
 
+    // Remembers the extent and SharedKeys of the last Doc each side of an isEqual call was found
+    // in. Nested dicts are nearly always in the same Doc, so this saves a locked lookup per dict.
+    struct Value::EqualityScopes {
+        struct Side {
+            slice       data;
+            SharedKeys* sharedKeys {nullptr};
+
+            SharedKeys* lookup(const Value *v) noexcept {
+                if (!data.containsAddress(v)) {
+                    auto scope = Scope::containing(v);
+                    data = scope ? scope->data() : slice();
+                    sharedKeys = scope ? scope->sharedKeys() : nullptr;
+                }
+                return sharedKeys;
+            }
+        };
+
+        Side a, b;
+    };
+
+
     bool Value::isEqual(const Value *v) const {
+        EqualityScopes scopes;
+        return isEqual(v, scopes);
+    }
+
+
+    bool Value::isEqual(const Value *v, EqualityScopes &scopes) const {
         if (!v || _byte[0] != v->_byte[0])
             return false;
-        if (_usuallyFalse(this == v))
+        if (this == v)
             return true;
         switch (tag()) {
             case kShortIntTag:
@@ -292,23 +323,241 @@ namespace fleece { namespace impl {
             case kBinaryTag:
                 return getStringBytes() == v->getStringBytes();
             case kArrayTag: {
-                Array::iterator i((const Array*)this);
-                Array::iterator j((const Array*)v);
-                if (i.count() != j.count())
+                Array::impl a(this), b(v);
+                if (a._count != b._count)
                     return false;
-                for (; i; ++i, ++j)
-                    if (!i.value()->isEqual(j.value()))
+                if (_usuallyTrue(a._width == b._width && !a.isMutableArray())) {
+                    // Identical headers mean identical widths, so compare the raw slots:
+                    if (a._width == kWide)
+                        return slotsEqual<true>(a._first, b._first, a._count, scopes);
+                    else
+                        return slotsEqual<false>(a._first, b._first, a._count, scopes);
+                }
+                for (Array::iterator i((const Array*)this), j((const Array*)v); i; ++i, ++j)
+                    if (!i.value()->isEqual(j.value(), scopes))
                         return false;
                 return true;
             }
             case kDictTag:
-                return ((const Dict*)this)->isEqualToDict((const Dict*)v);
+                return isEqualToDict(v, scopes);
             default:
                 return false;
         }
     }
 
 
+    // Compares two immutable Dicts with the same header byte.
+    bool Value::isEqualToDict(const Value *v, EqualityScopes &scopes) const {
+        auto d = (const Dict*)this, dv = (const Dict*)v;
+        if (isMutable() || v->isMutable())
+            return d->isEqualToDict(dv);
+        Array::impl a(this), b(v);
+        if (a._count == 0 || b._count == 0)
+            return a._count == b._count;
+        if (Dict::isMagicParentKey(a._first) || Dict::isMagicParentKey(b._first))
+            return d->isEqualToDict(dv);
+        if (a._count != b._count)
+            return false;
+
+        // Dicts are sorted with int (shared) keys first, then string keys in byte order. So if
+        // neither Dict has int keys, or all keys of both are ints mapped by the same SharedKeys,
+        // equal Dicts have equal keys in the same order, and can be compared slot by slot.
+        // (A SharedKeys may not have had a key yet when one Dict was encoded, so one Dict could
+        // store it as a string and the other as an int; then the last keys' kinds differ.)
+        auto lastKey = [](const Array::impl &i) {
+            return offsetby(i._first, 2 * (i._count - 1) * i._width);
+        };
+        bool aInts = (a._first->tag() == kShortIntTag), bInts = (b._first->tag() == kShortIntTag);
+        if (aInts != bInts)
+            return d->isEqualToDict(dv);
+        if (aInts) {
+            if (lastKey(a)->tag() != kShortIntTag || lastKey(b)->tag() != kShortIntTag)
+                return d->isEqualToDict(dv);
+            SharedKeys *sk = scopes.a.lookup(this);
+            if (!sk || sk != scopes.b.lookup(v))
+                return d->isEqualToDict(dv);
+        }
+        if (a._width == kWide)
+            return slotsEqual<true>(a._first, b._first, 2 * a._count, scopes);
+        else
+            return slotsEqual<false>(a._first, b._first, 2 * a._count, scopes);
+    }
+
+
+    // Compares consecutive slots of two immutable collections. Identical inline values are equal
+    // without being decoded. Pointers are followed, and if both lead to the same address -- as
+    // they do for unchanged subtrees when one document amends the other via Encoder::setBase --
+    // the values are equal without being visited.
+    template <bool WIDE>
+    __hot
+    bool Value::slotsEqual(const Value *a, const Value *b, uint32_t count,
+                           EqualityScopes &scopes)
+    {
+        constexpr size_t kWidth = WIDE ? kWide : kNarrow;
+        for (; count > 0; --count, a = a->next<WIDE>(), b = b->next<WIDE>()) {
+            if (!a->isPointer() && memcmp(a, b, kWidth) == 0)
+                continue;
+            const Value *va = a->deref<WIDE>(), *vb = b->deref<WIDE>();
+            if (va != vb && !va->isEqual(vb, scopes))
+                return false;
+        }
+        return true;
+    }
+
+
+#pragma mark - ORDERING & HASHING:
+
+
+    // The types in sort order: undefined, null, false, true, numbers, strings, data, arrays, dicts.
+    static int typeRank(const Value *v) noexcept {
+        if (!v)
+            return 0;
+        switch (v->type()) {
+            case kNull:     return v->isUndefined() ? 0 : 1;
+            case kBoolean:  return v->asBool() ? 3 : 2;
+            default:        return int(v->type()) + 2;
+        }
+    }
+
+    template <class T>
+    static int cmp(T a, T b) noexcept               {return (a > b) - (a < b);}
+
+    // Compares an integer with a double exactly. (NaN sorts after all other numbers.)
+    static int compareIntToDouble(const Value *intVal, double d) noexcept {
+        constexpr double kTwoTo63 = 9223372036854775808.0, kTwoTo64 = 18446744073709551616.0;
+        if (std::isnan(d))
+            return -1;
+        if (intVal->isUnsigned()) {
+            uint64_t u = intVal->asUnsigned();
+            if (d < 0) return 1;
+            if (d >= kTwoTo64) return -1;
+            // d is in [0, 2^64); compare its floor, then its fraction:
+            uint64_t floorD = uint64_t(d);
+            if (u != floorD) return cmp(u, floorD);
+            return (double(floorD) < d) ? -1 : 0;
+        } else {
+            int64_t i = intVal->asInt();
+            if (d < -kTwoTo63) return 1;
+            if (d >= kTwoTo63) return -1;
+            double f = std::floor(d);
+            int64_t floorD = int64_t(f);
+            if (i != floorD) return cmp(i, floorD);
+            return (f < d) ? -1 : 0;
+        }
+    }
+
+    static int compareNumbers(const Value *a, const Value *b) noexcept {
+        bool aInt = a->isInteger(), bInt = b->isInteger();
+        if (aInt && bInt) {
+            bool aBig = a->isUnsigned() && a->asUnsigned() > uint64_t(INT64_MAX);
+            bool bBig = b->isUnsigned() && b->asUnsigned() > uint64_t(INT64_MAX);
+            if (aBig || bBig)
+                return (aBig && bBig) ? cmp(a->asUnsigned(), b->asUnsigned()) : (aBig ? 1 : -1);
+            return cmp(a->asInt(), b->asInt());
+        } else if (aInt) {
+            return compareIntToDouble(a, b->asDouble());
+        } else if (bInt) {
+            return -compareIntToDouble(b, a->asDouble());
+        } else {
+            double da = a->asDouble(), db = b->asDouble();
+            if (_usuallyFalse(std::isnan(da) || std::isnan(db)))
+                return cmp(std::isnan(da), std::isnan(db));
+            return cmp(da, db);
+        }
+    }
+
+    // A Dict's items, sorted by key string. (Shared keys make the stored order differ.)
+    static smallVector<std::pair<slice, const Value*>, 16> sortedItems(const Dict *dict) {
+        smallVector<std::pair<slice, const Value*>, 16> items;
+        items.reserve(dict->count());
+        for (Dict::iterator i(dict); i; ++i)
+            items.push_back({i.keyString(), i.value()});
+        std::sort(items.begin(), items.end(), [](auto &a, auto &b) {return a.first < b.first;});
+        return items;
+    }
+
+
+    int Value::compare(const Value *v) const noexcept {
+        if (_usuallyFalse(this == v))
+            return 0;
+        int rank = typeRank(this), vRank = typeRank(v);
+        if (rank != vRank)
+            return rank - vRank;
+        switch (type()) {
+            case kNumber:
+                return compareNumbers(this, v);
+            case kString:
+            case kData:
+                return getStringBytes().compare(v->getStringBytes());
+            case kArray: {
+                Array::iterator i((const Array*)this), j((const Array*)v);
+                for (; i && j; ++i, ++j) {
+                    if (int c = i.value()->compare(j.value()); c != 0)
+                        return c;
+                }
+                return int(bool(i)) - int(bool(j));
+            }
+            case kDict: {
+                auto mine = sortedItems((const Dict*)this), theirs = sortedItems((const Dict*)v);
+                size_t n = std::min(mine.size(), theirs.size());
+                for (size_t k = 0; k < n; ++k) {
+                    if (int c = mine[k].first.compare(theirs[k].first); c != 0)
+                        return c;
+                    if (int c = mine[k].second->compare(theirs[k].second); c != 0)
+                        return c;
+                }
+                return cmp(mine.size(), theirs.size());
+            }
+            default:
+                return 0;   // null, undefined and booleans are entirely described by typeRank
+        }
+    }
+
+
+    uint32_t Value::hash() const noexcept {
+        switch (type()) {
+            case kNull:
+                return isUndefined() ? 0x756E6466 : 0x6E756C6C;
+            case kBoolean:
+                return asBool() ? 0x74727565 : 0x66616C73;
+            case kNumber: {
+                // Hash equivalent numbers identically: integral values as integers.
+                constexpr double kTwoTo63 = 9223372036854775808.0, kTwoTo64 = 18446744073709551616.0;
+                uint64_t bits;
+                if (isInteger()) {
+                    bits = asUnsigned();
+                } else {
+                    double d = asDouble();
+                    if (d == std::floor(d) && d >= -kTwoTo63 && d < kTwoTo64)
+                        bits = (d < kTwoTo63) ? uint64_t(int64_t(d)) : uint64_t(d);
+                    else
+                        memcpy(&bits, &d, sizeof(bits));
+                }
+                return slice(&bits, sizeof(bits)).hash();
+            }
+            case kString:
+                return getStringBytes().hash();
+            case kData:
+                return getStringBytes().hash() + 1;
+            case kArray: {
+                uint32_t h = 0x61727261;
+                for (Array::iterator i((const Array*)this); i; ++i)
+                    h = h * 0x9E3779B1 + i.value()->hash();
+                return h;
+            }
+            case kDict: {
+                // Key order depends on the encoding, so combine the items' hashes commutatively:
+                uint32_t h = 0x64696374;
+                for (Dict::iterator i((const Dict*)this); i; ++i)
+                    h += i.keyString().hash() * 0x9E3779B1 ^ i.value()->hash();
+                return h;
+            }
+            default:
+                return 0;
+        }
+    }
+
+
     bool Value::isMutable() const {
         return HeapValue::isHeapValue(this);
     }
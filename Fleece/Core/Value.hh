@@ -77,6 +77,21 @@ namespace fleece { namespace impl {
         /** Compares two Values for equality. */
         bool isEqual(const Value*) const FLPURE;
 
+        /** Compares two Values, returning a negative number if this one sorts first, 0 if
+            they're equivalent, or a positive number if this one sorts last. This is a total
+            ordering, the same one used by Collatable keys:
+            - Types sort as undefined, null, false, true, numbers, strings, data, arrays, dicts;
+              a nullptr Value is the same as undefined.
+            - Numbers are compared by exact numeric value, so `1` and `1.0` are equivalent.
+            - Strings and data compare by their bytes; arrays lexicographically by their items;
+              dicts like arrays of alternating keys and values, in key order.
+            Unlike \ref isEqual, this treats numbers encoded differently as equivalent. */
+        int compare(const Value*) const noexcept FLPURE;
+
+        /** Returns a hash of the Value's contents. Values that `compare` equivalent have equal
+            hashes, regardless of how they're encoded. */
+        uint32_t hash() const noexcept FLPURE;
+
         //////// Scalar types:
 
         /** Boolean value/conversion. Any value is considered true except false, null, 0. */
@@ -218,6 +233,14 @@ namespace fleece { namespace impl {
         static const Value* findRoot(slice) noexcept FLPURE;
         bool validate(const void* dataStart, const void *dataEnd) const noexcept FLPURE;
 
+        // equality:
+        struct EqualityScopes;
+        bool isEqual(const Value* NONNULL, EqualityScopes&) const FLPURE;
+        bool isEqualToDict(const Value* NONNULL, EqualityScopes&) const FLPURE;
+        template <bool WIDE>
+        static bool slotsEqual(const Value *a, const Value *b, uint32_t count,
+                               EqualityScopes&) FLPURE;
+
         internal::tags tag() const noexcept FLPURE   {return (internal::tags)(_byte[0] >> 4);}
         unsigned tinyValue() const noexcept FLPURE   {return _byte[0] & 0x0F;}
 
@@ -264,6 +287,7 @@ namespace fleece { namespace impl {
         friend class ValueTests;
         friend class EncoderTests;
         friend class ValueDumper;
+        friend class Doc;
         template <bool WIDE> friend struct dictImpl;
     };
 
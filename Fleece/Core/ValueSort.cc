@@ -0,0 +1,141 @@
+//
+// ValueSort.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "ValueSort.hh"
+#include "Array.hh"
+#include "Encoder.hh"
+#include "MutableArray.hh"
+#include "Path.hh"
+#include "FleeceException.hh"
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace fleece { namespace impl {
+
+    namespace {
+
+        // An item to be sorted, and the Value it's sorted by.
+        struct Entry {
+            const Value* key;
+            const Value* item;
+        };
+
+        bool lessThan(const Entry &a, const Entry &b) noexcept {
+            if (_usuallyFalse(!a.key))
+                return b.key && b.key->compare(nullptr) > 0;
+            return a.key->compare(b.key) < 0;
+        }
+
+
+        // Runs `fn(i)` for i in [0, n), on up to n threads.
+        template <class FN>
+        void forEachInParallel(size_t n, FN fn) {
+            if (n == 1) {
+                fn(0);
+                return;
+            }
+            vector<thread> threads;
+            threads.reserve(n);
+            for (size_t i = 0; i < n; ++i)
+                threads.emplace_back(fn, i);
+            for (auto &t : threads)
+                t.join();
+        }
+
+
+        // Stable-sorts `entries` by splitting it into a chunk per thread, sorting the chunks
+        // concurrently, then merging pairs of adjacent runs until one is left.
+        void parallelSort(vector<Entry> &entries, unsigned nThreads) {
+            size_t n = entries.size();
+            if (nThreads <= 1) {
+                stable_sort(entries.begin(), entries.end(), lessThan);
+                return;
+            }
+            vector<size_t> bounds;
+            for (unsigned t = 0; t <= nThreads; ++t)
+                bounds.push_back(n * t / nThreads);
+
+            auto begin = entries.begin();
+            forEachInParallel(nThreads, [&](size_t t) {
+                stable_sort(begin + bounds[t], begin + bounds[t + 1], lessThan);
+            });
+
+            while (bounds.size() > 2) {
+                size_t nMerges = (bounds.size() - 1) / 2;
+                forEachInParallel(nMerges, [&](size_t m) {
+                    inplace_merge(begin + bounds[2*m], begin + bounds[2*m + 1],
+                                  begin + bounds[2*m + 2], lessThan);
+                });
+                // Remove the boundaries between the merged runs:
+                vector<size_t> merged;
+                for (size_t b = 0; b < bounds.size(); b += 2)
+                    merged.push_back(bounds[b]);
+                if (merged.back() != n)
+                    merged.push_back(n);
+                bounds = std::move(merged);
+            }
+        }
+
+    }
+
+
+    /*static*/ vector<const Value*> ValueSort::sortedItems(const Array *array,
+                                                          const Path *key,
+                                                          unsigned maxThreads)
+    {
+        throwIf(key && !key->isLiteral(), PathSyntaxError, "Sort key path must be literal");
+        // Evaluate the keys first, on this thread, since a Path isn't thread-safe:
+        vector<Entry> entries;
+        entries.reserve(array ? array->count() : 0);
+        for (Array::iterator i(array); i; ++i)
+            entries.push_back({key ? key->eval(i.value()) : i.value(), i.value()});
+
+        unsigned nThreads = 1;
+        if (entries.size() >= kMinParallelCount) {
+            nThreads = std::max(thread::hardware_concurrency(), 1u);
+            if (maxThreads > 0)
+                nThreads = std::min(nThreads, maxThreads);
+        }
+        parallelSort(entries, nThreads);
+
+        vector<const Value*> result;
+        result.reserve(entries.size());
+        for (auto &e : entries)
+            result.push_back(e.item);
+        return result;
+    }
+
+
+    /*static*/ Retained<MutableArray> ValueSort::sorted(const Array *array, const Path *key,
+                                                       unsigned maxThreads)
+    {
+        auto items = sortedItems(array, key, maxThreads);
+        auto result = MutableArray::newArray(uint32_t(items.size()));
+        for (uint32_t i = 0; i < items.size(); ++i)
+            result->set(i, items[i]);
+        return result;
+    }
+
+
+    /*static*/ void ValueSort::writeSorted(const Array *array, Encoder &enc, const Path *key,
+                                           unsigned maxThreads)
+    {
+        auto items = sortedItems(array, key, maxThreads);
+        enc.beginArray(items.size());
+        for (auto item : items)
+            enc.writeValue(item);
+        enc.endArray();
+    }
+
+} }
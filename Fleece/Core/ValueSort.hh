@@ -0,0 +1,77 @@
+//
+// ValueSort.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "Value.hh"
+#include "fleece/RefCounted.hh"
+#include <functional>
+#include <vector>
+
+namespace fleece { namespace impl {
+    class Array;
+    class Encoder;
+    class MutableArray;
+    class Path;
+
+
+    /** A Value together with its hash, computed once. It's equal to another HashedValue if the
+        Values compare equivalent (see Value::compare), and works as a key in a hash table,
+        such as for grouping or de-duplicating values. */
+    struct HashedValue {
+        const Value*    value;
+        uint32_t        hash;
+
+        explicit HashedValue(const Value *v) noexcept   :value(v), hash(v ? v->hash() : 0) { }
+
+        bool operator== (const HashedValue &other) const noexcept {
+            if (value == other.value)
+                return true;
+            return hash == other.hash && value && other.value && value->compare(other.value) == 0;
+        }
+        bool operator!= (const HashedValue &other) const noexcept {return !(*this == other);}
+    };
+
+
+    /** Sorts the items of an Array by Value::compare, using multiple threads if it's large.
+        The sort is stable, so items that compare equivalent stay in their original order.
+        If a key Path is given, the items are sorted by the Value at that path in each item
+        (a missing value sorts first, like undefined); the Path must be literal.
+        `maxThreads` limits the number of threads; 0 means the number of CPU cores. */
+    class ValueSort {
+    public:
+        /** Returns the items of `array` in sorted order. */
+        static std::vector<const Value*> sortedItems(const Array *array,
+                                                     const Path *key =nullptr,
+                                                     unsigned maxThreads =0);
+
+        /** Returns a new MutableArray containing the items of `array` in sorted order. */
+        static Retained<MutableArray> sorted(const Array *array,
+                                             const Path *key =nullptr,
+                                             unsigned maxThreads =0);
+
+        /** Writes the items of `array` to an Encoder, as an array in sorted order. */
+        static void writeSorted(const Array *array, Encoder&,
+                                const Path *key =nullptr,
+                                unsigned maxThreads =0);
+
+        /** Arrays smaller than this are sorted on a single thread. */
+        static constexpr size_t kMinParallelCount = 8192;
+    };
+
+} }
+
+
+namespace std {
+    template <> struct hash<fleece::impl::HashedValue> {
+        size_t operator() (const fleece::impl::HashedValue &v) const noexcept {return v.hash;}
+    };
+}
@@ -38,8 +38,8 @@ namespace fleece { namespace impl { namespace internal {
 
 
     void HeapArray::populate(unsigned fromIndex) {
-        if (!_source)
-            return;
+        if (!_source || fromIndex >= _source->count())
+            return;                 // (the array may have grown past the end of its source)
         auto dst = _items.begin() + fromIndex;
         Array::iterator src(_source);
         for (src += fromIndex; src && dst != _items.end(); ++src, ++dst) {
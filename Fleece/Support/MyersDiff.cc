@@ -0,0 +1,285 @@
+//
+//  MyersDiff.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "MyersDiff.hh"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include "betterassert.hh"
+
+using namespace std;
+
+namespace fleece {
+
+    static inline uint64_t loadWord(const uint8_t *p) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        return w;
+    }
+
+    // Given the XOR of two words, returns the number of equal bytes before the first
+    // difference, in memory order...
+    static inline size_t equalLeadingBytes(uint64_t x) {
+        if constexpr (std::endian::native == std::endian::little)
+            return size_t(std::countr_zero(x)) / 8;
+        else
+            return size_t(std::countl_zero(x)) / 8;
+    }
+
+    // ...or the number of equal bytes after the last difference.
+    static inline size_t equalTrailingBytes(uint64_t x) {
+        if constexpr (std::endian::native == std::endian::little)
+            return size_t(std::countl_zero(x)) / 8;
+        else
+            return size_t(std::countr_zero(x)) / 8;
+    }
+
+
+    // The common prefix & suffix are compared a word at a time, which matters because text
+    // edits tend to be small and far apart, so most of the bytes are in a prefix or suffix.
+
+    /*static*/ size_t MyersDiff::commonPrefix(slice a, slice b) noexcept {
+        auto pa = (const uint8_t*)a.buf, pb = (const uint8_t*)b.buf;
+        size_t n = min(a.size, b.size), i = 0;
+        for (; i + 8 <= n; i += 8) {
+            if (uint64_t x = loadWord(pa + i) ^ loadWord(pb + i); x != 0)
+                return i + equalLeadingBytes(x);
+        }
+        while (i < n && pa[i] == pb[i])
+            ++i;
+        return i;
+    }
+
+
+    /*static*/ size_t MyersDiff::commonSuffix(slice a, slice b) noexcept {
+        auto ea = (const uint8_t*)a.end(), eb = (const uint8_t*)b.end();
+        size_t n = min(a.size, b.size), i = 0;
+        for (; i + 8 <= n; i += 8) {
+            if (uint64_t x = loadWord(ea - i - 8) ^ loadWord(eb - i - 8); x != 0)
+                return i + equalTrailingBytes(x);
+        }
+        while (i < n && ea[-1 - ptrdiff_t(i)] == eb[-1 - ptrdiff_t(i)])
+            ++i;
+        return i;
+    }
+
+
+    // Versions of the above for use by the diff algorithm, on bytes or on other types:
+
+    static inline size_t prefixLength(span<const uint8_t> a, span<const uint8_t> b) {
+        return MyersDiff::commonPrefix(slice(a.data(), a.size()), slice(b.data(), b.size()));
+    }
+
+    static inline size_t suffixLength(span<const uint8_t> a, span<const uint8_t> b) {
+        return MyersDiff::commonSuffix(slice(a.data(), a.size()), slice(b.data(), b.size()));
+    }
+
+    template <class T>
+    static size_t prefixLength(span<const T> a, span<const T> b) {
+        size_t n = min(a.size(), b.size()), i = 0;
+        while (i < n && a[i] == b[i])
+            ++i;
+        return i;
+    }
+
+    template <class T>
+    static size_t suffixLength(span<const T> a, span<const T> b) {
+        size_t n = min(a.size(), b.size()), i = 0;
+        while (i < n && a[a.size() - 1 - i] == b[b.size() - 1 - i])
+            ++i;
+        return i;
+    }
+
+
+    MyersDiff::MyersDiff(size_t maxEditDistance, double timeout)
+    :_maxEditDistance(maxEditDistance)
+    ,_timeout(timeout)
+    { }
+
+
+    bool MyersDiff::diff(slice oldStr, slice nuuStr) {
+        return _diff(span<const uint8_t>((const uint8_t*)oldStr.buf, oldStr.size),
+                     span<const uint8_t>((const uint8_t*)nuuStr.buf, nuuStr.size));
+    }
+
+
+    bool MyersDiff::diff(span<const uint32_t> oldSeq, span<const uint32_t> nuuSeq) {
+        return _diff(oldSeq, nuuSeq);
+    }
+
+
+    template <class T>
+    bool MyersDiff::_diff(span<const T> oldSeq, span<const T> nuuSeq) {
+        _hunks.clear();
+        if (_timeout > 0)
+            _deadline = clock::now() + chrono::duration_cast<clock::duration>(
+                                                        chrono::duration<double>(_timeout));
+
+        // Ranges left to diff. Instead of recursing, the halves of a range are pushed on a
+        // stack, second half first, so the hunks are still found in order:
+        struct Range {size_t oldPos, oldEnd, nuuPos, nuuEnd;};
+        vector<Range> stack;
+        stack.push_back({0, oldSeq.size(), 0, nuuSeq.size()});
+        while (!stack.empty()) {
+            Range r = stack.back();
+            stack.pop_back();
+
+            auto o = oldSeq.subspan(r.oldPos, r.oldEnd - r.oldPos);
+            auto n = nuuSeq.subspan(r.nuuPos, r.nuuEnd - r.nuuPos);
+            size_t prefix = prefixLength(o, n);
+            o = o.subspan(prefix);
+            n = n.subspan(prefix);
+            size_t suffix = suffixLength(o, n);
+            o = o.first(o.size() - suffix);
+            n = n.first(n.size() - suffix);
+            r.oldPos += prefix;
+            r.nuuPos += prefix;
+
+            if (o.empty() || n.empty()) {
+                if (!o.empty() || !n.empty())
+                    addHunk(r.oldPos, o.size(), r.nuuPos, n.size());
+                continue;
+            }
+
+            size_t splitOld, splitNuu;
+            if (!bisect(o, n, splitOld, splitNuu))
+                return false;
+            stack.push_back({r.oldPos + splitOld, r.oldPos + o.size(),
+                             r.nuuPos + splitNuu, r.nuuPos + n.size()});
+            stack.push_back({r.oldPos, r.oldPos + splitOld,
+                             r.nuuPos, r.nuuPos + splitNuu});
+        }
+        return true;
+    }
+
+
+    // Finds the "middle snake" of an optimal path through the edit graph, by searching forwards
+    // from the start and backwards from the end until the paths overlap; returns the point where
+    // they meet. The sequences must be non-empty and must not have a common prefix or suffix.
+    // (This follows the structure of `diff_bisect` in diff_match_patch.)
+    template <class T>
+    bool MyersDiff::bisect(span<const T> oldSeq, span<const T> nuuSeq,
+                           size_t &splitOld, size_t &splitNuu)
+    {
+        auto t1 = oldSeq.data(), t2 = nuuSeq.data();
+        const ptrdiff_t len1 = ptrdiff_t(oldSeq.size()), len2 = ptrdiff_t(nuuSeq.size());
+        const ptrdiff_t maxD = min((len1 + len2 + 1) / 2, ptrdiff_t(_maxEditDistance / 2 + 1));
+        const ptrdiff_t vOffset = maxD, vLength = 2 * maxD;
+        if (_v1.size() < size_t(vLength + 2)) {
+            _v1.resize(vLength + 2);
+            _v2.resize(vLength + 2);
+        }
+        auto v1 = _v1.data(), v2 = _v2.data();
+        std::fill_n(v1, vLength + 2, -1);
+        std::fill_n(v2, vLength + 2, -1);
+        v1[vOffset + 1] = 0;
+        v2[vOffset + 1] = 0;
+
+        const ptrdiff_t delta = len1 - len2;
+        // If the total number of characters is odd, the front path will collide with the
+        // reverse path; otherwise the reverse path collides with the front:
+        const bool front = (delta % 2 != 0);
+        // Offsets for the start and end of the k loops, which skip diagonals that have run off
+        // the edge of the grid:
+        ptrdiff_t k1start = 0, k1end = 0, k2start = 0, k2end = 0;
+
+        for (ptrdiff_t d = 0; d < maxD; d++) {
+            if (_timeout > 0 && clock::now() > _deadline)
+                return false;
+
+            // Walk the front path one step:
+            for (ptrdiff_t k1 = -d + k1start; k1 <= d - k1end; k1 += 2) {
+                ptrdiff_t k1Offset = vOffset + k1;
+                ptrdiff_t x1;
+                if (k1 == -d || (k1 != d && v1[k1Offset - 1] < v1[k1Offset + 1]))
+                    x1 = v1[k1Offset + 1];
+                else
+                    x1 = v1[k1Offset - 1] + 1;
+                ptrdiff_t y1 = x1 - k1;
+                while (x1 < len1 && y1 < len2 && t1[x1] == t2[y1]) {
+                    x1++;
+                    y1++;
+                }
+                v1[k1Offset] = x1;
+                if (x1 > len1) {
+                    k1end += 2;         // Ran off the right of the graph
+                } else if (y1 > len2) {
+                    k1start += 2;       // Ran off the bottom of the graph
+                } else if (front) {
+                    ptrdiff_t k2Offset = vOffset + delta - k1;
+                    if (k2Offset >= 0 && k2Offset < vLength && v2[k2Offset] != -1) {
+                        // Mirror x2 onto the top-left coordinate system:
+                        ptrdiff_t x2 = len1 - v2[k2Offset];
+                        if (x1 >= x2) {
+                            splitOld = size_t(x1);
+                            splitNuu = size_t(y1);
+                            return true;
+                        }
+                    }
+                }
+            }
+
+            // Walk the reverse path one step:
+            for (ptrdiff_t k2 = -d + k2start; k2 <= d - k2end; k2 += 2) {
+                ptrdiff_t k2Offset = vOffset + k2;
+                ptrdiff_t x2;
+                if (k2 == -d || (k2 != d && v2[k2Offset - 1] < v2[k2Offset + 1]))
+                    x2 = v2[k2Offset + 1];
+                else
+                    x2 = v2[k2Offset - 1] + 1;
+                ptrdiff_t y2 = x2 - k2;
+                while (x2 < len1 && y2 < len2 && t1[len1 - x2 - 1] == t2[len2 - y2 - 1]) {
+                    x2++;
+                    y2++;
+                }
+                v2[k2Offset] = x2;
+                if (x2 > len1) {
+                    k2end += 2;
+                } else if (y2 > len2) {
+                    k2start += 2;
+                } else if (!front) {
+                    ptrdiff_t k1Offset = vOffset + delta - k2;
+                    if (k1Offset >= 0 && k1Offset < vLength && v1[k1Offset] != -1) {
+                        ptrdiff_t x1 = v1[k1Offset];
+                        ptrdiff_t y1 = vOffset + x1 - k1Offset;
+                        x2 = len1 - x2;
+                        if (x1 >= x2) {
+                            splitOld = size_t(x1);
+                            splitNuu = size_t(y1);
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        if (maxD < (len1 + len2 + 1) / 2)
+            return false;           // The edit distance is more than the maximum
+        // No commonality at all: split so that one half is a deletion and the other an insertion
+        splitOld = size_t(len1);
+        splitNuu = 0;
+        return true;
+    }
+
+
+    void MyersDiff::addHunk(size_t oldPos, size_t oldLen, size_t nuuPos, size_t nuuLen) {
+        if (!_hunks.empty()) {
+            Hunk &last = _hunks.back();
+            if (last.oldPos + last.oldLen == oldPos && last.nuuPos + last.nuuLen == nuuPos) {
+                last.oldLen += oldLen;
+                last.nuuLen += nuuLen;
+                return;
+            }
+        }
+        _hunks.push_back({oldPos, oldLen, nuuPos, nuuLen});
+    }
+
+}
@@ -0,0 +1,77 @@
+//
+//  MyersDiff.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "fleece/slice.hh"
+#include <chrono>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace fleece {
+
+    /** Computes a minimal byte-level diff between two strings, or between two sequences of
+        integers, using Eugene Myers' O(ND) algorithm in its linear-space form ("An O(ND)
+        Difference Algorithm and Its Variations", 1986). Unlike `diff_match_patch`, it works on
+        raw bytes in place, and its only heap allocations are the result and two arrays
+        proportional to the edit distance.
+
+        Work is bounded by a maximum edit distance (items deleted plus items inserted) and an
+        optional timeout; if either is exceeded, `diff` gives up and returns false.
+
+        A MyersDiff can be reused for multiple diffs, which saves reallocating its arrays. */
+    class MyersDiff {
+    public:
+        /** A region where the strings differ: `oldLen` bytes at `oldPos` in the old string were
+            replaced by `nuuLen` bytes at `nuuPos` in the new one. (One length may be zero.)
+            The bytes between consecutive hunks are the same in both strings. */
+        struct Hunk {
+            size_t oldPos, oldLen;
+            size_t nuuPos, nuuLen;
+        };
+
+        /** @param maxEditDistance  The largest edit distance to search for.
+            @param timeout  Maximum time in seconds that `diff` may take; zero or negative means
+                            no limit. */
+        explicit MyersDiff(size_t maxEditDistance, double timeout =0);
+
+        /** Diffs two strings. On success, returns true and stores the differences, in order,
+            in `hunks`. Returns false if the edit distance or time limit was exceeded. */
+        bool diff(slice oldStr, slice nuuStr);
+
+        /** Diffs two sequences of integers, such as hashes; otherwise the same as above. */
+        bool diff(std::span<const uint32_t> oldSeq, std::span<const uint32_t> nuuSeq);
+
+        const std::vector<Hunk>& hunks() const          {return _hunks;}
+
+        /** Returns the length of the longest common prefix of two strings. */
+        static size_t commonPrefix(slice a, slice b) noexcept;
+
+        /** Returns the length of the longest common suffix of two strings. */
+        static size_t commonSuffix(slice a, slice b) noexcept;
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        template <class T> bool _diff(std::span<const T>, std::span<const T>);
+        template <class T> bool bisect(std::span<const T>, std::span<const T>,
+                                       size_t &splitOld, size_t &splitNuu);
+        void addHunk(size_t oldPos, size_t oldLen, size_t nuuPos, size_t nuuLen);
+
+        size_t                 _maxEditDistance;
+        double                 _timeout;
+        clock::time_point      _deadline;
+        std::vector<ptrdiff_t> _v1, _v2;            // Furthest-reaching paths, fwd and backward
+        std::vector<Hunk>      _hunks;
+    };
+
+}
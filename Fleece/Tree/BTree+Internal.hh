@@ -0,0 +1,148 @@
+//
+//  BTree+Internal.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "BTree.hh"
+#include "fleece/Mutable.hh"
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+namespace fleece { namespace btree {
+
+    /*
+        Data format:
+
+        Every node is a Fleece array.
+            Leaf Node:      [key0, value0, key1, value1, ... ]           (even count)
+            Interior Node:  [child0, key1, child1, ... keyN, childN]     (odd count)
+
+        Keys are strings, sorted in ascending byte-wise order.
+        In an interior node, `keyI` is the lowest key in the subtree `childI`; there is no key
+        before `child0` since it holds everything less than `key1`.
+        An empty tree is an empty array, i.e. an empty leaf.
+     */
+
+
+    class MutableNode;
+
+    static constexpr unsigned kMaxEntries = 32;     // Max keys in a leaf, or children in an interior
+    static constexpr unsigned kMaxDepth   = 16;     // Enough for kMaxEntries^kMaxDepth keys
+
+
+    // Holds either an immutable node (a Fleece array) or a MutableNode.
+    class NodeRef {
+    public:
+        NodeRef()                                   =default;
+        NodeRef(Array a)                            :_imm(a) { }
+        NodeRef(const MutableNode *m)               :_mut(m) { }
+
+        explicit operator bool() const              {return _mut || _imm;}
+        bool isMutable() const                      {return _mut != nullptr;}
+        const MutableNode* asMutable() const        {return _mut;}
+        Array asImmutable() const                   {return _imm;}
+
+        bool isLeaf() const;
+        unsigned count() const;                     // # of keys (leaf) or children (interior)
+
+        slice keyAt(unsigned i) const;              // In an interior, i must be > 0
+        Value valueAt(unsigned i) const;            // Leaf only
+        NodeRef childAt(unsigned i) const;          // Interior only
+
+        // Leaf: index of the first key >= `key` (may equal count()).
+        // Interior: index of the child whose subtree would contain `key`.
+        unsigned find(slice key) const;
+
+        Value get(slice key) const;
+        unsigned leafCount() const;
+
+        void dump(std::ostream&, unsigned indent) const;
+
+    private:
+        const MutableNode* _mut {nullptr};
+        Array _imm;
+    };
+
+
+    // A key or value stored in a MutableNode. Ones copied from an immutable node just point into
+    // its data, which has to outlive the tree anyway; new ones are copied or retained.
+    class Key {
+    public:
+        Key() =default;
+        Key(slice str, bool copy)   :_owned(copy ? alloc_slice(str) : alloc_slice())
+                                    ,_str(copy ? slice(_owned) : str) { }
+        operator slice() const      {return _str;}
+    private:
+        alloc_slice _owned;
+        slice       _str;
+    };
+
+    class LeafValue {
+    public:
+        LeafValue() =default;
+        LeafValue(Value v, bool retain)   :_owned(retain ? v : Value()), _value(v) { }
+        operator Value() const      {return _value;}
+    private:
+        RetainedValue _owned;
+        Value         _value;
+    };
+
+
+    // A mutable node. Immutable children are referenced in place, so only the nodes along the
+    // paths to changed keys ever get copied.
+    class MutableNode {
+    public:
+        static std::unique_ptr<MutableNode> newLeaf();
+        static std::unique_ptr<MutableNode> mutableCopy(Array);
+        static std::unique_ptr<MutableNode> newInterior(std::unique_ptr<MutableNode> left,
+                                                        std::unique_ptr<MutableNode> right);
+
+        using InsertCallback = std::function<Value(Value)>;
+
+        bool isLeaf() const                         {return _isLeaf;}
+        unsigned count() const                      {return unsigned(_keys.size());}
+
+        slice keyAt(unsigned i) const               {return _keys[i];}
+        Value valueAt(unsigned i) const             {return _values[i];}
+        NodeRef childAt(unsigned i) const;
+
+        unsigned find(slice key) const;
+
+        // Inserts or updates a key. If this node overflows, it splits and returns the new
+        // right-hand sibling. Sets `ok` to false if the callback returned nullptr.
+        std::unique_ptr<MutableNode> insert(slice key, const InsertCallback&, bool &ok);
+
+        bool remove(slice key);
+
+        // If this is an interior node with one child, returns that child (made mutable).
+        std::unique_ptr<MutableNode> collapse();
+
+        void writeTo(Encoder&) const;
+
+    private:
+        struct Child {
+            Array imm;
+            std::unique_ptr<MutableNode> mut;
+        };
+
+        explicit MutableNode(bool leaf)             :_isLeaf(leaf) { }
+        MutableNode* mutableChild(unsigned i);
+        std::unique_ptr<MutableNode> split();
+
+        bool                        _isLeaf;
+        std::vector<Key>            _keys;          // In an interior, _keys[0] is unused
+        std::vector<LeafValue>      _values;        // Leaf only
+        std::vector<Child>          _children;      // Interior only
+    };
+
+} }
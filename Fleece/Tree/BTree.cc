@@ -0,0 +1,275 @@
+//
+//  BTree.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "BTree.hh"
+#include "BTree+Internal.hh"
+#include "MutableBTree.hh"
+#include "fleece/Expert.hh"
+#include <ostream>
+#include <string>
+#include "betterassert.hh"
+
+using namespace std;
+
+namespace fleece {
+
+    namespace btree {
+
+        bool NodeRef::isLeaf() const {
+            return _mut ? _mut->isLeaf() : (_imm.count() & 1) == 0;
+        }
+
+        unsigned NodeRef::count() const {
+            if (_mut)
+                return _mut->count();
+            auto n = _imm.count();
+            return (n & 1) ? (n + 1) / 2 : n / 2;
+        }
+
+        slice NodeRef::keyAt(unsigned i) const {
+            if (_mut)
+                return _mut->keyAt(i);
+            else if (isLeaf())
+                return _imm.get(2*i).asString();
+            else
+                return _imm.get(2*i - 1).asString();
+        }
+
+        Value NodeRef::valueAt(unsigned i) const {
+            return _mut ? _mut->valueAt(i) : _imm.get(2*i + 1);
+        }
+
+        NodeRef NodeRef::childAt(unsigned i) const {
+            return _mut ? _mut->childAt(i) : NodeRef(_imm.get(2*i).asArray());
+        }
+
+        unsigned NodeRef::find(slice key) const {
+            if (_mut)
+                return _mut->find(key);
+            // Binary search. In a leaf, find the first key >= `key`; keys are at even indexes.
+            // In an interior node, find the last child whose key is <= `key`; keys are at odd
+            // indexes, and child i's key is at 2i-1.
+            unsigned n = _imm.count();
+            bool leaf = (n & 1) == 0;
+            unsigned lo = leaf ? 0 : 1, hi = leaf ? n / 2 : (n + 1) / 2;
+            while (lo < hi) {
+                unsigned mid = (lo + hi) / 2;
+                int cmp = _imm.get(leaf ? 2*mid : 2*mid - 1).asString().compare(key);
+                if (leaf ? (cmp < 0) : (cmp <= 0))
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return leaf ? lo : lo - 1;
+        }
+
+        Value NodeRef::get(slice key) const {
+            NodeRef node = *this;
+            while (!node.isLeaf()) {
+                if (node.count() == 0)
+                    return nullptr;
+                node = node.childAt(node.find(key));
+            }
+            unsigned i = node.find(key);
+            if (i < node.count() && node.keyAt(i) == key)
+                return node.valueAt(i);
+            return nullptr;
+        }
+
+        unsigned NodeRef::leafCount() const {
+            unsigned n = count();
+            if (isLeaf())
+                return n;
+            unsigned total = 0;
+            for (unsigned i = 0; i < n; ++i)
+                total += childAt(i).leafCount();
+            return total;
+        }
+
+        void NodeRef::dump(std::ostream &out, unsigned indent) const {
+            unsigned n = count();
+            char open = _mut ? '{' : '[', close = _mut ? '}' : ']';
+            out << string(2*indent, ' ') << open;
+            if (isLeaf()) {
+                for (unsigned i = 0; i < n; ++i) {
+                    out << (i ? ", " : "") << '"';
+                    auto k = keyAt(i);
+                    out.write((char*)k.buf, k.size);
+                    out << "\"=" << valueAt(i).toJSONString();
+                }
+            } else {
+                for (unsigned i = 0; i < n; ++i) {
+                    out << "\n";
+                    if (i > 0) {
+                        auto k = keyAt(i);
+                        out << string(2*indent + 2, ' ') << "<\"";
+                        out.write((char*)k.buf, k.size);
+                        out << "\">\n";
+                    }
+                    childAt(i).dump(out, indent + 1);
+                }
+            }
+            out << close;
+        }
+
+    }
+
+    using namespace btree;
+
+
+    BTree BTree::fromData(slice data, FLTrust trust) {
+        return BTree(ValueFromData(data, trust).asArray());
+    }
+
+    NodeRef BTree::rootNode() const {
+        return _root ? NodeRef(_root) : NodeRef();
+    }
+
+    Value BTree::get(slice key) const {
+        return _root ? rootNode().get(key) : nullptr;
+    }
+
+    unsigned BTree::count() const {
+        return _root ? rootNode().leafCount() : 0;
+    }
+
+    void BTree::dump(ostream &out) const {
+        out << "BTree ";
+        if (_root)
+            rootNode().dump(out, 0);
+        out << "\n";
+    }
+
+
+#pragma mark - ITERATOR
+
+
+    namespace btree {
+
+        struct iteratorImpl {
+            struct pos {
+                NodeRef node;
+                unsigned index;
+            };
+            NodeRef root;
+            pos stack[kMaxDepth];
+            unsigned depth {0};         // Number of items in `stack`; the top one is a leaf
+
+            explicit iteratorImpl(NodeRef r)
+            :root(r)
+            { }
+
+            // Descends from stack[depth-1] to the leftmost leaf below it.
+            void descend() {
+                while (!stack[depth-1].node.isLeaf()) {
+                    auto &top = stack[depth-1];
+                    assert(depth < kMaxDepth);
+                    stack[depth++] = {top.node.childAt(top.index), 0};
+                }
+            }
+
+            // Pops finished nodes off the stack until the top leaf has a current item.
+            pair<slice,Value> settle() {
+                while (depth > 0 && stack[depth-1].index >= stack[depth-1].node.count()) {
+                    if (--depth == 0)
+                        return {};
+                    ++stack[depth-1].index;
+                    if (stack[depth-1].index < stack[depth-1].node.count())
+                        descend();
+                }
+                if (depth == 0)
+                    return {};
+                auto &leaf = stack[depth-1];
+                return {leaf.node.keyAt(leaf.index), leaf.node.valueAt(leaf.index)};
+            }
+
+            pair<slice,Value> first() {
+                depth = 0;
+                if (!root || root.count() == 0)
+                    return {};
+                stack[depth++] = {root, 0};
+                descend();
+                return settle();
+            }
+
+            pair<slice,Value> seek(slice key) {
+                depth = 0;
+                if (!root || root.count() == 0)
+                    return {};
+                NodeRef node = root;
+                while (true) {
+                    assert(depth < kMaxDepth);
+                    unsigned i = node.find(key);
+                    stack[depth++] = {node, i};
+                    if (node.isLeaf())
+                        break;
+                    node = node.childAt(i);
+                }
+                return settle();
+            }
+
+            pair<slice,Value> next() {
+                if (depth == 0)
+                    return {};
+                ++stack[depth-1].index;
+                return settle();
+            }
+        };
+
+    }
+
+
+    BTree::iterator::iterator(const MutableBTree &tree)
+    :iterator(tree.rootNode())
+    { }
+
+    BTree::iterator::iterator(const BTree &tree)
+    :iterator(tree.rootNode())
+    { }
+
+    BTree::iterator::iterator(NodeRef root)
+    :_impl(new iteratorImpl(root))
+    {
+        tie(_key, _value) = _impl->first();
+    }
+
+    BTree::iterator::iterator(iterator&&) =default;
+    BTree::iterator::~iterator() =default;
+
+    BTree::iterator& BTree::iterator::operator++() {
+        tie(_key, _value) = _impl->next();
+        checkPrefix();
+        return *this;
+    }
+
+    BTree::iterator& BTree::iterator::seek(slice lowerBound) {
+        _prefix = nullslice;
+        tie(_key, _value) = _impl->seek(lowerBound);
+        return *this;
+    }
+
+    BTree::iterator& BTree::iterator::seekPrefix(slice prefix) {
+        _prefix = prefix;
+        tie(_key, _value) = _impl->seek(prefix);
+        checkPrefix();
+        return *this;
+    }
+
+    void BTree::iterator::checkPrefix() {
+        if (_prefix && _value && !_key.hasPrefix(_prefix)) {
+            _key = nullslice;
+            _value = nullptr;
+            _impl->depth = 0;
+        }
+    }
+
+}
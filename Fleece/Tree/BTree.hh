@@ -0,0 +1,95 @@
+//
+//  BTree.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "fleece/slice.hh"
+#include "fleece/Fleece.hh"
+#include <iosfwd>
+#include <memory>
+
+namespace fleece {
+
+    class MutableBTree;
+
+    namespace btree {
+        class NodeRef;
+        struct iteratorImpl;
+    }
+
+
+    /** The root of an immutable B+tree encoded as Fleece data. Unlike HashTree, the keys are
+        kept in sorted order (by byte-wise comparison), so the tree supports ordered iteration,
+        seeking to a lower bound, and prefix scans.
+
+        The nodes are ordinary Fleece arrays, so the tree can be appended to a Fleece file
+        incrementally with `Encoder::amend`, just like a HashTree. */
+    class BTree {
+    public:
+        BTree() =default;
+
+        /** Wraps an already-decoded root node. */
+        explicit BTree(Array root)                  :_root(root) { }
+
+        /** Returns the tree whose root is the root value of the Fleece data.
+            Like HashTree, the data is not validated unless `trust` is kFLUntrusted. */
+        static BTree fromData(slice data, FLTrust trust =kFLTrusted);
+
+        explicit operator bool() const              {return !!_root;}
+
+        Value get(slice key) const;
+
+        unsigned count() const;
+
+        /** The encoded root node. */
+        Array rootArray() const                     {return _root;}
+
+        void dump(std::ostream &out) const;
+
+
+        /** Iterates a tree's key/value pairs in ascending key order. */
+        class iterator {
+        public:
+            iterator(const MutableBTree&);
+            iterator(const BTree&);
+            iterator(iterator&&);
+            ~iterator();
+
+            slice key() const noexcept                      {return _key;}
+            Value value() const noexcept                    {return _value;}
+            explicit operator bool() const noexcept         {return !!_value;}
+            iterator& operator ++();
+
+            /** Repositions the iterator at the first key greater than or equal to `lowerBound`. */
+            iterator& seek(slice lowerBound);
+
+            /** Repositions the iterator at the first key that starts with `prefix`, and makes it
+                stop at the last such key. */
+            iterator& seekPrefix(slice prefix);
+
+        private:
+            iterator(btree::NodeRef);
+            void checkPrefix();
+
+            std::unique_ptr<btree::iteratorImpl> _impl;
+            alloc_slice _prefix;
+            slice _key;
+            Value _value;
+        };
+
+    private:
+        btree::NodeRef rootNode() const;
+
+        Array _root;
+
+        friend class MutableBTree;
+    };
+}
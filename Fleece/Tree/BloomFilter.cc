@@ -0,0 +1,91 @@
+//
+//  BloomFilter.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "BloomFilter.hh"
+#include "Endian.hh"
+#include "FleeceException.hh"
+#include <algorithm>
+#include <cstring>
+#include "betterassert.hh"
+
+using namespace std;
+
+namespace fleece { namespace hashtree {
+
+    BloomFilterBuilder::BloomFilterBuilder(size_t count, unsigned bitsPerKey) {
+        assert_precondition(bitsPerKey > 0);
+        size_t nBlocks = (count * bitsPerKey + 8 * BloomFilter::kBlockSize - 1)
+                            / (8 * BloomFilter::kBlockSize);
+        allocate(max(nBlocks, size_t(1)));
+    }
+
+
+    BloomFilterBuilder::BloomFilterBuilder(slice blockData) {
+        throwIf(blockData.size == 0 || blockData.size % BloomFilter::kBlockSize != 0,
+                InvalidData, "Invalid Bloom filter data");
+        allocate(blockData.size / BloomFilter::kBlockSize);
+        for (uint32_t i = 0; i < _nBlocks; ++i)
+            writeBlock(i, offsetby(blockData.buf, i * BloomFilter::kBlockSize));
+    }
+
+
+    void BloomFilterBuilder::allocate(size_t nBlocks) {
+        throwIf(nBlocks > UINT32_MAX / BloomFilter::kBlockSize, MemoryError,
+                "Bloom filter too large");
+        _nBlocks = uint32_t(nBlocks);
+        _blocks.reset(new Block[nBlocks]);
+        for (size_t i = 0; i < nBlocks; ++i) {
+            for (auto &word : _blocks[i].words)
+                word.store(0, std::memory_order_relaxed);
+        }
+        _isChanged.assign(nBlocks, false);
+    }
+
+
+    void BloomFilterBuilder::readBlock(uint32_t index, void *dst) const {
+        assert_precondition(index < _nBlocks);
+        auto out = (uint8_t*)dst;
+        for (auto &word : _blocks[index].words) {
+            uint64_t bits = endian::encLittle64(word.load(std::memory_order_relaxed));
+            memcpy(out, &bits, sizeof(bits));
+            out += sizeof(bits);
+        }
+    }
+
+
+    void BloomFilterBuilder::writeBlock(uint32_t index, const void *src) {
+        assert_precondition(index < _nBlocks);
+        auto in = (const uint8_t*)src;
+        for (auto &word : _blocks[index].words) {
+            uint64_t bits;
+            memcpy(&bits, in, sizeof(bits));
+            word.store(endian::decLittle64(bits), std::memory_order_relaxed);
+            in += sizeof(bits);
+        }
+    }
+
+
+    alloc_slice BloomFilterBuilder::blockData() const {
+        alloc_slice data(size_t(_nBlocks) * BloomFilter::kBlockSize);
+        for (uint32_t i = 0; i < _nBlocks; ++i)
+            readBlock(i, (void*)offsetby(data.buf, i * BloomFilter::kBlockSize));
+        return data;
+    }
+
+
+    void BloomFilterBuilder::clearChangedBlocks() {
+        for (auto index : _changedBlocks)
+            _isChanged[index] = false;
+        _changedBlocks.clear();
+    }
+
+} }
@@ -0,0 +1,134 @@
+//
+//  BloomFilter.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "HashTree+Internal.hh"
+#include "fleece/slice.hh"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace fleece { namespace hashtree {
+
+    /*
+        Data format:
+
+        A Bloom filter's data is a sequence of 64-byte blocks. Bit number `n` of a block is bit
+        `n % 8` of its byte `n / 8`. (DB stores this in its filter sections; see DB.cc.)
+     */
+
+
+    /** The layout of a blocked Bloom filter of HashTree key hashes. All of a key's bits are in
+        a single 64-byte block, so testing a key reads one cache line. */
+    class BloomFilter {
+    public:
+        static constexpr size_t kBlockSize = 64;
+        static constexpr unsigned kDefaultBitsPerKey = 10;
+
+    private:
+        friend class BloomFilterBuilder;
+
+        static constexpr unsigned kNumSalts = 8;
+        static constexpr uint32_t kSalts[kNumSalts] = {
+            0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+            0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31};
+
+        // The block is chosen by the hash's high bits (scaled to the number of blocks)...
+        static size_t blockIndex(hash_t hash, uint32_t nBlocks) {
+            return size_t((uint64_t(hash) * nBlocks) >> 32);
+        }
+
+        // ...and each of its bits by the top 9 bits of the hash times a salt.
+        static unsigned bitNumber(hash_t hash, unsigned i) {
+            return uint32_t(hash * kSalts[i]) >> 23;
+        }
+    };
+
+
+    /** A Bloom filter in memory, with the layout described by BloomFilter, that keys can be
+        added to.
+        One thread may add keys while others call `mayContain`. It keeps track of the blocks that
+        adding keys has changed, so that a copy of the filter can be kept up to date by saving
+        only those. */
+    class BloomFilterBuilder {
+    public:
+        /** Creates an empty filter sized for `count` keys. */
+        BloomFilterBuilder(size_t count, unsigned bitsPerKey =BloomFilter::kDefaultBitsPerKey);
+
+        /** Creates a filter from the contents of its blocks, as returned by `blockData`. */
+        explicit BloomFilterBuilder(slice blockData);
+
+        void add(hash_t hash) {
+            uint32_t index = uint32_t(BloomFilter::blockIndex(hash, _nBlocks));
+            Block &block = _blocks[index];
+            bool changed = false;
+            for (unsigned i = 0; i < BloomFilter::kNumSalts; ++i) {
+                unsigned bit = BloomFilter::bitNumber(hash, i);
+                auto &word = block.words[bit >> 6];
+                uint64_t bits = word.load(std::memory_order_relaxed);
+                uint64_t mask = uint64_t(1) << (bit & 63);
+                if (!(bits & mask)) {
+                    word.store(bits | mask, std::memory_order_relaxed);    // (only one writer)
+                    changed = true;
+                }
+            }
+            if (changed && !_isChanged[index]) {
+                _isChanged[index] = true;
+                _changedBlocks.push_back(index);
+            }
+        }
+
+        /** Returns false if no key with this hash has been added; true if one might have been. */
+        bool mayContain(hash_t hash) const {
+            const Block &block = _blocks[BloomFilter::blockIndex(hash, _nBlocks)];
+            for (unsigned i = 0; i < BloomFilter::kNumSalts; ++i) {
+                unsigned bit = BloomFilter::bitNumber(hash, i);
+                if (!(block.words[bit >> 6].load(std::memory_order_relaxed)
+                            & (uint64_t(1) << (bit & 63))))
+                    return false;
+            }
+            return true;
+        }
+
+        uint32_t blockCount() const                 {return _nBlocks;}
+
+        /** The contents of all the blocks, in the same format as a BloomFilter's. */
+        alloc_slice blockData() const;
+
+        /** Copies a block's contents, `BloomFilter::kBlockSize` bytes, to `dst`. */
+        void readBlock(uint32_t index, void *dst) const;
+
+        /** Replaces a block's contents from `src`. This doesn't count as a change. */
+        void writeBlock(uint32_t index, const void *src);
+
+        /** The indexes of the blocks changed by `add` since the last `clearChangedBlocks`. */
+        const std::vector<uint32_t>& changedBlocks() const  {return _changedBlocks;}
+
+        void clearChangedBlocks();
+
+    private:
+        // Bit number `n` of a block is bit `n % 64` of word `n / 64`, which is byte `n / 8` of
+        // the block in little-endian order.
+        struct alignas(BloomFilter::kBlockSize) Block {
+            std::atomic<uint64_t> words[BloomFilter::kBlockSize / 8];
+        };
+        static_assert(sizeof(Block) == BloomFilter::kBlockSize);
+
+        void allocate(size_t nBlocks);
+
+        uint32_t                 _nBlocks;
+        std::unique_ptr<Block[]> _blocks;
+        std::vector<bool>        _isChanged;
+        std::vector<uint32_t>    _changedBlocks;
+    };
+
+} }
@@ -0,0 +1,778 @@
+//
+//  DB.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "DB.hh"
+
+#if FL_HAVE_MMAP
+
+#include "HashTree+Internal.hh"
+#include "BloomFilter.hh"
+#include "HashTreeBuilder.hh"
+#include "Endian.hh"
+#include "FileUtils.hh"
+#include "FleeceException.hh"
+#include "fleece/Expert.hh"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "betterassert.hh"
+
+namespace fleece::wyhash {
+    #include "wyhash.h"
+}
+
+using namespace std;
+
+namespace fleece {
+
+    /*
+        File format:
+
+        The file starts with a FileHeader. After that comes a series of commits, each of which
+        is the output of an Encoder amending all the data before it: new and changed Values,
+        then the changed HashTree nodes, ending with the 8-byte root node. That may be followed
+        by a Bloom filter section. A CommitTrailer follows each commit, giving the positions of
+        its root node and of the latest Bloom filter section.
+
+        A Bloom filter section is either a whole filter of the tree's keys, or a patch holding
+        the blocks of the filter that changed since the previous section:
+            blocks   [64 bytes each]
+            indexes  [4-byte int each; patches only]
+            FilterHeader
+        The filter is read by following the chain of patches back to a whole filter, and applying
+        them to it in order. A commit that adds no keys doesn't need a section of its own.
+
+        The trailer also records how much of the file's data is reachable from the root. Each
+        commit updates it by adding the delta's size and subtracting the sizes of the values and
+        nodes it replaced, so it's an estimate (shared data may be counted more than once.)
+     */
+
+    struct FileHeader {
+        char                         magic[8];
+        endian::uint32_le_unaligned  version;
+        endian::uint32_le_unaligned  reserved;
+    };
+
+    struct CommitTrailer {
+        endian::uint32_le_unaligned  magic;
+        endian::uint32_le_unaligned  commitStart;   // File offset of the start of the commit
+        endian::uint32_le_unaligned  treeEnd;       // File offset of the end of the root node
+        endian::uint32_le_unaligned  filter;        // File offset of the end of the latest
+                                                    //   Bloom filter section, or 0 if none
+        endian::uint32_le_unaligned  fileSize;      // File offset of the end of this trailer
+        endian::uint32_le_unaligned  liveBytes;     // Size of the data reachable from the root
+        endian::uint32_le_unaligned  checksum;      // Checksum of the commit's data
+    };
+
+    struct FilterHeader {
+        endian::uint32_le_unaligned  magic;         // kWholeFilterMagic or kFilterPatchMagic
+        endian::uint32_le_unaligned  bitsPerKey;    // Bits per key the filter was sized for
+        endian::uint32_le_unaligned  nBlocks;       // Number of blocks in the filter
+        endian::uint32_le_unaligned  nKeys;         // Number of keys added to the filter
+        endian::uint32_le_unaligned  count;         // Number of blocks in this section
+        endian::uint32_le_unaligned  previous;      // Patch: file offset of the end of the
+                                                    //   section it applies to
+    };
+
+    static_assert(sizeof(FileHeader) == 16 && sizeof(CommitTrailer) == 28
+                  && sizeof(FilterHeader) == 24);
+
+    static constexpr char     kFileMagic[8] = {'F','l','e','e','c','e','D','B'};
+    static constexpr uint32_t kFileVersion = 3;
+    static constexpr uint32_t kTrailerMagic = 0x7EC0DB17;
+    static constexpr uint32_t kWholeFilterMagic = 0xB1003F18;
+    static constexpr uint32_t kFilterPatchMagic = 0xB1003F19;
+    static constexpr size_t   kBlockSize = hashtree::BloomFilter::kBlockSize;
+
+    // The smallest possible commit is just a root node:
+    static constexpr size_t kMinCommitSize = sizeof(hashtree::Interior) + sizeof(CommitTrailer);
+
+    // Initial size of the memory mapping; it's remapped at twice the file size when outgrown.
+    static constexpr size_t kMinMappingSize = 1 << 20;
+
+    // How many times `compact` tries to catch up with new commits before blocking them.
+    static constexpr int kMaxCompactCatchUps = 3;
+
+
+    static uint32_t checksum(slice s) {
+        return uint32_t(wyhash::wyhash(s.buf, s.size, 0, wyhash::_wyp));
+    }
+
+
+    // A Doc covering a memory-mapped region of the file. It unmaps the memory when freed, i.e.
+    // once the DB, and every Snapshot and retained Value using it, are gone.
+    class MappedFile : public impl::Doc {
+    public:
+        MappedFile(void *addr, size_t size)
+        :Doc(slice(addr, size), kDontParse)
+        {
+            // The file grows into the mapping, so its contents change; don't validate them.
+            dontValidate();
+        }
+
+    protected:
+        ~MappedFile() {
+            unregister();
+            ::munmap((void*)data().buf, data().size);
+        }
+    };
+
+
+    // The Bloom filter of the latest commit's keys, kept in memory and updated by each commit.
+    // Snapshots share it, and may read it while later commits add keys; that only makes false
+    // positives a bit more likely for them.
+    class DB::Filter : public RefCounted {
+    public:
+        // Creates an empty filter with room for `capacity` keys.
+        Filter(size_t capacity, unsigned bitsPerKey_)
+        :builder(capacity, bitsPerKey_)
+        ,bitsPerKey(bitsPerKey_)
+        { }
+
+        // Creates a filter from a whole filter section.
+        Filter(const FilterHeader &header, slice blockData)
+        :builder(blockData)
+        ,bitsPerKey(header.bitsPerKey)
+        ,nKeys(header.nKeys)
+        { }
+
+        bool mayContain(slice key) const {
+            return builder.mayContain(hashtree::ComputeHash(key));
+        }
+
+        // The number of keys it can hold with the false-positive rate it was sized for.
+        size_t capacity() const {
+            return size_t(builder.blockCount()) * 8 * kBlockSize / bitsPerKey;
+        }
+
+        // The size of a whole filter section.
+        size_t sectionSize() const {
+            return size_t(builder.blockCount()) * kBlockSize + sizeof(FilterHeader);
+        }
+
+        // Returns a section holding the whole filter, or the blocks changed since the last one.
+        alloc_slice section(bool whole) const {
+            auto &changed = builder.changedBlocks();
+            uint32_t count = whole ? builder.blockCount() : uint32_t(changed.size());
+            FilterHeader header;
+            header.magic = whole ? kWholeFilterMagic : kFilterPatchMagic;
+            header.bitsPerKey = bitsPerKey;
+            header.nBlocks = builder.blockCount();
+            header.nKeys = nKeys;
+            header.count = count;
+            header.previous = whole ? 0 : uint32_t(sectionEnd);
+            alloc_slice result;
+            if (whole) {
+                result = builder.blockData();
+                result.append(slice(&header, sizeof(header)));
+            } else {
+                result.resize(count * (kBlockSize + sizeof(uint32_t)) + sizeof(header));
+                auto out = (uint8_t*)result.buf;
+                for (uint32_t i = 0; i < count; ++i)
+                    builder.readBlock(changed[i], out + i * kBlockSize);
+                out += count * kBlockSize;
+                for (uint32_t i = 0; i < count; ++i) {
+                    endian::uint32_le_unaligned index = changed[i];
+                    memcpy(out + i * sizeof(uint32_t), &index, sizeof(uint32_t));
+                }
+                memcpy(out + count * sizeof(uint32_t), &header, sizeof(header));
+            }
+            return result;
+        }
+
+        hashtree::BloomFilterBuilder builder;
+        unsigned    bitsPerKey;
+        uint32_t    nKeys {0};              // Number of keys added (some may be gone)
+        uint32_t    patchedBlocks {0};      // Blocks written in patches since the whole filter
+        size_t      sectionEnd {0};         // File offset of the end of its latest section
+    };
+
+
+    DB::DB(const char *path, OpenMode mode)
+    :_path(path)
+    ,_writable(mode != kReadOnly)
+    ,_snapshots(new SnapshotRegistry)
+    {
+        try {
+            open(mode);
+        } catch (...) {
+            close();
+            throw;
+        }
+    }
+
+
+    DB::~DB() {
+        _tree = MutableHashTree();      // Release nodes & values before unmapping
+        _latest = nullptr;
+        close();
+    }
+
+
+    void DB::open(OpenMode mode) {
+        int flags = (_writable ? O_RDWR : O_RDONLY) | O_CLOEXEC;
+        if (mode == kCreate)
+            flags |= O_CREAT;
+        _fd = checkErrno(::open(_path.c_str(), flags, 0644), "Can't open DB file");
+
+        struct stat st;
+        checkErrno(::fstat(_fd, &st), "Can't get DB file size");
+        size_t size = size_t(st.st_size);
+        if (size == 0 && _writable) {
+            FileHeader header = {};
+            memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+            header.version = kFileVersion;
+            write({&header, sizeof(header)}, 0);
+            size = sizeof(header);
+        }
+
+        mapFile(size);
+        auto header = (const FileHeader*)_mappings.back()->data().buf;
+        throwIf(size < sizeof(FileHeader) || memcmp(header->magic, kFileMagic, sizeof(kFileMagic)) != 0,
+                InvalidData, "Not a Fleece DB file");
+        throwIf(header->version != kFileVersion, InvalidData, "Unsupported Fleece DB file version");
+
+        // Find the last valid commit, and discard whatever follows it:
+        _eof = size;
+        _eof = findLastCommit();
+        _discarded = size - _eof;
+        if (_discarded > 0 && _writable)
+            checkErrno(::ftruncate(_fd, off_t(_eof)), "Can't truncate DB file");
+        resetTree();
+        loadFilter();
+        publishSnapshot();
+    }
+
+
+    void DB::close() noexcept {
+        _mappings.clear();
+        if (_fd >= 0) {
+            ::close(_fd);
+            _fd = -1;
+        }
+    }
+
+
+    // Maps the file into memory, reserving address space for it to grow. Existing mappings
+    // are left alone, since Values returned by `get` and Snapshots may point into them.
+    void DB::mapFile(size_t minSize) {
+        size_t pageSize = size_t(::sysconf(_SC_PAGESIZE));
+        size_t size = max(2 * minSize, kMinMappingSize);
+        size = (size + pageSize - 1) & ~(pageSize - 1);
+        void *addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, _fd, 0);
+        if (addr == MAP_FAILED)
+            FleeceException::_throwErrno("Can't memory-map DB file");
+        _mappings.push_back(new MappedFile(addr, size));
+    }
+
+
+    // Returns true if a valid commit trailer ends at file offset `end`.
+    bool DB::isValidCommit(size_t end) const {
+        if (end < sizeof(FileHeader) + kMinCommitSize || end > _eof)
+            return false;
+        size_t trailerPos = end - sizeof(CommitTrailer);
+        auto trailer = (const CommitTrailer*)offsetby(data().buf, trailerPos);
+        if (trailer->magic != kTrailerMagic || trailer->fileSize != end)
+            return false;
+        size_t start = trailer->commitStart, treeEnd = trailer->treeEnd;
+        if (start < sizeof(FileHeader) || start + sizeof(hashtree::Interior) > treeEnd
+                || treeEnd > trailerPos || trailer->filter > trailerPos)
+            return false;
+        return trailer->checksum == checksum(data().upTo(trailerPos).from(start));
+    }
+
+
+    // Scans backwards from the EOF for the last valid commit, returning the offset of its end.
+    // (Commits are 2-byte aligned, like all Fleece data.)
+    size_t DB::findLastCommit() const {
+        for (size_t end = _eof & ~size_t(1); end >= sizeof(FileHeader) + kMinCommitSize; end -= 2) {
+            if (isValidCommit(end))
+                return end;
+        }
+        return sizeof(FileHeader);
+    }
+
+
+    // Returns the trailer of the last commit in `data`, or null if there are no commits.
+    static const CommitTrailer* lastTrailer(slice data) {
+        if (data.size <= sizeof(FileHeader))
+            return nullptr;
+        return (const CommitTrailer*)offsetby(data.buf, data.size - sizeof(CommitTrailer));
+    }
+
+
+    const HashTree* DB::committedTree() const {
+        auto trailer = lastTrailer(data());
+        return trailer ? HashTree::fromData(data().upTo(trailer->treeEnd)) : nullptr;
+    }
+
+
+    uint32_t DB::committedLiveBytes() const {
+        auto trailer = lastTrailer(data());
+        return trailer ? uint32_t(trailer->liveBytes) : 0;
+    }
+
+
+    // Resets the in-memory tree to the latest commit.
+    void DB::resetTree() {
+        _tree = committedTree();
+    }
+
+
+    // Reads the latest commit's Bloom filter into memory: the last whole filter, with the
+    // patches written since then applied to it.
+    void DB::loadFilter() {
+        _filter = nullptr;
+        auto trailer = lastTrailer(data());
+        if (!trailer || trailer->filter == 0)
+            return;
+        vector<const FilterHeader*> patches;
+        size_t pos = trailer->filter;
+        const FilterHeader *header;
+        size_t blocksSize;
+        while (true) {
+            throwIf(pos < sizeof(FileHeader) + sizeof(FilterHeader) || pos > _eof,
+                    InvalidData, "Invalid Bloom filter in DB file");
+            header = (const FilterHeader*)offsetby(data().buf, pos - sizeof(FilterHeader));
+            bool whole = (header->magic == kWholeFilterMagic);
+            throwIf((!whole && header->magic != kFilterPatchMagic) || header->nBlocks == 0
+                        || header->count > (whole ? size_t(header->nBlocks) : pos / kBlockSize),
+                    InvalidData, "Invalid Bloom filter in DB file");
+            blocksSize = header->count * (whole ? kBlockSize : kBlockSize + sizeof(uint32_t));
+            throwIf(blocksSize > pos - sizeof(FileHeader) - sizeof(FilterHeader),
+                    InvalidData, "Invalid Bloom filter in DB file");
+            if (whole)
+                break;
+            patches.push_back(header);
+            throwIf(header->previous >= pos - sizeof(FilterHeader) - blocksSize,
+                    InvalidData, "Invalid Bloom filter in DB file");
+            pos = header->previous;
+        }
+        Retained<Filter> filter = new Filter(*header, slice(offsetby(header, -ssize_t(blocksSize)),
+                                                            blocksSize));
+        for (auto i = patches.rbegin(); i != patches.rend(); ++i) {
+            auto patch = *i;
+            throwIf(patch->nBlocks != header->nBlocks, InvalidData,
+                    "Invalid Bloom filter in DB file");
+            uint32_t count = patch->count;
+            auto blocks = (const uint8_t*)patch - count * (kBlockSize + sizeof(uint32_t));
+            auto indexes = (const endian::uint32_le_unaligned*)(blocks + count * kBlockSize);
+            for (uint32_t b = 0; b < count; ++b) {
+                throwIf(indexes[b] >= header->nBlocks, InvalidData,
+                        "Invalid Bloom filter in DB file");
+                filter->builder.writeBlock(indexes[b], blocks + b * kBlockSize);
+            }
+            filter->patchedBlocks += count;
+            filter->nKeys = patch->nKeys;
+        }
+        filter->sectionEnd = trailer->filter;
+        _filter = filter;
+        _bloomBitsPerKey = filter->bitsPerKey;
+    }
+
+
+    void DB::write(slice s, size_t pos) {
+        while (s.size > 0) {
+            ssize_t n = ::pwrite(_fd, s.buf, s.size, off_t(pos));
+            if (_usuallyFalse(n < 0))
+                FleeceException::_throwErrno("%s", "Can't write to DB file");
+            s.moveStart(size_t(n));
+            pos += size_t(n);
+        }
+    }
+
+
+#pragma mark - ACCESSORS:
+
+
+    Dict DB::get(slice key) const {
+        if (_filter && !_tree.isChanged() && !_filter->mayContain(key))
+            return nullptr;
+        return _tree.get(key).asDict();
+    }
+
+
+    MutableDict DB::getMutable(slice key) {
+        return _tree.getMutableDict(key);
+    }
+
+
+    void DB::put(slice key, Dict dict) {
+        throwIf(!_writable, InvalidData, "DB is read-only");
+        _tree.set(key, dict);
+    }
+
+
+    bool DB::remove(slice key) {
+        throwIf(!_writable, InvalidData, "DB is read-only");
+        return _tree.remove(key);
+    }
+
+
+#pragma mark - COMMITTING:
+
+
+    void DB::commitChanges(bool sync) {
+        throwIf(!_writable, InvalidData, "DB is read-only");
+        if (!_tree.isChanged())
+            return;
+
+        // Encode the changes as a delta that can be appended to the file:
+        Encoder enc;
+        expert(enc).amend(data());
+        expert(enc).suppressTrailer();
+        _tree.writeTo(enc);
+        appendCommit(enc.finish(), sync);
+    }
+
+
+    // Appends a delta, which must end with a HashTree root node, to the file as a new commit.
+    void DB::appendCommit(slice delta, bool sync) {
+        assert(delta.size >= sizeof(hashtree::Interior) && delta.size % 2 == 0);
+
+        size_t commitStart = _eof, treeEnd = _eof + delta.size;
+        throwIf(treeEnd + sizeof(CommitTrailer) > UINT32_MAX, MemoryError, "DB file is full");
+        write(delta, commitStart);
+        if (treeEnd > _mappings.back()->data().size)
+            mapFile(treeEnd);
+
+        // Now that the new tree is in the mapping, see how much of the old one it replaced:
+        slice mapped = _mappings.back()->data();
+        const HashTree *older = committedTree();
+        const HashTree *newer = HashTree::fromData(mapped.upTo(treeEnd));
+        size_t garbage = 0;
+        if (older)
+            garbage = newer->replacedBytes(*older, mapped.upTo(commitStart));
+        size_t oldLive = committedLiveBytes();
+        size_t live = oldLive - min(garbage, oldLive) + delta.size;
+
+        // Write the part of the Bloom filter that changed, if any:
+        bool wholeFilter;
+        Retained<Filter> filter = updateFilter(older, *newer, wholeFilter);
+        alloc_slice section;
+        if (filter && (wholeFilter || !filter->builder.changedBlocks().empty()))
+            section = filter->section(wholeFilter);
+        size_t trailerPos = treeEnd + section.size;
+        size_t newEOF = trailerPos + sizeof(CommitTrailer);
+        throwIf(newEOF > UINT32_MAX, MemoryError, "DB file is full");
+        if (section)
+            write(section, treeEnd);
+        if (newEOF > _mappings.back()->data().size)
+            mapFile(newEOF);
+
+        CommitTrailer trailer;
+        trailer.magic = kTrailerMagic;
+        trailer.commitStart = uint32_t(commitStart);
+        trailer.treeEnd = uint32_t(treeEnd);
+        trailer.filter = uint32_t(section ? trailerPos : (filter ? filter->sectionEnd : 0));
+        trailer.fileSize = uint32_t(newEOF);
+        trailer.liveBytes = uint32_t(live);
+        trailer.checksum = checksum(_mappings.back()->data().upTo(trailerPos).from(commitStart));
+        write({&trailer, sizeof(trailer)}, trailerPos);
+        if (sync)
+            checkErrno(::fsync(_fd), "Can't sync DB file");
+
+        if (section) {
+            filter->patchedBlocks = wholeFilter ? 0 : filter->patchedBlocks
+                                                        + uint32_t(filter->builder.changedBlocks().size());
+            filter->sectionEnd = trailerPos;
+            filter->builder.clearChangedBlocks();
+        }
+        _filter = filter;
+        _eof = newEOF;
+        resetTree();
+        publishSnapshot();
+    }
+
+
+    // Adds the keys a commit added to the Bloom filter, returning the filter to use from then on
+    // (or null if it's disabled.) Then either the blocks it changed are written as a patch, or
+    // `whole` is set and the whole filter is written: if there wasn't one, if the keys have
+    // outgrown it, or if the patches since the last whole filter add up to its size.
+    Retained<DB::Filter> DB::updateFilter(const HashTree *older, const HashTree &newer,
+                                          bool &whole)
+    {
+        whole = false;
+        if (_bloomBitsPerKey == 0)
+            return nullptr;
+        Retained<Filter> filter = _filter;
+        vector<hashtree::hash_t> added;
+        if (filter && older) {
+            newer.diff(*older, [&](slice key, Value oldValue, Value) {
+                if (!oldValue)
+                    added.push_back(hashtree::ComputeHash(key));
+            });
+        }
+        if (!filter || !older || filter->bitsPerKey != _bloomBitsPerKey
+                    || filter->nKeys + added.size() > filter->capacity()) {
+            // Make a new filter with room for twice as many keys, so this rarely happens:
+            unsigned count = newer.count();
+            filter = new Filter(2 * size_t(count), _bloomBitsPerKey);
+            for (HashTree::iterator i(&newer); i; ++i)
+                filter->builder.add(hashtree::ComputeHash(i.key()));
+            filter->nKeys = count;
+            whole = true;
+        } else {
+            for (auto hash : added)
+                filter->builder.add(hash);
+            filter->nKeys += uint32_t(added.size());
+            whole = (filter->patchedBlocks + filter->builder.changedBlocks().size()
+                        > filter->builder.blockCount());
+        }
+        return filter;
+    }
+
+
+
+
+    void DB::revertChanges() {
+        resetTree();
+    }
+
+
+    void DB::setBloomFilter(unsigned bitsPerKey) {
+        _bloomBitsPerKey = bitsPerKey;
+        if (bitsPerKey == 0)
+            _filter = nullptr;
+    }
+
+
+#pragma mark - SNAPSHOTS:
+
+
+    void DB::publishSnapshot() {
+        _latest = new Snapshot(committedTree(), _filter, _eof, committedLiveBytes(),
+                               _mappings.back(), _snapshots);
+    }
+
+
+    uint64_t DB::oldestSnapshotSize() const {
+        lock_guard<mutex> lock(_snapshots->mutex);
+        return _snapshots->fileSizes.empty() ? _eof : *_snapshots->fileSizes.begin();
+    }
+
+
+    DB::Snapshot::Snapshot(const HashTree *tree, Filter *filter,
+                           uint64_t fileSize, uint64_t liveBytes, impl::Doc *file,
+                           SnapshotRegistry *registry)
+    :_tree(tree)
+    ,_filter(filter)
+    ,_fileSize(fileSize)
+    ,_liveBytes(liveBytes)
+    ,_file(file)
+    ,_registry(registry)
+    {
+        lock_guard<mutex> lock(_registry->mutex);
+        _registry->fileSizes.insert(_fileSize);
+    }
+
+
+    DB::Snapshot::~Snapshot() {
+        lock_guard<mutex> lock(_registry->mutex);
+        _registry->fileSizes.erase(_registry->fileSizes.find(_fileSize));
+    }
+
+
+    Dict DB::Snapshot::get(slice key) const {
+        if (!_tree || (_filter && !_filter->mayContain(key)))
+            return nullptr;
+        return _tree->get(key).asDict();
+    }
+
+
+    unsigned DB::Snapshot::count() const {
+        return _tree ? _tree->count() : 0;
+    }
+
+
+#pragma mark - COMPACTION:
+
+
+    // Writes a tree's keys and values from scratch, sorted by hash so that neighboring nodes
+    // and their leaves are stored together.
+    static void writeCompactTree(Encoder &enc, const HashTree *tree) {
+        HashTreeBuilder builder;
+        builder.reserve(tree->count());
+        for (HashTree::iterator i(tree); i; ++i)
+            builder.add(i.key(), i.value());
+        builder.writeTo(enc);
+    }
+
+
+    // Calls `callback` for every key whose value differs between the trees, either of which
+    // may be null (empty).
+    static void diffTrees(const HashTree *older, const HashTree *newer,
+                          const HashTree::DiffCallback &callback)
+    {
+        if (older && newer) {
+            newer->diff(*older, callback);
+        } else if (older || newer) {
+            for (HashTree::iterator i(older ? older : newer); i; ++i) {
+                if (older)
+                    callback(i.key(), i.value(), nullptr);
+                else
+                    callback(i.key(), nullptr, i.value());
+            }
+        }
+    }
+
+
+    uint64_t DB::liveBytes() const {
+        Retained<Snapshot> snap = snapshot();
+        if (!snap->_tree)
+            return sizeof(FileHeader);
+        size_t filterSize = snap->_filter ? snap->_filter->sectionSize() : 0;
+        return sizeof(FileHeader) + snap->_liveBytes + filterSize + sizeof(CommitTrailer);
+    }
+
+
+    void DB::compact() {
+        throwIf(!_writable, InvalidData, "DB is read-only");
+        string tempPath = _path + ".compact";
+        ::unlink(tempPath.c_str());
+        try {
+            DB dst(tempPath.c_str(), kCreate);
+            dst.setBloomFilter(_bloomBitsPerKey);
+
+            // Copy the latest commit's tree to the new file:
+            Retained<Snapshot> base = snapshot();
+            if (base->_tree) {
+                Encoder enc;
+                expert(enc).amend(dst.data());
+                expert(enc).suppressTrailer();
+                writeCompactTree(enc, base->_tree);
+                dst.appendCommit(enc.finish(), false);
+            }
+
+            // Copy the changes made by any commits since then:
+            auto catchUp = [&] {
+                Retained<Snapshot> latest = snapshot();
+                if (latest.get() == base.get())
+                    return false;
+                diffTrees(base->_tree, latest->_tree, [&](slice key, Value, Value newValue) {
+                    dst._tree.set(key, newValue);
+                });
+                dst.commitChanges(false);
+                base = latest;
+                return true;
+            };
+            for (int i = 0; i < kMaxCompactCatchUps && catchUp(); ++i) { }
+
+            // Finally, become the committer so no more commits can happen, catch up one last
+            // time, and switch to the new file:
+            unique_lock<mutex> lock(_commitMutex);
+            _commitCond.wait(lock, [&] {return !_committing;});
+            _committing = true;
+            lock.unlock();
+            try {
+                throwIf(_tree.isChanged(), InvalidData, "Can't compact DB with uncommitted changes");
+                catchUp();
+                checkErrno(::fsync(dst._fd), "Can't sync compacted DB file");
+                checkErrno(::rename(tempPath.c_str(), _path.c_str()), "Can't replace DB file");
+                takeOver(dst);
+            } catch (...) {
+                lock.lock();
+                _committing = false;
+                _commitCond.notify_all();
+                throw;
+            }
+            lock.lock();
+            _committing = false;
+            _commitCond.notify_all();
+        } catch (...) {
+            ::unlink(tempPath.c_str());
+            throw;
+        }
+    }
+
+
+    // Takes over the open file of another DB, which has been moved to my path. The old file's
+    // mappings are kept until I'm closed, since Values returned by `get` may point into them,
+    // and its Snapshots stay in the registry so `oldestSnapshotSize` still counts them.
+    void DB::takeOver(DB &other) {
+        ::close(_fd);
+        _fd = exchange(other._fd, -1);
+        _mappings.insert(_mappings.end(), other._mappings.begin(), other._mappings.end());
+        other._mappings.clear();
+        _eof = other._eof;
+        _discarded = 0;
+        _filter = std::move(other._filter);
+        resetTree();
+        publishSnapshot();
+    }
+
+
+#pragma mark - GROUP COMMIT:
+
+
+    // Group commit: the first caller to find no commit in progress becomes the committer. It
+    // takes every queued batch (including its own), writes them as one commit, then wakes up
+    // the other callers whose batches it wrote. Batches queued meanwhile wait for the next one.
+    void DB::commitBatch(span<const BatchOp> changes, bool sync) {
+        throwIf(!_writable, InvalidData, "DB is read-only");
+        PendingBatch batch {changes, sync};
+        unique_lock<mutex> lock(_commitMutex);
+        _commitQueue.push_back(&batch);
+        _commitCond.wait(lock, [&] {return batch.done || !_committing;});
+        if (!batch.done) {
+            _committing = true;
+            vector<PendingBatch*> group;
+            swap(group, _commitQueue);
+            lock.unlock();
+            commitGroup(group);
+            lock.lock();
+            for (auto b : group)
+                b->done = true;
+            _committing = false;
+            _commitCond.notify_all();
+        }
+        if (batch.error)
+            rethrow_exception(batch.error);
+    }
+
+
+    void DB::commitGroup(const vector<PendingBatch*> &group) {
+        try {
+            // First commit any changes made by `put` and `remove`, so that if the group's commit
+            // fails, reverting it doesn't lose them:
+            commitChanges(false);
+            try {
+                bool sync = false;
+                if (group.size() == 1) {
+                    _tree.applyBatch(group[0]->changes);
+                    sync = group[0]->sync;
+                } else {
+                    vector<BatchOp> changes;
+                    for (auto b : group) {
+                        changes.insert(changes.end(), b->changes.begin(), b->changes.end());
+                        sync |= b->sync;
+                    }
+                    _tree.applyBatch(changes);
+                }
+                commitChanges(sync);
+            } catch (...) {
+                revertChanges();
+                throw;
+            }
+        } catch (...) {
+            auto error = current_exception();
+            for (auto b : group)
+                b->error = error;
+        }
+    }
+
+}
+
+#endif // FL_HAVE_MMAP
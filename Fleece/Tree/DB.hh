@@ -0,0 +1,244 @@
+//
+//  DB.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "MutableHashTree.hh"
+#include "AtomicRetained.hh"
+#include "Doc.hh"
+#include "fleece/Mutable.hh"
+#include "fleece/RefCounted.hh"
+#include "fleece/slice.hh"
+#include "sliceIO.hh"
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <span>
+#include <string>
+#include <vector>
+
+// DB memory-maps its file, which requires a filesystem and POSIX `mmap`.
+#ifndef FL_HAVE_MMAP
+    #if FL_HAVE_FILESYSTEM && !defined(_MSC_VER)
+        #define FL_HAVE_MMAP 1
+    #else
+        #define FL_HAVE_MMAP 0
+    #endif
+#endif
+
+#if FL_HAVE_MMAP
+
+namespace fleece {
+
+    /** A persistent key-value store whose values are Dicts, stored in an append-only file.
+        (See FleeceStorage.md.)
+
+        The file is memory-mapped, and its latest HashTree is read in place with no parsing.
+        Changes are made to an in-memory MutableHashTree. `commitChanges` appends them to the
+        file as a delta (new values, changed tree nodes and the new root) followed by a
+        checksummed trailer. On open, the DB finds the last commit with a valid trailer and
+        discards anything after it, such as a commit that was cut short by a crash.
+
+        Values returned by `get` point into the mapped file, and are valid until the DB is
+        destroyed. The mapped file is registered as a Doc, so they can be retained; that (or a
+        Snapshot) keeps the mapping alive after the DB is gone.
+
+        Offsets in the file, like Fleece pointers, are 32 bits, so it can't grow past 4GB; a
+        commit that would make it larger throws a MemoryError instead. (`compact` can make room
+        by removing garbage.)
+
+        A DB is not thread-safe, except that `commitBatch` and `snapshot` may be called on any
+        thread at any time, and Snapshots may be used on any thread. Only one DB instance may
+        write to a file. */
+    class DB {
+    public:
+        enum OpenMode {
+            kReadOnly,          ///< Opens an existing file read-only
+            kWritable,          ///< Opens an existing file for reading and writing
+            kCreate,            ///< Like kWritable, but creates the file if it doesn't exist
+        };
+
+        explicit DB(const char *path, OpenMode =kCreate);
+        ~DB();
+
+        /** Returns the Dict stored under a key, or null. */
+        Dict get(slice key) const;
+
+        /** Returns a mutable version of the Dict stored under a key, or null if there isn't one.
+            Changes made to it will be saved by the next commit. */
+        MutableDict getMutable(slice key);
+
+        /** Stores a Dict under a key, or removes the key if the Dict is null. */
+        void put(slice key, Dict);
+
+        /** Removes a key, returning false if it didn't exist. */
+        bool remove(slice key);
+
+        /** The number of keys. */
+        unsigned count() const                      {return _tree.count();}
+
+        /** True if there are uncommitted changes. */
+        bool isChanged() const                      {return _tree.isChanged();}
+
+        /** Appends the changes to the file. If `sync` is true, waits until they've been
+            written to disk (`fsync`) before returning. */
+        void commitChanges(bool sync =true);
+
+        /** Discards all uncommitted changes. */
+        void revertChanges();
+
+        /** If `bitsPerKey` is nonzero, the DB keeps a Bloom filter of all the keys, which `get`
+            and Snapshots use to quickly reject most missing keys. It's kept in memory and updated
+            by each commit, which writes only the parts of it that changed (plus the whole filter
+            once in a while, when the keys outgrow it.) The setting is saved in the file, and
+            takes effect at the next commit. */
+        void setBloomFilter(unsigned bitsPerKey);
+
+        using BatchOp = MutableHashTree::BatchOp;
+
+        /** Applies a set of changes (a null value removes a key) and commits them, returning when
+            they're written. This may be called on multiple threads at once: while one commit is
+            being written, other callers' batches queue up, then all of them go into the next
+            commit, with a single `fsync`. If that commit fails, all of its callers get the
+            exception and none of their changes are applied.
+            Any uncommitted changes made by other methods are committed first, in a commit of their
+            own, so they're kept even if the batch fails. (If that commit fails, they're left
+            uncommitted, and the batches aren't applied.) */
+        void commitBatch(std::span<const BatchOp> changes, bool sync =true);
+
+        /** The current size of the file, i.e. the end of the last valid commit. */
+        uint64_t fileSize() const                   {return _eof;}
+
+        /** The size of the data reachable from the latest commit; the rest of the file is garbage.
+            Compacting the file shrinks it to about this size, or less, since it also flattens
+            values that were amended from earlier versions. This is tracked as commits are made,
+            so it's cheap; it's an estimate, as data shared by several values may be counted
+            more than once. */
+        uint64_t liveBytes() const;
+
+        /** Rewrites the file without garbage, keeping only the latest commit's data, with the
+            tree in hash order. This is done in a new file, which then replaces the old one.
+            Commits made by `commitBatch` on other threads can continue while it runs; they're
+            only blocked briefly at the end, while it copies their changes and swaps the files.
+            Snapshots and Values from before the compaction remain valid. */
+        void compact();
+
+        /** The number of bytes of incomplete or corrupted data found after the last valid commit
+            when the file was opened. (If writable, the file was truncated to remove them.) */
+        uint64_t discardedBytes() const             {return _discarded;}
+
+        /** Iterates over the keys and values, in no particular order. */
+        class iterator : public HashTree::iterator {
+        public:
+            explicit iterator(const DB &db)         :HashTree::iterator(db._tree) { }
+        };
+
+    private:
+        class Filter;
+
+        // Keeps track of the live Snapshots' commits; shared by the DB and its Snapshots.
+        struct SnapshotRegistry : public RefCounted {
+            std::mutex              mutex;
+            std::multiset<uint64_t> fileSizes;
+        };
+
+    public:
+        /** A read-only view of the DB as of one commit, unaffected by later changes. Since the
+            file is append-only, a commit's tree stays valid forever, so a Snapshot can be read on
+            any thread without locking while the DB appends new commits. A Snapshot keeps the
+            memory-mapped file alive, even after the DB is destroyed. */
+        class Snapshot : public RefCounted {
+        public:
+            Dict get(slice key) const;
+            unsigned count() const;
+
+            /** The size of the file as of this Snapshot's commit. */
+            uint64_t fileSize() const               {return _fileSize;}
+
+            class iterator : public HashTree::iterator {
+            public:
+                explicit iterator(const Snapshot &s) :HashTree::iterator(s._tree) { }
+            };
+
+        protected:
+            ~Snapshot();
+
+        private:
+            friend class DB;
+            Snapshot(const HashTree*, Filter*,
+                     uint64_t fileSize, uint64_t liveBytes, impl::Doc *file, SnapshotRegistry*);
+
+            const HashTree*            _tree;       // Null if the DB was empty
+            Retained<Filter>           _filter;     // Null if the commit has none
+            uint64_t                   _fileSize;
+            uint64_t                   _liveBytes;  // The commit's `liveBytes`, minus overhead
+            Retained<impl::Doc>        _file;       // The mapping containing the tree
+            Retained<SnapshotRegistry> _registry;
+        };
+
+        /** Returns a Snapshot of the latest commit. This never waits for a commit in progress. */
+        Retained<Snapshot> snapshot() const         {return _latest.get();}
+
+        /** The `fileSize` of the oldest Snapshot still in use. (The DB always holds a Snapshot of
+            its latest commit.) Data that's only reachable from older commits is garbage.
+            Snapshots from before a compaction are still counted; their sizes are of the old file. */
+        uint64_t oldestSnapshotSize() const;
+
+    private:
+        struct PendingBatch {
+            std::span<const BatchOp> changes;
+            bool                     sync;
+            bool                     done {false};
+            std::exception_ptr       error;
+        };
+
+        DB(const DB&) =delete;
+        DB& operator=(const DB&) =delete;
+
+        void open(OpenMode);
+        void close() noexcept;
+        void mapFile(size_t minSize);
+        slice data() const                          {return {_mappings.back()->data().buf, _eof};}
+        size_t findLastCommit() const;
+        bool isValidCommit(size_t end) const;
+        const HashTree* committedTree() const;
+        uint32_t committedLiveBytes() const;
+        void resetTree();
+        void loadFilter();
+        Retained<Filter> updateFilter(const HashTree *older, const HashTree &newer, bool &whole);
+        void publishSnapshot();
+        void write(slice, size_t pos);
+        void appendCommit(slice delta, bool sync);
+        void takeOver(DB &other);
+        void commitGroup(const std::vector<PendingBatch*>&);
+
+        std::string          _path;
+        int                  _fd {-1};
+        bool                 _writable;
+        std::vector<Retained<impl::Doc>> _mappings; // Latest is last; old ones kept till close,
+                                                    // including those of files replaced by `compact`
+        size_t               _eof {0};              // End of the last valid commit
+        uint64_t             _discarded {0};
+        MutableHashTree      _tree;
+        Retained<Filter>     _filter;               // The latest commit's Bloom filter
+        unsigned             _bloomBitsPerKey {0};
+        AtomicRetained<Snapshot> _latest;           // Snapshot of the latest commit
+        Retained<SnapshotRegistry> _snapshots;
+
+        std::mutex           _commitMutex;          // Guards the members below
+        std::condition_variable _commitCond;
+        std::vector<PendingBatch*> _commitQueue;    // Batches waiting for the next commit
+        bool                 _committing {false};   // True while a commit is being written
+    };
+
+}
+
+#endif // FL_HAVE_MMAP
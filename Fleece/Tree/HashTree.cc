@@ -12,6 +12,7 @@
 
 #include "HashTree.hh"
 #include "HashTree+Internal.hh"
+#include "Doc.hh"
 #include "Bitmap.hh"
 #include "Endian.hh"
 #include "fleece/PlatformCompat.hh"
@@ -108,6 +109,8 @@ namespace fleece {
 
         // Returns the total number of leaves under this node.
         unsigned Interior::leafCount() const {
+            if (childCount() == 0)
+                return 0;           // (an empty root has no children pointer)
             unsigned count = 0;
             auto c = childAtIndex(0);
             for (unsigned n = childCount(); n > 0; --n, ++c) {
@@ -122,7 +125,7 @@ namespace fleece {
         void Interior::dump(std::ostream &out, unsigned indent =1) const {
             unsigned n = childCount();
             out << string(2*indent, ' ') << "[";
-            auto child = childAtIndex(0);
+            auto child = n > 0 ? childAtIndex(0) : nullptr;
             for (unsigned i = 0; i < n; ++i, ++child) {
                 out << "\n";
                 if (child->isLeaf())
@@ -172,6 +175,188 @@ namespace fleece {
             }
         }
 
+
+
+        // Walks two versions of a tree in parallel for HashTree::diff.
+        class Differ {
+        public:
+            explicit Differ(const HashTree::DiffCallback &callback) :_callback(callback) { }
+
+            void diffInteriors(const Interior *older, const Interior *newer) {
+                bitmap_t oldBits = older->bitmap(), newBits = newer->bitmap();
+                if (oldBits == 0 && newBits == 0)
+                    return;
+                if (oldBits == newBits && older->childAtIndex(0) == newer->childAtIndex(0))
+                    return;     // Same children array, so the subtrees are identical
+                for (unsigned bitNo = 0; bitNo < kMaxChildren; ++bitNo) {
+                    auto oldChild = older->childForBitNumber(bitNo);
+                    auto newChild = newer->childForBitNumber(bitNo);
+                    if (oldChild && newChild)
+                        diffNodes(oldChild, newChild);
+                    else if (oldChild)
+                        reportAll(oldChild, false);
+                    else if (newChild)
+                        reportAll(newChild, true);
+                }
+            }
+
+        private:
+            void diffNodes(const Node *older, const Node *newer) {
+                if (older == newer)
+                    return;
+                if (older->isLeaf()) {
+                    if (newer->isLeaf())
+                        diffLeaves(&older->leaf, &newer->leaf);
+                    else
+                        diffLeafWithInterior(&older->leaf, &newer->interior, false);
+                } else {
+                    if (newer->isLeaf())
+                        diffLeafWithInterior(&newer->leaf, &older->interior, true);
+                    else
+                        diffInteriors(&older->interior, &newer->interior);
+                }
+            }
+
+            void diffLeaves(const Leaf *older, const Leaf *newer) {
+                if (older->key() == newer->key() || older->matches(newer->keyString())) {
+                    diffValues(newer->keyString(), older->value(), newer->value());
+                } else {
+                    _callback(older->keyString(), older->value(), nullptr);
+                    _callback(newer->keyString(), nullptr, newer->value());
+                }
+            }
+
+            // Compares a leaf in one tree with the subtree at the same position in the other.
+            // If `leafIsNewer` is true, the leaf is from the newer tree.
+            void diffLeafWithInterior(const Leaf *leaf, const Interior *interior, bool leafIsNewer) {
+                slice key = leaf->keyString();
+                bool found = false;
+                forEachLeaf(interior, [&](const Leaf *other) {
+                    if (other->matches(key)) {
+                        found = true;
+                        if (leafIsNewer)
+                            diffValues(key, other->value(), leaf->value());
+                        else
+                            diffValues(key, leaf->value(), other->value());
+                    } else {
+                        report(other, !leafIsNewer);
+                    }
+                });
+                if (!found)
+                    report(leaf, leafIsNewer);
+            }
+
+            void diffValues(slice key, Value oldValue, Value newValue) {
+                if (oldValue != newValue && !oldValue.isEqual(newValue))
+                    _callback(key, oldValue, newValue);
+            }
+
+            void report(const Leaf *leaf, bool added) {
+                if (added)
+                    _callback(leaf->keyString(), nullptr, leaf->value());
+                else
+                    _callback(leaf->keyString(), leaf->value(), nullptr);
+            }
+
+            void reportAll(const Node *node, bool added) {
+                if (node->isLeaf())
+                    report(&node->leaf, added);
+                else
+                    forEachLeaf(&node->interior, [&](const Leaf *leaf) {report(leaf, added);});
+            }
+
+            template <class FN>
+            static void forEachLeaf(const Interior *interior, const FN &fn) {
+                unsigned n = interior->childCount();
+                if (n == 0)
+                    return;
+                auto child = interior->childAtIndex(0);
+                for (; n > 0; --n, ++child) {
+                    if (child->isLeaf())
+                        fn(&child->leaf);
+                    else
+                        forEachLeaf(&child->interior, fn);
+                }
+            }
+
+            const HashTree::DiffCallback &_callback;
+        };
+
+
+        // Estimates how much of the data reachable from an older tree is no longer reachable from a
+        // newer one written on top of it. Subtrees the two share are skipped, so this takes time
+        // proportional to the size of the change.
+        class GarbageCounter {
+        public:
+            GarbageCounter(const Interior &newRoot, slice olderData)
+            :_newRoot(newRoot), _olderData(olderData) { }
+
+            size_t count(const Interior &oldRoot) {
+                _size = sizeof(Interior);
+                countInteriors(oldRoot, _newRoot);
+                return _size;
+            }
+
+        private:
+            void countInteriors(const Interior &older, const Interior &newer) {
+                unsigned n = older.childCount();
+                if (n == 0 || (older.bitmap() == newer.bitmap()
+                                    && older.childAtIndex(0) == newer.childAtIndex(0)))
+                    return;     // Same children array, so the subtrees are identical
+                _size += n * sizeof(Node);
+                for (unsigned bitNo = 0; bitNo < kMaxChildren; ++bitNo) {
+                    auto oldChild = older.childForBitNumber(bitNo);
+                    if (!oldChild)
+                        continue;
+                    auto newChild = newer.childForBitNumber(bitNo);
+                    if (oldChild->isLeaf())
+                        countLeaf(oldChild->leaf);
+                    else if (newChild && !newChild->isLeaf())
+                        countInteriors(oldChild->interior, newChild->interior);
+                    else
+                        countSubtree(oldChild->interior);
+                }
+            }
+
+            // Counts a subtree the newer tree doesn't have, though its leaves may have moved.
+            void countSubtree(const Interior &interior) {
+                unsigned n = interior.childCount();
+                _size += n * sizeof(Node);
+                for (unsigned i = 0; i < n; ++i) {
+                    auto child = interior.childAtIndex(int(i));
+                    if (child->isLeaf())
+                        countLeaf(child->leaf);
+                    else
+                        countSubtree(child->interior);
+                }
+            }
+
+            // Counts the parts of a leaf's key and value that the newer tree no longer uses.
+            void countLeaf(const Leaf &oldLeaf) {
+                auto newLeaf = _newRoot.findNearest(oldLeaf.hash());
+                if (newLeaf && !newLeaf->matches(oldLeaf.keyString()))
+                    newLeaf = nullptr;
+                if (!newLeaf || newLeaf->key() != oldLeaf.key())
+                    _size += sizeOf(oldLeaf.key());
+                Value oldValue = oldLeaf.value();
+                if (!newLeaf) {
+                    _size += sizeOf(oldValue);
+                } else if (Value newValue = newLeaf->value(); newValue != oldValue) {
+                    // The new value may still use parts of the old one, such as unchanged properties:
+                    size_t oldSize = sizeOf(oldValue), keptSize = sizeOf(newValue);
+                    _size += oldSize - min(oldSize, keptSize);
+                }
+            }
+
+            size_t sizeOf(Value value) const {
+                return impl::Doc::subtreeSize((const impl::Value*)FLValue(value), _olderData);
+            }
+
+            const Interior &_newRoot;
+            slice                     _olderData;
+            size_t                    _size {0};
+        };
+
     }
 
     using namespace hashtree;
@@ -198,6 +383,14 @@ namespace fleece {
         return rootNode()->leafCount();
     }
 
+    void HashTree::diff(const HashTree &older, const DiffCallback &callback) const {
+        Differ(callback).diffInteriors(older.rootNode(), rootNode());
+    }
+
+    size_t HashTree::replacedBytes(const HashTree &older, slice olderData) const {
+        return GarbageCounter(*rootNode(), olderData).count(*older.rootNode());
+    }
+
     void HashTree::dump(ostream &out) const {
         out << "HashTree [\n";
         rootNode()->dump(out);
@@ -13,6 +13,7 @@
 #pragma once
 #include "fleece/slice.hh"
 #include "fleece/Fleece.hh"
+#include <functional>
 #include <memory>
 
 namespace fleece {
@@ -38,6 +39,23 @@ namespace fleece {
 
         void dump(std::ostream &out) const;
 
+        /** Callback for `diff`. For an added key `oldValue` is null; for a removed key
+            `newValue` is null; for a changed key neither is. */
+        using DiffCallback = std::function<void(slice key, Value oldValue, Value newValue)>;
+
+        /** Reports every key that differs between `older` and this tree. Subtrees that the two
+            trees share (as when this one was written by amending `older`'s data) are skipped
+            without being visited, so the time taken is proportional to the size of the change.
+            Both trees must be in the same address space, i.e. `older`'s data must not have been
+            copied since this tree was written on top of it. */
+        void diff(const HashTree &older, const DiffCallback&) const;
+
+        /** Estimates how much of `olderData` is reachable from `older` (its nodes, keys and
+            values) but not from this tree, i.e. became garbage when this tree was written on top
+            of `older`. Like `diff`, it skips shared subtrees. Data shared by several values may
+            be counted more than once. */
+        size_t replacedBytes(const HashTree &older, slice olderData) const;
+
 
         class iterator {
         public:
@@ -0,0 +1,254 @@
+//
+//  HashTreeBuilder.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "HashTreeBuilder.hh"
+#include "HashTree+Internal.hh"
+#include "FleeceException.hh"
+#include "TempArray.hh"
+#include "fleece/Expert.hh"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include "betterassert.hh"
+
+using namespace std;
+
+namespace fleece {
+    using namespace hashtree;
+
+    static constexpr size_t kKeyChunkSize = 64 * 1024;
+
+    // Below this many entries, sorting isn't worth spawning threads for.
+    static constexpr size_t kMinParallelEntries = 64 * 1024;
+
+
+    // The tree's branch at depth `d` is picked by hash bits [5d, 5d+5), i.e. the low bits come
+    // first. This reverses the order of the 5-bit groups, so that sorting entries by this key
+    // makes every subtree's entries contiguous. (The last group only has 2 bits.)
+    static inline uint32_t sortKey(hash_t hash) {
+        uint32_t key = 0;
+        for (unsigned shift = 0; shift < 30; shift += kBitShift)
+            key = (key << kBitShift) | ((hash >> shift) & (kMaxChildren - 1));
+        return (key << 2) | (hash >> 30);
+    }
+
+    static inline unsigned childBitNumber(hash_t hash, unsigned shift) {
+        return (hash >> shift) & (kMaxChildren - 1);
+    }
+
+
+    HashTreeBuilder::HashTreeBuilder() =default;
+    HashTreeBuilder::~HashTreeBuilder() =default;
+
+
+    void HashTreeBuilder::reserve(size_t n) {
+        _entries.reserve(n);
+    }
+
+
+    slice HashTreeBuilder::copyKey(slice key) {
+        if (key.size > _keySpace) {
+            size_t chunkSize = max(key.size, kKeyChunkSize);
+            _keyChunks.emplace_back(new char[chunkSize]);
+            _keyPos = _keyChunks.back().get();
+            _keySpace = chunkSize;
+        }
+        if (key.size > 0)   // (key.buf may be null)
+            memcpy(_keyPos, key.buf, key.size);
+        slice copied(_keyPos, key.size);
+        _keyPos += key.size;
+        _keySpace -= key.size;
+        return copied;
+    }
+
+
+    void HashTreeBuilder::add(slice key, Value value) {
+        assert_precondition(value);
+        throwIf(key.size > UINT32_MAX, InvalidData, "HashTree key too long");
+        slice copied = copyKey(key);
+        _entries.push_back({ComputeHash(key), uint32_t(key.size), (const char*)copied.buf, value});
+    }
+
+
+#pragma mark - SORTING:
+
+
+    // Stable LSD radix sort of `src` by bits [0, 27) of the entries' sort keys, in three 9-bit
+    // passes, ping-ponging between `src` and `tmp`. The result ends up in `tmp`.
+    template <class ENTRY>
+    static void radixSortLowBits(ENTRY *src, ENTRY *tmp, size_t n) {
+        static constexpr unsigned kDigitBits = 9, kBuckets = 1 << kDigitBits;
+        size_t counts[kBuckets];
+        ENTRY *from = src, *to = tmp;
+        for (unsigned pass = 0; pass < 3; ++pass) {
+            unsigned shift = pass * kDigitBits;
+            memset(counts, 0, sizeof(counts));
+            for (size_t i = 0; i < n; ++i)
+                ++counts[(sortKey(from[i].hash) >> shift) & (kBuckets - 1)];
+            size_t total = 0;
+            for (auto &c : counts) {
+                size_t count = c;
+                c = total;
+                total += count;
+            }
+            for (size_t i = 0; i < n; ++i)
+                to[counts[(sortKey(from[i].hash) >> shift) & (kBuckets - 1)]++] = from[i];
+            swap(from, to);
+        }
+        // After an odd number of passes the result is in `tmp`.
+    }
+
+
+    // Sorts the entries by `sortKey`, stably (so that later duplicates stay after earlier ones.)
+    // The first pass partitions by the top-level branch; each of the 32 resulting buckets is
+    // then sorted independently, on worker threads if `parallel` is true.
+    void HashTreeBuilder::sort(bool parallel) {
+        size_t n = _entries.size();
+        vector<Entry> tmp(n);
+
+        size_t starts[kMaxChildren + 1] = {};
+        for (auto &e : _entries)
+            ++starts[childBitNumber(e.hash, 0) + 1];
+        for (unsigned b = 0; b < kMaxChildren; ++b)
+            starts[b + 1] += starts[b];
+        {
+            size_t pos[kMaxChildren];
+            copy(begin(starts), begin(starts) + kMaxChildren, pos);
+            for (auto &e : _entries)
+                tmp[pos[childBitNumber(e.hash, 0)]++] = e;
+        }
+
+        // Now sort each bucket from `tmp` back into `_entries`:
+        auto sortBucket = [&](unsigned b) {
+            radixSortLowBits(&tmp[starts[b]], &_entries[starts[b]], starts[b+1] - starts[b]);
+        };
+
+        unsigned nThreads = parallel && n >= kMinParallelEntries
+                                ? min(thread::hardware_concurrency(), unsigned(kMaxChildren)) : 1;
+        if (nThreads <= 1) {
+            for (unsigned b = 0; b < kMaxChildren; ++b)
+                sortBucket(b);
+        } else {
+            atomic<unsigned> nextBucket {0};
+            vector<thread> threads;
+            for (unsigned t = 0; t < nThreads; ++t) {
+                threads.emplace_back([&] {
+                    unsigned b;
+                    while ((b = nextBucket++) < kMaxChildren)
+                        sortBucket(b);
+                });
+            }
+            for (auto &t : threads)
+                t.join();
+        }
+    }
+
+
+#pragma mark - WRITING:
+
+
+    // Writes sorted entries to an Encoder in the same order MutableInterior::writeTo does.
+    class HashTreeBuilder::Writer {
+    public:
+        explicit Writer(Encoder &enc)   :_enc(enc) { }
+
+        // Writes the interior node containing the entries [begin, end), all of which have the
+        // same hash bits below `shift`. Returns the node, with an absolute children position.
+        Interior writeInterior(const Entry *begin, const Entry *end, unsigned shift) {
+            // Find the runs of entries belonging to each child:
+            const Entry* runs[kMaxChildren + 1];
+            bool isLeaf[kMaxChildren];
+            bitmap_t bitmap = 0;
+            unsigned n = 0;
+            for (auto e = begin; e != end; ) {
+                unsigned bitNo = childBitNumber(e->hash, shift);
+                auto runEnd = e + 1;
+                while (runEnd != end && childBitNumber(runEnd->hash, shift) == bitNo)
+                    ++runEnd;
+                bitmap |= bitmap_t(1) << bitNo;
+                isLeaf[n] = (runEnd[-1].hash == e->hash);   // All the same hash?
+                runs[n++] = e;
+                e = runEnd;
+            }
+            runs[n] = end;
+
+            // Write interior nodes, then leaf node Values, then leaf node keys:
+            TempArray(nodes, Node, n);
+            TempArray(valuePos, uint32_t, n);
+            for (unsigned i = 0; i < n; ++i) {
+                if (!isLeaf[i])
+                    nodes[i].interior = writeInterior(runs[i], runs[i+1], shift + kBitShift);
+            }
+            for (unsigned i = 0; i < n; ++i) {
+                if (isLeaf[i]) {
+                    _enc.writeValue(leafEntry(runs[i], runs[i+1]).value);
+                    valuePos[i] = uint32_t(expert(_enc).finishItem());
+                }
+            }
+            for (unsigned i = 0; i < n; ++i) {
+                if (isLeaf[i]) {
+                    _enc.writeString(leafEntry(runs[i], runs[i+1]).key());
+                    nodes[i].leaf = Leaf(uint32_t(expert(_enc).finishItem()), valuePos[i]);
+                }
+            }
+
+            // Convert the Nodes' absolute positions into offsets, and write them:
+            const uint32_t childrenPos = uint32_t(expert(_enc).nextWritePos());
+            auto curPos = childrenPos;
+            for (unsigned i = 0; i < n; ++i) {
+                if (isLeaf[i])
+                    nodes[i].leaf.makeRelativeTo(curPos);
+                else
+                    nodes[i].interior.makeRelativeTo(curPos);
+                curPos += sizeof(Node);
+            }
+            expert(_enc).writeRaw({nodes, n * sizeof(Node)});
+            return Interior(bitmap, childrenPos);
+        }
+
+        uint32_t writeRoot(const Entry *begin, const Entry *end) {
+            Interior root = writeInterior(begin, end, 0);
+            auto curPos = uint32_t(expert(_enc).nextWritePos());
+            root.makeRelativeTo(curPos);
+            expert(_enc).writeRaw({&root, sizeof(root)});
+            return curPos;
+        }
+
+    private:
+        // Given a run of entries with identical hashes, returns the one to store in the leaf.
+        static const Entry& leafEntry(const Entry *begin, const Entry *end) {
+            const Entry &last = end[-1];
+            for (auto e = begin; e != end - 1; ++e) {
+                throwIf(e->key() != last.key(), InternalError,
+                        "HashTree can't store keys with colliding hashes");
+            }
+            return last;
+        }
+
+        Encoder &_enc;
+    };
+
+
+    uint32_t HashTreeBuilder::writeTo(Encoder &enc, bool parallel) {
+        if (_entries.empty())
+            return 0;
+        sort(parallel);
+        uint32_t rootPos = Writer(enc).writeRoot(_entries.data(), _entries.data() + _entries.size());
+        _entries.clear();
+        _keyChunks.clear();
+        _keyPos = nullptr;
+        _keySpace = 0;
+        return rootPos;
+    }
+
+}
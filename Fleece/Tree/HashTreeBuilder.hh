@@ -0,0 +1,71 @@
+//
+//  HashTreeBuilder.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "HashTree.hh"
+#include "fleece/slice.hh"
+#include <memory>
+#include <vector>
+
+namespace fleece {
+    class Encoder;
+
+
+    /** Bulk-loads a HashTree from a (possibly huge) unsorted stream of key/value pairs.
+
+        Instead of inserting keys one at a time into a MutableHashTree, the builder just collects
+        them, radix-sorts them by hash so that every subtree's keys are contiguous, then writes
+        the encoded tree bottom-up in one pass. No mutable nodes are ever allocated.
+
+        Keys are copied, but Values are _not_ retained: they must remain valid until `writeTo`
+        returns. If the same key is added more than once, the last value wins. */
+    class HashTreeBuilder {
+    public:
+        HashTreeBuilder();
+        ~HashTreeBuilder();
+
+        /** Preallocates space for `n` entries. */
+        void reserve(size_t n);
+
+        /** Adds a key and value. */
+        void add(slice key, Value);
+
+        /** The number of entries added (including duplicate keys.) */
+        size_t count() const                    {return _entries.size();}
+
+        /** Sorts the entries and writes the encoded tree to the encoder, in the same format as
+            `MutableHashTree::writeTo`, returning the position of the root node (or 0 if empty.)
+            If `parallel` is true, the 32 top-level branches are sorted on multiple threads.
+            The builder is left empty afterwards. */
+        uint32_t writeTo(Encoder&, bool parallel =true);
+
+    private:
+        struct Entry {
+            uint32_t    hash;
+            uint32_t    keySize;
+            const char* keyBuf;
+            FLValue     value;
+
+            slice key() const                   {return {keyBuf, keySize};}
+        };
+        class Writer;
+
+        slice copyKey(slice key);
+        void sort(bool parallel);
+
+        std::vector<Entry> _entries;
+        std::vector<std::unique_ptr<char[]>> _keyChunks;    // Storage for copied keys
+        char* _keyPos {nullptr};                            // Next free byte in last chunk
+        size_t _keySpace {0};                               // Bytes free in last chunk
+    };
+
+}
@@ -0,0 +1,332 @@
+//
+//  MutableBTree.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "MutableBTree.hh"
+#include "BTree+Internal.hh"
+#include "fleece/Mutable.hh"
+#include <algorithm>
+#include <ostream>
+#include "betterassert.hh"
+
+using namespace std;
+
+namespace fleece {
+
+    namespace btree {
+
+        unique_ptr<MutableNode> MutableNode::newLeaf() {
+            return unique_ptr<MutableNode>(new MutableNode(true));
+        }
+
+
+        unique_ptr<MutableNode> MutableNode::mutableCopy(Array array) {
+            NodeRef imm(array);
+            unsigned n = imm.count();
+            unique_ptr<MutableNode> node(new MutableNode(imm.isLeaf()));
+            node->_keys.reserve(n + 1);
+            if (node->_isLeaf) {
+                node->_values.reserve(n + 1);
+                for (unsigned i = 0; i < n; ++i) {
+                    node->_keys.emplace_back(imm.keyAt(i), false);
+                    node->_values.emplace_back(imm.valueAt(i), false);
+                }
+            } else {
+                node->_children.reserve(n + 1);
+                for (unsigned i = 0; i < n; ++i) {
+                    node->_keys.emplace_back(i > 0 ? imm.keyAt(i) : slice(), false);
+                    node->_children.push_back({imm.childAt(i).asImmutable(), nullptr});
+                }
+            }
+            return node;
+        }
+
+
+        unique_ptr<MutableNode> MutableNode::newInterior(unique_ptr<MutableNode> left,
+                                                         unique_ptr<MutableNode> right)
+        {
+            unique_ptr<MutableNode> node(new MutableNode(false));
+            node->_keys.push_back(left->_keys.empty() ? Key() : left->_keys[0]);
+            node->_keys.push_back(right->_keys[0]);
+            node->_children.push_back({Array(), std::move(left)});
+            node->_children.push_back({Array(), std::move(right)});
+            return node;
+        }
+
+
+        NodeRef MutableNode::childAt(unsigned i) const {
+            auto &child = _children[i];
+            return child.mut ? NodeRef(child.mut.get()) : NodeRef(child.imm);
+        }
+
+
+        unsigned MutableNode::find(slice key) const {
+            if (_isLeaf) {
+                auto i = lower_bound(_keys.begin(), _keys.end(), key,
+                                     [](const Key &k, slice key) {return slice(k) < key;});
+                return unsigned(i - _keys.begin());
+            } else {
+                // _keys[0] is ignored; child 0 takes everything below _keys[1].
+                auto i = upper_bound(_keys.begin() + 1, _keys.end(), key,
+                                     [](slice key, const Key &k) {return key < slice(k);});
+                return unsigned(i - _keys.begin()) - 1;
+            }
+        }
+
+
+        MutableNode* MutableNode::mutableChild(unsigned i) {
+            auto &child = _children[i];
+            if (!child.mut)
+                child.mut = mutableCopy(child.imm);
+            return child.mut.get();
+        }
+
+
+        unique_ptr<MutableNode> MutableNode::insert(slice key, const InsertCallback &callback,
+                                                    bool &ok)
+        {
+            ok = true;
+            unsigned i = find(key);
+            if (_isLeaf) {
+                if (i < count() && slice(_keys[i]) == key) {
+                    Value val = callback(_values[i]);
+                    if (!val) {
+                        ok = false;
+                        return nullptr;
+                    }
+                    _values[i] = LeafValue(val, true);
+                    return nullptr;
+                }
+                Value val = callback(nullptr);
+                if (!val) {
+                    ok = false;
+                    return nullptr;
+                }
+                _keys.emplace(_keys.begin() + i, key, true);
+                _values.emplace(_values.begin() + i, val, true);
+            } else {
+                auto sibling = mutableChild(i)->insert(key, callback, ok);
+                if (!sibling)
+                    return nullptr;
+                _keys.emplace(_keys.begin() + i + 1, sibling->_keys[0]);
+                _children.insert(_children.begin() + i + 1, Child{Array(), std::move(sibling)});
+            }
+            return (count() > kMaxEntries) ? split() : nullptr;
+        }
+
+
+        // Moves the upper half of my entries into a new sibling node, and returns it.
+        // The sibling's first key is the lowest key in it, which the parent uses as a separator.
+        unique_ptr<MutableNode> MutableNode::split() {
+            unsigned mid = count() / 2;
+            unique_ptr<MutableNode> sibling(new MutableNode(_isLeaf));
+            sibling->_keys.assign(make_move_iterator(_keys.begin() + mid),
+                                  make_move_iterator(_keys.end()));
+            _keys.resize(mid);
+            if (_isLeaf) {
+                sibling->_values.assign(make_move_iterator(_values.begin() + mid),
+                                        make_move_iterator(_values.end()));
+                _values.resize(mid);
+            } else {
+                sibling->_children.assign(make_move_iterator(_children.begin() + mid),
+                                          make_move_iterator(_children.end()));
+                _children.resize(mid);
+            }
+            return sibling;
+        }
+
+
+        bool MutableNode::remove(slice key) {
+            unsigned i = find(key);
+            if (_isLeaf) {
+                if (i >= count() || slice(_keys[i]) != key)
+                    return false;
+                _keys.erase(_keys.begin() + i);
+                _values.erase(_values.begin() + i);
+                return true;
+            } else {
+                auto &child = _children[i];
+                if (child.mut) {
+                    if (!child.mut->remove(key))
+                        return false;
+                } else {
+                    // Don't keep the mutable copy unless the key was actually there:
+                    auto copy = mutableCopy(child.imm);
+                    if (!copy->remove(key))
+                        return false;
+                    child.mut = std::move(copy);
+                }
+                if (child.mut->count() == 0) {
+                    _keys.erase(_keys.begin() + i);
+                    _children.erase(_children.begin() + i);
+                }
+                return true;
+            }
+        }
+
+
+        unique_ptr<MutableNode> MutableNode::collapse() {
+            if (_isLeaf || count() != 1)
+                return nullptr;
+            mutableChild(0);
+            return std::move(_children[0].mut);
+        }
+
+
+        void MutableNode::writeTo(Encoder &enc) const {
+            unsigned n = count();
+            if (_isLeaf) {
+                enc.beginArray(2 * n);
+                for (unsigned i = 0; i < n; ++i) {
+                    enc.writeString(_keys[i]);
+                    enc.writeValue(_values[i]);
+                }
+            } else {
+                enc.beginArray(2 * n - 1);
+                for (unsigned i = 0; i < n; ++i) {
+                    if (i > 0)
+                        enc.writeString(_keys[i]);
+                    if (auto &child = _children[i]; child.mut)
+                        child.mut->writeTo(enc);
+                    else
+                        enc.writeValue(child.imm);     // Becomes a pointer if it's in the base
+                }
+            }
+            enc.endArray();
+        }
+
+    }
+
+    using namespace btree;
+
+
+    MutableBTree::MutableBTree()
+    { }
+
+    MutableBTree::MutableBTree(const BTree &tree)
+    :_imRoot(tree)
+    { }
+
+    MutableBTree::~MutableBTree() =default;
+
+    MutableBTree& MutableBTree::operator= (MutableBTree &&other) noexcept {
+        _imRoot = other._imRoot;
+        _root = std::move(other._root);
+        other._imRoot = BTree();
+        return *this;
+    }
+
+    MutableBTree& MutableBTree::operator= (const BTree &imTree) {
+        _imRoot = imTree;
+        _root.reset();
+        return *this;
+    }
+
+    NodeRef MutableBTree::rootNode() const {
+        if (_root)
+            return _root.get();
+        else
+            return _imRoot.rootNode();
+    }
+
+    unsigned MutableBTree::count() const {
+        auto root = rootNode();
+        return root ? root.leafCount() : 0;
+    }
+
+    Value MutableBTree::get(slice key) const {
+        auto root = rootNode();
+        return root ? root.get(key) : nullptr;
+    }
+
+    bool MutableBTree::insert(slice key, InsertCallback callback) {
+        if (!_root)
+            _root = _imRoot ? MutableNode::mutableCopy(_imRoot.rootArray()) : MutableNode::newLeaf();
+        bool ok;
+        auto sibling = _root->insert(key, callback, ok);
+        if (sibling) {
+            // Root split, so grow the tree by one level:
+            _root = MutableNode::newInterior(std::move(_root), std::move(sibling));
+        }
+        return ok;
+    }
+
+    void MutableBTree::set(slice key, Value val) {
+        if (val)
+            insert(key, [=](Value){ return val; });
+        else
+            remove(key);
+    }
+
+    bool MutableBTree::remove(slice key) {
+        if (!_root) {
+            if (!_imRoot)
+                return false;
+            auto copy = MutableNode::mutableCopy(_imRoot.rootArray());
+            if (!copy->remove(key))
+                return false;
+            _root = std::move(copy);
+        } else if (!_root->remove(key)) {
+            return false;
+        }
+        while (auto child = _root->collapse())
+            _root = std::move(child);
+        if (!_root->isLeaf() && _root->count() == 0)
+            _root = MutableNode::newLeaf();
+        return true;
+    }
+
+
+    MutableArray MutableBTree::getMutableArray(slice key) {
+        MutableArray result;
+        insert(key, [&](Value value) -> Value {
+            auto array = value.asArray();
+            result = array.asMutable();
+            if (!result)
+                result = array.mutableCopy();
+            return result;
+        });
+        return result;
+    }
+
+    MutableDict MutableBTree::getMutableDict(slice key) {
+        MutableDict result;
+        insert(key, [&](Value value) -> Value {
+            auto dict = value.asDict();
+            result = dict.asMutable();
+            if (!result)
+                result = dict.mutableCopy();
+            return result;
+        });
+        return result;
+    }
+
+    void MutableBTree::writeTo(Encoder &enc) {
+        if (_root)
+            _root->writeTo(enc);
+        else if (_imRoot)
+            enc.writeValue(_imRoot.rootArray());
+        else
+            MutableNode::newLeaf()->writeTo(enc);
+    }
+
+    void MutableBTree::dump(std::ostream &out) {
+        if (_imRoot && !_root) {
+            _imRoot.dump(out);
+        } else {
+            out << "MutableBTree ";
+            if (_root)
+                rootNode().dump(out, 0);
+            out << "\n";
+        }
+    }
+
+}
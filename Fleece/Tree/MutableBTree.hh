@@ -0,0 +1,74 @@
+//
+//  MutableBTree.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "BTree.hh"
+#include "fleece/slice.hh"
+#include <functional>
+#include <memory>
+
+namespace fleece {
+    class MutableArray;
+    class MutableDict;
+    class Encoder;
+
+    namespace btree {
+        class MutableNode;
+        class NodeRef;
+    }
+
+
+    /** A mutable B+tree, optionally based on an immutable BTree. Only the nodes along the paths
+        to changed keys are copied into memory; everything else is referenced in place. */
+    class MutableBTree {
+    public:
+        MutableBTree();
+        MutableBTree(const BTree&);
+        ~MutableBTree();
+
+        MutableBTree& operator= (MutableBTree&&) noexcept;
+        MutableBTree& operator= (const BTree&);
+
+        Value get(slice key) const;
+
+        MutableArray getMutableArray(slice key);
+        MutableDict getMutableDict(slice key);
+
+        unsigned count() const;
+
+        bool isChanged() const                  {return _root != nullptr;}
+
+        using InsertCallback = std::function<Value(Value)>;
+
+        void set(slice key, Value);
+        bool insert(slice key, InsertCallback);
+        bool remove(slice key);
+
+        /** Writes the tree's root node as the next value in the Encoder. If the encoder is
+            amending the data containing the original BTree, unchanged nodes are written as
+            pointers back into it, so only the modified nodes are appended. */
+        void writeTo(Encoder&);
+
+        void dump(std::ostream &out);
+
+        using iterator = BTree::iterator;
+
+    private:
+        btree::NodeRef rootNode() const;
+
+        BTree _imRoot;
+        std::unique_ptr<btree::MutableNode> _root;
+
+        friend class BTree::iterator;
+    };
+
+}
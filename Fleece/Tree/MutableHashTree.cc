@@ -21,8 +21,10 @@
 #include "HeapArray.hh"
 #include "HeapDict.hh"
 #include <algorithm>
+#include <atomic>
 #include <ostream>
 #include <string>
+#include <thread>
 #include "betterassert.hh"
 
 using namespace std;
@@ -40,28 +42,45 @@ namespace fleece {
     { }
 
     MutableHashTree::~MutableHashTree() {
-        if (_root)
-            _root->deleteTree();
+        freeNodes();
     }
 
     MutableHashTree& MutableHashTree::operator= (MutableHashTree &&other) noexcept {
+        freeNodes();
         _imRoot = other._imRoot;
-        if (_root)
-            _root->deleteTree();
         _root = other._root;
+        _arena = std::move(other._arena);
+        _workerArenas = std::move(other._workerArenas);
         other._imRoot = nullptr;
         other._root = nullptr;
         return *this;
     }
 
     MutableHashTree& MutableHashTree::operator= (const HashTree *imTree) {
+        freeNodes();
         _imRoot = imTree;
-        if (_root)
-            _root->deleteTree();
-        _root = nullptr;
         return *this;
     }
 
+    NodeArena& MutableHashTree::arena() {
+        if (!_arena)
+            _arena = make_unique<NodeArena>();
+        return *_arena;
+    }
+
+    // Frees all the mutable nodes at once, by resetting the arena they were allocated from.
+    void MutableHashTree::freeNodes() {
+        if (_root) {
+            _root->destroyLeaves();
+            _root = nullptr;
+        }
+        if (_arena)
+            _arena->reset();
+        // Nodes allocated by applyBatch's workers may be anywhere in the tree:
+        for (auto &workerArena : _workerArenas)
+            workerArena->reset();
+    }
+
     unsigned MutableHashTree::count() const {
         if (_root)
             return _root->leafCount();
@@ -102,8 +121,8 @@ namespace fleece {
 
     bool MutableHashTree::insert(slice key, InsertCallback callback) {
         if (!_root)
-            _root = MutableInterior::newRoot(_imRoot);
-        auto result = _root->insert(Target(key, &callback), 0);
+            _root = MutableInterior::newRoot(arena(), _imRoot);
+        auto result = _root->insert(arena(), Target(key, &callback), 0);
         if (!result)
             return false;
         _root = result;
@@ -121,9 +140,85 @@ namespace fleece {
         if (!_root) {
             if (!_imRoot)
                 return false;
-            _root = MutableInterior::newRoot(_imRoot);
+            _root = MutableInterior::newRoot(arena(), _imRoot);
+        }
+        return _root->remove(arena(), Target(key), 0);
+    }
+
+
+    // Below this many operations, applyBatch just applies them in order on the current thread.
+    static constexpr size_t kMinParallelBatch = 1024;
+
+    void MutableHashTree::applyBatch(span<const BatchOp> ops, bool parallel) {
+        if (!parallel || ops.size() < kMinParallelBatch) {
+            for (auto &op : ops)
+                set(op.key, op.value);
+            return;
+        }
+
+        // Group the ops by top-level branch, keeping them in order within each group:
+        vector<hash_t> hashes(ops.size());
+        size_t starts[kMaxChildren + 1] = {};
+        for (size_t i = 0; i < ops.size(); ++i) {
+            hashes[i] = ComputeHash(ops[i].key);
+            ++starts[(hashes[i] & (kMaxChildren - 1)) + 1];
+        }
+        for (unsigned b = 0; b < kMaxChildren; ++b)
+            starts[b + 1] += starts[b];
+        vector<uint32_t> order(ops.size());
+        {
+            size_t pos[kMaxChildren];
+            copy(begin(starts), begin(starts) + kMaxChildren, pos);
+            for (size_t i = 0; i < ops.size(); ++i)
+                order[pos[hashes[i] & (kMaxChildren - 1)]++] = uint32_t(i);
+        }
+
+        // Detach each affected branch from the root, so the workers don't share any nodes:
+        if (!_root)
+            _root = MutableInterior::newRoot(arena(), _imRoot);
+        MutableInterior* branches[kMaxChildren] = {};
+        for (unsigned b = 0; b < kMaxChildren; ++b) {
+            if (starts[b + 1] > starts[b])
+                branches[b] = _root->detachBranch(arena(), b);
+        }
+
+        // Each worker thread takes the next unclaimed branch and applies its ops, allocating
+        // from its own arena:
+        unsigned nThreads = max(1u, min(thread::hardware_concurrency(), unsigned(kMaxChildren)));
+        while (_workerArenas.size() < nThreads)
+            _workerArenas.push_back(make_unique<NodeArena>());
+        atomic<unsigned> nextBranch {0};
+        auto work = [&](NodeArena &workerArena) {
+            unsigned b;
+            while ((b = nextBranch++) < kMaxChildren) {
+                if (!branches[b])
+                    continue;
+                for (size_t i = starts[b]; i < starts[b + 1]; ++i) {
+                    auto &op = ops[order[i]];
+                    InsertCallback callback = [&](Value) {return op.value;};
+                    Target target(op.key, hashes[order[i]], &callback);
+                    if (op.value)
+                        branches[b] = branches[b]->insert(workerArena, target, 0);
+                    else
+                        branches[b]->remove(workerArena, target, 0);
+                }
+            }
+        };
+        if (nThreads == 1) {
+            work(*_workerArenas[0]);
+        } else {
+            vector<thread> threads;
+            for (unsigned t = 0; t < nThreads; ++t)
+                threads.emplace_back(work, ref(*_workerArenas[t]));
+            for (auto &t : threads)
+                t.join();
+        }
+
+        // Stitch the branches back into the root:
+        for (unsigned b = 0; b < kMaxChildren; ++b) {
+            if (branches[b])
+                _root = _root->reattachBranch(arena(), b, branches[b]);
         }
-        return _root->remove(Target(key), 0);
     }
 
 
@@ -155,8 +250,8 @@ namespace fleece {
         if (_root) {
             return _root->writeRootTo(enc);
         } else if (_imRoot) {
-            unique_ptr<MutableInterior> tempRoot( MutableInterior::newRoot(_imRoot) );
-            return tempRoot->writeRootTo(enc);
+            NodeArena tempArena;
+            return MutableInterior::newRoot(tempArena, _imRoot)->writeRootTo(enc);
         } else {
             return 0;
         }
@@ -241,7 +336,7 @@ namespace fleece {
     { }
 
     HashTree::iterator::iterator(const HashTree *tree)
-    :iterator(tree->rootNode())
+    :iterator(tree ? NodeRef(tree->rootNode()) : NodeRef())
     { }
 
 
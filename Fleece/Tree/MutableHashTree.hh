@@ -15,6 +15,8 @@
 #include "fleece/slice.hh"
 #include <functional>
 #include <memory>
+#include <span>
+#include <vector>
 
 namespace fleece {
     class MutableArray;
@@ -23,6 +25,7 @@ namespace fleece {
 
     namespace hashtree {
         class MutableInterior;
+        class NodeArena;
         class NodeRef;
     }
 
@@ -51,6 +54,17 @@ namespace fleece {
         bool insert(slice key, InsertCallback);
         bool remove(slice key);
 
+        /** An operation for `applyBatch`: sets `key` to `value`, or removes it if `value` is null. */
+        struct BatchOp {
+            slice key;
+            Value value;
+        };
+
+        /** Applies a batch of operations in order, with the same effect as calling `set` for each.
+            The operations are grouped by the tree's 32 top-level branches, which are independent
+            of each other; if `parallel` is true, the groups are applied on multiple threads. */
+        void applyBatch(std::span<const BatchOp>, bool parallel =true);
+
         uint32_t writeTo(Encoder&);
 
         void dump(std::ostream &out);
@@ -59,9 +73,13 @@ namespace fleece {
         
     private:
         hashtree::NodeRef rootNode() const;
+        hashtree::NodeArena& arena();
+        void freeNodes();
 
         const HashTree* _imRoot {nullptr};
         hashtree::MutableInterior* _root {nullptr};
+        std::unique_ptr<hashtree::NodeArena> _arena;    // Allocates the mutable nodes
+        std::vector<std::unique_ptr<hashtree::NodeArena>> _workerArenas; // Used by applyBatch
 
         friend class HashTree::iterator;
     };
@@ -14,6 +14,7 @@
 
 #pragma once
 #include "NodeRef.hh"
+#include "NodeArena.hh"
 #include "fleece/PlatformCompat.hh"
 #include "fleece/RefCounted.hh"
 #include "fleece/Mutable.hh"
@@ -55,15 +56,17 @@ namespace fleece { namespace hashtree {
     };
 
 
-    // A leaf node that holds a single key and value.
+    // A leaf node that holds a single key and value. Its key is stored in the NodeArena.
     class MutableLeaf : public MutableNode {
     public:
-        MutableLeaf(const Target &t, Value v)
-        :MutableNode(0)
-        ,_key(t.key)
-        ,_hash(t.hash)
-        ,_value(v)
-        { }
+        static MutableLeaf* newLeaf(NodeArena &arena, const Target &t, Value v) {
+            return new (arena.alloc(0, sizeof(MutableLeaf))) MutableLeaf(arena.copy(t.key), t, v);
+        }
+
+        void free(NodeArena &arena) {
+            this->~MutableLeaf();
+            arena.free(this, 0);
+        }
 
         bool matches(Target target) const {
             return _hash == target.hash && _key == target.key;
@@ -86,9 +89,17 @@ namespace fleece { namespace hashtree {
             out << "\"=" << _value.toJSONString() << "}";
         }
 
-        alloc_slice const _key;
+        slice const _key;
         hash_t const _hash;
         RetainedValue _value;
+
+    private:
+        MutableLeaf(slice key, const Target &t, Value v)
+        :MutableNode(0)
+        ,_key(key)
+        ,_hash(t.hash)
+        ,_value(v)
+        { }
     };
 
 
@@ -96,11 +107,11 @@ namespace fleece { namespace hashtree {
     class MutableInterior : public MutableNode {
     public:
 
-        static MutableInterior* newRoot(const HashTree *imTree) {
-            if (imTree)
-                return mutableCopy(imTree->rootNode());
+        static MutableInterior* newRoot(NodeArena &arena, const HashTree *imTree) {
+            if (imTree && imTree->rootNode()->childCount() > 0)
+                return mutableCopy(arena, imTree->rootNode());
             else
-                return newNode(kMaxChildren);
+                return newNode(arena, kMaxChildren);
         }
 
 
@@ -115,18 +126,47 @@ namespace fleece { namespace hashtree {
         }
 
 
-        void deleteTree() {
+        // Destructs all the mutable leaves in the tree, without freeing any memory; this is
+        // done before resetting the NodeArena, which frees all the nodes at once.
+        void destroyLeaves() {
             unsigned n = childCount();
             for (unsigned i = 0; i < n; ++i) {
                 auto child = _children[i].asMutable();
                 if (child) {
                     if (child->isLeaf())
-                        delete (MutableLeaf*)child;
+                        ((MutableLeaf*)child)->~MutableLeaf();
                     else
-                        ((MutableInterior*)child)->deleteTree();
+                        ((MutableInterior*)child)->destroyLeaves();
                 }
             }
-            delete this;
+        }
+
+
+        // Detaches my child at `bitNo` (if any) into a new node of its own, so that it can be
+        // modified independently of my other children -- even on another thread.
+        MutableInterior* detachBranch(NodeArena &arena, unsigned bitNo) {
+            auto branch = newNode(arena, 1);
+            if (hasChild(bitNo))
+                branch->_addChild(bitNo, 0, childForBitNumber(bitNo));
+            return branch;
+        }
+
+
+        // Puts back a branch returned by `detachBranch`, and frees it. Like `insert`, returns
+        // either 'this' or a new node that replaces 'this'.
+        MutableInterior* reattachBranch(NodeArena &arena, unsigned bitNo, MutableInterior *branch) {
+            MutableInterior *node = this;
+            if (branch->hasChild(bitNo)) {
+                NodeRef child = branch->_children[0];
+                if (hasChild(bitNo))
+                    childForBitNumber(bitNo) = child;
+                else
+                    node = addChild(arena, bitNo, child);
+            } else if (hasChild(bitNo)) {
+                removeChild(bitNo, childIndexForBitNumber(bitNo));   // branch is now empty
+            }
+            branch->free(arena);
+            return node;
         }
 
 
@@ -170,7 +210,7 @@ namespace fleece { namespace hashtree {
 
         // Recursive insertion method. On success returns either 'this', or a new node that
         // replaces 'this'. On failure (i.e. callback returned nullptr) returns nullptr.
-        MutableInterior* insert(const Target &target, unsigned shift) {
+        MutableInterior* insert(NodeArena &arena, const Target &target, unsigned shift) {
             assert_precondition(shift + kBitShift < 8*sizeof(hash_t));//FIX: //TODO: Handle hash collisions
             unsigned bitNo = childBitNumber(target.hash, shift);
             if (!hasChild(bitNo)) {
@@ -178,7 +218,7 @@ namespace fleece { namespace hashtree {
                 Value val = (*target.insertCallback)(nullptr);
                 if (!val)
                     return nullptr;
-                return addChild(bitNo, new MutableLeaf(target, val));
+                return addChild(arena, bitNo, MutableLeaf::newLeaf(arena, target, val));
             }
             NodeRef &childRef = childForBitNumber(bitNo);
             if (childRef.isLeaf()) {
@@ -190,14 +230,14 @@ namespace fleece { namespace hashtree {
                     if (childRef.isMutable())
                         ((MutableLeaf*)childRef.asMutable())->_value = val;
                     else
-                        childRef = new MutableLeaf(target, val);
+                        childRef = MutableLeaf::newLeaf(arena, target, val);
                     return this;
                 } else {
                     // Nope, need to promote the leaf to an interior node & add new key:
-                    MutableInterior *node = promoteLeaf(childRef, shift);
-                    auto insertedNode = node->insert(target, shift+kBitShift);
+                    MutableInterior *node = promoteLeaf(arena, childRef, shift);
+                    auto insertedNode = node->insert(arena, target, shift+kBitShift);
                     if (!insertedNode) {
-                        delete node;
+                        node->free(arena);
                         return nullptr;
                     }
                     childRef = insertedNode;
@@ -207,17 +247,18 @@ namespace fleece { namespace hashtree {
                 // Progress down to interior node...
                 auto child = (MutableInterior*)childRef.asMutable();
                 if (!child)
-                    child = mutableCopy(&childRef.asImmutable()->interior, 1);
-                child = child->insert(target, shift+kBitShift);
+                    child = mutableCopy(arena, &childRef.asImmutable()->interior, 1);
+                child = child->insert(arena, target, shift+kBitShift);
                 if (child)
                     childRef = child;
-                //FIX: This can leak if child is created by mutableCopy, but then
+                // (If the insert failed, a node created by mutableCopy is leaked until the
+                // arena is reset.)
                 return this;
             }
         }
 
 
-        bool remove(Target target, unsigned shift) {
+        bool remove(NodeArena &arena, Target target, unsigned shift) {
             assert_precondition(shift + kBitShift < 8*sizeof(hash_t));
             unsigned bitNo = childBitNumber(target.hash, shift);
             if (!hasChild(bitNo))
@@ -228,7 +269,8 @@ namespace fleece { namespace hashtree {
                 // Child is a leaf -- is it the right key?
                 if (childRef.matches(target)) {
                     removeChild(bitNo, childIndex);
-                    delete (MutableLeaf*)childRef.asMutable();
+                    if (auto leaf = (MutableLeaf*)childRef.asMutable())
+                        leaf->free(arena);
                     return true;
                 } else {
                     return false;
@@ -237,19 +279,19 @@ namespace fleece { namespace hashtree {
                 // Recurse into child node...
                 auto child = (MutableInterior*)childRef.asMutable();
                 if (child) {
-                    if (!child->remove(target, shift+kBitShift))
+                    if (!child->remove(arena, target, shift+kBitShift))
                         return false;
                 } else {
-                    child = mutableCopy(&childRef.asImmutable()->interior);
-                    if (!child->remove(target, shift+kBitShift)) {
-                        delete child;
+                    child = mutableCopy(arena, &childRef.asImmutable()->interior);
+                    if (!child->remove(arena, target, shift+kBitShift)) {
+                        child->free(arena);
                         return false;
                     }
                     _children[childIndex] = child;
                 }
                 if (child->_bitmap.empty()) {
                     removeChild(bitNo, childIndex);     // child node is now empty, so remove it
-                    delete child;
+                    child->free(arena);
                 }
                 return true;
             }
@@ -323,8 +365,8 @@ namespace fleece { namespace hashtree {
             out << " }";
         }
 
-        static void operator delete(void* ptr) {
-            ::operator delete(ptr);
+        void free(NodeArena &arena) {
+            arena.free(this, capacity());
         }
 
     private:
@@ -333,32 +375,30 @@ namespace fleece { namespace hashtree {
         MutableInterior(MutableInterior&& i) = delete;
         MutableInterior& operator=(const MutableInterior&) = delete;
 
-        static MutableInterior* newNode(unsigned capacity, MutableInterior *orig =nullptr) {
-            return new (capacity) MutableInterior(capacity, orig);
-        }
-
-        static void* operator new(size_t size, unsigned capacity) {
-            return ::operator new(size + capacity*sizeof(NodeRef));
-        }
-
-        static void operator delete(void* ptr, unsigned capacity) {
-            ::operator delete(ptr);
+        // Interior nodes are allocated from the arena by capacity, which is their size class.
+        static MutableInterior* newNode(NodeArena &arena, unsigned capacity,
+                                        MutableInterior *orig =nullptr)
+        {
+            void *mem = arena.alloc(capacity, sizeof(MutableInterior) + capacity*sizeof(NodeRef));
+            return new (mem) MutableInterior(capacity, orig);
         }
 
-        static MutableInterior* mutableCopy(const Interior *iNode, unsigned extraCapacity =0) {
+        static MutableInterior* mutableCopy(NodeArena &arena, const Interior *iNode,
+                                            unsigned extraCapacity =0)
+        {
             auto childCount = iNode->childCount();
-            auto node = newNode(childCount + extraCapacity);
+            auto node = newNode(arena, min(childCount + extraCapacity, unsigned(kMaxChildren)));
             node->_bitmap = asBitmap(iNode->bitmap());
             for (unsigned i = 0; i < childCount; ++i)
                 node->_children[i] = NodeRef(iNode->childAtIndex(i));
             return node;
         }
 
-        static MutableInterior* promoteLeaf(NodeRef& childLeaf, unsigned shift) {
+        static MutableInterior* promoteLeaf(NodeArena &arena, NodeRef& childLeaf, unsigned shift) {
             unsigned level = shift / kBitShift;
-            MutableInterior* node = newNode(2 + (level<1) + (level<3));
+            MutableInterior* node = newNode(arena, 2 + (level<1) + (level<3));
             unsigned childBitNo = childBitNumber(childLeaf.hash(), shift+kBitShift);
-            node = node->addChild(childBitNo, childLeaf);
+            node = node->addChild(arena, childBitNo, childLeaf);
             return node;
         }
 
@@ -373,13 +413,14 @@ namespace fleece { namespace hashtree {
         }
 
 
-        MutableInterior* grow() {
+        // Replaces me with a copy with 50% more slots, returning my old block to the arena's
+        // free list, where the next node to grow from my capacity will pick it up.
+        MutableInterior* grow(NodeArena &arena) {
             assert_precondition(capacity() < kMaxChildren);
-            auto replacement = (MutableInterior*)realloc(this,
-                                    sizeof(MutableInterior) + (capacity()+1)*sizeof(NodeRef));
-            if (!replacement)
-                throw std::bad_alloc();
-            replacement->_capacity++;
+            unsigned newCapacity = std::min(capacity() + std::max(capacity() / 2, 1),
+                                            kMaxChildren);
+            auto replacement = newNode(arena, newCapacity, this);
+            free(arena);
             return replacement;
         }
 
@@ -411,12 +452,13 @@ namespace fleece { namespace hashtree {
         }
 
 
-        MutableInterior* addChild(unsigned bitNo, NodeRef child) {
-            return addChild(bitNo, childIndexForBitNumber(bitNo), child);
+        MutableInterior* addChild(NodeArena &arena, unsigned bitNo, NodeRef child) {
+            return addChild(arena, bitNo, childIndexForBitNumber(bitNo), child);
         }
 
-        MutableInterior* addChild(unsigned bitNo, unsigned childIndex, NodeRef child) {
-            MutableInterior* node = (childCount() < capacity()) ? this : grow();
+        MutableInterior* addChild(NodeArena &arena, unsigned bitNo, unsigned childIndex,
+                                  NodeRef child) {
+            MutableInterior* node = (childCount() < capacity()) ? this : grow(arena);
             return node->_addChild(bitNo, childIndex, child);
         }
 
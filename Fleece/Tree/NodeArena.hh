@@ -0,0 +1,103 @@
+//
+//  NodeArena.hh
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#pragma once
+#include "HashTree+Internal.hh"
+#include "fleece/slice.hh"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "betterassert.hh"
+
+namespace fleece { namespace hashtree {
+
+    /** Allocates the nodes (and key strings) of a MutableHashTree out of large chunks.
+        Freed nodes go onto a free list for their size class -- a leaf, or an interior node of a
+        given capacity -- and are reused by the next allocation of that class. Memory is only
+        returned to the heap, all at once, when the arena is reset or destroyed.
+        (A block may be freed to a different arena than it came from, as long as the two arenas
+        are always reset together.) */
+    class NodeArena {
+    public:
+        static constexpr unsigned kNumSizeClasses = kMaxChildren + 1;
+
+        NodeArena() =default;
+        NodeArena(const NodeArena&) =delete;
+        NodeArena& operator=(const NodeArena&) =delete;
+
+        /** Allocates a block for size class `sizeClass`, which must always have size `size`. */
+        void* alloc(unsigned sizeClass, size_t size) {
+            assert_precondition(sizeClass < kNumSizeClasses);
+            if (FreeBlock *block = _freeLists[sizeClass]) {
+                _freeLists[sizeClass] = block->next;
+                return block;
+            }
+            return allocRaw(size, kAlignment);
+        }
+
+        /** Puts a block back on its size class's free list. */
+        void free(void *ptr, unsigned sizeClass) {
+            assert_precondition(sizeClass < kNumSizeClasses);
+            auto block = (FreeBlock*)ptr;
+            block->next = _freeLists[sizeClass];
+            _freeLists[sizeClass] = block;
+        }
+
+        /** Copies a string into the arena. It's never freed individually. */
+        slice copy(slice s) {
+            if (s.size == 0)
+                return s.buf ? slice("", size_t(0)) : slice();
+            void *buf = allocRaw(s.size, 1);
+            memcpy(buf, s.buf, s.size);
+            return slice(buf, s.size);
+        }
+
+        /** Frees all memory. Anything allocated from the arena is now invalid. */
+        void reset() {
+            _chunks.clear();
+            _next = _end = nullptr;
+            std::fill(std::begin(_freeLists), std::end(_freeLists), nullptr);
+        }
+
+    private:
+        static constexpr size_t kChunkSize = 64 * 1024;
+        static constexpr size_t kAlignment = alignof(std::max_align_t);
+
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        void* allocRaw(size_t size, size_t alignment) {
+            auto start = (uint8_t*)((size_t(_next) + alignment - 1) & ~(alignment - 1));
+            if (!_next || start + size > _end) {
+                if (size > kChunkSize / 4) {
+                    // Big strings get a chunk of their own, leaving the current one in use:
+                    _chunks.emplace_back(new uint8_t[size]);
+                    return _chunks.back().get();
+                }
+                _chunks.emplace_back(new uint8_t[kChunkSize]);
+                start = _chunks.back().get();
+                _end = start + kChunkSize;
+            }
+            _next = start + size;
+            return start;
+        }
+
+        std::vector<std::unique_ptr<uint8_t[]>> _chunks;
+        uint8_t* _next {nullptr};
+        uint8_t* _end {nullptr};
+        FreeBlock* _freeLists[kNumSizeClasses] {};
+    };
+
+} }
@@ -27,6 +27,10 @@ namespace fleece { namespace hashtree {
         :key(k), hash(ComputeHash(k)), insertCallback(callback)
         { }
 
+        Target(slice k, hash_t h, MutableHashTree::InsertCallback *callback =nullptr)
+        :key(k), hash(h), insertCallback(callback)
+        { }
+
         bool operator== (const Target &b) const {
             return hash == b.hash && key == b.key;
         }
@@ -103,6 +103,19 @@ TEST_CASE("API Doc", "[API][SharedKeys]") {
 }
 
 
+
+TEST_CASE("API Extract Doc", "[API]") {
+    Doc doc = Doc::fromJSON(R"({"big": [1, 2, 3, 4, 5, 6, 7, 8, 9, 10], "small": {"k": "v"}})"_sl);
+    Value small = doc.root().asDict()["small"];
+    FLError error = kFLNoError;
+    FLDoc extracted = FLValue_ExtractDoc(small, &error);
+    REQUIRE(extracted);
+    CHECK(FLDoc_GetRetainedBytes(extracted) < FLDoc_GetRetainedBytes(doc));
+    CHECK(Value(FLDoc_GetRoot(extracted)).toJSONString() == R"({"k":"v"})");
+    FLDoc_Release(extracted);
+    CHECK(FLValue_ExtractDoc(nullptr, &error) == nullptr);
+}
+
 TEST_CASE("API Encoder", "[API][Encoder]") {
     Encoder enc;
     enc.beginDict();
@@ -160,6 +173,140 @@ TEST_CASE("API Paths", "[API][Encoder]") {
 }
 
 
+TEST_CASE("API Path wildcards", "[API][Encoder]") {
+    alloc_slice fleeceData = readTestFile(kBigJSONTestFileName);
+    Doc doc = Doc::fromJSON(fleeceData);
+    auto root = doc.root();
+
+    FLError error;
+    KeyPath path{"[30:33].friends[*].name"_sl, &error};
+    REQUIRE(path);
+    CHECK(path.eval(root).asString() == root[KeyPath("[30].friends[0].name"_sl, &error)].asString());
+
+    std::vector<Value> names;
+    CHECK(FLKeyPath_ForEachMatch(path, root, [](void *context, FLValue value) {
+        ((std::vector<Value>*)context)->push_back(value);
+        return true;
+    }, &names));
+    size_t expectedCount = 0;
+    for (int i = 30; i < 33; ++i)
+        expectedCount += root.asArray()[i].asDict()["friends"].asArray().count();
+    CHECK(names.size() == expectedCount);
+    for (Value name : names)
+        CHECK(name.type() == kFLString);
+
+    FLSlice key;
+    int32_t index;
+    CHECK(FLKeyPath_GetElement(path, 1, &key, &index));
+    CHECK(!FLKeyPath_GetElement(path, 2, &key, &index));
+}
+
+
+TEST_CASE("API Projection", "[API][Encoder]") {
+    alloc_slice fleeceData = readTestFile(kBigJSONTestFileName);
+    Doc doc = Doc::fromJSON(fleeceData);
+    auto root = doc.root();
+
+    FLError error;
+    KeyPath paths[] = {{"[32].name"_sl, &error}, {"[32].friends[1].name"_sl, &error},
+                       {"[32].age"_sl, &error}, {"[32].bogus"_sl, &error}};
+    FLKeyPath flPaths[] = {paths[0], paths[1], paths[2], paths[3]};
+    FLProjection projection = FLProjection_New(flPaths, 4);
+    REQUIRE(projection);
+    CHECK(FLProjection_GetCount(projection) == 4);
+
+    FLValue values[4];
+    FLProjection_Eval(projection, root, values);
+    for (int i = 0; i < 4; ++i)
+        CHECK(values[i] == paths[i].eval(root));
+    CHECK(Value(values[0]).asString() == "Mendez Tran"_sl);
+    CHECK(values[3] == nullptr);
+    FLProjection_Free(projection);
+}
+
+
+TEST_CASE("API Array kernels", "[API][Encoder]") {
+    alloc_slice fleeceData = readTestFile(kBigJSONTestFileName);
+    Doc doc = Doc::fromJSON(fleeceData);
+    Array people = doc.root().asArray();
+
+    FLError error;
+    KeyPath age{"age"_sl, &error};
+    FLNumericSummary summary;
+    REQUIRE(FLArray_Summarize(people, age, &summary, &error));
+    int64_t sum = 0, minAge = INT64_MAX, maxAge = INT64_MIN, nOver40 = 0;
+    for (Array::iterator i(people); i; ++i) {
+        int64_t n = i.value().asDict()["age"].asInt();
+        sum += n;
+        minAge = std::min(minAge, n);
+        maxAge = std::max(maxAge, n);
+        nOver40 += (n > 40);
+    }
+    CHECK(summary.count == people.count());
+    CHECK(summary.sum == sum);
+    CHECK(summary.min == minAge);
+    CHECK(summary.max == maxAge);
+
+    std::vector<uint64_t> bitmap((people.count() + 63) / 64);
+    CHECK(FLArray_Select(people, age, kFLGreater, 40, bitmap.data(), &error) == nOver40);
+    for (uint32_t i = 0; i < people.count(); ++i) {
+        bool bit = (bitmap[i / 64] >> (i % 64)) & 1;
+        CHECK(bit == (people[i].asDict()["age"].asInt() > 40));
+    }
+
+    KeyPath wild{"friends[*].id"_sl, &error};
+    error = kFLNoError;
+    CHECK(!FLArray_Summarize(people, wild, &summary, &error));
+    CHECK(error != kFLNoError);
+    CHECK(FLArray_Select(people, wild, kFLEqual, 0, bitmap.data(), nullptr) == -1);
+}
+
+
+TEST_CASE("API Collatable", "[API]") {
+    Doc doc = Doc::fromJSON(R"([[1, "b"], [1.0, "a"], [-3, {"x": null}], [1, "b", false]])"_sl);
+    Array rows = doc.root().asArray();
+    std::vector<alloc_slice> keys;
+    for (Array::iterator i(rows); i; ++i)
+        keys.push_back(alloc_slice(FLValue_ToCollatable(i.value())));
+    CHECK(keys[2] < keys[1]);
+    CHECK(keys[1] < keys[0]);
+    CHECK(keys[0] < keys[3]);
+
+    FLError error;
+    alloc_slice fleece(FLData_FromCollatable(keys[1], &error));
+    REQUIRE(fleece);
+    CHECK(Value(FLValue_FromData(fleece, kFLTrusted)).toJSONString() == R"([1,"a"])");
+
+    error = kFLNoError;
+    CHECK(!alloc_slice(FLData_FromCollatable("\x08\x05"_sl, &error)));
+    CHECK(error == kFLInvalidData);
+}
+
+
+TEST_CASE("API Compare and Sort", "[API]") {
+    Doc doc = Doc::fromJSON(R"([{"k": "b"}, {"k": 2}, {"k": 1.0}, {"k": null}, {}, {"k": 1}])"_sl);
+    Array rows = doc.root().asArray();
+    CHECK(FLValue_Compare(rows[2].asDict()["k"], rows[5].asDict()["k"]) == 0);
+    CHECK(FLValue_Hash(rows[2].asDict()["k"]) == FLValue_Hash(rows[5].asDict()["k"]));
+    CHECK(FLValue_Compare(rows[1].asDict()["k"], rows[0].asDict()["k"]) < 0);
+    CHECK(FLValue_Compare(nullptr, rows[3].asDict()["k"]) < 0);
+    CHECK(FLValue_Compare(nullptr, nullptr) == 0);
+
+    FLError error;
+    KeyPath key{"k"_sl, &error};
+    FLMutableArray sorted = FLArray_Sorted(rows, key, &error);
+    REQUIRE(sorted);
+    CHECK(Value(FLValue(sorted)).toJSONString() ==
+          R"([{},{"k":null},{"k":1.0},{"k":1},{"k":2},{"k":"b"}])");
+    FLMutableArray_Release(sorted);
+
+    KeyPath wild{"[*]"_sl, &error};
+    error = kFLNoError;
+    CHECK(FLArray_Sorted(rows, wild, &error) == nullptr);
+    CHECK(error != kFLNoError);
+}
+
+
 TEST_CASE("API Undefined", "[API]") {
     Encoder enc;
     enc.beginArray();
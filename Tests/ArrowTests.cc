@@ -0,0 +1,184 @@
+//
+// ArrowTests.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "FleeceTests.hh"
+#include "FleeceImpl.hh"
+#include "ArrowExport.hh"
+#include "Doc.hh"
+#include <cstring>
+
+using namespace fleece;
+using namespace fleece::impl;
+using namespace fleece_test;
+
+
+static bool isValid(const ArrowArray *column, int64_t row) {
+    auto validity = (const uint8_t*)column->buffers[0];
+    return !validity || (validity[row >> 3] & (1 << (row & 7)));
+}
+
+static std::string stringAt(const ArrowArray *column, int64_t row) {
+    auto offsets = (const int32_t*)column->buffers[1];
+    auto chars = (const char*)column->buffers[2];
+    return std::string(chars + offsets[row], offsets[row + 1] - offsets[row]);
+}
+
+
+TEST_CASE("Arrow export", "[Arrow]") {
+    auto doc = Doc::fromJSON(json5(
+        "[{name: 'Alice', age: 30, score: 1.5, ok: true,  tags: ['a'], mix: 1,   id: 9},"
+        " {name: 'Bob',   age: 41, score: 2,   ok: false, tags: [],    mix: 'x', id: 9223372036854775807},"
+        " {                        score: null,ok: true,  tags: {t:1}, mix: 2.5, id: 18446744073709551615},"
+        " 17,"
+        " {name: '',      age: -5, score: 4,              tags: null,  mix: false}]"));
+    std::vector<Path> paths;
+    for (auto spec : {"name", "age", "score", "ok", "tags", "mix", "id", "missing"})
+        paths.emplace_back(slice(spec));
+
+    ArrowSchema schema;
+    ArrowArray array;
+    ArrowExport::exportColumns(doc->root()->asArray(), paths, &schema, &array);
+    REQUIRE(schema.release);
+    REQUIRE(array.release);
+
+    CHECK(std::string(schema.format) == "+s");
+    REQUIRE(schema.n_children == 8);
+    CHECK(array.length == 5);
+    CHECK(array.null_count == 0);
+    CHECK(array.n_buffers == 1);
+    REQUIRE(array.n_children == 8);
+
+    const char* formats[] = {"u", "l", "g", "b", "u", "u", "g", "n"};
+    for (int c = 0; c < 8; ++c) {
+        INFO("Column " << c);
+        CHECK(std::string(schema.children[c]->name) == std::string(paths[c]));
+        CHECK(std::string(schema.children[c]->format) == formats[c]);
+        CHECK(schema.children[c]->flags == ARROW_FLAG_NULLABLE);
+        CHECK(array.children[c]->length == 5);
+    }
+
+    // Strings:
+    auto names = array.children[0];
+    CHECK(names->null_count == 2);
+    CHECK(names->n_buffers == 3);
+    CHECK(stringAt(names, 0) == "Alice");
+    CHECK(stringAt(names, 1) == "Bob");
+    CHECK(!isValid(names, 2));
+    CHECK(!isValid(names, 3));
+    CHECK(isValid(names, 4));
+    CHECK(stringAt(names, 4) == "");
+
+    // Integers:
+    auto ages = array.children[1];
+    CHECK(ages->null_count == 2);
+    auto ageValues = (const int64_t*)ages->buffers[1];
+    CHECK(ageValues[0] == 30);
+    CHECK(ageValues[1] == 41);
+    CHECK(ageValues[4] == -5);
+
+    // Doubles, with ints promoted:
+    auto scores = array.children[2];
+    CHECK(scores->null_count == 2);
+    auto scoreValues = (const double*)scores->buffers[1];
+    CHECK(scoreValues[0] == 1.5);
+    CHECK(scoreValues[1] == 2.0);
+    CHECK(!isValid(scores, 2));
+    CHECK(scoreValues[4] == 4.0);
+
+    // Booleans are bits:
+    auto oks = array.children[3];
+    CHECK(oks->null_count == 2);
+    auto okBits = ((const uint8_t*)oks->buffers[1])[0];
+    CHECK((okBits & 0x07) == 0x05);
+
+    // Containers and mixed types are JSON:
+    auto tags = array.children[4];
+    CHECK(tags->null_count == 2);
+    CHECK(stringAt(tags, 0) == R"(["a"])");
+    CHECK(stringAt(tags, 1) == "[]");
+    CHECK(stringAt(tags, 2) == R"({"t":1})");
+    auto mixed = array.children[5];
+    CHECK(stringAt(mixed, 0) == "1");
+    CHECK(stringAt(mixed, 1) == R"("x")");
+    CHECK(stringAt(mixed, 2) == "2.5");
+    CHECK(stringAt(mixed, 4) == "false");
+    const char *metadata = schema.children[5]->metadata;
+    REQUIRE(metadata);
+    int32_t n;
+    memcpy(&n, metadata, sizeof(n));
+    CHECK(n == 1);
+    CHECK(std::string(metadata + 8, 20) == "ARROW:extension:name");
+    CHECK(std::string(metadata + 32, 10) == "arrow.json");
+    CHECK(schema.children[4]->metadata != nullptr);
+    CHECK(schema.children[0]->metadata == nullptr);
+
+    // An unsigned integer too big for int64 makes the column double:
+    auto ids = array.children[6];
+    CHECK(((const double*)ids->buffers[1])[2] == 18446744073709551615.0);
+
+    // A column with no values has the null type and no buffers:
+    auto missing = array.children[7];
+    CHECK(missing->n_buffers == 0);
+    CHECK(missing->null_count == 5);
+
+    // A consumer may move a child out before releasing the parent:
+    ArrowArray movedColumn = *array.children[1];
+    array.children[1]->release = nullptr;
+    array.release(&array);
+    CHECK(array.release == nullptr);
+    CHECK(((const int64_t*)movedColumn.buffers[1])[1] == 41);
+    movedColumn.release(&movedColumn);
+    schema.release(&schema);
+    CHECK(schema.release == nullptr);
+}
+
+
+TEST_CASE("Arrow export empty", "[Arrow]") {
+    ArrowSchema schema;
+    ArrowArray array;
+    std::vector<Path> paths {Path("name")};
+    ArrowExport::exportColumns(nullptr, paths, &schema, &array);
+    CHECK(array.length == 0);
+    REQUIRE(array.n_children == 1);
+    CHECK(array.children[0]->length == 0);
+    CHECK(std::string(schema.children[0]->format) == "n");
+    array.release(&array);
+    schema.release(&schema);
+
+    paths = {Path("tags[*]")};
+    CHECK_THROWS_AS(ArrowExport::exportColumns(nullptr, paths, &schema, &array), FleeceException);
+}
+
+
+TEST_CASE("Arrow export API", "[Arrow][API]") {
+    auto doc = Doc::fromJSON(readTestFile(kBigJSONTestFileName));
+    auto people = doc->root()->asArray();
+    FLKeyPath paths[] = {FLKeyPath_New("name"_sl, nullptr), FLKeyPath_New("age"_sl, nullptr),
+                         FLKeyPath_New("friends[0].name"_sl, nullptr)};
+    ArrowSchema schema;
+    ArrowArray array;
+    FLError error;
+    REQUIRE(FLArray_ExportArrow((FLArray)people, paths, 3, &schema, &array, &error));
+    REQUIRE(array.n_children == 3);
+    CHECK(array.length == people->count());
+    CHECK(std::string(schema.children[1]->format) == "l");
+    CHECK(std::string(schema.children[2]->name) == "friends[0].name");
+    for (uint32_t row = 0; row < people->count(); row += 97) {
+        auto person = people->get(row)->asDict();
+        CHECK(stringAt(array.children[0], row) == std::string(person->get("name"_sl)->asString()));
+        CHECK(((const int64_t*)array.children[1]->buffers[1])[row] == person->get("age"_sl)->asInt());
+    }
+    array.release(&array);
+    schema.release(&schema);
+    for (auto path : paths)
+        FLKeyPath_Free(path);
+}
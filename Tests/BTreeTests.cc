@@ -0,0 +1,327 @@
+//
+//  BTreeTests.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "FleeceTests.hh"
+#include "MutableBTree.hh"
+#include "MutableHashTree.hh"
+#include "HashTree.hh"
+#include "fleece/Expert.hh"
+#include "fleece/Mutable.hh"
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace fleece;
+
+
+class BTreeTests {
+public:
+    MutableBTree tree;
+    vector<alloc_slice> keys;           // in ascending order
+    Array values;
+    Doc _doc;
+
+    void createItems(size_t N) {
+        Encoder enc;
+        enc.beginArray(N);
+        for (size_t i = 0; i < N; i++)
+            enc.writeInt(i);
+        enc.endArray();
+        _doc = enc.finishDoc();
+        values = _doc.asArray();
+
+        keys.clear();
+        for (size_t i = 0; i < N; i++) {
+            char buf[20];
+            snprintf(buf, sizeof(buf), "key-%06zu", i);
+            keys.push_back(alloc_slice(buf));
+        }
+    }
+
+    // Inserts keys in a scrambled order, so splits happen all over the tree.
+    void insertItems(size_t N =0) {
+        if (N == 0)
+            N = keys.size();
+        for (size_t j = 0; j < N; j++) {
+            size_t i = (j * 7919) % N;
+            tree.set(keys[i], values.get(uint32_t(i)));
+        }
+    }
+
+    void checkTree(size_t N) {
+        CHECK(tree.count() == N);
+        for (size_t i = 0; i < N; i++) {
+            auto value = tree.get(keys[i]);
+            REQUIRE(value);
+            CHECK(value.asInt() == int64_t(i));
+        }
+    }
+
+    void checkIterator(size_t N) {
+        size_t i = 0;
+        for (MutableBTree::iterator iter(tree); iter; ++iter, ++i) {
+            REQUIRE(i < N);
+            CHECK(iter.key() == keys[i]);
+            CHECK(iter.value().asInt() == int64_t(i));
+        }
+        CHECK(i == N);
+    }
+
+    alloc_slice encodeTree() {
+        Encoder enc;
+        tree.writeTo(enc);
+        return enc.finish();
+    }
+};
+
+
+#pragma mark - TEST CASES:
+
+
+TEST_CASE_METHOD(BTreeTests, "Empty MutableBTree", "[BTree]") {
+    CHECK(tree.count() == 0);
+    CHECK(tree.get("foo"_sl) == nullptr);
+    CHECK(!tree.remove("foo"_sl));
+    CHECK(!MutableBTree::iterator(tree));
+
+    alloc_slice data = encodeTree();
+    BTree itree = BTree::fromData(data);
+    CHECK(itree.count() == 0);
+    CHECK(itree.get("foo"_sl) == nullptr);
+    CHECK(!BTree::iterator(itree));
+}
+
+
+TEST_CASE_METHOD(BTreeTests, "Tiny MutableBTree Insert", "[BTree]") {
+    createItems(1);
+    tree.set(keys[0], values.get(0));
+    CHECK(tree.get(keys[0]) == values.get(0));
+    CHECK(tree.count() == 1);
+
+    // Check that insertion-with-callback passes value to callback and supports failure:
+    Value existingVal = nullptr;
+    CHECK(!tree.insert(keys[0], [&](Value val) {existingVal = val; return nullptr;}));
+    CHECK(existingVal == values.get(0));
+}
+
+
+TEST_CASE_METHOD(BTreeTests, "Bigger MutableBTree Insert", "[BTree]") {
+    static constexpr size_t N = 10000;
+    createItems(N);
+    insertItems();
+    checkTree(N);
+    checkIterator(N);
+}
+
+
+TEST_CASE_METHOD(BTreeTests, "Bigger MutableBTree Remove", "[BTree]") {
+    static constexpr size_t N = 5000;
+    createItems(N);
+    insertItems();
+    for (size_t i = 0; i < N; i += 3)
+        CHECK(tree.remove(keys[i]));
+    for (size_t i = 0; i < N; i++)
+        CHECK(tree.get(keys[i]) == ((i%3) ? values.get(uint32_t(i)) : nullptr));
+    CHECK(tree.count() == N - 1 - (N / 3));
+
+    for (size_t i = 0; i < N; i++)
+        tree.remove(keys[i]);
+    CHECK(tree.count() == 0);
+    CHECK(!MutableBTree::iterator(tree));
+}
+
+
+TEST_CASE_METHOD(BTreeTests, "BTree Write And Read", "[BTree]") {
+    static constexpr size_t N = 1000;
+    createItems(N);
+    insertItems();
+
+    alloc_slice data = encodeTree();
+    BTree itree = BTree::fromData(data);
+    CHECK(itree.count() == N);
+    for (size_t i = 0; i < N; i++) {
+        auto value = itree.get(keys[i]);
+        REQUIRE(value);
+        CHECK(value.asInt() == int64_t(i));
+    }
+    CHECK(itree.get("key-"_sl) == nullptr);
+    CHECK(itree.get("key-999999"_sl) == nullptr);
+
+    size_t i = 0;
+    for (BTree::iterator iter(itree); iter; ++iter, ++i)
+        CHECK(iter.key() == keys[i]);
+    CHECK(i == N);
+}
+
+
+TEST_CASE_METHOD(BTreeTests, "BTree Seek And Prefix", "[BTree]") {
+    static constexpr size_t N = 1000;
+    createItems(N);
+    insertItems();
+    alloc_slice data = encodeTree();
+    BTree itree = BTree::fromData(data);
+
+    BTree::iterator iter(itree);
+    iter.seek("key-000500"_sl);
+    REQUIRE(iter);
+    CHECK(iter.key() == "key-000500"_sl);
+    iter.seek("key-0005000"_sl);            // between two keys
+    REQUIRE(iter);
+    CHECK(iter.key() == "key-000501"_sl);
+    iter.seek(""_sl);
+    REQUIRE(iter);
+    CHECK(iter.key() == keys[0]);
+    iter.seek("zzz"_sl);
+    CHECK(!iter);
+
+    size_t n = 0;
+    for (iter.seekPrefix("key-00012"_sl); iter; ++iter, ++n)
+        CHECK(iter.key() == keys[120 + n]);
+    CHECK(n == 10);
+
+    iter.seekPrefix("nope"_sl);
+    CHECK(!iter);
+
+    // The same on the mutable tree:
+    MutableBTree::iterator miter(tree);
+    n = 0;
+    for (miter.seekPrefix("key-0009"_sl); miter; ++miter, ++n)
+        CHECK(miter.key() == keys[900 + n]);
+    CHECK(n == 100);
+}
+
+
+TEST_CASE_METHOD(BTreeTests, "BTree Mutate", "[BTree]") {
+    static constexpr size_t N = 1000;
+    createItems(N);
+    insertItems(N);
+
+    alloc_slice data = encodeTree();
+    tree = BTree::fromData(data);
+    CHECK(!tree.isChanged());
+    checkTree(N);
+
+    tree.set(keys[17], values.get(3));
+    CHECK(tree.isChanged());
+    CHECK(tree.get(keys[17]).asInt() == 3);
+    CHECK(tree.count() == N);
+    CHECK(tree.remove(keys[18]));
+    CHECK(!tree.remove(keys[18]));
+    CHECK(tree.count() == N - 1);
+    tree.set("key-000017a"_sl, values.get(4));
+    CHECK(tree.count() == N);
+
+    MutableBTree::iterator iter(tree);
+    iter.seek(keys[16]);
+    CHECK(iter.key() == keys[16]);
+    ++iter;
+    CHECK(iter.key() == keys[17]);
+    ++iter;
+    CHECK(iter.key() == "key-000017a"_sl);
+    ++iter;
+    CHECK(iter.key() == keys[19]);
+}
+
+
+TEST_CASE_METHOD(BTreeTests, "BTree Re-Encode Delta", "[BTree]") {
+    static constexpr size_t N = 2000;
+    createItems(N + 10);
+    insertItems(N);
+    alloc_slice data = encodeTree();
+    tree = BTree::fromData(data);
+
+    for (size_t i = N; i < N + 10; i++)
+        tree.set(keys[i], values.get(uint32_t(i)));
+    for (size_t i = 2; i < N; i += 300)
+        CHECK(tree.remove(keys[i]));
+
+    Encoder enc;
+    expert(enc).amend(data, true);
+    tree.writeTo(enc);
+    alloc_slice delta = enc.finish();
+    alloc_slice full = encodeTree();
+    cerr << "Original is " << data.size << " bytes; delta is " << delta.size
+         << " bytes; full rewrite would be " << full.size << " bytes.\n";
+    CHECK(delta.size < full.size / 4);
+
+    alloc_slice total(data.size + delta.size);
+    memcpy((void*)&total[0],         data.buf, data.size);
+    memcpy((void*)&total[data.size], delta.buf, delta.size);
+
+    BTree itree = BTree::fromData(total);
+    CHECK(itree.count() == N + 10 - 7);
+    for (size_t i = 0; i < N + 10; i++) {
+        if (i < N && i % 300 == 2)
+            CHECK(!itree.get(keys[i]));
+        else
+            CHECK(itree.get(keys[i]).asInt() == int64_t(i));
+    }
+}
+
+
+#pragma mark - BENCHMARK:
+
+
+#if FL_HAVE_TEST_FILES
+TEST_CASE("Perf BTree vs HashTree lookup", "[.Perf]") {
+    static constexpr int kSamples = 2000;
+
+    Doc doc = Doc::fromJSON(fleece_test::readTestFile(kBigJSONTestFileName));
+    Array people = doc.root().asArray();
+    REQUIRE(people);
+
+    vector<alloc_slice> names;
+    MutableBTree btree;
+    MutableHashTree htree;
+    for (Array::iterator i(people); i; ++i) {
+        auto person = i.value().asDict();
+        alloc_slice key(person.get("guid").asString());
+        names.push_back(key);
+        btree.set(key, person);
+        htree.set(key, person);
+    }
+
+    Encoder benc;
+    btree.writeTo(benc);
+    alloc_slice bdata = benc.finish();
+    BTree imBTree = BTree::fromData(bdata);
+
+    Encoder henc;
+    expert(henc).suppressTrailer();
+    htree.writeTo(henc);
+    alloc_slice hdata = henc.finish();
+    const HashTree *imHashTree = HashTree::fromData(hdata);
+
+    slice keys[100];
+    Benchmark bbench, hbench;
+    for (int i = 0; i < kSamples; i++) {
+        for (int k = 0; k < 100; k++)
+            keys[k] = names[ random() % names.size() ];
+        bbench.start();
+        for (int k = 0; k < 100; k++) {
+            if (!imBTree.get(keys[k]))
+                abort();
+        }
+        bbench.stop();
+        hbench.start();
+        for (int k = 0; k < 100; k++) {
+            if (!imHashTree->get(keys[k]))
+                abort();
+        }
+        hbench.stop();
+    }
+    fprintf(stderr, "BTree lookup:    ");
+    bbench.printReport(1.0/100, "lookup");
+    fprintf(stderr, "HashTree lookup: ");
+    hbench.printReport(1.0/100, "lookup");
+}
+#endif
@@ -0,0 +1,674 @@
+//
+//  DBTests.cc
+//
+// Copyright 2026-Present Couchbase, Inc.
+//
+// Use of this software is governed by the Business Source License included
+// in the file licenses/BSL-Couchbase.txt.  As of the Change Date specified
+// in that file, in accordance with the Business Source License, use of this
+// software will be governed by the Apache License, Version 2.0, included in
+// the file licenses/APL2.txt.
+//
+
+#include "FleeceTests.hh"
+#include "DB.hh"
+#include "FleeceException.hh"
+#include "fleece/Mutable.hh"
+#include <atomic>
+#include <csignal>
+#include <thread>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+
+#if FL_HAVE_MMAP
+
+using namespace std;
+using namespace fleece;
+
+
+class DBTests {
+public:
+    static constexpr const char* kPath = kTempDir "DBTests.fleecedb";
+
+    unique_ptr<DB> db;
+
+    DBTests() {
+        ::unlink(kPath);
+        reopen();
+    }
+
+    ~DBTests() {
+        db.reset();
+        ::unlink(kPath);
+    }
+
+    void reopen(DB::OpenMode mode =DB::kCreate) {
+        db.reset();
+        db = make_unique<DB>(kPath, mode);
+    }
+
+    static string keyFor(size_t i) {
+        char buf[20];
+        snprintf(buf, sizeof(buf), "doc-%06zu", i);
+        return buf;
+    }
+
+    static MutableDict makeDoc(size_t i) {
+        MutableDict doc = MutableDict::newDict();
+        doc["i"] = int64_t(i);
+        doc["name"] = "Fleece";
+        doc["even"] = (i % 2 == 0);
+        return doc;
+    }
+
+    void putDocs(size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            MutableDict doc = makeDoc(i);
+            db->put(slice(keyFor(i)), doc);
+        }
+    }
+
+    void checkDocs(size_t begin, size_t end) {
+        CHECK(db->count() == end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            Dict doc = db->get(slice(keyFor(i)));
+            REQUIRE(doc);
+            CHECK(doc["i"].asInt() == int64_t(i));
+            CHECK(doc["name"].asString() == "Fleece"_sl);
+        }
+    }
+
+    // Appends raw bytes to the file, as though a commit had been interrupted.
+    void appendGarbage(slice garbage) {
+        FILE *f = fopen(kPath, "ab");
+        REQUIRE(f);
+        REQUIRE(fwrite(garbage.buf, 1, garbage.size, f) == garbage.size);
+        fclose(f);
+    }
+};
+
+
+TEST_CASE_METHOD(DBTests, "DB Empty", "[DB]") {
+    CHECK(db->count() == 0);
+    CHECK(!db->get("foo"_sl));
+    CHECK(!db->isChanged());
+    db->commitChanges();
+    reopen(DB::kReadOnly);
+    CHECK(db->count() == 0);
+    CHECK(db->discardedBytes() == 0);
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Put And Commit", "[DB]") {
+    putDocs(0, 100);
+    CHECK(db->isChanged());
+    checkDocs(0, 100);
+    db->commitChanges();
+    CHECK(!db->isChanged());
+    checkDocs(0, 100);
+    auto size = db->fileSize();
+
+    reopen(DB::kReadOnly);
+    CHECK(db->fileSize() == size);
+    CHECK(db->discardedBytes() == 0);
+    checkDocs(0, 100);
+    MutableDict doc = makeDoc(0);
+    CHECK_THROWS_AS(db->put("foo"_sl, doc), FleeceException);
+
+    size_t n = 0;
+    for (DB::iterator i(*db); i; ++i)
+        ++n;
+    CHECK(n == 100);
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Update", "[DB]") {
+    putDocs(0, 100);
+    db->commitChanges();
+    auto size = db->fileSize();
+
+    {
+        MutableDict doc = db->getMutable("doc-000042"_sl);
+        REQUIRE(doc);
+        doc["name"] = "Modified";
+    }
+    CHECK(db->remove("doc-000007"_sl));
+    CHECK(!db->remove("nope"_sl));
+    db->commitChanges();
+    // Only the changed doc and tree nodes were appended:
+    CHECK(db->fileSize() - size < 500);
+
+    reopen();
+    CHECK(db->count() == 99);
+    CHECK(!db->get("doc-000007"_sl));
+    CHECK(db->get("doc-000042"_sl)["name"].asString() == "Modified"_sl);
+    CHECK(db->get("doc-000042"_sl)["i"].asInt() == 42);
+    CHECK(db->get("doc-000043"_sl)["name"].asString() == "Fleece"_sl);
+
+    // Storing a Dict that was read from the file:
+    Dict existing = db->get("doc-000001"_sl);
+    db->put("copy"_sl, existing);
+    db->put("doc-000002"_sl, Dict());       // null Dict removes
+    db->commitChanges();
+    reopen();
+    CHECK(db->count() == 99);
+    CHECK(db->get("copy"_sl)["i"].asInt() == 1);
+    CHECK(!db->get("doc-000002"_sl));
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Revert", "[DB]") {
+    putDocs(0, 10);
+    db->commitChanges();
+    putDocs(10, 20);
+    CHECK(db->remove("doc-000003"_sl));
+    CHECK(db->count() == 19);
+    db->revertChanges();
+    CHECK(!db->isChanged());
+    checkDocs(0, 10);
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Remove All", "[DB]") {
+    putDocs(0, 10);
+    db->commitChanges();
+    for (size_t i = 0; i < 10; ++i)
+        CHECK(db->remove(slice(keyFor(i))));
+    db->commitChanges();
+    CHECK(db->count() == 0);
+    reopen();
+    CHECK(db->count() == 0);
+    CHECK(!db->get("doc-000000"_sl));
+    putDocs(0, 5);
+    db->commitChanges();
+    reopen();
+    checkDocs(0, 5);
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Recovery", "[DB]") {
+    putDocs(0, 50);
+    db->commitChanges();
+    auto size = db->fileSize();
+
+    SECTION("Truncated commit") {
+        // Write a second commit, then chop off its last few bytes:
+        putDocs(50, 60);
+        db->commitChanges();
+        auto fullSize = db->fileSize();
+        db.reset();
+        REQUIRE(::truncate(kPath, off_t(fullSize - 5)) == 0);
+    }
+    SECTION("Garbage") {
+        db.reset();
+        uint8_t garbage[1000];
+        for (size_t i = 0; i < sizeof(garbage); ++i)
+            garbage[i] = uint8_t(i * 37);
+        appendGarbage({garbage, sizeof(garbage)});
+    }
+    SECTION("Corrupted trailer") {
+        // Append a copy of the last commit's trailer, which is at the wrong position:
+        alloc_slice file = readFile(kPath);
+        db.reset();
+        appendGarbage(file.from(file.size - 16));
+    }
+
+    reopen();
+    CHECK(db->discardedBytes() > 0);
+    CHECK(db->fileSize() == size);
+    checkDocs(0, 50);
+
+    // The DB is usable again:
+    putDocs(50, 70);
+    db->commitChanges();
+    reopen();
+    CHECK(db->discardedBytes() == 0);
+    checkDocs(0, 70);
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Not A DB", "[DB]") {
+    db.reset();
+    ::unlink(kPath);
+    appendGarbage("this is not a database file"_sl);
+    CHECK_THROWS_AS(reopen(), FleeceException);
+    ::unlink(kPath);
+    CHECK_THROWS_AS(reopen(DB::kWritable), FleeceException);
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Grow", "[DB]") {
+    // Commit enough data to outgrow the initial memory mapping; values read before the file
+    // was remapped must remain valid.
+    putDocs(0, 100);
+    db->commitChanges(false);
+    Dict first = db->get("doc-000000"_sl);
+    string padding(1000, 'x');
+    size_t i = 100;
+    while (db->fileSize() < 3 * 1024 * 1024) {
+        for (size_t end = i + 100; i < end; ++i) {
+            MutableDict doc = makeDoc(i);
+            doc["padding"] = padding;
+            db->put(slice(keyFor(i)), doc);
+        }
+        db->commitChanges(false);
+    }
+    CHECK(first["i"].asInt() == 0);
+    CHECK(db->get(slice(keyFor(i - 1)))["i"].asInt() == int64_t(i - 1));
+
+    reopen();
+    CHECK(db->count() == i);
+    CHECK(db->get(slice(keyFor(i - 1)))["padding"].asString() == slice(padding));
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Group Commit", "[DB]") {
+    static constexpr size_t kThreads = 8, kBatches = 20, kBatchSize = 10;
+    putDocs(0, 10);
+    db->commitChanges();
+
+    // Each thread commits batches of docs with its own keys, and removes one existing doc:
+    vector<thread> threads;
+    for (size_t t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t b = 0; b < kBatches; ++b) {
+                size_t first = 10 + (t * kBatches + b) * kBatchSize;
+                vector<string> keys;
+                vector<MutableDict> docs;
+                vector<DB::BatchOp> ops;
+                for (size_t i = first; i < first + kBatchSize; ++i) {
+                    keys.push_back(keyFor(i));
+                    docs.push_back(makeDoc(i));
+                }
+                for (size_t i = 0; i < kBatchSize; ++i)
+                    ops.push_back({slice(keys[i]), docs[i]});
+                if (b == 0) {
+                    keys.push_back(keyFor(t));
+                    ops.push_back({slice(keys.back()), nullptr});
+                }
+                db->commitBatch(ops, false);
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+
+    CHECK(!db->isChanged());
+    reopen();
+    CHECK(db->count() == 10 + kThreads * kBatches * kBatchSize - kThreads);
+    for (size_t i = 10; i < 10 + kThreads * kBatches * kBatchSize; ++i)
+        CHECK(db->get(slice(keyFor(i)))["i"].asInt() == int64_t(i));
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Failed Batch", "[DB]") {
+    putDocs(0, 10);
+    db->commitChanges();
+    putDocs(10, 20);                // (left uncommitted)
+
+    vector<string> keys;
+    vector<MutableDict> docs;
+    vector<DB::BatchOp> ops;
+    for (size_t i = 1000; i < 3000; ++i) {
+        keys.push_back(keyFor(i));
+        docs.push_back(makeDoc(i));
+    }
+    for (size_t i = 0; i < keys.size(); ++i)
+        ops.push_back({slice(keys[i]), docs[i]});
+
+    // Make the batch's commit fail by limiting the size of files the process can write:
+    auto oldHandler = signal(SIGXFSZ, SIG_IGN);
+    rlimit oldLimit;
+    REQUIRE(getrlimit(RLIMIT_FSIZE, &oldLimit) == 0);
+    rlimit limit = oldLimit;
+    limit.rlim_cur = rlim_t(db->fileSize() + 8192);
+    REQUIRE(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+    CHECK_THROWS_AS(db->commitBatch(ops), FleeceException);
+    setrlimit(RLIMIT_FSIZE, &oldLimit);
+    signal(SIGXFSZ, oldHandler);
+
+    // The changes made before the batch were committed, and the batch wasn't:
+    CHECK(!db->isChanged());
+    checkDocs(0, 20);
+    db->commitBatch(ops);
+    reopen();
+    CHECK(db->count() == 20 + keys.size());
+    CHECK(db->get(slice(keyFor(19))));
+    CHECK(db->get(slice(keyFor(2999))));
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Snapshots", "[DB]") {
+    auto empty = db->snapshot();
+    CHECK(empty->count() == 0);
+    CHECK(!empty->get("doc-000000"_sl));
+    CHECK(!DB::Snapshot::iterator(*empty));
+
+    putDocs(0, 10);
+    db->commitChanges();
+    auto s1 = db->snapshot();
+    CHECK(s1->count() == 10);
+    CHECK(s1->fileSize() == db->fileSize());
+
+    // Uncommitted changes aren't visible in a snapshot:
+    putDocs(10, 20);
+    CHECK(db->remove("doc-000003"_sl));
+    CHECK(db->snapshot().get() == s1.get());
+    db->commitChanges();
+
+    auto s2 = db->snapshot();
+    CHECK(s2 != s1);
+    CHECK(s2->count() == 19);
+    CHECK(s1->count() == 10);
+    CHECK(s1->get("doc-000003"_sl)["i"].asInt() == 3);
+    CHECK(!s1->get("doc-000010"_sl));
+    CHECK(!s2->get("doc-000003"_sl));
+    size_t n = 0;
+    for (DB::Snapshot::iterator i(*s1); i; ++i)
+        ++n;
+    CHECK(n == 10);
+
+    CHECK(db->oldestSnapshotSize() == empty->fileSize());
+    empty = nullptr;
+    CHECK(db->oldestSnapshotSize() == s1->fileSize());
+    s1 = nullptr;
+    CHECK(db->oldestSnapshotSize() == db->fileSize());
+
+    // A snapshot outlives the DB:
+    db.reset();
+    CHECK(s2->count() == 19);
+    CHECK(s2->get("doc-000019"_sl)["i"].asInt() == 19);
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Concurrent Snapshots", "[DB]") {
+    // Each commit adds one doc and updates a "count" doc, so every snapshot must agree with it.
+    static constexpr size_t kCommits = 200, kReaders = 4;
+    atomic<bool> done {false};
+    atomic<size_t> nChecks {0};
+    vector<thread> readers;
+    for (size_t r = 0; r < kReaders; ++r) {
+        readers.emplace_back([&] {
+            while (!done) {
+                auto snap = db->snapshot();
+                Dict meta = snap->get("count"_sl);
+                int64_t count = meta ? meta["n"].asInt() : 0;
+                if (snap->count() != (count ? count + 1 : 0)
+                        || (count && !snap->get(slice(keyFor(size_t(count - 1))))))
+                    abort();
+                ++nChecks;
+                this_thread::yield();
+            }
+        });
+    }
+    for (size_t i = 0; i < kCommits; ++i) {
+        MutableDict doc = makeDoc(i), meta = MutableDict::newDict();
+        meta["n"] = int64_t(i + 1);
+        db->put(slice(keyFor(i)), doc);
+        db->put("count"_sl, meta);
+        db->commitChanges(false);
+    }
+    done = true;
+    for (auto &t : readers)
+        t.join();
+    CHECK(nChecks > 0);
+    CHECK(db->snapshot()->count() == kCommits + 1);
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Compact", "[DB]") {
+    auto emptySnapshot = db->snapshot();
+    putDocs(0, 100);
+    db->commitChanges(false);
+    // Rewrite every doc several times, leaving the old versions as garbage:
+    for (int round = 0; round < 5; ++round) {
+        for (size_t i = 0; i < 100; ++i) {
+            MutableDict doc = db->getMutable(slice(keyFor(i)));
+            doc["round"] = round;
+        }
+        db->commitChanges(false);
+    }
+    CHECK(db->remove("doc-000050"_sl));
+    db->commitChanges(false);
+
+    auto oldSize = db->fileSize(), live = db->liveBytes();
+    CHECK(live < oldSize / 2);
+    auto oldSnapshot = db->snapshot();
+    Dict oldDoc = db->get("doc-000001"_sl);
+
+    db->compact();
+    // (Each amended doc still refers to its earlier versions, until compacting flattens it:)
+    CHECK(db->fileSize() <= live);
+    CHECK(db->liveBytes() == db->fileSize());
+    CHECK(db->count() == 99);
+    CHECK(db->get("doc-000001"_sl)["round"].asInt() == 4);
+    CHECK(!db->get("doc-000050"_sl));
+    // Snapshots from the old file are still usable, and still counted:
+    CHECK(db->oldestSnapshotSize() == emptySnapshot->fileSize());
+    emptySnapshot = nullptr;
+    CHECK(db->oldestSnapshotSize() == db->fileSize());
+    CHECK(oldSnapshot->count() == 99);
+    CHECK(oldSnapshot->get("doc-000002"_sl)["round"].asInt() == 4);
+    oldSnapshot = nullptr;
+    // So are Values from it, even when nothing retains them:
+    CHECK(oldDoc["i"].asInt() == 1);
+
+    // The compacted file can be committed to and reopened:
+    putDocs(100, 110);
+    db->commitChanges();
+    reopen();
+    CHECK(db->discardedBytes() == 0);
+    CHECK(db->count() == 109);
+    CHECK(db->get("doc-000099"_sl)["round"].asInt() == 4);
+    CHECK(db->get("doc-000105"_sl)["i"].asInt() == 105);
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Live Bytes", "[DB]") {
+    CHECK(db->liveBytes() == db->fileSize());
+    putDocs(0, 1000);
+    db->commitChanges(false);
+    CHECK(db->liveBytes() == db->fileSize());
+    // Replace docs, remove some, and add a few:
+    for (size_t round = 0; round < 5; ++round) {
+        putDocs(0, 1000);
+        for (size_t i = round; i < 1000; i += 7)
+            db->remove(slice(keyFor(i)));
+        db->commitChanges(false);
+        putDocs(2000 + 10 * round, 2010 + 10 * round);
+        db->commitChanges(false);
+    }
+    auto live = db->liveBytes();
+    CHECK(live < db->fileSize() / 4);
+    reopen();
+    CHECK(db->liveBytes() == live);
+
+    db->compact();
+    CHECK(db->liveBytes() == db->fileSize());
+    CHECK(live > db->fileSize() * 95 / 100);
+    CHECK(live < db->fileSize() * 105 / 100);
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Bloom Filter", "[DB]") {
+    putDocs(0, 100);
+    db->commitChanges();
+    db->setBloomFilter(10);
+    putDocs(100, 200);
+    db->commitChanges();
+
+    auto check = [&](size_t n) {
+        auto snap = db->snapshot();
+        for (size_t i = 0; i < n + 100; ++i) {
+            bool present = (i < n);
+            CHECK(!!db->get(slice(keyFor(i))) == present);
+            CHECK(!!snap->get(slice(keyFor(i))) == present);
+        }
+    };
+    check(200);
+    // Uncommitted changes aren't in the filter, so it isn't used until they're committed:
+    putDocs(200, 210);
+    CHECK(db->get("doc-000205"_sl));
+    db->commitChanges();
+    check(210);
+
+    // The filter is saved in the file:
+    reopen();
+    check(210);
+
+    // A commit writes only the blocks of the filter it changed, not the whole filter:
+    putDocs(210, 2000);
+    db->commitChanges();
+    check(2000);
+    auto commitGrowth = [&](size_t i) {
+        auto size = db->fileSize();
+        putDocs(i, i + 1);
+        db->commitChanges();
+        return db->fileSize() - size;
+    };
+    size_t growth = commitGrowth(2000);
+    reopen();
+    check(2001);
+    size_t growthAfterReopen = commitGrowth(2001);
+    check(2002);
+
+    db->compact();
+    check(2002);
+    reopen();
+    check(2002);
+
+    // Turning the filter off:
+    db->setBloomFilter(0);
+    putDocs(2002, 2010);
+    db->commitChanges();
+    check(2010);
+    reopen();
+    check(2010);
+
+    size_t growthWithoutFilter = commitGrowth(2010);
+    size_t patchSize = 2 * (64 + 4) + 24;
+    size_t filterSize = 2 * 2000 * 10 / 8;
+    CHECK(growth <= growthWithoutFilter + patchSize);
+    CHECK(growthAfterReopen <= growthWithoutFilter + patchSize);
+    CHECK(patchSize < filterSize / 10);
+}
+
+
+TEST_CASE_METHOD(DBTests, "DB Compact While Committing", "[DB]") {
+    static constexpr size_t kBatches = 100, kBatchSize = 10;
+    putDocs(0, 1000);
+    db->commitChanges(false);
+
+    // Another thread keeps committing batches while the DB is compacted:
+    atomic<bool> started {false};
+    thread writer([&] {
+        for (size_t b = 0; b < kBatches; ++b) {
+            vector<string> keys;
+            vector<MutableDict> docs;
+            vector<DB::BatchOp> ops;
+            for (size_t i = 1000 + b * kBatchSize; i < 1000 + (b + 1) * kBatchSize; ++i) {
+                keys.push_back(keyFor(i));
+                docs.push_back(makeDoc(i));
+            }
+            for (size_t i = 0; i < kBatchSize; ++i)
+                ops.push_back({slice(keys[i]), docs[i]});
+            keys.push_back(keyFor(b));
+            ops.push_back({slice(keys.back()), nullptr});
+            db->commitBatch(ops, false);
+            started = true;
+        }
+    });
+    while (!started)
+        this_thread::yield();
+    db->compact();
+    writer.join();
+
+    auto check = [&] {
+        CHECK(db->count() == 1000 + kBatches * kBatchSize - kBatches);
+        for (size_t i = 0; i < kBatches; ++i)
+            CHECK(!db->get(slice(keyFor(i))));
+        for (size_t i = kBatches; i < 1000 + kBatches * kBatchSize; ++i)
+            CHECK(db->get(slice(keyFor(i)))["i"].asInt() == int64_t(i));
+    };
+    check();
+    reopen();
+    check();
+}
+
+
+#pragma mark - BENCHMARK:
+
+
+TEST_CASE_METHOD(DBTests, "Perf DB", "[.Perf]") {
+    static constexpr size_t kNumDocs = 100000, kBatchSize = 1000;
+
+    for (bool sync : {false, true}) {
+        db.reset();
+        ::unlink(kPath);
+        reopen();
+        Benchmark wbench;
+        for (size_t i = 0; i < kNumDocs; i += kBatchSize) {
+            wbench.start();
+            putDocs(i, i + kBatchSize);
+            db->commitChanges(sync);
+            wbench.stop();
+        }
+        fprintf(stderr, "Batched writes (%s): ", (sync ? "fsync" : "no fsync"));
+        wbench.printReport(1.0 / kBatchSize, "doc");
+    }
+    fprintf(stderr, "File size: %llu bytes\n", (unsigned long long)db->fileSize());
+
+    reopen(DB::kReadOnly);
+    Benchmark rbench;
+    string keys[100];
+    for (int s = 0; s < 2000; ++s) {
+        for (auto &key : keys)
+            key = keyFor(random() % kNumDocs);
+        rbench.start();
+        for (auto &key : keys) {
+            if (!db->get(slice(key))["i"])
+                abort();
+        }
+        rbench.stop();
+    }
+    fprintf(stderr, "Random reads: ");
+    rbench.printReport(1.0 / 100, "read");
+}
+
+TEST_CASE_METHOD(DBTests, "Perf DB Group Commit", "[.Perf]") {
+    static constexpr size_t kCommits = 2000, kBatchSize = 10;
+
+    for (size_t nThreads : {1, 4, 16}) {
+        db.reset();
+        ::unlink(kPath);
+        reopen();
+        atomic<size_t> nextCommit {0};
+        Stopwatch st;
+        vector<thread> threads;
+        for (size_t t = 0; t < nThreads; ++t) {
+            threads.emplace_back([&] {
+                size_t c;
+                while ((c = nextCommit++) < kCommits) {
+                    vector<string> keys;
+                    vector<MutableDict> docs;
+                    vector<DB::BatchOp> ops;
+                    for (size_t i = c * kBatchSize; i < (c + 1) * kBatchSize; ++i) {
+                        keys.push_back(keyFor(i));
+                        docs.push_back(makeDoc(i));
+                    }
+                    for (size_t i = 0; i < kBatchSize; ++i)
+                        ops.push_back({slice(keys[i]), docs[i]});
+                    db->commitBatch(ops);
+                }
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+        double elapsed = st.elapsed();
+        fprintf(stderr, "%2zu threads: %8.0f commits/sec\n", nThreads, kCommits / elapsed);
+        CHECK(db->count() == kCommits * kBatchSize);
+    }
+}
+
+#endif // FL_HAVE_MMAP
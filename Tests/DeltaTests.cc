@@ -13,8 +13,18 @@
 #include "FleeceTests.hh"
 #include "FleeceImpl.hh"
 #include "JSONDelta.hh"
+#include "FleeceDelta.hh"
+#include "MutableArray.hh"
+#include "MutableDict.hh"
 #include <iostream>
 
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdouble-promotion"
+#pragma clang diagnostic ignored "-Wdocumentation"
+#pragma clang diagnostic ignored "-Wdocumentation-unknown-command"
+#include "diff_match_patch.hh"
+#pragma clang diagnostic pop
+
 namespace fleece { namespace impl {
     extern bool gCompatibleDeltas;
 } }
@@ -31,6 +41,21 @@ static std::string toJSONString(const Value *v) {
 }
 
 
+// Applies a delta in place to a mutable copy of `v1`, if it's a collection, and checks that the
+// result equals `v2`.
+static void checkDeltaInPlace(const Value *v1, const Value *v2, slice jsonDelta, bool json5) {
+    if (auto dict = v1->asDict(); dict) {
+        auto md = MutableDict::newDict(dict);
+        JSONDelta::applyInPlace(md, jsonDelta, json5);
+        CHECK(md->toJSON(true) == v2->toJSON(true));
+    } else if (auto array = v1->asArray(); array) {
+        auto ma = MutableArray::newArray(array);
+        JSONDelta::applyInPlace(ma, jsonDelta, json5);
+        CHECK(ma->toJSON(true) == v2->toJSON(true));
+    }
+}
+
+
 static void checkDelta(const char *json1, const char *json2, const char *deltaExpected) {
     auto sk = retained(new SharedKeys());
 
@@ -64,6 +89,10 @@ static void checkDelta(const char *json1, const char *json2, const char *deltaEx
         auto v2_reconstituted = Value::fromData(f2_reconstituted);
         INFO("value2 reconstituted:  " << toJSONString(v2_reconstituted) << " ;  should be:  " << toJSONString(v2) << " ;  delta: " << jsonDelta);
         CHECK(v2_reconstituted->isEqual(v2));
+
+        // Apply it in place to a mutable copy of the old value:
+        if (v1 && v2 && v1->type() == v2->type())
+            checkDeltaInPlace(v1, v2, jsonDelta, true);
     }
 }
 
@@ -104,11 +133,11 @@ TEST_CASE("Delta strings", "[delta]") {
     // Modify string
     checkDelta("'to wound the autumnal city. So howled out for the world to give him a name.  The in-dark answered with the wind.'",
                "'To wound the eternal city. So he howled out for the world to give him its name. The in-dark answered with wind.'",
-               "[\"1-1+T|12=5-4+eter|13=3+he |37=1-3+its|6=1-27=4-5=\",0,2]");
+               "[\"1-1+T|12=5-4+eter|14=3+e h|36=1-3+its|7=1-25=4-6=\",0,2]");
     // Insert in middle
     checkDelta("'to wound the autumnal city. The in-dark answered with the wind.'",
                "'to wound the autumnal city. So howled out for the world to give him a name. The in-dark answered with the wind.'",
-               "[\"27=48+ So howled out for the world to give him a name.|36=\",0,2]");
+               "[\"28=48+So howled out for the world to give him a name. |35=\",0,2]");
     // Inefficient delta
     checkDelta("'Lorem ipsum dolor sit amet, assueverit sadipscing usu ea, mei efficiantur intellegebat in, iudico ullamcorper ei ius. Ius quaeque eripuit instructior ea, et ipsum doctus quo, pri decore ornatus et. Te wisi omittantur interpretaris quo, in audire prompta nominati vim. Dicat epicuri delectus sit eu.'",
                "'Ex quo prima efficiantur, an pro modus pertinax. Magna tractatos qualisque vim id. Eum at omnis inani, labore possim nec id. Exerci audire eam eu, summo liberavisse mel ei. Homero ponderum ea his, cum id impedit fuisset.'",
@@ -129,7 +158,7 @@ TEST_CASE("Delta strings UTF-8", "[delta]") {
     // Multi-byte UTF-8 chars, with patches occurring in midst of UTF-8 sequences:
     checkDelta(u8"'モバイルデータベースは将来のものです。 ある日、私たちのデータが端に集まります。'",
                u8"'モバイルデータベースがここにあります。 あなたのデータはすべて端にあります。'",
-               u8"[\"30=49-37+がここにあります。 あなた|12=3-12+はすべて|6=3-3-3+あ|12=\",0,2]");
+               u8"[\"30=49-37+がここにあります。 あなた|12=3-12+はすべて|6=6-3+あ|12=\",0,2]");
 
     // Here the C7/C6 bytes can't be included in the preceding XXX/YYY diff:
     checkDelta("'<aaaaaaaaXXX\xC7\x88zzzzzzzz>'",
@@ -138,7 +167,7 @@ TEST_CASE("Delta strings UTF-8", "[delta]") {
 
     checkDelta(u8"'யாமறிந்த மொழிகளிலே தமிழ்மொழி போல் இனிதாவது எங்கும் காணோம், பாமரராய் விலங்குகளாய், உலகனைத்தும் இகழ்ச்சிசொலப் பான்மை கெட்டு, நாமமது தமிழரெனக் கொண்டு இங்கு வாழ்ந்திடுதல் நன்றோ? சொல்லீர்! தேமதுரத் இகழ்ச்சிசொலப் உலகமெலாம் பரவும்வகை செய்தல் வேண்டும்.'",
                u8"'யாமறிந்த மொழிகளிலே தமிழ்மொழி போல் இனிதாவது எங்கும் காணோம், பாமரராய் விலங்குகளாய், உலகனைத்தும் இகழ்ச்சிசொலப் பான்மை கெட்டு, நாமமது தமிழரெனக் கொண்டு இங்கு வாழ்ந்திடுதல் நன்றோ? கொண்டு! தேமதுரத் தமிழோசை உலகமெலாம் பரவும்வகை செய்தல் வேண்டும்.'",
-               u8"[\"476=3-3+க|3=3-3+ண|3=12-6+டு|27=21-6+தம|3=15-12+ழோசை|104=\",0,2]");
+               u8"[\"476=24-18+கொண்டு|27=39-21+தமிழோசை|104=\",0,2]");
 
     JSONDelta::gMinStringDiffLength = 60;
 }
@@ -183,7 +212,7 @@ TEST_CASE("Delta simple arrays", "[delta]") {
 
     checkDelta("[]", "[1, 2, 3]", "[[1,2,3]]");
     checkDelta("[1, 2, 3]", "[]", "[[]]");
-    checkDelta("[1, 2, 3, 5, 6, 7]", "[1, 2, 3, 4, 5]", "{\"3\":4,\"4\":5,\"5-\":[]}"); // non-optimal - could be {"3-":[4,5]}
+    checkDelta("[1, 2, 3, 5, 6, 7]", "[1, 2, 3, 4, 5]", "{\"3+\":[[4]],\"4-\":[]}");
     checkDelta("[1, 2, 3]", "[1, 2, 3, 4, 5]", "{\"3-\":[4,5]}");
     checkDelta("[1, 2, 3, 4, 5]", "[1, 2, 3]", "{\"3-\":[]}");
     checkDelta("[1, 2, 3]", "[1, 9, 3]", "{\"1\":9}");
@@ -192,6 +221,54 @@ TEST_CASE("Delta simple arrays", "[delta]") {
 }
 
 
+TEST_CASE("Delta array insertions, deletions and moves", "[delta]") {
+    checkDelta("[1, 2, 3]", "[0, 1, 2, 3]", "{\"0+\":[[0]]}");
+    checkDelta("['a', 'b', 'c', 'd', 'e']", "['a', 'b', 'd', 'e']", "{\"2-\":1}");
+    checkDelta("['a', 'b', 'c', 'd', 'e']", "['a', 'e']", "{\"1-\":3}");
+    checkDelta("['a', 'b', 'c', 'd', 'e']", "['a', 'b', 'X', 'Y', 'c', 'd', 'e']",
+               "{\"2+\":[\"X\",\"Y\"]}");
+    checkDelta("['a', 'b', 'c']", "['a', 'X', 'c', 'Y']", "{\"1\":\"X\",\"3-\":[\"Y\"]}");
+    checkDelta("[[1], [2], [3]]", "[[1], [2], [2.5], [3]]", "{\"2+\":[[[2.5]]]}");
+    // Moves:
+    checkDelta("[{id: 1}, {id: 2}, {id: 3}]", "[{id: 2}, {id: 3}, {id: 1}]",
+               "{\"0-\":1,\"3+\":[0]}");
+    checkDelta("['first', 'a', 'b', 'c', 'last']", "['last', 'a', 'b', 'c', 'first']",
+               "{\"0\":\"last\",\"4\":\"first\"}");
+    // Modified items are still diffed:
+    checkDelta("[{id: 1}, {id: 2, x: 0}, {id: 3}]", "[{id: 0}, {id: 1}, {id: 2, x: 1}, {id: 3}]",
+               "{\"0+\":[{id:0}],\"1\":{x:1}}");
+
+    // If the arrays differ by more than the maximum edit distance, items are diffed by index:
+    size_t savedMaxDistance = JSONDelta::gMaxArrayDiffDistance;
+    JSONDelta::gMaxArrayDiffDistance = 1;
+    checkDelta("['a', 'b', 'c']", "['X', 'a', 'b', 'c']", "{\"0+\":[\"X\"]}");
+    checkDelta("['a', 'b', 'c']", "['X', 'a', 'b']", "{\"0\":\"X\",\"1\":\"a\",\"2\":\"b\"}");
+    checkDelta("['a', 'b', 'c', 'd']", "['X', 'a', 'b', 'c', 'd', 'Y']",
+               "{\"0\":\"X\",\"1\":\"a\",\"2\":\"b\",\"3\":\"c\",\"4-\":[\"d\",\"Y\"]}");
+    JSONDelta::gMaxArrayDiffDistance = savedMaxDistance;
+}
+
+
+TEST_CASE("Delta array insertion in long array", "[delta]") {
+    std::string oldJSON = "[", nuuJSON = "[\"new\"";
+    for (int i = 0; i < 10000; ++i) {
+        oldJSON += (i ? ",{\"i\":" : "{\"i\":") + std::to_string(i) + "}";
+        nuuJSON += ",{\"i\":" + std::to_string(i) + "}";
+    }
+    oldJSON += "]";
+    nuuJSON += "]";
+    Retained<Doc> oldDoc = Doc::fromJSON(oldJSON), nuuDoc = Doc::fromJSON(nuuJSON);
+    alloc_slice delta = JSONDelta::create(oldDoc->root(), nuuDoc->root());
+    CHECK(delta == "{\"0+\":[\"new\"]}"_sl);
+    alloc_slice result = JSONDelta::apply(oldDoc->root(), delta);
+    CHECK(Value::fromData(result)->toJSON() == nuuDoc->root()->toJSON());
+    checkDeltaInPlace(oldDoc->root(), nuuDoc->root(), delta, false);
+
+    CHECK_THROWS_AS(JSONDelta::apply(oldDoc->root(), "{\"0-\":20000}"_sl), FleeceException);
+    CHECK_THROWS_AS(JSONDelta::apply(oldDoc->root(), "{\"0+\":[20000]}"_sl), FleeceException);
+}
+
+
 TEST_CASE("Delta nested arrays", "[delta]") {
     checkDelta("[[[]]]", "[[[]]]", nullptr);
     checkDelta("[1,[2,[3]]]", "[1,[2,[3]]]", nullptr);
@@ -201,6 +278,37 @@ TEST_CASE("Delta nested arrays", "[delta]") {
 }
 
 
+TEST_CASE("Delta apply in place", "[delta]") {
+    Retained<Doc> doc = Doc::fromJSON(ConvertJSON5(
+        "{name: 'x', big: {a: [1, 2, 3]}, list: [{id: 1}, {id: 2}, {id: 3}], s: 'hi'}"));
+    auto md = MutableDict::newDict(doc->root()->asDict());
+
+    JSONDelta::applyInPlace(md, "{name:'y', list:{'1':{id:22}}}"_sl, true);
+    CHECK(md->toJSONString() == "{\"big\":{\"a\":[1,2,3]},\"list\":[{\"id\":1},{\"id\":22},{\"id\":3}],\"name\":\"y\",\"s\":\"hi\"}");
+    // Only the collections that were changed were made mutable:
+    CHECK(md->get("list"_sl)->isMutable());
+    CHECK(md->get("list"_sl)->asArray()->get(1)->isMutable());
+    CHECK(!md->get("list"_sl)->asArray()->get(0)->isMutable());
+    CHECK(!md->get("big"_sl)->isMutable());
+
+    // Moving a mutable item copies it, so the items can be changed separately:
+    JSONDelta::applyInPlace(md, "{list:{'0-':1,'3+':[1,0]}}"_sl, true);
+    CHECK(md->get("list"_sl)->toJSONString() == "[{\"id\":22},{\"id\":3},{\"id\":22},{\"id\":1}]");
+    JSONDelta::applyInPlace(md, "{list:{'0':{id:5}}, s:[]}"_sl, true);
+    CHECK(md->toJSONString() == "{\"big\":{\"a\":[1,2,3]},\"list\":[{\"id\":5},{\"id\":3},{\"id\":22},{\"id\":1}],\"name\":\"y\"}");
+
+    // Replacing the whole dict:
+    JSONDelta::applyInPlace(md, "[{z:1}]"_sl, true);
+    CHECK(md->toJSONString() == "{\"z\":1}");
+
+    CHECK_THROWS_AS(JSONDelta::applyInPlace(md, "[5]"_sl), FleeceException);
+    CHECK_THROWS_AS(JSONDelta::applyInPlace(md, "{\"z\":{\"a\":1}}"_sl), FleeceException);
+    auto ma = MutableArray::newArray(doc->root()->asDict()->get("list"_sl)->asArray());
+    CHECK_THROWS_AS(JSONDelta::applyInPlace(ma, "{\"0-\":4}"_sl), FleeceException);
+    CHECK_THROWS_AS(JSONDelta::applyInPlace(ma, "{\"0+\":[3]}"_sl), FleeceException);
+}
+
+
 static void checkDelta(const Value *left, const Value *right, const Value *expectedDelta) {
     if (!expectedDelta)
         expectedDelta = Dict::kEmpty;
@@ -215,6 +323,118 @@ static void checkDelta(const Value *left, const Value *right, const Value *expec
 }
 
 
+// Returns `nWords` pseudo-random words, separated by spaces.
+static std::string randomText(size_t nWords) {
+    static const char* const kWords[] = {"lorem", "ipsum", "dolor", "sit", "amet", "consectetur",
+        "adipiscing", "elit", "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore",
+        "et", "dolore", "magna", "aliqua", "enim", "ad", "minim", "veniam", "quis", "nostrud"};
+    std::string text;
+    for (size_t i = 0; i < nWords; ++i) {
+        if (i > 0)
+            text += ' ';
+        text += kWords[random() % (sizeof(kWords) / sizeof(kWords[0]))];
+    }
+    return text;
+}
+
+// Returns `text` with `nEdits` random words inserted or replaced.
+static std::string editText(std::string text, int nEdits) {
+    for (int i = 0; i < nEdits; ++i) {
+        size_t pos = random() % text.size();
+        if (i % 2)
+            text.insert(pos, " EDITED");
+        else
+            text.replace(pos, std::min(size_t(6), text.size() - pos), "CHANGE");
+    }
+    return text;
+}
+
+static alloc_slice encodeString(const std::string &str) {
+    Encoder enc;
+    enc.beginArray();
+    enc.writeString(str);
+    enc.endArray();
+    return enc.finish();
+}
+
+
+TEST_CASE("Delta long strings", "[delta]") {
+    srandom(4321);
+    std::string oldStr = randomText(4000);
+    std::string nuuStr = editText(oldStr, 10);
+    alloc_slice oldDoc = encodeString(oldStr), nuuDoc = encodeString(nuuStr);
+    auto v1 = Value::fromData(oldDoc), v2 = Value::fromData(nuuDoc);
+
+    alloc_slice delta = JSONDelta::create(v1, v2);
+    INFO("Delta: " << std::string(delta));
+    CHECK(delta.size < 300);
+    alloc_slice result = JSONDelta::apply(v1, delta);
+    CHECK(Value::fromData(result)->isEqual(v2));
+
+    // If the strings differ by more than the maximum edit distance, the whole string is replaced:
+    size_t savedMaxDistance = JSONDelta::gMaxStringDiffDistance;
+    JSONDelta::gMaxStringDiffDistance = 16;
+    delta = JSONDelta::create(v1, v2);
+    JSONDelta::gMaxStringDiffDistance = savedMaxDistance;
+    CHECK(delta.size > nuuStr.size());
+    result = JSONDelta::apply(v1, delta);
+    CHECK(Value::fromData(result)->isEqual(v2));
+}
+
+
+TEST_CASE("Delta long strings size", "[delta]") {
+    // Each edit inserts at most 7 bytes. Encoding it takes at most 5+2+2+1 more bytes for its
+    // counts and separators, plus at most 5 for the match before the next edit (or the end):
+    static constexpr size_t kMaxEditSize = 7 + 10 + 5;
+    static constexpr size_t kOverhead = 15 + 5; // The JSON around the string delta, and the
+                                                // match before the first edit
+    srandom(1234);
+    std::string oldStr = randomText(2000);
+    alloc_slice oldDoc = encodeString(oldStr);
+    auto v1 = Value::fromData(oldDoc);
+    for (int nEdits = 1; nEdits <= 64; nEdits *= 2) {
+        std::string nuuStr = editText(oldStr, nEdits);
+        alloc_slice nuuDoc = encodeString(nuuStr);
+        auto v2 = Value::fromData(nuuDoc);
+        alloc_slice delta = JSONDelta::create(v1, v2);
+        INFO("Edits: " << nEdits << ", delta: " << std::string(delta));
+        CHECK(delta.size <= nEdits * kMaxEditSize + kOverhead);
+        alloc_slice result = JSONDelta::apply(v1, delta);
+        CHECK(Value::fromData(result)->isEqual(v2));
+    }
+}
+
+
+TEST_CASE("Perf Delta long strings", "[.Perf]") {
+    srandom(4321);
+    for (size_t nWords : {1000, 10000, 100000}) {
+        std::string oldStr = randomText(nWords);
+        std::string nuuStr = editText(oldStr, 20);
+        alloc_slice oldDoc = encodeString(oldStr), nuuDoc = encodeString(nuuStr);
+        auto v1 = Value::fromData(oldDoc), v2 = Value::fromData(nuuDoc);
+
+        Benchmark bench, dmpBench;
+        alloc_slice delta;
+        for (int i = 0; i < 10; ++i) {
+            bench.start();
+            delta = JSONDelta::create(v1, v2);
+            bench.stop();
+
+            dmpBench.start();
+            diff_match_patch<std::string> dmp;
+            dmp.Diff_Timeout = 0;
+            auto patches = dmp.patch_make(oldStr, nuuStr);
+            dmpBench.stop();
+        }
+        fprintf(stderr, "%zu-byte string, %zu-byte delta:\n", oldStr.size(), delta.size);
+        fprintf(stderr, "    JSONDelta:        ");
+        bench.printReport();
+        fprintf(stderr, "    diff_match_patch: ");
+        dmpBench.printReport();
+    }
+}
+
+
 TEST_CASE("JSONDiffPatch test suite", "[delta]") {
     Encoder enc;
     auto input = readTestFile("DeltaTests.json5");
@@ -257,6 +477,423 @@ TEST_CASE("JSONDiffPatch test suite", "[delta]") {
 
 
 
+TEST_CASE("Perf Delta apply in place", "[.Perf]") {
+    // Applying small deltas to a large cached document, by re-encoding it or in place:
+    srandom(1234);
+    Encoder enc;
+    enc.beginDictionary();
+    for (int i = 0; i < 5000; ++i) {
+        enc.writeKey(std::to_string(i));
+        enc.beginDictionary();
+        enc.writeKey("text");
+        enc.writeString(randomText(20));
+        enc.endDictionary();
+    }
+    enc.endDictionary();
+    Retained<Doc> doc = enc.finishDoc();
+    std::vector<std::string> deltas;
+    for (int i = 0; i < 100; ++i)
+        deltas.push_back("{\"" + std::to_string(random() % 5000) + "\":{\"n\":" + std::to_string(i) + "}}");
+
+    Benchmark reencode, inPlace;
+    for (int rep = 0; rep < 10; ++rep) {
+        Retained<Doc> cachedDoc = doc;
+        Retained<MutableDict> cached = MutableDict::newDict(doc->root()->asDict());
+        reencode.start();
+        for (auto &delta : deltas) {
+            cachedDoc = new Doc(JSONDelta::apply(cached, slice(delta)), Doc::kTrusted);
+            cached = MutableDict::newDict(cachedDoc->root()->asDict());
+        }
+        reencode.stop();
+
+        Retained<MutableDict> cached2 = MutableDict::newDict(doc->root()->asDict());
+        inPlace.start();
+        for (auto &delta : deltas)
+            JSONDelta::applyInPlace(cached2, slice(delta));
+        inPlace.stop();
+        CHECK(cached2->toJSON(true) == cached->toJSON(true));
+    }
+    fprintf(stderr, "Applying a delta to a %zu-byte document:\n", size_t(doc->data().size));
+    fprintf(stderr, "    re-encoding: ");
+    reencode.printReport(1.0 / deltas.size(), "delta");
+    fprintf(stderr, "    in place:    ");
+    inPlace.printReport(1.0 / deltas.size(), "delta");
+}
+
+
+#pragma mark - COMPOSING DELTAS:
+
+
+// Checks that composing the deltas json1->json2 and json2->json3 gives the expected delta, and
+// that it turns json1 into json3. If `composedExpected` is null, composing should fail.
+static void checkComposedDelta(const char *json1, const char *json2, const char *json3,
+                               const char *composedExpected)
+{
+    auto sk = retained(new SharedKeys());
+    Retained<Doc> docs[3];
+    const Value *values[3];
+    const char *jsons[3] = {json1, json2, json3};
+    for (int i = 0; i < 3; ++i) {
+        auto j = std::string("[") + ConvertJSON5(std::string(jsons[i])) + "]";
+        docs[i] = Doc::fromJSON(slice(j), sk);
+        values[i] = docs[i]->root()->asArray()->get(0);
+    }
+    alloc_slice delta1 = JSONDelta::create(values[0], values[1], true);
+    alloc_slice delta2 = JSONDelta::create(values[1], values[2], true);
+    alloc_slice composed = JSONDelta::compose(delta1, delta2, true);
+    std::cerr << "Composed: " << std::string(delta1) << " + " << std::string(delta2) << " = "
+              << std::string(composed) << "\n";
+    if (!composedExpected) {
+        CHECK(!composed);
+        return;
+    }
+    CHECK(composed == slice(composedExpected));
+
+    alloc_slice result = JSONDelta::apply(values[0], composed, true);
+    auto v3 = Value::fromData(result);
+    INFO("value3 reconstituted:  " << toJSONString(v3) << " ;  should be:  " << toJSONString(values[2]));
+    CHECK(v3->isEqual(values[2]));
+    checkDeltaInPlace(values[0], values[2], composed, true);
+}
+
+
+TEST_CASE("Delta composition", "[delta]") {
+    // Scalars and replacements:
+    checkComposedDelta("1", "2", "3", "[3]");
+    checkComposedDelta("1", "{a: 1}", "{a: 2}", "[{a:2}]");
+    checkComposedDelta("{a: 1}", "{a: 2}", "{a: 2}", "{a:2}");
+    checkComposedDelta("{a: 1}", "{a: 1}", "{a: 1}", "{}");
+    // Dicts:
+    checkComposedDelta("{a: 1, b: 2, c: {d: 3}}", "{a: 1, b: 3, c: {d: 4}, e: 5}",
+                       "{b: 3, c: {d: 4, f: 6}, e: 7}", "{b:3,c:{d:4,f:6},e:7,a:[]}");
+    checkComposedDelta("{a: 1}", "{a: 2}", "{a: 1}", "{a:1}");
+    // (A key inserted and then deleted composes to a deletion that's allowed to find no key:)
+    checkComposedDelta("{a: 1}", "{a: 1, x: 2}", "{a: 1}", "{x:[0,0,4]}");
+    checkComposedDelta("{a: 1, x: 1}", "{a: 1, x: 2}", "{a: 1}", "{x:[0,0,4]}");
+    checkComposedDelta("{a: 1, x: 2}", "{a: 1}", "{a: 1, x: 3}", "{x:3}");
+    checkComposedDelta("{a: {b: {c: 1}}}", "{a: {b: {c: 2}}}", "{a: {b: {c: 2, d: 3}}}",
+                       "{a:{b:{c:2,d:3}}}");
+    // Arrays:
+    checkComposedDelta("[1, 2, 3]", "[1, 2, 4]", "[1, 5, 4]", "{\"2\":4,\"1\":5}");
+    checkComposedDelta("[1, 2, 3, 4, 5]", "[0, 1, 2, 3, 4, 5]", "[0, 1, 2, 4, 5, 6]",
+                       "{\"0+\":[[0]],\"2-\":1,\"5-\":[6]}");
+    checkComposedDelta("['a', 'b', 'c', 'd', 'e']", "['a', 'b', 'd', 'e']", "['a', 'e']", "{\"1-\":3}");
+    checkComposedDelta("['a', 'b', 'c']", "['a', 'b', 'c', 'd']", "['a', 'X', 'b', 'c', 'd']",
+                       "{\"1+\":[\"X\"],\"3-\":[\"d\"]}");
+    checkComposedDelta("['a', 'b', 'c']", "['a', 'b']", "['a', 'b', 'Z']", "{\"2-\":[\"Z\"]}");
+    checkComposedDelta("[{id: 1}, {id: 2}, {id: 3}]", "[{id: 2}, {id: 3}, {id: 1}]",
+                       "[{id: 3}, {id: 1}, {id: 4}]", "{\"0-\":2,\"3+\":[0,{id:4}],\"3-\":[]}");
+    checkComposedDelta("[{id: 1, x: 1}, {id: 2}]", "[{id: 1, x: 2}, {id: 2}]",
+                       "[{id: 1, x: 3}, {id: 2}, {id: 5}]", "{\"0\":{x:3},\"2-\":[{id:5}]}");
+    checkComposedDelta("[{id: 1}, {id: 2}]", "[{id: 0}, {id: 1}, {id: 2}]",
+                       "[{id: 0, x: 1}, {id: 1}, {id: 2}]", "{\"0+\":[{id:0,x:1}]}");
+    // An array item that's modified, then moved, can't be composed:
+    checkComposedDelta("[{id: 1, x: 1}, {id: 2}, {id: 3}]", "[{id: 1, x: 2}, {id: 2}, {id: 3}]",
+                       "[{id: 2}, {id: 3}, {id: 1, x: 2}]", nullptr);
+    // Strings:
+    JSONDelta::gMinStringDiffLength = 36;
+    checkComposedDelta("'The fog comes in on little cat feet, it sits looking over harbor and city'",
+                       "'The dog comes in on little cat feet, it sits looking over harbor and city'",
+                       "'The dog comes in on big cat feet, it sits looking over the harbor and city'",
+                       "[\"4=1-1+d|15=6-3+big|31=4+ the|16=\",0,2]");
+    checkComposedDelta("'hi'",
+                       "'The dog comes in on little cat feet, it sits looking over harbor and city'",
+                       "'The dog comes in on big cat feet, it sits looking over the harbor and city'",
+                       "[\"The dog comes in on big cat feet, it sits looking over the harbor and city\"]");
+    JSONDelta::gMinStringDiffLength = 60;
+}
+
+
+TEST_CASE("Delta composition invalid", "[delta]") {
+    CHECK_THROWS_AS(JSONDelta::compose("{\"a\":1}"_sl, "[\"1=\",0,2]"_sl), FleeceException);
+    CHECK_THROWS_AS(JSONDelta::compose("[]"_sl, "{\"a\":1}"_sl), FleeceException);
+    CHECK_THROWS_AS(JSONDelta::compose("[\"3=\",0,2]"_sl, "[\"4=\",0,2]"_sl), FleeceException);
+    CHECK_THROWS_AS(JSONDelta::compose("{\"1-\":[]}"_sl, "{\"3\":1,\"0-\":1}"_sl),
+                    FleeceException);
+    // The second delta copies an item of an array the first one emptied:
+    CHECK_THROWS_AS(JSONDelta::compose("{\"0-\":[]}"_sl, "{\"0+\":[0]}"_sl), FleeceException);
+}
+
+
+TEST_CASE("Delta deletion of missing key", "[delta]") {
+    // A delta that deletes a key the value doesn't have was made from a different value:
+    Retained<Doc> doc = Doc::fromJSON("{\"a\":1,\"b\":{\"c\":2}}"_sl);
+    for (auto delta : {"{\"x\":[]}", "{\"b\":{\"x\":[]}}", "{\"x\":[0,0,0]}"}) {
+        INFO("Delta " << delta);
+        CHECK_THROWS_AS(JSONDelta::apply(doc->root(), slice(delta)), FleeceException);
+        Retained<MutableDict> md = MutableDict::newDict(doc->asDict());
+        CHECK_THROWS_AS(JSONDelta::applyInPlace(md, slice(delta)), FleeceException);
+    }
+    // ...unless it's a composed deletion, which may not know whether the key exists:
+    alloc_slice result = JSONDelta::apply(doc->root(), "{\"x\":[0,0,4],\"a\":[0,0,4]}"_sl);
+    CHECK(Value::fromData(result)->toJSONString() == "{\"b\":{\"c\":2}}");
+}
+
+
+TEST_CASE("Delta composition chain", "[delta]") {
+    // Makes a series of random edits to an array of strings, and collapses the deltas between
+    // revisions into a single delta from a base revision:
+    srandom(1234);
+    std::vector<std::string> items;
+    for (int i = 0; i < 20; ++i)
+        items.push_back(randomText(20));
+    auto encode = [&](int rev) {
+        Encoder enc;
+        enc.beginDictionary();
+        enc.writeKey("rev");
+        enc.writeInt(rev);
+        enc.writeKey("items");
+        enc.beginArray();
+        for (auto &item : items)
+            enc.writeString(item);
+        enc.endArray();
+        enc.endDictionary();
+        return enc.finishDoc();
+    };
+
+    Retained<Doc> base = encode(0), prev = base;
+    auto cached = MutableDict::newDict(base->root()->asDict());
+    alloc_slice composed;
+    unsigned nComposed = 0, nRestarts = 0;
+    for (int rev = 1; rev <= 100; ++rev) {
+        size_t pos = random() % items.size();
+        switch (random() % 4) {
+            case 0:
+                items.insert(items.begin() + pos, randomText(20));
+                break;
+            case 1:
+                if (items.size() > 1)
+                    items.erase(items.begin() + pos);
+                break;
+            case 2:
+                items[pos] = editText(items[pos], 1);
+                break;
+            case 3: {
+                std::string item = items[pos];
+                items.erase(items.begin() + pos);
+                items.insert(items.begin() + random() % (items.size() + 1), item);
+                break;
+            }
+        }
+        Retained<Doc> doc = encode(rev);
+        alloc_slice delta = JSONDelta::create(prev->root(), doc->root());
+        JSONDelta::applyInPlace(cached, delta);
+        if (!composed) {
+            composed = delta;
+        } else if (alloc_slice c = JSONDelta::compose(composed, delta); c) {
+            composed = c;
+            ++nComposed;
+        } else {
+            // Can't compose; the caller would apply the deltas so far, then start a new chain:
+            base = prev;
+            composed = delta;
+            ++nRestarts;
+        }
+        alloc_slice result = JSONDelta::apply(base->root(), composed);
+        INFO("rev " << rev << ": delta " << std::string(delta) << ", composed " << std::string(composed));
+        REQUIRE(Value::fromData(result)->toJSON() == doc->root()->toJSON());
+        prev = doc;
+    }
+    CHECK(nComposed > 4 * nRestarts);
+    CHECK(cached->toJSON(true) == prev->root()->toJSON(true));
+}
+
+
+TEST_CASE("Perf Delta composition", "[.Perf]") {
+    // Catching up a large document that's 50 revisions behind, by applying each delta in turn
+    // or by composing them and applying the result once:
+    srandom(1234);
+    std::vector<std::string> items;
+    for (int i = 0; i < 5000; ++i)
+        items.push_back(randomText(20));
+    auto encode = [&] {
+        Encoder enc;
+        enc.beginArray();
+        for (auto &item : items)
+            enc.writeString(item);
+        enc.endArray();
+        return enc.finishDoc();
+    };
+    Retained<Doc> base = encode(), prev = base;
+    std::vector<alloc_slice> deltas;
+    for (int rev = 1; rev <= 50; ++rev) {
+        size_t pos = random() % items.size();
+        if (rev % 2)
+            items[pos] = editText(items[pos], 1);
+        else
+            items.insert(items.begin() + pos, randomText(20));
+        Retained<Doc> doc = encode();
+        deltas.push_back(JSONDelta::create(prev->root(), doc->root()));
+        prev = doc;
+    }
+
+    Benchmark sequential, composed;
+    for (int i = 0; i < 20; ++i) {
+        sequential.start();
+        Retained<Doc> doc = base;
+        for (auto &delta : deltas)
+            doc = new Doc(JSONDelta::apply(doc->root(), delta), Doc::kTrusted);
+        sequential.stop();
+        CHECK(doc->root()->isEqual(prev->root()));
+
+        composed.start();
+        alloc_slice delta = deltas[0];
+        for (size_t d = 1; d < deltas.size(); ++d)
+            delta = JSONDelta::compose(delta, deltas[d]);
+        alloc_slice result = JSONDelta::apply(base->root(), delta);
+        composed.stop();
+        CHECK(Value::fromData(result)->isEqual(prev->root()));
+    }
+    fprintf(stderr, "Applying %zu deltas to a %zu-byte document:\n",
+            deltas.size(), size_t(base->data().size));
+    fprintf(stderr, "    one at a time: ");
+    sequential.printReport();
+    fprintf(stderr, "    composed:      ");
+    composed.printReport();
+}
+
+
+#pragma mark - FLEECE DELTAS:
+
+
+// Creates a FleeceDelta, checks that applying it to `v1` produces `v2`, and returns it.
+static alloc_slice checkFleeceDelta(const Value *v1, const Value *v2) {
+    alloc_slice delta = FleeceDelta::create(v1, v2);
+    REQUIRE(delta);
+    alloc_slice result = FleeceDelta::apply(v1, delta);
+    auto v2_reconstituted = Value::fromData(result);
+    INFO("value2 reconstituted:  " << toJSONString(v2_reconstituted) << " ;  should be:  "
+         << toJSONString(v2) << " ;  delta: " << toJSONString(Value::fromData(delta)));
+    if (v2)
+        CHECK(v2_reconstituted->isEqual(v2));
+    else
+        CHECK(v2_reconstituted->isUndefined());
+    return delta;
+}
+
+static void checkFleeceDelta(const char *json1, const char *json2, const char *deltaExpected) {
+    Retained<Doc> doc1 = Doc::fromJSON(ConvertJSON5(std::string("[") + json1 + "]"));
+    Retained<Doc> doc2 = Doc::fromJSON(ConvertJSON5(std::string("[") + json2 + "]"));
+    alloc_slice delta = checkFleeceDelta(doc1->root()->asArray()->get(0),
+                                         doc2->root()->asArray()->get(0));
+    CHECK(Value::fromData(delta)->toJSONString() == std::string(deltaExpected));
+}
+
+
+TEST_CASE("FleeceDelta", "[delta]") {
+    checkFleeceDelta("5", "5", "{}");
+    checkFleeceDelta("5", "'five'", "\"five\"");
+    checkFleeceDelta("{}", "[]", "[0,[]]");
+    checkFleeceDelta("{a: 1, b: 2}", "{a: 1, b: 3}", "{\"b\":3}");
+    checkFleeceDelta("{a: 1, b: 2}", "{a: 1}", "{\"b\":[]}");
+    checkFleeceDelta("{a: 1}", "{a: 1, c: {d: 4}}", "{\"c\":[0,{\"d\":4}]}");
+    checkFleeceDelta("{a: {b: {c: 1}}}", "{a: {b: {c: 2}}}", "{\"a\":{\"b\":{\"c\":2}}}");
+    checkFleeceDelta("[1, 2, 3]", "[1, 9, 3]", "[2,3,null,1,9]");
+    checkFleeceDelta("[1, 2, 3]", "[1, 2, 3, 4, 5]", "[2,3,[4,5]]");
+    checkFleeceDelta("[1, 2, 3, 4, 5]", "[1, 2]", "[2,2,null]");
+    checkFleeceDelta("[1, [21, 22], 3]", "[1, [21, 222], 3]", "[2,3,null,1,[2,2,null,1,222]]");
+    checkFleeceDelta("{list: [1, 2]}", "{list: [1, 2, {x: 1}]}", "{\"list\":[2,2,[{\"x\":1}]]}");
+
+    JSONDelta::gMinStringDiffLength = 36;
+    checkFleeceDelta("'to wound the autumnal city. The in-dark answered with the wind.'",
+                     "'to wound the autumnal city. So howled out for the world to give him a name. The in-dark answered with the wind.'",
+                     // (The inserted data is shown in base64)
+                     "[1,28,0,\"U28gaG93bGVkIG91dCBmb3IgdGhlIHdvcmxkIHRvIGdpdmUgaGltIGEgbmFtZS4g\"]");
+    JSONDelta::gMinStringDiffLength = 60;
+
+    // Deleting the root value:
+    Retained<Doc> doc = Doc::fromJSON("[1,2]");
+    (void)checkFleeceDelta(doc->root(), nullptr);
+}
+
+
+TEST_CASE("FleeceDelta invalid", "[delta]") {
+    Retained<Doc> doc = Doc::fromJSON("{\"a\":[1,2,3],\"s\":\"hello\"}");
+    for (const char *json : {"{\"a\":[9]}", "{\"a\":[2,4,null]}", "{\"a\":[2,2,null,5,0]}",
+                             "{\"s\":[1,3,9,\"\"]}", "{\"a\":[0]}", "{\"q\":{\"x\":1}}"}) {
+        INFO("Delta: " << json);
+        Retained<Doc> deltaDoc = Doc::fromJSON(json);
+        CHECK_THROWS_AS(FleeceDelta::apply(doc->root(), deltaDoc->allocedData()),
+                        FleeceException);
+    }
+    CHECK_THROWS_AS(FleeceDelta::apply(doc->root(), "not fleece"_sl), FleeceException);
+}
+
+
+TEST_CASE("FleeceDelta JSONDiffPatch test suite", "[delta]") {
+    auto input = readTestFile("DeltaTests.json5");
+    Retained<Doc> testDoc = Doc::fromJSON(ConvertJSON5(std::string(input)));
+    const Dict *testSuites = testDoc->root()->asDict();
+    REQUIRE(testSuites);
+    for (Dict::iterator i_suite(testSuites); i_suite; ++i_suite) {
+        for (Array::iterator i_test(i_suite.value()->asArray()); i_test; ++i_test) {
+            const Dict *test = i_test.value()->asDict();
+            if (!test)
+                continue;
+            auto left = test->get("left"_sl), right = test->get("right"_sl);
+            if (left && right) {
+                (void)checkFleeceDelta(left, right);
+                (void)checkFleeceDelta(right, left);
+            }
+        }
+    }
+}
+
+
+TEST_CASE("Perf FleeceDelta vs JSONDelta", "[.Perf]") {
+    auto input = readTestFile("DeltaTests.json5");
+    Retained<Doc> testDoc = Doc::fromJSON(ConvertJSON5(std::string(input)));
+    const Dict *testSuites = testDoc->root()->asDict();
+    REQUIRE(testSuites);
+    std::vector<std::pair<const Value*,const Value*>> pairs;
+    for (Dict::iterator i_suite(testSuites); i_suite; ++i_suite) {
+        for (Array::iterator i_test(i_suite.value()->asArray()); i_test; ++i_test) {
+            if (const Dict *test = i_test.value()->asDict()) {
+                auto left = test->get("left"_sl), right = test->get("right"_sl);
+                if (left && right) {
+                    pairs.emplace_back(left, right);
+                    pairs.emplace_back(right, left);
+                }
+            }
+        }
+    }
+
+    std::vector<alloc_slice> jsonDeltas(pairs.size()), fleeceDeltas(pairs.size());
+    Benchmark jsonCreate, fleeceCreate, jsonApply, fleeceApply;
+    for (int rep = 0; rep < 50; ++rep) {
+        jsonCreate.start();
+        for (size_t i = 0; i < pairs.size(); ++i)
+            jsonDeltas[i] = JSONDelta::create(pairs[i].first, pairs[i].second);
+        jsonCreate.stop();
+        fleeceCreate.start();
+        for (size_t i = 0; i < pairs.size(); ++i)
+            fleeceDeltas[i] = FleeceDelta::create(pairs[i].first, pairs[i].second);
+        fleeceCreate.stop();
+        jsonApply.start();
+        for (size_t i = 0; i < pairs.size(); ++i)
+            (void)JSONDelta::apply(pairs[i].first, jsonDeltas[i]);
+        jsonApply.stop();
+        fleeceApply.start();
+        for (size_t i = 0; i < pairs.size(); ++i)
+            (void)FleeceDelta::apply(pairs[i].first, fleeceDeltas[i]);
+        fleeceApply.stop();
+    }
+
+    size_t jsonSize = 0, fleeceSize = 0;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        jsonSize += jsonDeltas[i].size;
+        fleeceSize += fleeceDeltas[i].size;
+    }
+    fprintf(stderr, "%zu deltas: JSON %zu bytes, Fleece %zu bytes\n",
+            pairs.size(), jsonSize, fleeceSize);
+    double scale = 1.0 / pairs.size();
+    fprintf(stderr, "Create, JSON:   ");  jsonCreate.printReport(scale, "delta");
+    fprintf(stderr, "Create, Fleece: ");  fleeceCreate.printReport(scale, "delta");
+    fprintf(stderr, "Apply, JSON:    ");  jsonApply.printReport(scale, "delta");
+    fprintf(stderr, "Apply, Fleece:  ");  fleeceApply.printReport(scale, "delta");
+}
+
+
 // Based on utf8_check.c by Markus Kuhn, 2005
 // https://www.cl.cam.ac.uk/~mgk25/ucs/utf8_check.c
 static bool isValidUTF8(fleece::slice sl) noexcept
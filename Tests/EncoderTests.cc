@@ -14,6 +14,12 @@
 #include "Pointer.hh"
 #include "JSONConverter.hh"
 #include "Path.hh"
+#include "PathIndex.hh"
+#include "PathProjection.hh"
+#include "DeepIterator.hh"
+#include "ArrayKernels.hh"
+#include "Doc.hh"
+#include "SharedKeys.hh"
 #include "Internal.hh"
 #include "NumConversion.hh"
 #include <iostream>
@@ -834,6 +840,272 @@ public:
 #endif
     }
 
+    TEST_CASE_METHOD(EncoderTests, "Path projection", "[Encoder]") {
+        auto input = readTestFile(kBigJSONTestFileName);
+        JSONConverter jr(enc);
+        jr.encodeJSON(input);
+        enc.end();
+        alloc_slice fleeceData = enc.finish();
+        const Value *root = Value::fromData(fleeceData);
+
+        const char* specs[] = {"[32].name", "[32].friends[1].name", "[32].friends[1].id",
+                               "[32].friends[-1].name", "[32]", "[-1].name", "[32].name",
+                               "[32].tags[0]", "[32].nosuchkey", "[32].name.oops", "[32][0]",
+                               "[9999].name", "[32].friends[99].name", ""};
+        std::vector<Path> paths;
+        for (auto spec : specs)
+            paths.push_back(*spec ? Path(spec) : Path());   // "" means the root
+        CHECK(paths[6] == paths[0]);                    // Equal paths are merged by projection
+        CHECK(paths[7] != paths[0]);
+        CHECK(Path("[32].friends[1]") != Path("[32].friends.x"));
+        PathProjection projection(paths);
+        REQUIRE(projection.size() == paths.size());
+
+        std::vector<const Value*> values(projection.size(), (const Value*)-1);
+        for (int pass = 0; pass < 2; ++pass) {       // 2nd pass uses cached shared-key hints
+            projection.eval(root, values.data());
+            for (size_t i = 0; i < paths.size(); ++i) {
+                INFO("Path " << specs[i]);
+                CHECK(values[i] == paths[i].eval(root));
+            }
+        }
+        CHECK(values[0]->asString() == "Mendez Tran"_sl);
+        CHECK(values[6] == values[0]);
+        CHECK(values[8] == nullptr);
+        CHECK(values[13] == root);
+
+        CHECK(projection.addPath("[32].friends[1].name"_sl) == paths.size());
+        values.resize(projection.size());
+        projection.eval(root->asArray()->get(0), values.data());
+        for (size_t i = 0; i < values.size(); ++i) {
+            INFO("Path " << i);
+            CHECK(values[i] == (i == 13 ? root->asArray()->get(0) : nullptr));
+        }
+
+        projection.eval(nullptr, values.data());
+        for (auto value : values)
+            CHECK(value == nullptr);
+    }
+
+    TEST_CASE("Path index", "[Encoder]") {
+        Retained<SharedKeys> sk = new SharedKeys();
+        Retained<Doc> doc = Doc::fromJSON(readTestFile(kBigJSONTestFileName), sk);
+        const Value *root = doc->root();
+        alloc_slice indexData = PathIndex::build(root, doc->data());
+        PathIndex index(indexData, doc->data());
+        CHECK(index.root() == root);
+
+        // Every value can be found by its path:
+        size_t count = 0;
+        for (PreorderIterator i(root); i; ++i, ++count) {
+            char buf[256];
+            slice_ostream out(buf, sizeof(buf));
+            REQUIRE(i.writePath(out));
+            Path path = out.bytesWritten() ? Path(out.output()) : Path();    // root's path is ""
+            INFO("Path " << std::string(path));
+            REQUIRE(index.get(path) == i.value());
+            REQUIRE(path.eval(index) == i.value());
+        }
+        CHECK(index.count() == count);
+
+        // Paths the index can't answer fall back to regular evaluation:
+        for (auto spec : {"[32].name", "[-1].name", "[32].friends[-1].name", "[32].nosuchkey",
+                          "[32].name.oops", "[32][0]", "[9999].name", "[*].name",
+                          "[32].tags[1:].x", "..guid"}) {
+            INFO("Path " << spec);
+            Path path(spec);
+            CHECK(path.eval(index) == path.eval(root));
+        }
+        CHECK(index.get(Path("[-1].name")) == nullptr);
+        CHECK(index.get(Path("[*].name")) == nullptr);
+        CHECK(index.get(Path("[32].nosuchkey")) == nullptr);
+        CHECK(index.get(Path()) == root);
+
+        // An index only works with the data it was built from:
+        CHECK_THROWS_AS(PathIndex(indexData, doc->data().upTo(doc->data().size - 2)),
+                        FleeceException);
+        CHECK_THROWS_AS(PathIndex(indexData.upTo(indexData.size - 1), doc->data()),
+                        FleeceException);
+        CHECK_THROWS_AS(PathIndex(doc->data(), doc->data()), FleeceException);
+        CHECK_THROWS_AS(PathIndex::build(root, indexData), FleeceException);
+
+        // A corrupt index with no empty slots, which would make lookups loop forever, is rejected:
+        alloc_slice corrupt = alloc_slice(slice(indexData));    // (a copy)
+        auto entries = (uint8_t*)corrupt.buf + 5 * sizeof(uint32_t);
+        for (size_t pos = 0; pos < corrupt.size - 5 * sizeof(uint32_t); pos += 12)
+            memset(entries + pos, 0x55, sizeof(uint64_t));
+        CHECK_THROWS_AS(PathIndex(corrupt, doc->data()), FleeceException);
+    }
+
+    static std::string allMatches(const Path &path, const Value *root) {
+        std::string result;
+        path.forEachMatch(root, [&](const Value *match) {
+            if (!result.empty())
+                result += ' ';
+            result += match->toJSONString();
+            return true;
+        });
+        return result;
+    }
+
+    TEST_CASE("Path wildcards", "[Encoder]") {
+        auto doc = Doc::fromJSON(json5(
+            "{orders: [{id: 1, items: [{sku: 'a', n: 2}, {sku: 'b'}]},"
+                      "{id: 2, items: []},"
+                      "{id: 3, items: [{sku: 'c', sub: {sku: 'd'}}]}],"
+             "events: [0, 1, 2, 3, 4, 5],"
+             "'*': 'star'}"));
+        const Value *root = doc->root();
+
+        auto check = [&](const char *spec, const char *expected, const char *asString) {
+            INFO("Path " << spec);
+            Path path(spec);
+            CHECK(!path.isLiteral());
+            CHECK(allMatches(path, root) == expected);
+            CHECK(std::string(path) == asString);
+            CHECK(Path(std::string(path)) == path);
+            // eval returns the first match:
+            const Value *first = path.eval(root);
+            std::string expectedFirst = std::string(expected).substr(0, std::string(expected).find(' '));
+            CHECK((first ? first->toJSONString() : "") == expectedFirst);
+            CHECK(Path::eval(slice(spec), root) == first);
+        };
+
+        check("orders[*].items[*].sku", R"("a" "b" "c")", "orders[*].items[*].sku");
+        check("orders.*.id", "1 2 3", "orders[*].id");
+        check("orders[*].items[0].n", "2", "orders[*].items[0].n");
+        check("events[-2:]", "4 5", "events[-2:]");
+        check("events[1:3]", "1 2", "events[1:3]");
+        check("events[:-4]", "0 1", "events[:-4]");
+        check("events[4:2]", "", "events[4:2]");
+        check("events[-100:100]", "0 1 2 3 4 5", "events[-100:100]");  // clamped
+        check("$..sku", R"("a" "b" "c" "d")", "..sku");
+        check("orders[2]..sku", R"("c" "d")", "orders[2]..sku");
+        check("events..[0]", "0", "events..[0]");
+        check("orders[0].items[*].*", R"(2 "a" "b")", "orders[0].items[*][*]");
+        check("orders[1].items[*]", "", "orders[1].items[*]");
+        check("events[0][*]", "", "events[0][*]");
+
+        // Escaped '*' is a property name:
+        Path star("\\*");
+        CHECK(star.isLiteral());
+        CHECK(star.eval(root)->asString() == "star"_sl);
+        CHECK(std::string(star) == "\\*");
+        CHECK(Path("orders[0].id").isLiteral());
+
+        // Stopping early:
+        int n = 0;
+        CHECK(!Path("events[*]").forEachMatch(root, [&](const Value*) {return ++n < 3;}));
+        CHECK(n == 3);
+
+        // Step-by-step construction:
+        Path built;
+        built.addProperty("orders");
+        built.addWildcard();
+        built.addDescendants();
+        built.addProperty("sku");
+        CHECK(built == Path("orders[*]..sku"));
+        built = Path();
+        built.addProperty("events");
+        built.addSlice(2, 4);
+        CHECK(allMatches(built, root) == "2 3");
+
+        for (auto bad : {"events[1:2:3]", "events[x:]", "a...b"}) {
+            INFO("Path " << bad);
+            CHECK_THROWS_AS(Path{slice(bad)}, FleeceException);
+        }
+        CHECK_THROWS_AS(PathProjection().addPath("orders[*].id"_sl), FleeceException);
+    }
+
+    TEST_CASE("Array kernels", "[Encoder]") {
+        // Enough items for several batches, ending with a partial one:
+        const size_t kCount = 3 * ArrayKernels::kBatchSize + 77;
+        std::stringstream json;
+        json << "[";
+        for (size_t i = 0; i < kCount; ++i) {
+            if (i > 0) json << ",";
+            if (i % 10 == 3)
+                json << R"({"name":"x"})";                         // missing
+            else if (i % 10 == 7)
+                json << R"({"stats":{"price":"cheap"}})";          // not a number
+            else if (i % 2)
+                json << R"({"stats":{"price":)" << (int(i) - 500) << "}}";
+            else
+                json << R"({"stats":{"price":)" << (double(i) + 0.5) << "}}";
+        }
+        json << "]";
+        auto doc = Doc::fromJSON(json.str());
+        const Array *rows = doc->root()->asArray();
+        REQUIRE(rows->count() == kCount);
+        Path path("stats.price");
+
+        // Compute the expected results one item at a time:
+        NumericSummary expected;
+        std::vector<double> prices;
+        for (Array::iterator i(rows); i; ++i) {
+            const Value *price = path.eval(i.value());
+            bool valid = price && price->type() == kNumber;
+            prices.push_back(valid ? price->asDouble() : NAN);
+            if (valid) {
+                ++expected.count;
+                expected.sum += prices.back();
+                expected.min = std::min(expected.min, prices.back());
+                expected.max = std::max(expected.max, prices.back());
+            }
+        }
+
+        NumericSummary summary = ArrayKernels::summarize(rows, path);
+        CHECK(summary.count == expected.count);
+        CHECK(summary.sum == expected.sum);      // (exact, since the values are x or x.5)
+        CHECK(summary.min == -499);
+        CHECK(summary.max == expected.max);
+        CHECK(summary.average() == expected.sum / expected.count);
+
+        auto check = [&](ArrayKernels::Comparison op, double operand, auto cmp) {
+            INFO("Comparison " << int(op) << " with " << operand);
+            std::vector<uint64_t> bitmap = ArrayKernels::select(rows, path, op, operand);
+            REQUIRE(bitmap.size() == (kCount + 63) / 64);
+            size_t nMatches = 0;
+            for (size_t i = 0; i < bitmap.size() * 64; ++i) {
+                bool expectedBit = i < kCount && prices[i] == prices[i] && cmp(prices[i], operand);
+                bool bit = (bitmap[i / 64] >> (i % 64)) & 1;
+                if (bit != expectedBit)
+                    FAIL("Wrong bit for item " << i);
+                nMatches += bit;
+            }
+            std::vector<uint64_t> bitmap2(bitmap.size());
+            CHECK(ArrayKernels::select(rows, path, op, operand, bitmap2.data()) == nMatches);
+            CHECK(bitmap2 == bitmap);
+        };
+        check(ArrayKernels::kEqual, 1.5, [](double a, double b) {return a == b;});
+        check(ArrayKernels::kNotEqual, 1.5, [](double a, double b) {return a != b;});
+        check(ArrayKernels::kLess, 0, [](double a, double b) {return a < b;});
+        check(ArrayKernels::kLessOrEqual, -99, [](double a, double b) {return a <= b;});
+        check(ArrayKernels::kGreater, 600.5, [](double a, double b) {return a > b;});
+        check(ArrayKernels::kGreaterOrEqual, 1e9, [](double a, double b) {return a >= b;});
+
+        // Nothing to find:
+        summary = ArrayKernels::summarize(rows, Path("name"));
+        CHECK(summary.count == 0);
+        CHECK(summary.sum == 0);
+        CHECK(std::isnan(summary.average()));
+        summary = ArrayKernels::summarize(nullptr, path);
+        CHECK(summary.count == 0);
+        CHECK(ArrayKernels::select(nullptr, path, ArrayKernels::kLess, 0).empty());
+
+        // An array of numbers, with the empty path:
+        auto numbers = Doc::fromJSON("[3, 1, 4, 1, 5, 9, 2, 6]"_sl);
+        summary = ArrayKernels::summarize(numbers->root()->asArray(), Path());
+        CHECK(summary.count == 8);
+        CHECK(summary.sum == 31);
+        CHECK(summary.min == 1);
+        CHECK(summary.max == 9);
+        CHECK(ArrayKernels::select(numbers->root()->asArray(), Path(), ArrayKernels::kGreater, 3)
+              == std::vector<uint64_t>{0b10110100});
+
+        CHECK_THROWS_AS(ArrayKernels::summarize(rows, Path("stats.*")), FleeceException);
+    }
+
     TEST_CASE_METHOD(EncoderTests, "Resuse Encoder", "[Encoder]") {
         enc.beginDictionary();
         enc.writeKey("foo");
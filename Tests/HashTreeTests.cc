@@ -13,11 +13,14 @@
 
 #include "FleeceTests.hh"
 #include "MutableHashTree.hh"
+#include "HashTreeBuilder.hh"
+#include "BloomFilter.hh"
 #include "HashTree+Internal.hh"     // for ComputeHash
 #include "Doc.hh"
 #include "fleece/PlatformCompat.hh"
 #include "fleece/Expert.hh"
 #include <iostream>
+#include <map>
 #include <set>
 
 using namespace std;
@@ -56,6 +59,18 @@ public:
         }
     }
 
+    // Like createItems, but skips keys whose hashes collide with earlier ones. (Neither
+    // MutableHashTree nor the tree format handle hash collisions yet, and a million keys is
+    // bound to have some.)
+    void createUniqueItems(size_t N) {
+        createItems(N);
+        set<hashtree::hash_t> hashes;
+        erase_if(keys, [&](slice key) {
+            return !hashes.insert(hashtree::ComputeHash(key) & 0x3FFFFFFF).second;
+        });
+        fprintf(stderr, "Using %zu keys\n", keys.size());
+    }
+
     void insertItems(size_t N =0, bool verbose= false, bool check =false) {
         if (N == 0)
             N = keys.size();
@@ -258,6 +273,33 @@ TEST_CASE_METHOD(HashTreeTests, "Tiny HashTree Mutate", "[HashTree]") {
 }
 
 
+TEST_CASE_METHOD(HashTreeTests, "Empty HashTree Mutate", "[HashTree]") {
+    // Removing every key leaves a root node with no children:
+    createItems(10);
+    insertItems();
+    for (int i = 0; i < 10; i++)
+        CHECK(tree.remove(keys[i]));
+    alloc_slice data = encodeTree();
+    const HashTree *itree = HashTree::fromData(data);
+    CHECK(itree->count() == 0);
+    CHECK(!itree->get(keys[0]));
+    itree->dump(cerr);
+
+    // Wrap in a MutableHashTree and insert into it:
+    tree = itree;
+    CHECK(tree.count() == 0);
+    tree.set(keys[3], values.get(3));
+    tree.set(keys[4], values.get(4));
+    CHECK(tree.count() == 2);
+    CHECK(tree.get(keys[3]).asInt() == 3);
+
+    alloc_slice newData = encodeTree();
+    itree = HashTree::fromData(newData);
+    CHECK(itree->count() == 2);
+    CHECK(itree->get(keys[4]).asInt() == 4);
+}
+
+
 TEST_CASE_METHOD(HashTreeTests, "Bigger HashTree Mutate by replacing", "[HashTree]") {
     createItems(100);
     insertItems(100);
@@ -354,6 +396,204 @@ TEST_CASE_METHOD(HashTreeTests, "HashTree Re-Encode Delta", "[HashTree]") {
 }
 
 
+TEST_CASE_METHOD(HashTreeTests, "MutableHashTree applyBatch", "[HashTree]") {
+    static const unsigned N = 5000;
+    createItems(N);
+    insertItems(N / 2);
+    alloc_slice data = encodeTree();
+    tree = HashTree::fromData(data);
+
+    // Overwrite the existing keys, add new ones, then remove every 5th key and re-add every
+    // 15th. The same key often appears more than once, so order within the batch matters.
+    vector<MutableHashTree::BatchOp> ops;
+    for (unsigned i = 0; i < N; i++)
+        ops.push_back({keys[i], values.get(uint32_t(N - 1 - i))});
+    for (unsigned i = 0; i < N; i += 5)
+        ops.push_back({keys[i], nullptr});
+    for (unsigned i = 0; i < N; i += 15)
+        ops.push_back({keys[i], values.get(uint32_t(i))});
+
+    MutableHashTree expected(HashTree::fromData(data));
+    for (auto &op : ops)
+        expected.set(op.key, op.value);
+
+    bool parallel = GENERATE(false, true);
+    tree.applyBatch(ops, parallel);
+    CHECK(tree.count() == expected.count());
+    for (unsigned i = 0; i < N; i++)
+        CHECK(tree.get(keys[i]) == expected.get(keys[i]));
+
+    Encoder enc;
+    expert(enc).suppressTrailer();
+    expected.writeTo(enc);
+    CHECK(encodeTree() == enc.finish());
+
+    // A small batch is applied in place:
+    tree.applyBatch(span(ops).first(10), parallel);
+    for (unsigned i = 0; i < 10; i++)
+        expected.set(ops[i].key, ops[i].value);
+    CHECK(tree.count() == expected.count());
+}
+
+
+TEST_CASE_METHOD(HashTreeTests, "HashTree Diff", "[HashTree]") {
+    static const unsigned N = 1000;
+    createItems(N + 20);
+    insertItems(N);
+
+    alloc_slice data = encodeTree();
+    tree = HashTree::fromData(data);
+
+    // Make some changes: add keys N..N+19, change every 100th value, remove every 77th key.
+    map<alloc_slice, pair<int64_t,int64_t>> expected;     // key -> (old value, new value)
+    for (unsigned i = N; i < N + 20; i++) {
+        tree.set(keys[i], values.get(uint32_t(i)));
+        expected[keys[i]] = {-1, i};
+    }
+    for (unsigned i = 50; i < N; i += 100) {
+        tree.set(keys[i], values.get(uint32_t(i + 1)));
+        expected[keys[i]] = {i, i + 1};
+    }
+    for (unsigned i = 0; i < N; i += 77) {
+        CHECK(tree.remove(keys[i]));
+        expected[keys[i]] = {i, -1};
+    }
+    tree.set(keys[1], values.get(1));           // Setting an equal value isn't a change
+
+    auto diffTrees = [&](const HashTree &older, const HashTree &newer) {
+        map<alloc_slice, pair<int64_t,int64_t>> changes;
+        newer.diff(older, [&](slice key, Value oldValue, Value newValue) {
+            auto entry = make_pair(oldValue ? oldValue.asInt() : -1,
+                                   newValue ? newValue.asInt() : -1);
+            CHECK(changes.emplace(key, entry).second);   // no key is reported twice
+        });
+        return changes;
+    };
+
+    SECTION("Appended") {
+        Encoder enc;
+        expert(enc).amend(data, false);
+        expert(enc).suppressTrailer();
+        tree.writeTo(enc);
+        alloc_slice delta = enc.finish();
+
+        alloc_slice total(data.size + delta.size);
+        memcpy((void*)&total[0],         data.buf, data.size);
+        memcpy((void*)&total[data.size], delta.buf, delta.size);
+        const HashTree *older = HashTree::fromData(total.upTo(data.size));
+        const HashTree *newer = HashTree::fromData(total);
+
+        CHECK(diffTrees(*older, *newer) == expected);
+        CHECK(diffTrees(*newer, *newer).empty());
+
+        // Reversing the trees swaps additions and removals:
+        auto reversed = diffTrees(*newer, *older);
+        CHECK(reversed.size() == expected.size());
+        for (auto &[key, values] : reversed)
+            CHECK(expected[key] == make_pair(values.second, values.first));
+    }
+    SECTION("Separate") {
+        // Trees that share no nodes can still be diffed, just more slowly:
+        alloc_slice newData = encodeTree();
+        CHECK(diffTrees(*HashTree::fromData(data), *HashTree::fromData(newData)) == expected);
+    }
+}
+
+
+TEST_CASE_METHOD(HashTreeTests, "HashTreeBuilder", "[HashTree]") {
+    static const unsigned N = 5000;
+    createItems(N);
+    insertItems();
+    alloc_slice expected = encodeTree();
+
+    // Add the keys in a different order, with some duplicates whose first values get replaced:
+    HashTreeBuilder builder;
+    for (unsigned i = 0; i < N; i += 7)
+        builder.add(keys[i], values.get(0));
+    for (unsigned i = N; i-- > 0; )
+        builder.add(keys[i], values.get(uint32_t(i)));
+    CHECK(builder.count() == N + (N + 6) / 7);
+
+    bool parallel = GENERATE(false, true);
+    Encoder enc;
+    expert(enc).suppressTrailer();
+    builder.writeTo(enc, parallel);
+    alloc_slice data = enc.finish();
+    CHECK(builder.count() == 0);
+
+    // The builder should produce exactly the same tree as MutableHashTree:
+    CHECK(data == expected);
+
+    const HashTree *itree = HashTree::fromData(data);
+    CHECK(itree->count() == N);
+    for (unsigned i = 0; i < N; i++)
+        CHECK(itree->get(keys[i]).asInt() == int64_t(i));
+}
+
+
+TEST_CASE("HashTreeBuilder Empty", "[HashTree]") {
+    HashTreeBuilder builder;
+    Encoder enc;
+    CHECK(builder.writeTo(enc) == 0);
+}
+
+
+TEST_CASE_METHOD(HashTreeTests, "BloomFilterBuilder", "[HashTree]") {
+    static const unsigned N = 5000;
+    createItems(2 * N);             // the second half are keys that won't be added
+    hashtree::BloomFilterBuilder filter(N, 10);
+    CHECK(filter.blockCount() == (N * 10 + 511) / 512);
+    for (unsigned i = 0; i < N; i++)
+        filter.add(hashtree::ComputeHash(keys[i]));
+
+    // No false negatives, and few false positives:
+    unsigned falsePositives = 0;
+    for (unsigned i = 0; i < 2 * N; i++) {
+        bool present = filter.mayContain(hashtree::ComputeHash(keys[i]));
+        if (i < N)
+            CHECK(present);
+        else
+            falsePositives += present;
+    }
+    CHECK(falsePositives < N * 3 / 100);
+}
+
+
+TEST_CASE_METHOD(HashTreeTests, "BloomFilterBuilder Changed Blocks", "[HashTree]") {
+    static const unsigned N = 1000;
+    createItems(N);
+    hashtree::BloomFilterBuilder filter(N, 10);
+    CHECK(filter.blockCount() == (N * 10 + 511) / 512);
+    for (unsigned i = 0; i < N / 2; i++)
+        filter.add(hashtree::ComputeHash(keys[i]));
+    CHECK(filter.changedBlocks().size() == filter.blockCount());
+
+    // Adding a few more keys changes only their blocks:
+    filter.clearChangedBlocks();
+    CHECK(filter.changedBlocks().empty());
+    filter.add(hashtree::ComputeHash(keys[N / 2]));
+    filter.add(hashtree::ComputeHash(keys[N / 2 + 1]));
+    CHECK(filter.changedBlocks().size() >= 1);
+    CHECK(filter.changedBlocks().size() <= 2);
+
+    // A copy made from the old blocks, plus the changed ones, matches:
+    filter.clearChangedBlocks();
+    hashtree::BloomFilterBuilder copy(filter.blockData());
+    CHECK(copy.blockCount() == filter.blockCount());
+    for (unsigned i = N / 2 + 2; i < N; i++)
+        filter.add(hashtree::ComputeHash(keys[i]));
+    uint8_t block[hashtree::BloomFilter::kBlockSize];
+    for (uint32_t index : filter.changedBlocks()) {
+        filter.readBlock(index, block);
+        copy.writeBlock(index, block);
+    }
+    CHECK(copy.changedBlocks().empty());
+    CHECK(copy.blockData() == filter.blockData());
+    for (unsigned i = 0; i < N; i++)
+        CHECK(copy.mayContain(hashtree::ComputeHash(keys[i])));
+}
+
+
 #if 0 // currently throws an exception; debug this later --jens Feb 2020
 TEST_CASE("Perf TreeSearch", "[.Perf]") {
     static const int kSamples = 500000;
@@ -405,3 +645,129 @@ TEST_CASE("Perf TreeSearch", "[.Perf]") {
     bench.printReport();
 }
 #endif
+
+
+#if !FL_EMBEDDED
+TEST_CASE_METHOD(HashTreeTests, "Perf MutableHashTree Insert", "[.Perf]") {
+    static const unsigned N = 1000000;
+    createUniqueItems(N);
+    Benchmark insertBench, removeBench, writeBench, freeBench;
+    for (int run = 0; run < 5; run++) {
+        insertBench.start();
+        for (size_t i = 0; i < keys.size(); i++)
+            tree.set(keys[i], values.get(uint32_t(i)));
+        insertBench.stop();
+
+        removeBench.start();
+        for (size_t i = 0; i < keys.size(); i += 4)
+            tree.remove(keys[i]);
+        removeBench.stop();
+
+        writeBench.start();
+        alloc_slice data = encodeTree();
+        writeBench.stop();
+
+        freeBench.start();
+        tree = MutableHashTree();
+        freeBench.stop();
+    }
+    fprintf(stderr, "Insert: "); insertBench.printReport(1.0 / keys.size(), "key");
+    fprintf(stderr, "Remove: "); removeBench.printReport(4.0 / keys.size(), "key");
+    fprintf(stderr, "Write:  "); writeBench.printReport();
+    fprintf(stderr, "Free:   "); freeBench.printReport();
+}
+
+
+TEST_CASE_METHOD(HashTreeTests, "Perf MutableHashTree applyBatch", "[.Perf]") {
+    static const unsigned N = 1000000, kBatchSize = 100000;
+    createUniqueItems(N);
+    for (size_t i = 0; i < keys.size(); i += 2)
+        tree.set(keys[i], values.get(uint32_t(i)));
+    alloc_slice data = encodeTree();
+
+    // A batch of sets and removes scattered across the tree:
+    vector<MutableHashTree::BatchOp> ops;
+    for (size_t i = 0; i < kBatchSize; i++) {
+        size_t k = (i * 7919) % keys.size();
+        ops.push_back({keys[k], (i % 4) ? values.get(uint32_t(k)) : Value()});
+    }
+
+    for (bool parallel : {false, true}) {
+        Benchmark bench;
+        for (int run = 0; run < 5; run++) {
+            tree = HashTree::fromData(data);
+            bench.start();
+            tree.applyBatch(ops, parallel);
+            bench.stop();
+        }
+        fprintf(stderr, "applyBatch%s: ", (parallel ? " (parallel)" : ""));
+        bench.printReport(1.0 / kBatchSize, "op");
+    }
+}
+
+
+TEST_CASE_METHOD(HashTreeTests, "Perf HashTree Bloom Filter", "[.Perf]") {
+    static const unsigned N = 1000000;
+    createUniqueItems(N);
+    size_t nKeys = keys.size() / 2;     // the other half are misses
+    HashTreeBuilder builder;
+    hashtree::BloomFilterBuilder filter(nKeys, 10);
+    for (size_t i = 0; i < nKeys; i++) {
+        builder.add(keys[i], values.get(uint32_t(i)));
+        filter.add(hashtree::ComputeHash(keys[i]));
+    }
+    Encoder enc;
+    expert(enc).suppressTrailer();
+    builder.writeTo(enc);
+    alloc_slice data = enc.finish();
+    const HashTree *itree = HashTree::fromData(data);
+
+    const hashtree::BloomFilterBuilder* filters[] = {nullptr, &filter};
+    for (auto f : filters) {
+        for (bool hits : {true, false}) {
+            Benchmark bench;
+            for (int s = 0; s < 20; s++) {
+                bench.start();
+                for (size_t i = 0; i < nKeys; i++) {
+                    slice key = keys[hits ? i : nKeys + i];
+                    bool found = (!f || f->mayContain(hashtree::ComputeHash(key)))
+                                    && itree->get(key);
+                    if (found != hits)
+                        abort();
+                }
+                bench.stop();
+            }
+            fprintf(stderr, "%s, %s filter: ", (hits ? "Hits  " : "Misses"),
+                    (f ? "with   " : "without"));
+            bench.printReport(1.0 / nKeys, "lookup");
+        }
+    }
+}
+
+
+TEST_CASE_METHOD(HashTreeTests, "Perf HashTreeBuilder", "[.Perf]") {
+    static const unsigned N = 1000000;
+    createUniqueItems(N);
+    Stopwatch st;
+    for (size_t i = 0; i < keys.size(); i++)
+        tree.set(keys[i], values.get(uint32_t(i)));
+    alloc_slice treeData = encodeTree();
+    double treeTime = st.elapsed();
+
+    for (bool parallel : {false, true}) {
+        st.reset();
+        HashTreeBuilder builder;
+        builder.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); i++)
+            builder.add(keys[i], values.get(uint32_t(i)));
+        Encoder enc;
+        expert(enc).suppressTrailer();
+        builder.writeTo(enc, parallel);
+        alloc_slice builderData = enc.finish();
+        double builderTime = st.elapsed();
+        CHECK(builderData == treeData);
+        fprintf(stderr, "MutableHashTree %.3f sec, HashTreeBuilder%s %.3f sec (%.1fx)\n",
+                treeTime, (parallel ? " (parallel)" : ""), builderTime, treeTime / builderTime);
+    }
+}
+#endif
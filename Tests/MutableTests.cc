@@ -303,6 +303,18 @@ namespace fleece {
     }
 
 
+    TEST_CASE("MutableArray insert past end of source", "[Mutable]") {
+        Retained<Doc> doc = Doc::fromJSON("[1, 2]");
+        Retained<MutableArray> ma = MutableArray::newArray(doc->root()->asArray());
+        ma->append(3);
+        ma->insert(3, 1);
+        ma->set(3, 4);
+        ma->remove(3, 1);
+        ma->insert(3, 1);
+        CHECK(ma->toJSONString() == "[1,2,3,null]");
+    }
+
+
     TEST_CASE("Retain scalar in mutable collection (throws!)", "[Mutable]") {
         // Test case for #223, "Can't retain a scalar that's inline in a mutable collection".
         Retained<MutableArray> ma = MutableArray::newArray();
@@ -835,6 +847,78 @@ namespace fleece {
     }
 
 
+    TEST_CASE("Equality of amended documents", "[Mutable]") {
+        std::string json = json5("{a: [1, 'x', 'xyz', {b: 2}], c: 'a longer string value',"
+                                 " d: {e: [1.5, true, null, 123456]}, f: 'y'}");
+        Retained<SharedKeys> sk = new SharedKeys();
+        Retained<Doc> doc = Doc::fromJSON(json, sk);
+        const Dict *root = doc->asDict();
+
+        // Same encoding in a different buffer, with and without the same SharedKeys:
+        Retained<Doc> copy = Doc::fromJSON(json, sk);
+        CHECK(root->isEqual(copy->root()));
+        CHECK(copy->root()->isEqual(root));
+        Retained<Doc> unshared = Doc::fromJSON(json);
+        CHECK(root->isEqual(unshared->root()));
+        CHECK(unshared->root()->isEqual(root));
+        Retained<SharedKeys> otherSK = new SharedKeys();
+        Retained<Doc> otherKeys = Doc::fromJSON(json, otherSK);
+        CHECK(root->isEqual(otherKeys->root()));
+
+        // The same SharedKeys, but a key that was a string in the first encoding is an int in
+        // the second, since it was too long to be shared at first:
+        {
+            Retained<SharedKeys> mixedSK = new SharedKeys();
+            mixedSK->setMaxKeyLength(1);
+            Retained<Doc> stringKey = Doc::fromJSON("{\"a\":1,\"bb\":2}"_sl, mixedSK);
+            mixedSK->setMaxKeyLength(16);
+            Retained<Doc> intKey = Doc::fromJSON("{\"a\":1,\"bb\":2}"_sl, mixedSK);
+            CHECK(stringKey->data() != intKey->data());
+            CHECK(stringKey->root()->isEqual(intKey->root()));
+            CHECK(intKey->root()->isEqual(stringKey->root()));
+            Retained<Doc> different = Doc::fromJSON("{\"a\":1,\"bb\":3}"_sl, mixedSK);
+            CHECK(!stringKey->root()->isEqual(different->root()));
+        }
+
+        // Differences in inline values, nested values, and keys:
+        for (auto changed : {"{a: [1, 'x', 'xyz', {b: 3}], c: 'a longer string value',"
+                               " d: {e: [1.5, true, null, 123456]}, f: 'y'}",
+                             "{a: [1, 'x', 'xyz', {b: 2}], c: 'a longer string value',"
+                               " d: {e: [1.5, true, null, 123457]}, f: 'y'}",
+                             "{a: [1, 'x', 'xyz', {b: 2}], c: 'a longer string value',"
+                               " d: {e: [1.5, true, null, 123456]}, f: 'z'}",
+                             "{a: [1, 'x', 'xyw', {b: 2}], c: 'a longer string value',"
+                               " d: {e: [1.5, true, null, 123456]}, f: 'y'}",
+                             "{a: [1, 'x', 'xyz', {b: 2}], c: 'a longer string value',"
+                               " d: {e: [1.5, true, null, 123456]}, g: 'y'}"}) {
+            INFO("Changed = " << changed);
+            Retained<Doc> other = Doc::fromJSON(json5(changed), sk);
+            CHECK(!root->isEqual(other->root()));
+            CHECK(!other->root()->isEqual(root));
+            Retained<Doc> otherUnshared = Doc::fromJSON(json5(changed));
+            CHECK(!root->isEqual(otherUnshared->root()));
+        }
+
+        // Amend the document, changing one value, then changing it back:
+        Retained<MutableDict> md = MutableDict::newDict(root);
+        md->set("f"_sl, "z"_sl);
+        for (int pass = 0; pass < 2; ++pass) {
+            Encoder enc;
+            enc.setSharedKeys(sk);
+            enc.setBase(doc->data(), true);
+            enc.reuseBaseStrings();
+            enc.writeValue(md);
+            alloc_slice delta = enc.finish();
+            Retained<Doc> amended = new Doc(delta, Doc::kTrusted, sk, doc->data());
+            const Dict *amendedRoot = amended->asDict();
+            CHECK(amendedRoot->get("d"_sl) == root->get("d"_sl));   // unchanged, so shared
+            CHECK(amendedRoot->isEqual(root) == (pass == 1));
+            CHECK(root->isEqual(amendedRoot) == (pass == 1));
+            md->set("f"_sl, "y"_sl);
+        }
+    }
+
+
     TEST_CASE("Compaction", "[Mutable]") {
         static constexpr size_t kMaxDataSize = 1000;
         alloc_slice data;
@@ -14,6 +14,15 @@
 #include "FleeceImpl.hh"
 #include "JSONConverter.hh"
 #include "Doc.hh"
+#include "DeepIterator.hh"
+#include "ArrowExport.hh"
+#include "ArrayKernels.hh"
+#include "MutableArray.hh"
+#include "MutableDict.hh"
+#include "Collatable.hh"
+#include "Path.hh"
+#include "PathIndex.hh"
+#include "PathProjection.hh"
 #include "varint.hh"
 #include <chrono>
 #include <stdlib.h>
@@ -173,6 +182,379 @@ static void testFindPersonByIndex(int sort) {
 TEST_CASE("Perf FindPersonByIndexSorted", "[.Perf]")      {testFindPersonByIndex(1);}
 TEST_CASE("Perf FindPersonByIndexKeyed", "[.Perf]")       {testFindPersonByIndex(2);}
 
+TEST_CASE("Perf PathProjection", "[.Perf]") {
+    assert(false); // This test should not be run with a debug build!
+    static const int kSamples = 500;
+
+    // Nest each person two levels deep, as in a document with a "data.person" property:
+    alloc_slice input = readTestFile("1000people.fleece");
+    if (!input)
+        abort();
+    std::vector<alloc_slice> docs;
+    for (Array::iterator i(Value::fromTrustedData(input)->asArray()); i; ++i) {
+        Encoder enc;
+        enc.beginDictionary();
+        enc.writeKey("type");
+        enc.writeString("person");
+        enc.writeKey("data");
+        enc.beginDictionary();
+        enc.writeKey("person");
+        enc.writeValue(i.value());
+        enc.endDictionary();
+        enc.endDictionary();
+        docs.push_back(enc.finish());
+    }
+
+    static const char* const kPaths[] = {
+        "data.person.name", "data.person.age", "data.person.email", "data.person.company",
+        "data.person.address", "data.person.latitude", "data.person.longitude",
+        "data.person.isActive", "data.person.balance", "data.person.eyeColor",
+        "data.person.tags[0]", "data.person.tags[1]", "data.person.tags[-1]",
+        "data.person.friends[0].id", "data.person.friends[0].name",
+        "data.person.friends[1].id", "data.person.friends[1].name",
+        "data.person.friends[2].id", "data.person.friends[2].name", "type"};
+    static constexpr size_t kNPaths = sizeof(kPaths) / sizeof(kPaths[0]);
+    std::vector<Path> paths;
+    for (auto spec : kPaths)
+        paths.emplace_back(slice(spec));
+    PathProjection projection(paths);
+    const Value* values[kNPaths];
+
+    fprintf(stderr, "Evaluating %zu paths one at a time... ", kNPaths);
+    Benchmark bench1;
+    for (int i = 0; i < kSamples; i++) {
+        bench1.start();
+        for (auto &doc : docs) {
+            auto root = Value::fromTrustedData(doc);
+            for (size_t p = 0; p < kNPaths; ++p)
+                values[p] = paths[p].eval(root);
+            CHECK(values[0] != nullptr);
+        }
+        bench1.stop();
+    }
+    bench1.printReport(1.0/docs.size(), "doc");
+
+    fprintf(stderr, "Evaluating %zu paths as a projection... ", kNPaths);
+    Benchmark bench2;
+    for (int i = 0; i < kSamples; i++) {
+        bench2.start();
+        for (auto &doc : docs) {
+            projection.eval(Value::fromTrustedData(doc), values);
+            CHECK(values[0] != nullptr);
+        }
+        bench2.stop();
+    }
+    bench2.printReport(1.0/docs.size(), "doc");
+}
+
+
+template <class ITERATOR, class PATH_FN>
+static void benchDeepIteration(const char *what, const Value *root, PATH_FN pathFn) {
+    static const int kSamples = 50;
+    size_t nValues = 0, pathBytes = 0;
+    Benchmark bench;
+    for (int i = 0; i < kSamples; i++) {
+        nValues = pathBytes = 0;
+        bench.start();
+        for (ITERATOR iter(root); iter; ++iter) {
+            ++nValues;
+            pathBytes += pathFn(iter);
+        }
+        bench.stop();
+    }
+    fprintf(stderr, "%-40s %6.1f million values/sec  ", what, nValues / bench.median() / 1e6);
+    bench.printReport(1.0 / nValues, "value");
+    CHECK(pathBytes > 0 || nValues > 0);
+}
+
+TEST_CASE("Perf DeepIterator", "[.Perf]") {
+    assert(false); // This test should not be run with a debug build!
+    alloc_slice input = readTestFile("1000people.fleece");
+    if (!input)
+        abort();
+    auto root = Value::fromTrustedData(input);
+
+    benchDeepIteration<DeepIterator>("DeepIterator:", root,
+                                     [](DeepIterator&) {return 0;});
+    benchDeepIteration<PreorderIterator>("PreorderIterator:", root,
+                                         [](PreorderIterator&) {return 0;});
+    benchDeepIteration<DeepIterator>("DeepIterator + jsonPointer:", root,
+                                     [](DeepIterator &i) {return i.jsonPointer().size();});
+    benchDeepIteration<PreorderIterator>("PreorderIterator + writeJSONPointer:", root,
+                                         [](PreorderIterator &i) {
+        char buf[256];
+        slice_ostream out(buf, sizeof(buf));
+        i.writeJSONPointer(out);
+        return out.bytesWritten();
+    });
+}
+
+
+TEST_CASE("Perf Arrow export", "[.Perf]") {
+    assert(false); // This test should not be run with a debug build!
+    static const int kSamples = 200;
+    alloc_slice input = readTestFile("1000people.fleece");
+    if (!input)
+        abort();
+    auto people = Value::fromTrustedData(input)->asArray();
+    std::vector<Path> paths;
+    for (auto spec : {"name", "age", "latitude", "isActive", "friends[0].name"})
+        paths.emplace_back(slice(spec));
+
+    ArrowSchema schema;
+    ArrowArray array;
+    Benchmark exportBench;
+    for (int i = 0; i < kSamples; i++) {
+        exportBench.start();
+        ArrowExport::exportColumns(people, paths, &schema, &array);
+        exportBench.stop();
+        if (i < kSamples - 1) {
+            array.release(&array);
+            schema.release(&schema);
+        }
+    }
+    fprintf(stderr, "Exporting %zu columns: ", paths.size());
+    exportBench.printReport(1.0 / people->count(), "row");
+
+    // Compare summing a column of Arrow doubles with reading the Fleece values:
+    Dict::key latitudeKey("latitude"_sl);
+    Benchmark fleeceBench, arrowBench;
+    double fleeceSum = 0, arrowSum = 0;
+    for (int i = 0; i < kSamples * 10; i++) {
+        fleeceBench.start();
+        fleeceSum = 0;
+        for (Array::iterator iter(people); iter; ++iter)
+            fleeceSum += iter.value()->asDict()->get(latitudeKey)->asDouble();
+        fleeceBench.stop();
+
+        arrowBench.start();
+        auto latitudes = array.children[2];
+        auto values = (const double*)latitudes->buffers[1];
+        arrowSum = 0;
+        for (int64_t row = 0; row < latitudes->length; ++row)
+            arrowSum += values[row];
+        arrowBench.stop();
+    }
+    CHECK(fleeceSum == arrowSum);
+    fprintf(stderr, "Summing a Fleece property: ");
+    fleeceBench.printReport(1.0 / people->count(), "row");
+    fprintf(stderr, "Summing an Arrow column:   ");
+    arrowBench.printReport(1.0 / people->count(), "row");
+    array.release(&array);
+    schema.release(&schema);
+}
+
+
+TEST_CASE("Perf ArrayKernels", "[.Perf]") {
+    assert(false); // This test should not be run with a debug build!
+    static const int kSamples = 2000;
+    alloc_slice input = readTestFile("1000people.fleece");
+    if (!input)
+        abort();
+    auto people = Value::fromTrustedData(input)->asArray();
+    Path path("latitude");
+    Dict::key latitudeKey("latitude"_sl);
+    std::vector<uint64_t> bitmap((people->count() + 63) / 64);
+
+    Benchmark loopBench, summaryBench, selectLoopBench, selectBench;
+    NumericSummary loopResult, summary;
+    size_t loopMatches = 0, matches = 0;
+    for (int i = 0; i < kSamples; i++) {
+        summaryBench.start();
+        summary = ArrayKernels::summarize(people, path);
+        summaryBench.stop();
+
+        loopBench.start();
+        loopResult = NumericSummary();
+        for (Array::iterator iter(people); iter; ++iter) {
+            const Value *v = iter.value()->asDict()->get(latitudeKey);
+            if (v && v->type() == kNumber) {
+                double d = v->asDouble();
+                ++loopResult.count;
+                loopResult.sum += d;
+                loopResult.min = std::min(loopResult.min, d);
+                loopResult.max = std::max(loopResult.max, d);
+            }
+        }
+        loopBench.stop();
+
+        selectLoopBench.start();
+        loopMatches = 0;
+        std::fill(bitmap.begin(), bitmap.end(), 0);
+        uint32_t row = 0;
+        for (Array::iterator iter(people); iter; ++iter, ++row) {
+            const Value *v = iter.value()->asDict()->get(latitudeKey);
+            if (v && v->type() == kNumber && v->asDouble() > 0) {
+                bitmap[row / 64] |= uint64_t(1) << (row % 64);
+                ++loopMatches;
+            }
+        }
+        selectLoopBench.stop();
+
+        selectBench.start();
+        matches = ArrayKernels::select(people, path, ArrayKernels::kGreater, 0, bitmap.data());
+        selectBench.stop();
+    }
+    CHECK(summary.count == loopResult.count);
+    CHECK(summary.min == loopResult.min);
+    CHECK(summary.max == loopResult.max);
+    CHECK(matches == loopMatches);
+    fprintf(stderr, "Summarize, item by item: ");
+    loopBench.printReport(1.0 / people->count(), "item");
+    fprintf(stderr, "Summarize, batched:      ");
+    summaryBench.printReport(1.0 / people->count(), "item");
+    fprintf(stderr, "Select, item by item:    ");
+    selectLoopBench.printReport(1.0 / people->count(), "item");
+    fprintf(stderr, "Select, batched:         ");
+    selectBench.printReport(1.0 / people->count(), "item");
+}
+
+
+TEST_CASE("Perf Collatable sort", "[.Perf]") {
+    assert(false); // This test should not be run with a debug build!
+    static const int kSamples = 200;
+    alloc_slice input = readTestFile("1000people.fleece");
+    if (!input)
+        abort();
+    auto people = Value::fromTrustedData(input)->asArray();
+
+    // Make a compound index key [gender, age, name] for each person:
+    Encoder enc;
+    enc.beginArray();
+    for (Array::iterator i(people); i; ++i) {
+        auto person = i.value()->asDict();
+        enc.beginArray();
+        enc.writeValue(person->get("gender"_sl));
+        enc.writeValue(person->get("age"_sl));
+        enc.writeValue(person->get("name"_sl));
+        enc.endArray();
+    }
+    enc.endArray();
+    alloc_slice data = enc.finish();
+    auto rows = Value::fromTrustedData(data)->asArray();
+
+    Benchmark valueSortBench, encodeBench, keySortBench;
+    std::vector<const Value*> sortedValues;
+    std::vector<alloc_slice> keys;
+    for (int i = 0; i < kSamples; i++) {
+        sortedValues.clear();
+        for (Array::iterator iter(rows); iter; ++iter)
+            sortedValues.push_back(iter.value());
+        valueSortBench.start();
+        std::sort(sortedValues.begin(), sortedValues.end(), [](const Value *a, const Value *b) {
+            return a->compare(b) < 0;
+        });
+        valueSortBench.stop();
+
+        encodeBench.start();
+        keys.clear();
+        for (Array::iterator iter(rows); iter; ++iter)
+            keys.push_back(Collatable::encode(iter.value()));
+        encodeBench.stop();
+
+        keySortBench.start();
+        std::sort(keys.begin(), keys.end());
+        keySortBench.stop();
+    }
+    for (size_t i = 0; i < keys.size(); ++i)
+        CHECK(keys[i] == Collatable::encode(sortedValues[i]));
+
+    fprintf(stderr, "Sorting with Value::compare:             ");
+    valueSortBench.printReport(1.0 / rows->count(), "row");
+    fprintf(stderr, "Encoding collatable keys:                ");
+    encodeBench.printReport(1.0 / rows->count(), "row");
+    fprintf(stderr, "Sorting collatable keys with memcmp:     ");
+    keySortBench.printReport(1.0 / rows->count(), "row");
+}
+
+
+TEST_CASE("Perf isEqual deep document", "[.Perf]") {
+    assert(false); // This test should not be run with a debug build!
+    static const int kSamples = 500;
+    alloc_slice json = readTestFile(kBigJSONTestFileName);
+    Retained<SharedKeys> sk = new SharedKeys();
+    Retained<Doc> doc = Doc::fromJSON(json, sk);
+    Retained<Doc> copy = Doc::fromJSON(json, sk);       // same encoding, different buffer
+    auto people = doc->root()->asArray();
+
+    // Amend the document, changing only the last person's age:
+    Retained<MutableArray> mutablePeople = MutableArray::newArray(people);
+    auto lastPerson = mutablePeople->getMutableDict(people->count() - 1);
+    lastPerson->set("age"_sl, 9999);
+    Encoder enc;
+    enc.setSharedKeys(sk);
+    enc.setBase(doc->data(), true);
+    enc.reuseBaseStrings();
+    enc.writeValue(mutablePeople);
+    alloc_slice delta = enc.finish();
+    Retained<Doc> amended = new Doc(delta, Doc::kTrusted, sk, doc->data());
+
+    Benchmark copyBench, amendedBench;
+    for (int i = 0; i < kSamples; i++) {
+        copyBench.start();
+        bool equal = doc->root()->isEqual(copy->root());
+        copyBench.stop();
+        CHECK(equal);
+
+        amendedBench.start();
+        equal = doc->root()->isEqual(amended->root());
+        amendedBench.stop();
+        CHECK(!equal);
+    }
+    fprintf(stderr, "isEqual to a separately encoded copy:    ");
+    copyBench.printReport(1.0 / people->count(), "person");
+    fprintf(stderr, "isEqual to an amended copy (setBase):    ");
+    amendedBench.printReport(1.0 / people->count(), "person");
+}
+
+
+TEST_CASE("Perf PathIndex", "[.Perf]") {
+    assert(false); // This test should not be run with a debug build!
+    static const int kSamples = 200;
+    Retained<SharedKeys> sk = new SharedKeys();
+    Retained<Doc> doc = Doc::fromJSON(readTestFile(kBigJSONTestFileName), sk);
+    const Value *root = doc->root();
+
+    // A deep path into each person:
+    std::vector<Path> paths;
+    for (uint32_t i = 0; i < root->asArray()->count(); ++i) {
+        paths.emplace_back();
+        paths.back().addIndex(int(i));
+        paths.back().addComponents("friends[2].name"_sl);
+    }
+
+    Benchmark buildBench, evalBench, indexedBench;
+    alloc_slice indexData;
+    for (int i = 0; i < kSamples; i++) {
+        buildBench.start();
+        indexData = PathIndex::build(root, doc->data());
+        buildBench.stop();
+    }
+    PathIndex index(indexData, doc->data());
+
+    size_t total = 0;
+    for (int i = 0; i < kSamples; i++) {
+        evalBench.start();
+        for (auto &path : paths)
+            total += path.eval(root)->asString().size;
+        evalBench.stop();
+
+        indexedBench.start();
+        for (auto &path : paths)
+            total += path.eval(index)->asString().size;
+        indexedBench.stop();
+    }
+    CHECK(total > 0);
+
+    fprintf(stderr, "Building index of %zu values (%zu bytes): ", index.count(), indexData.size);
+    buildBench.printReport(1.0 / index.count(), "value");
+    fprintf(stderr, "Path::eval:                    ");
+    evalBench.printReport(1.0 / paths.size(), "path");
+    fprintf(stderr, "Path::eval with PathIndex:     ");
+    indexedBench.printReport(1.0 / paths.size(), "path");
+}
+
+
 TEST_CASE("Perf LoadPeople", "[.Perf]") {
     assert(false); // This test should not be run with a debug build!
     for (int shareKeys = 0; shareKeys <= 1; ++shareKeys) {
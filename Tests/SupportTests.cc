@@ -21,6 +21,7 @@
 #include "TempArray.hh"
 #include "sliceIO.hh"
 #include "Base64.hh"
+#include "MyersDiff.hh"
 #include <iostream>
 #include <future>
 
@@ -356,6 +357,80 @@ TEST_CASE("Base64 encode and decode", "[Base64]") {
 }
 
 
+// Applies MyersDiff's hunks to `oldStr`, to check that they produce `nuuStr`.
+static string applyHunks(slice oldStr, slice nuuStr, const vector<MyersDiff::Hunk> &hunks) {
+    string result;
+    size_t pos = 0;
+    for (auto &h : hunks) {
+        CHECK(h.oldPos >= pos);
+        CHECK(h.oldPos - pos == h.nuuPos - result.size());     // Equal bytes are equal length
+        result.append((const char*)oldStr.buf + pos, h.oldPos - pos);
+        result.append((const char*)nuuStr.buf + h.nuuPos, h.nuuLen);
+        pos = h.oldPos + h.oldLen;
+    }
+    result.append((const char*)oldStr.buf + pos, oldStr.size - pos);
+    return result;
+}
+
+TEST_CASE("MyersDiff", "[MyersDiff]") {
+    CHECK(MyersDiff::commonPrefix("", "") == 0);
+    CHECK(MyersDiff::commonPrefix("abcdefghijklmnopq", "abcdefghijklmnopq") == 17);
+    CHECK(MyersDiff::commonPrefix("abcdefghijklmnopq", "abcdefghijkLmnopq") == 11);
+    CHECK(MyersDiff::commonPrefix("abcdefghijklmnopq", "abcdefgh") == 8);
+    CHECK(MyersDiff::commonSuffix("", "x") == 0);
+    CHECK(MyersDiff::commonSuffix("abcdefghijklmnopq", "abcdefghijklmnopq") == 17);
+    CHECK(MyersDiff::commonSuffix("abcdefghijklmnopq", "abcdeFghijklmnopq") == 11);
+    CHECK(MyersDiff::commonSuffix("abcdefghijklmnopq", "jklmnopq") == 8);
+
+    MyersDiff differ(1000);
+    REQUIRE(differ.diff("The quick brown fox", "The quick brown fox"));
+    CHECK(differ.hunks().empty());
+
+    REQUIRE(differ.diff("The quick brown fox", "The quick red fox"));
+    REQUIRE(differ.hunks().size() == 2);    // "b" -> "", "own" -> "ed"
+    CHECK(applyHunks("The quick brown fox", "The quick red fox", differ.hunks())
+          == "The quick red fox");
+
+    REQUIRE(differ.diff("abc", "xyz"));
+    REQUIRE(differ.hunks().size() == 1);
+    CHECK(differ.hunks()[0].oldLen == 3);
+    CHECK(differ.hunks()[0].nuuLen == 3);
+
+    // Random edits; the edit distance can't be more than the number of bytes changed:
+    srandom(12345);
+    for (int test = 0; test < 100; ++test) {
+        string oldStr, nuuStr;
+        size_t len = random() % 1000;
+        for (size_t i = 0; i < len; ++i)
+            oldStr += char('a' + random() % 4);
+        nuuStr = oldStr;
+        size_t changed = 0;
+        for (int e = random() % 20; e > 0; --e) {
+            size_t pos = nuuStr.empty() ? 0 : random() % nuuStr.size();
+            size_t n = 1 + random() % 10;
+            if (random() % 2) {
+                nuuStr.insert(pos, string(n, 'x'));
+            } else {
+                n = min(n, nuuStr.size() - pos);
+                nuuStr.erase(pos, n);
+            }
+            changed += n;
+        }
+        REQUIRE(differ.diff(oldStr, nuuStr));
+        CHECK(applyHunks(oldStr, nuuStr, differ.hunks()) == nuuStr);
+        size_t distance = 0;
+        for (auto &h : differ.hunks())
+            distance += h.oldLen + h.nuuLen;
+        CHECK(distance <= changed);
+    }
+
+    // Exceeding the maximum edit distance:
+    MyersDiff limited(10);
+    CHECK(limited.diff("abcdefghijklmnopqrstuvwxyz", "abcdefghijklmNOPQRSTUVWXYz") == false);
+    CHECK(limited.diff("abcdefghijklmnopqrstuvwxyz", "abcdefghijklmNOpqrstuvwxyz") == true);
+}
+
+
 TEST_CASE("Timestamp Conversions", "[Timestamps]") {
     FLTimestamp ts = FLTimestamp_Now();
     bool asUTC = true;
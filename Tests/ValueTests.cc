@@ -20,10 +20,18 @@
 #include "Pointer.hh"
 #include "varint.hh"
 #include "DeepIterator.hh"
+#include "Collatable.hh"
+#include "Encoder.hh"
+#include "MutableArray.hh"
+#include "MutableDict.hh"
+#include "ValueSort.hh"
+#include "Path.hh"
 #include "SharedKeys.hh"
 #include "Doc.hh"
 #include <iostream>
+#include <set>
 #include <sstream>
+#include <unordered_map>
 
 #undef NOMINMAX
 
@@ -175,6 +183,294 @@ namespace fleece {
     }
 
 
+    TEST_CASE("PreorderIterator") {
+        {
+            PreorderIterator i(nullptr);
+            CHECK(!i);
+            i.next();
+            CHECK(i.value() == nullptr);
+        }
+
+        auto doc = Doc::fromJSON(json5("{a: [1, {b: 2, 'c/d': []}], e: {}, f: 3}"));
+        std::vector<std::string> pointers, paths;
+        char buf[100];
+        for (PreorderIterator i(doc->root()); i; ++i) {
+            slice_ostream out(buf, sizeof(buf));
+            REQUIRE(i.writeJSONPointer(out));
+            pointers.push_back(std::string(out.output()));
+            out = slice_ostream(buf, sizeof(buf));
+            REQUIRE(i.writePath(out));
+            paths.push_back(std::string(out.output()));
+            CHECK((i.depth() == 0) == (i.parent() == nullptr));
+        }
+        CHECK(pointers == std::vector<std::string>{"/", "/a", "/a/0", "/a/1", "/a/1/b",
+                                                   "/a/1/c~1d", "/e", "/f"});
+        CHECK(paths == std::vector<std::string>{"", ".a", ".a[0]", ".a[1]", ".a[1].b",
+                                                ".a[1][\"c/d\"]", ".e", ".f"});
+
+        // A path that doesn't fit:
+        PreorderIterator i(doc->root());
+        for (int n = 0; n < 5; ++n)
+            ++i;
+        CHECK(i.keyString() == "c/d"_sl);
+        CHECK(i.index() == 0);
+        CHECK(i.depth() == 3);
+        CHECK(i.pathComponent(1).index == 1);
+        slice_ostream out(buf, 8);
+        CHECK(!i.writePath(out));
+
+        // Same values and paths as DeepIterator, except for the order:
+        auto input = readTestFile("1person.fleece");
+        auto person = Value::fromData(input);
+        std::multiset<std::string> deepItems, preorderItems;
+        for (DeepIterator d(person); d; ++d)
+            deepItems.insert(d.pathString() + ": " + d.value()->toJSONString());
+        for (PreorderIterator p(person); p; ++p) {
+            slice_ostream pathOut(buf, sizeof(buf));
+            REQUIRE(p.writePath(pathOut));
+            preorderItems.insert(std::string(pathOut.output()) + ": " + p.value()->toJSONString());
+        }
+        CHECK(preorderItems == deepItems);
+
+        stringstream s;
+        for (PreorderIterator p(person); p; ++p) {
+            if (p.depth() == 0)
+                continue;
+            slice_ostream pointerOut(buf, sizeof(buf));
+            REQUIRE(p.writeJSONPointer(pointerOut));
+            s << std::string(pointerOut.output()) << ": " << p.value()->toString().asString() << "\n";
+            p.skipChildren();
+        }
+#if FL_HAVE_TEST_FILES
+        CHECK(s.str() == readFile(kTestFilesDir "1person-shallowIterOutput.txt").asString());
+#endif
+    }
+
+
+    TEST_CASE("Collatable") {
+        // Values in increasing order; adjacent values with `same` set are equal:
+        struct Item {std::function<void(Encoder&)> write; bool same = false;};
+        const std::vector<Item> items = {
+            {[](Encoder &e) {e.writeUndefined();}},
+            {[](Encoder &e) {e.writeNull();}},
+            {[](Encoder &e) {e.writeBool(false);}},
+            {[](Encoder &e) {e.writeBool(true);}},
+            {[](Encoder &e) {e.writeDouble(-INFINITY);}},
+            {[](Encoder &e) {e.writeDouble(-1e300);}},
+            {[](Encoder &e) {e.writeInt(INT64_MIN);}},
+            {[](Encoder &e) {e.writeInt(INT64_MIN + 1);}},
+            {[](Encoder &e) {e.writeInt(-(1ll << 53) - 1);}},
+            {[](Encoder &e) {e.writeInt(-(1ll << 53));}},
+            {[](Encoder &e) {e.writeDouble(-2.5);}},
+            {[](Encoder &e) {e.writeInt(-2);}},
+            {[](Encoder &e) {e.writeDouble(-1e-300);}},
+            {[](Encoder &e) {e.writeInt(0);}},
+            {[](Encoder &e) {e.writeDouble(-0.0);}, true},
+            {[](Encoder &e) {e.writeDouble(0.0);}, true},
+            {[](Encoder &e) {e.writeDouble(1e-300);}},
+            {[](Encoder &e) {e.writeInt(1);}},
+            {[](Encoder &e) {e.writeDouble(1.0);}, true},
+            {[](Encoder &e) {e.writeFloat(1.5f);}},
+            {[](Encoder &e) {e.writeInt(2);}},
+            {[](Encoder &e) {e.writeInt(1000);}},
+            {[](Encoder &e) {e.writeInt(1ll << 53);}},
+            {[](Encoder &e) {e.writeInt((1ll << 53) + 1);}},
+            {[](Encoder &e) {e.writeInt((1ll << 53) + 2);}},
+            {[](Encoder &e) {e.writeInt((1ll << 53) + 3);}},
+            {[](Encoder &e) {e.writeInt(INT64_MAX - 1);}},
+            {[](Encoder &e) {e.writeInt(INT64_MAX);}},
+            {[](Encoder &e) {e.writeDouble(9223372036854775808.0);}},
+            {[](Encoder &e) {e.writeUInt(9223372036854775808ull);}, true},
+            {[](Encoder &e) {e.writeUInt(9223372036854775809ull);}},
+            {[](Encoder &e) {e.writeUInt(UINT64_MAX - 1);}},
+            {[](Encoder &e) {e.writeUInt(UINT64_MAX);}},
+            {[](Encoder &e) {e.writeDouble(18446744073709551616.0);}},
+            {[](Encoder &e) {e.writeDouble(1e300);}},
+            {[](Encoder &e) {e.writeDouble(INFINITY);}},
+            {[](Encoder &e) {e.writeString("");}},
+            {[](Encoder &e) {e.writeString("a"_sl);}},
+            {[](Encoder &e) {e.writeString(slice("a\0", 2));}},
+            {[](Encoder &e) {e.writeString(slice("a\0\0", 3));}},
+            {[](Encoder &e) {e.writeString(slice("a\0b", 3));}},
+            {[](Encoder &e) {e.writeString("a\x01"_sl);}},
+            {[](Encoder &e) {e.writeString("ab"_sl);}},
+            {[](Encoder &e) {e.writeString("\xC3\xA9t\xC3\xA9"_sl);}},
+            {[](Encoder &e) {e.writeData(""_sl);}},
+            {[](Encoder &e) {e.writeData(slice("\0", 1));}},
+            {[](Encoder &e) {e.beginArray(); e.endArray();}},
+            {[](Encoder &e) {e.beginArray(); e.writeNull(); e.endArray();}},
+            {[](Encoder &e) {e.beginArray(); e.writeInt(1); e.endArray();}},
+            {[](Encoder &e) {e.beginArray(); e.writeInt(1); e.writeNull(); e.endArray();}},
+            {[](Encoder &e) {e.beginArray(); e.writeInt(1); e.writeInt(2); e.endArray();}},
+            {[](Encoder &e) {e.beginArray(); e.writeDouble(1.0); e.writeDouble(2.0); e.endArray();}, true},
+            {[](Encoder &e) {e.beginArray(); e.writeString("a"_sl); e.endArray();}},
+            {[](Encoder &e) {e.beginArray(); e.writeString(slice("a\0", 2)); e.endArray();}},
+            {[](Encoder &e) {e.beginArray(); e.beginArray(); e.endArray(); e.endArray();}},
+            {[](Encoder &e) {e.beginDictionary(); e.endDictionary();}},
+            {[](Encoder &e) {e.beginDictionary(); e.writeKey(""_sl); e.writeInt(1);
+                             e.endDictionary();}},
+            {[](Encoder &e) {e.beginDictionary(); e.writeKey("a"_sl); e.writeInt(1);
+                             e.endDictionary();}},
+            {[](Encoder &e) {e.beginDictionary(); e.writeKey("a"_sl); e.writeInt(1);
+                             e.writeKey("b"_sl); e.writeInt(0); e.endDictionary();}},
+            {[](Encoder &e) {e.beginDictionary(); e.writeKey("a"_sl); e.writeInt(2);
+                             e.endDictionary();}},
+        };
+
+        std::vector<alloc_slice> keys;
+        std::vector<alloc_slice> data;
+        for (auto &item : items) {
+            Encoder enc;
+            item.write(enc);
+            data.push_back(enc.finish());
+            keys.push_back(Collatable::encode(Value::fromTrustedData(data.back())));
+        }
+        for (size_t i = 0; i < items.size(); ++i) {
+            const Value *value = Value::fromTrustedData(data[i]);
+            INFO("Item " << i << ": " << value->toJSONString());
+            // Check the order against every other item:
+            for (size_t j = 0; j < items.size(); ++j) {
+                int expected = (i < j) ? -1 : 1;
+                if (i == j || (i < j && std::all_of(&items[i+1], &items[j+1],
+                                                    [](auto &it) {return it.same;}))
+                           || (j < i && std::all_of(&items[j+1], &items[i+1],
+                                                    [](auto &it) {return it.same;})))
+                    expected = 0;
+                int cmp = keys[i].compare(keys[j]);
+                if ((cmp > 0) - (cmp < 0) != expected)
+                    FAIL("Wrong order of items " << i << " and " << j);
+                // Value::compare and Value::hash agree with the keys:
+                const Value *other = Value::fromTrustedData(data[j]);
+                cmp = value->compare(other);
+                if ((cmp > 0) - (cmp < 0) != expected)
+                    FAIL("Wrong comparison of items " << i << " and " << j);
+                if (expected == 0 && value->hash() != other->hash())
+                    FAIL("Different hashes of items " << i << " and " << j);
+            }
+
+            // Decoding gives back the same value, except that integral floats become integers:
+            alloc_slice decoded = Collatable::decode(keys[i]);
+            const Value *result = Value::fromTrustedData(decoded);
+            REQUIRE(result);
+            CHECK(Collatable::encode(result) == keys[i]);
+            std::string json = value->toJSONString();
+            if (i == 14 || i == 15)
+                json = "0";
+            else if (i == 18)
+                json = "1";
+            else if (i == 28)
+                json = "9223372036854775808";
+            else if (i == 51)
+                json = "[1,2]";
+            CHECK(result->toJSONString() == json);
+        }
+        CHECK(Value::fromTrustedData(Collatable::decode(keys[32]))->asUnsigned() == UINT64_MAX);
+        CHECK(Value::fromTrustedData(Collatable::decode(keys[6]))->asInt() == INT64_MIN);
+        CHECK(Collatable::encode(nullptr) == keys[0]);
+
+        // Dict keys are in string order regardless of shared keys:
+        Retained<SharedKeys> sk = new SharedKeys();
+        int bKey;
+        sk->encodeAndAdd("b"_sl, bKey);     // so "b" is encoded as 0 and "a" as 1
+        auto doc = Doc::fromJSON(R"({"b":0,"a":1})"_sl, sk);
+        CHECK(Collatable::encode(doc->root()) == keys[items.size() - 2]);
+        const Value *sameDict = Value::fromTrustedData(data[items.size() - 2]);
+        CHECK(doc->root()->compare(sameDict) == 0);
+        CHECK(doc->root()->hash() == sameDict->hash());
+        CHECK(Value::fromTrustedData(data[0])->compare(nullptr) == 0);
+        CHECK(Value::fromTrustedData(data[1])->compare(nullptr) > 0);
+
+        for (auto bad : {""_sl, "\x0A"_sl, "\x05\x80"_sl, "\x06" "abc"_sl, "\x08\x02"_sl,
+                         "\x09\x02\x00"_sl, "\x02\x02"_sl}) {
+            INFO("Key " << bad.hexString());
+            CHECK_THROWS_AS(Collatable::decode(bad), FleeceException);
+        }
+    }
+
+
+    TEST_CASE("ValueSort") {
+        // Make an array of dicts, with many duplicate values, big enough to sort in parallel:
+        const size_t kCount = ValueSort::kMinParallelCount + 1234;
+        Encoder enc;
+        enc.beginArray();
+        for (size_t i = 0; i < kCount; ++i) {
+            enc.beginDictionary();
+            enc.writeKey("n"_sl);
+            uint32_t r = uint32_t(i * 2654435761u) % 1000;
+            switch (r % 4) {
+                case 0:  enc.writeInt(r); break;
+                case 1:  enc.writeDouble(r / 4.0); break;
+                case 2:  enc.writeString(std::to_string(r)); break;
+                default: enc.beginArray(); enc.writeInt(r % 7); enc.endArray(); break;
+            }
+            enc.writeKey("i"_sl);
+            enc.writeInt(i);
+            enc.endDictionary();
+        }
+        enc.endArray();
+        alloc_slice data = enc.finish();
+        const Array *rows = Value::fromTrustedData(data)->asArray();
+        Path key("n");
+
+        for (unsigned maxThreads : {1u, 3u, 0u}) {
+            INFO("maxThreads = " << maxThreads);
+            auto sorted = ValueSort::sortedItems(rows, &key, maxThreads);
+            REQUIRE(sorted.size() == kCount);
+            for (size_t i = 1; i < kCount; ++i) {
+                const Dict *a = sorted[i-1]->asDict(), *b = sorted[i]->asDict();
+                int cmp = a->get("n"_sl)->compare(b->get("n"_sl));
+                // Sorted, and stable:
+                if (cmp > 0 || (cmp == 0 && a->get("i"_sl)->asInt() > b->get("i"_sl)->asInt()))
+                    FAIL("Items " << (i-1) << " and " << i << " are out of order");
+            }
+        }
+
+        // Sorting whole values, into a MutableArray and into an Encoder:
+        std::vector<const Value*> expected;
+        for (Array::iterator i(rows); i; ++i)
+            expected.push_back(i.value()->asDict()->get("n"_sl));
+        std::stable_sort(expected.begin(), expected.end(), [](const Value *a, const Value *b) {
+            return a->compare(b) < 0;
+        });
+        Encoder enc2;
+        enc2.beginArray();
+        for (auto v : expected)
+            enc2.writeValue(v);
+        enc2.endArray();
+        Retained<Doc> valuesDoc = enc2.finishDoc();    // (MutableArray needs a Doc to retain)
+        const Array *values = valuesDoc->root()->asArray();
+
+        Retained<MutableArray> sorted = ValueSort::sorted(values, nullptr, 2);
+        REQUIRE(sorted->count() == kCount);
+        for (uint32_t i = 0; i < kCount; ++i)
+            CHECK(sorted->get(i)->isEqual(values->get(i)));
+
+        Encoder enc3;
+        ValueSort::writeSorted(values, enc3);
+        alloc_slice sortedData = enc3.finish();
+        CHECK(Value::fromTrustedData(sortedData)->isEqual(values));
+
+        Path wildcard("n[*]");
+        CHECK_THROWS_AS(ValueSort::sortedItems(rows, &wildcard), FleeceException);
+        CHECK(ValueSort::sortedItems(nullptr).empty());
+
+        // Group by value, with numbers in any encoding grouped together:
+        std::unordered_map<HashedValue, int> groups;
+        for (Array::iterator i(values); i; ++i)
+            ++groups[HashedValue(i.value())];
+        auto doc = Doc::fromJSON("[12, 12.0, \"12\", [5]]"_sl);
+        const Array *probes = doc->root()->asArray();
+        CHECK(HashedValue(probes->get(0)) == HashedValue(probes->get(1)));
+        CHECK(HashedValue(probes->get(0)) != HashedValue(probes->get(2)));
+        int total = 0;
+        for (auto &group : groups)
+            total += group.second;
+        CHECK(total == int(kCount));
+        CHECK(groups.count(HashedValue(probes->get(1))) == 1);
+        CHECK(groups.count(HashedValue(probes->get(3))) == 1);
+    }
+
+
     TEST_CASE("Doc", "[SharedKeys]") {
         const Dict *root;
         {
@@ -237,6 +533,84 @@ namespace fleece {
         }
     }
 
+    TEST_CASE("Extract Doc", "[Doc]") {
+        Retained<SharedKeys> sk = new SharedKeys();
+        Retained<Doc> doc = Doc::fromJSON(readTestFile(kBigJSONTestFileName), sk);
+        CHECK(doc->retainedBytes() == doc->data().size);
+        auto people = doc->asArray();
+        auto person = people->get(123)->asDict();
+        alloc_slice personJSON = person->toJSON();
+
+        std::vector<const Value*> values {person, person->get("friends"_sl),
+                                          person->get("name"_sl), person->get("age"_sl),
+                                          person->get("isActive"_sl), people};
+        for (auto value : values) {
+            INFO("Value " << value->toJSONString());
+            Retained<Doc> extracted = Doc::extract(value);
+            CHECK(extracted->sharedKeys() == sk);
+            CHECK(!doc->data().containsAddress(extracted->root()));
+            CHECK(extracted->retainedBytes() == extracted->data().size);
+            CHECK(extracted->root()->toJSON() == value->toJSON());
+        }
+
+        // The extracted Doc doesn't keep the original data alive:
+        Retained<Doc> extracted = Doc::extract(person);
+        CHECK(extracted->retainedBytes() < doc->retainedBytes() / 500);
+        doc = nullptr;
+        CHECK(extracted->root()->toJSON() == personJSON);
+        CHECK(extracted->asDict()->get("name"_sl)->asString() == "Concepcion Burns"_sl);
+
+        // A Dict whose string was written long before it is re-encoded, not copied with
+        // everything in between:
+        std::string padding = "[";
+        for (int i = 0; i < 1000; ++i)
+            padding += std::to_string(i * 1000) + ",";
+        padding += "0]";
+        doc = Doc::fromJSON("{\"a\": \"this string is long enough to be shared\", \"b\": "
+                            + padding + ", \"c\": {\"s\": \"this string is long enough to be shared\"}}",
+                            sk);
+        auto c = doc->asDict()->get("c"_sl);
+        extracted = Doc::extract(c);
+        CHECK(extracted->retainedBytes() < 100);
+        CHECK(extracted->root()->toJSON() == c->toJSON());
+
+        // A string the subtree refers to many times is only counted once, so a subtree that's
+        // small but refers to one string over and over isn't copied with everything around it:
+        {
+            std::string shared = "[";
+            for (int i = 0; i < 301; ++i)
+                shared += "\"abcdefghijklmno\",";
+            shared += "\"abcdefghijklmno\"]";
+            Retained<Doc> sharedDoc = Doc::fromJSON("{\"a\": \"abcdefghijklmno\", \"b\": "
+                                                    + padding + ", \"c\": " + shared + "}");
+            auto sc = sharedDoc->asDict()->get("c"_sl);
+            Retained<Doc> sharedExtracted = Doc::extract(sc);
+            CHECK(sharedExtracted->retainedBytes() < 1000);
+            CHECK(sharedDoc->retainedBytes() > 5000);
+            CHECK(sharedExtracted->root()->toJSON() == sc->toJSON());
+        }
+
+        // Values in the base of an amended Doc, and mutable values, are re-encoded:
+        Retained<MutableDict> md = MutableDict::newDict(doc->asDict());
+        md->set("d"_sl, 17);
+        Encoder enc;
+        enc.setSharedKeys(sk);
+        enc.setBase(doc->data(), true);
+        enc.writeValue(md);
+        alloc_slice delta = enc.finish();
+        Retained<Doc> amended = new Doc(delta, Doc::kTrusted, sk, doc->data());
+        // The amended Doc only keeps its own data alive, not its base:
+        CHECK(amended->retainedBytes() == delta.size);
+        // A Doc on part of another Doc's data keeps that Doc, and its block, alive:
+        Retained<Doc> sub = new Doc(doc.get(), doc->data().upTo(8), Doc::kDontParse);
+        CHECK(sub->retainedBytes() == doc->retainedBytes());
+        extracted = Doc::extract(amended->root());
+        CHECK(extracted->root()->toJSON() == amended->root()->toJSON());
+        CHECK(!doc->data().containsAddress(extracted->asDict()->get("c"_sl)));
+        extracted = Doc::extract(md);
+        CHECK(extracted->root()->toJSON() == md->toJSON());
+    }
+
     TEST_CASE("Empty FLArrayIterator", "[API]") {
         FLDoc doc = FLDoc_FromJSON("[]"_sl, nullptr);
         FLArray arr = FLValue_AsArray(FLDoc_GetRoot(doc));
@@ -11,18 +11,25 @@ function(set_source_files_base)
         Fleece/API_Impl/FLEncoder.cc
         Fleece/API_Impl/FLSlice.cc
         Fleece/Core/Array.cc
+        Fleece/Core/ArrayKernels.cc
+        Fleece/Core/ArrowExport.cc
         Fleece/Core/Builder.cc
+        Fleece/Core/Collatable.cc
         Fleece/Core/DeepIterator.cc
         Fleece/Core/Dict.cc
         Fleece/Core/Doc.cc
         Fleece/Core/Encoder.cc
+        Fleece/Core/FleeceDelta.cc
         Fleece/Core/JSONConverter.cc
         Fleece/Core/JSONDelta.cc
         Fleece/Core/Path.cc
+        Fleece/Core/PathIndex.cc
+        Fleece/Core/PathProjection.cc
         Fleece/Core/Pointer.cc
         Fleece/Core/SharedKeys.cc
         Fleece/Core/Value+Dump.cc
         Fleece/Core/Value.cc
+        Fleece/Core/ValueSort.cc
         Fleece/Integration/MContext.cc
         Fleece/Mutable/HeapArray.cc
         Fleece/Mutable/HeapDict.cc
@@ -37,6 +44,7 @@ function(set_source_files_base)
         Fleece/Support/FileUtils.cc
         Fleece/Support/FleeceException.cc
         Fleece/Support/InstanceCounted.cc
+        Fleece/Support/MyersDiff.cc
         Fleece/Support/NumConversion.cc
         Fleece/Support/JSON5.cc
         Fleece/Support/JSONEncoder.cc
@@ -48,9 +56,14 @@ function(set_source_files_base)
         Fleece/Support/StringTable.cc
         Fleece/Support/varint.cc
         Fleece/Support/Writer.cc
-#        Fleece/Tree/HashTree.cc
-#        Fleece/Tree/MutableHashTree.cc
-#        Fleece/Tree/NodeRef.cc
+        Fleece/Tree/BTree.cc
+        Fleece/Tree/BloomFilter.cc
+        Fleece/Tree/DB.cc
+        Fleece/Tree/HashTree.cc
+        Fleece/Tree/HashTreeBuilder.cc
+        Fleece/Tree/MutableBTree.cc
+        Fleece/Tree/MutableHashTree.cc
+        Fleece/Tree/NodeRef.cc
         vendor/jsonsl/jsonsl.c
         vendor/libb64/cdecode.c
         vendor/libb64/cencode.c
@@ -69,11 +82,14 @@ function(set_test_source_files_base)
     set(
         ${BASE_SSS_RESULT}
         Tests/API_ValueTests.cc
+        Tests/ArrowTests.cc
         Tests/DeltaTests.cc
         Tests/EncoderTests.cc
         Tests/FleeceTests.cc
         Tests/BuilderTests.cc
-#       Tests/HashTreeTests.cc
+        Tests/BTreeTests.cc
+        Tests/DBTests.cc
+        Tests/HashTreeTests.cc
         Tests/JSON5Tests.cc
         Tests/MutableTests.cc
         Tests/PerfTests.cc